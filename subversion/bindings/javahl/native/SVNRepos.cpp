@@ -638,10 +638,11 @@ SVNRepos::verify(File &path, Revision &revisionStart, Revision &revisionEnd,
       (SVN_ERR_INCORRECT_PARAMS, NULL,
        _("Start revision cannot be higher than end revision")), );
 
-  SVN_JNI_ERR(svn_repos_verify_fs3(repos, lower, upper,
+  SVN_JNI_ERR(svn_repos_verify_fs4(repos, lower, upper,
                                    keepGoing,
                                    checkNormalization,
                                    metadataOnly,
+                                   1,
                                    notifyCallback != NULL
                                     ? ReposNotifyCallback::notify
                                     : NULL,
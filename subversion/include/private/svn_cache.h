@@ -115,6 +115,12 @@ typedef struct svn_memcache_t svn_memcache_t;
  */
 typedef struct svn_membuffer_t svn_membuffer_t;
 
+/**
+ * A persistent, file-backed cache storage that may be shared between
+ * processes.
+ */
+typedef struct svn_disk_cache_t svn_disk_cache_t;
+
 /**
  * Opaque type for an in-memory cache.
  */
@@ -174,6 +180,18 @@ typedef struct svn_cache__info_t
    */
   apr_uint64_t total_entries;
 
+  /** Number of getter calls that have been served without acquiring
+   * the cache's lock.  Included in @a gets.
+   * May be 0 if that information is not available.
+   */
+  apr_uint64_t lock_free_gets;
+
+  /** Number of lock-free getter attempts that were invalidated by a
+   * concurrent modification and had to be repeated under the cache lock.
+   * May be 0 if that information is not available.
+   */
+  apr_uint64_t lock_free_retries;
+
   /** Number of index buckets with the given number of entries.
    * Bucket sizes larger than the array will saturate into the
    * highest array index.
@@ -270,6 +288,67 @@ svn_cache__make_memcache_from_config(svn_memcache_t **memcache_p,
                                      apr_pool_t *result_pool,
                                      apr_pool_t *scratch_pool);
 
+/**
+ * Sets @a *cache_p to the persistent cache storage in the file at @a path,
+ * creating the file if necessary.  The file will be @a size bytes large,
+ * including about 0.6 percent of index data.  If an existing file has a
+ * different size or format, it will be reset.
+ *
+ * Storage objects are process-global and shared between all callers that
+ * open the same @a path; they stay open until the process terminates.
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_cache__open_disk_cache(svn_disk_cache_t **cache_p,
+                           const char *path,
+                           apr_uint64_t size,
+                           apr_pool_t *scratch_pool);
+
+/**
+ * Creates a new cache in @a *cache_p, storing its data in the persistent
+ * @a storage.  The elements in the cache will be indexed by keys of length
+ * @a klen, which may be APR_HASH_KEY_STRING if they are strings.  Values
+ * will be serialized using @a serialize_func and deserialized using
+ * @a deserialize_func.  Because the same storage may be shared by many
+ * different kinds of values and even different processes, @a prefix
+ * should be specified to differentiate this cache from other caches.
+ * @a *cache_p will be allocated in @a result_pool.
+ *
+ * If @a deserialize_func is NULL, then the data is returned as an
+ * svn_stringbuf_t; if @a serialize_func is NULL, then the data is
+ * assumed to be an svn_stringbuf_t.
+ *
+ * These caches are always thread safe.  Writes are best-effort and will
+ * silently be dropped while another process is writing to @a storage.
+ *
+ * These caches do not support svn_cache__iter.
+ */
+svn_error_t *
+svn_cache__create_disk_cache(svn_cache__t **cache_p,
+                             svn_disk_cache_t *storage,
+                             svn_cache__serialize_func_t serialize_func,
+                             svn_cache__deserialize_func_t deserialize_func,
+                             apr_ssize_t klen,
+                             const char *prefix,
+                             apr_pool_t *result_pool);
+
+/**
+ * Creates a two-level cache in @a *cache_p, allocated in @a result_pool.
+ * Lookups consult @a first and fall back to @a second; hits in @a second
+ * are copied into @a first.  New entries are written to both caches.
+ * Both caches must use the same key and value types.
+ *
+ * The result is thread safe if both underlying caches are.  Cache
+ * statistics are those of @a first.
+ *
+ * These caches do not support svn_cache__iter.
+ */
+svn_error_t *
+svn_cache__create_tiered_cache(svn_cache__t **cache_p,
+                               svn_cache__t *first,
+                               svn_cache__t *second,
+                               apr_pool_t *result_pool);
+
 /**
  * Creates a new membuffer cache object in @a *cache. It will contain
  * up to @a total_size bytes of data, using @a directory_size bytes
@@ -310,6 +389,28 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   svn_boolean_t allow_blocking_writes,
                                   apr_pool_t *result_pool);
 
+/**
+ * Like svn_cache__membuffer_cache_create() but place all cache data into
+ * anonymous shared memory and synchronize access through inter-process
+ * locks.  All processes forked from the current one after this call will
+ * use the same cache contents.  Within each process, the cache is also
+ * thread-safe and writes will always wait for the segment lock.
+ *
+ * The locks are robust.  If a process terminates while holding one of
+ * them, the next process to acquire it drops all contents of the
+ * respective cache segment, as they may be inconsistent.
+ *
+ * Return an #APR_ENOTIMPL error if the platform does not support
+ * anonymous shared memory or robust inter-process mutexes.  Allocate the
+ * process-local control structures in @a result_pool.
+ */
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         apr_pool_t *result_pool);
+
 /**
  * @defgroup Standard priority classes for #svn_cache__create_membuffer_cache.
  * @{
@@ -535,6 +636,18 @@ svn_cache__format_info(const svn_cache__info_t *info,
 struct svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void);
 
+/**
+ * Create the process-global (singleton) membuffer cache right away using
+ * the current cache config but place it into shared memory, such that
+ * all processes forked from this one afterwards share the cache contents.
+ * See svn_cache__membuffer_cache_create_shared() for details.
+ *
+ * Return an error if the global cache has already been created.  If the
+ * desired cache size is 0, this is a no-op.
+ */
+svn_error_t *
+svn_cache__share_global_membuffer_cache(void);
+
 /**
  * Return total access and size stats over all membuffer caches as they
  * share the underlying data buffer.  The result will be allocated in POOL.
@@ -108,6 +108,57 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
                                  apr_pool_t *pool);
 
+/** Like svn_txdelta_run() but compute up to @a thread_count windows
+ * concurrently.  The streams will still be read and @a handler will
+ * still be called from the current thread and in the order of the
+ * target data.  If @a thread_count is 1 or less, or if threads are not
+ * supported, this is equivalent to svn_txdelta_run().
+ */
+svn_error_t *
+svn_txdelta__run(svn_stream_t *source,
+                 svn_stream_t *target,
+                 svn_txdelta_window_handler_t handler,
+                 void *handler_baton,
+                 svn_checksum_kind_t checksum_kind,
+                 svn_checksum_t **checksum,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 int thread_count,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool);
+
+/** Return a writable stream that computes the delta of the data written
+ * to it against @a source and writes it as svndiff version
+ * @a svndiff_version with @a compression_level to @a output.  Closing
+ * the returned stream will close @a output.
+ *
+ * Up to @a thread_count windows get computed and encoded concurrently.
+ * The result is identical to svn_txdelta_target_push() feeding
+ * svn_txdelta_to_svndiff3(), which is what will be used if
+ * @a thread_count is 1 or less or if threads are not supported.
+ *
+ * Allocate the stream and all buffers in @a pool.
+ */
+svn_stream_t *
+svn_txdelta__target_push_svndiff(svn_stream_t *source,
+                                 svn_stream_t *output,
+                                 int svndiff_version,
+                                 int compression_level,
+                                 int thread_count,
+                                 apr_pool_t *pool);
+
+/** Return the svndiff version 0 encoding of a window that inserts
+ * @a len bytes of new data, up to but not including that data.  I.e.
+ * the result followed by those @a len bytes forms a complete window.
+ * If @a stream_header is TRUE, prefix it with the svndiff stream header.
+ *
+ * Allocate the result in @a pool.
+ */
+svn_string_t *
+svn_txdelta__insertion_window_header(apr_size_t len,
+                                     svn_boolean_t stream_header,
+                                     apr_pool_t *pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
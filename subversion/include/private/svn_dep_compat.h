@@ -46,6 +46,21 @@ extern "C" {
 #error int is shorter than 32 bits and may break Subversion. Define SVN_ALLOW_SHORT_INTS to skip this check.
 #endif
 
+/**
+ * Indicate whether SSE2 intrinsics (<emmintrin.h>) are available.  SSE2
+ * is part of the x64 baseline and enabled by default for 32 bit x86 by
+ * all current compilers, so there is no need for a runtime check.
+ * Define SVN__HAVE_SSE2 as 0 to force the portable code paths.
+ */
+#ifndef SVN__HAVE_SSE2
+# if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) \
+     || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SVN__HAVE_SSE2 1
+# else
+#  define SVN__HAVE_SSE2 0
+# endif
+#endif
+
 /**
  * We assume that 'char' is 8 bits wide.  The critical interfaces are
  * our repository formats and RA encodings.  E.g. a 32 bit wide char may
@@ -100,6 +100,21 @@ typedef struct svn_fs_fs__histogram_t
   svn_fs_fs__histogram_line_t lines[64];
 } svn_fs_fs__histogram_t;
 
+/* Location and length of a delta chain.
+ */
+typedef struct svn_fs_fs__chain_info_t
+{
+  /* revision containing the representation at the tip of the chain */
+  svn_revnum_t revision;
+
+  /* item index (offset in physical addressing mode) of that rep */
+  apr_uint64_t item_index;
+
+  /* number of representations that need to be combined to reconstruct
+   * the contents, including the tip itself */
+  apr_uint64_t length;
+} svn_fs_fs__chain_info_t;
+
 /* Information we collect per file ending.
  */
 typedef struct svn_fs_fs__extension_info_t
@@ -248,6 +263,13 @@ typedef struct svn_fs_fs__stats_t
   /* histogram of sizes of directories property representations */
   svn_fs_fs__histogram_t dir_prop_rep_histogram;
 
+  /* histogram of delta chain lengths of all used representations */
+  svn_fs_fs__histogram_t chain_length_histogram;
+
+  /* the longest delta chains, longest first.
+   * Array of svn_fs_fs__chain_info_t*. */
+  apr_array_header_t *longest_chains;
+
   /* extension -> svn_fs_fs__extension_info_t* map */
   apr_hash_t *by_extension;
 } svn_fs_fs__stats_t;
@@ -196,6 +196,31 @@ svn_fs__get_mergeinfo_for_path(svn_mergeinfo_t *mergeinfo,
                                apr_pool_t *scratch_pool);
 
 
+/** Find out where the contents of the file @a path in the revision root
+ * @a root are stored, so they can be copied without being reconstructed.
+ *
+ * If the contents are available as a single contiguous block of
+ * @a *length bytes starting at @a *offset in @a *file, and that block
+ * is either the plain fulltext or an svndiff stream against the empty
+ * source, set those accordingly.  Set @a *svndiff_version to the svndiff
+ * version of that stream or to -1 for a fulltext.  Otherwise, or if the
+ * back-end does not support this, set @a *file to NULL.
+ *
+ * The file remains open until @a result_pool gets cleaned up.  Callers
+ * must not rely on its current position.  Use @a scratch_pool for
+ * temporary allocations.
+ */
+svn_error_t *
+svn_fs__get_file_storage(apr_file_t **file,
+                         apr_off_t *offset,
+                         svn_filesize_t *length,
+                         int *svndiff_version,
+                         svn_fs_root_t *root,
+                         const char *path,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool);
+
+
 /** @} */
 
 
@@ -84,6 +84,18 @@ svn_error_t *
 svn_io__file_lock_autocreate(const char *lock_file,
                              apr_pool_t *pool);
 
+/**
+ * Create @a to_path as a hard link to the existing file @a from_path.
+ *
+ * Fail if @a to_path already exists, if both are on different devices
+ * or if the platform or file system does not support hard links.
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__file_link(const char *from_path,
+                  const char *to_path,
+                  apr_pool_t *scratch_pool);
+
 
 /** Buffer test handler function for a generic stream. @see svn_stream_t
  * and svn_stream__is_buffered().
@@ -85,6 +85,16 @@ svn_log__get_file(const char *path, svn_revnum_t rev,
                   svn_boolean_t want_contents, svn_boolean_t want_props,
                   apr_pool_t *pool);
 
+/**
+ * Return a log string for a get-files action.  @a paths is an array of
+ * <tt>const char *</tt>.
+ *
+ * @since New in 1.10.
+ */
+const char *
+svn_log__get_files(const apr_array_header_t *paths,
+                   apr_pool_t *pool);
+
 /**
  * Return a log string for a get-dir action.
  *
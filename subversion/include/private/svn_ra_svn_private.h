@@ -29,6 +29,7 @@
 
 #include "svn_ra_svn.h"
 #include "svn_editor.h"
+#include "private/svn_subr_private.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -48,6 +49,163 @@ svn_ra_svn__set_shim_callbacks(svn_ra_svn_conn_t *conn,
 apr_pool_t *
 svn_ra_svn__get_pool(svn_ra_svn_conn_t *conn);
 
+/**
+ * Compression methods for the svndiff data sent over an ra_svn connection.
+ */
+typedef enum svn_ra_svn__compression_t
+{
+  /** Send uncompressed svndiff0 data. */
+  svn_ra_svn__compression_none,
+
+  /** Send zlib-compressed svndiff1 data, if the peer accepts it. */
+  svn_ra_svn__compression_zlib,
+
+  /** Send LZ4-compressed svndiff2 data, if the peer accepts it,
+   * falling back to svndiff1 otherwise. */
+  svn_ra_svn__compression_lz4
+} svn_ra_svn__compression_t;
+
+/**
+ * Parse the compression configuration @a value, which may be "none",
+ * "lz4", "zlib" or "zlib-N" with N being the zlib compression level
+ * from 1 to 9, into @a *method and @a *level.
+ */
+svn_error_t *
+svn_ra_svn__parse_compression(svn_ra_svn__compression_t *method,
+                              int *level,
+                              const char *value);
+
+/**
+ * Make @a conn use the compression @a method from now on.  @a level is
+ * the zlib compression level to use with svndiff1 and will be ignored
+ * if @a method is #svn_ra_svn__compression_none.
+ */
+void
+svn_ra_svn__set_compression(svn_ra_svn_conn_t *conn,
+                            svn_ra_svn__compression_t method,
+                            int level);
+
+/**
+ * Callback type used with svn_ra_svn__set_command_observer().  It gets
+ * invoked after the command @a cmdname has been executed, which took
+ * @a duration microseconds.  @a failed indicates whether the command
+ * returned an error.  @a bytes_received and @a bytes_sent is the network
+ * traffic caused by the command.
+ */
+typedef void
+(*svn_ra_svn__command_observer_t)(void *baton,
+                                  const char *cmdname,
+                                  apr_interval_time_t duration,
+                                  svn_boolean_t failed,
+                                  apr_uint64_t bytes_received,
+                                  apr_uint64_t bytes_sent);
+
+/**
+ * Make svn_ra_svn__handle_command() call @a observer with @a baton for
+ * every known command it executes on @a conn.  Commands that get executed
+ * while handling another command, e.g. during an edit drive, are
+ * accounted to the outer command.  Set @a observer to NULL to disable
+ * this.
+ */
+void
+svn_ra_svn__set_command_observer(svn_ra_svn_conn_t *conn,
+                                 svn_ra_svn__command_observer_t observer,
+                                 void *baton);
+
+/**
+ * Return the svndiff version to use when sending data over @a conn,
+ * given its compression method and the capabilities of the peer.
+ */
+int
+svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn);
+
+/**
+ * Return a session ticket that allows @a user to authenticate to
+ * @a realm, with the password @a password, until @a expiry.  The ticket
+ * is signed with the server-private @a secret.  Allocate the result in
+ * @a pool.
+ */
+const char *
+svn_ra_svn__session_ticket_create(const char *secret,
+                                  const char *user,
+                                  const char *realm,
+                                  const char *password,
+                                  apr_time_t expiry,
+                                  apr_pool_t *pool);
+
+/**
+ * Authenticate the client on @a conn, which chose the TICKET mechanism
+ * with the initial response @a expiry_str.  Challenge the client to prove
+ * that it knows a ticket created by svn_ra_svn__session_ticket_create()
+ * for @a secret, @a realm, that expiry time and the user name and
+ * password listed in @a pwdb.  Reject tickets that expired before
+ * @a now.  Set @a *user to the user name the client sent and @a *success
+ * to whether the client authenticated.  Report failure to the client.
+ * Use @a pool for allocations.
+ *
+ * The ticket itself is only sent once, in the response to the
+ * get-session-ticket command.
+ */
+svn_error_t *
+svn_ra_svn__session_ticket_server(svn_ra_svn_conn_t *conn,
+                                  apr_pool_t *pool,
+                                  const char *expiry_str,
+                                  const char *secret,
+                                  const char *realm,
+                                  svn_config_t *pwdb,
+                                  apr_time_t now,
+                                  const char **user,
+                                  svn_boolean_t *success);
+
+/**
+ * Authenticate to the server on @a conn as @a user, using the session
+ * @a ticket and the TICKET mechanism.  Set @a *message to NULL on
+ * success or to the reason for failure otherwise.  In the latter case,
+ * the server expects another auth response.  Use @a pool for
+ * allocations.
+ */
+svn_error_t *
+svn_ra_svn__session_ticket_client(svn_ra_svn_conn_t *conn,
+                                  apr_pool_t *pool,
+                                  const char *user,
+                                  const char *ticket,
+                                  const char **message);
+
+/**
+ * Callback type used with svn_ra_svn__get_editor() to find out where the
+ * contents of the file at the edit path @a path in @a revision are stored.
+ * See svn_fs__get_file_storage() for the meaning of the output parameters.
+ * Set @a *file to @c NULL if the contents cannot be sent from storage.
+ * Allocate the results in @a pool.
+ */
+typedef svn_error_t *(*svn_ra_svn__file_storage_func_t)(
+  apr_file_t **file,
+  apr_off_t *offset,
+  svn_filesize_t *length,
+  int *svndiff_version,
+  void *baton,
+  const char *path,
+  svn_revnum_t revision,
+  apr_pool_t *pool);
+
+/**
+ * Like svn_ra_svn_get_editor() but, if @a storage_func is not @c NULL,
+ * the returned editor uses it with @a storage_baton whenever a text delta
+ * against the empty source is requested.  If the stored data can be used
+ * on @a conn as is, the editor sends it straight from storage, e.g. with
+ * sendfile(), and returns svn_delta_noop_window_handler() as the window
+ * handler.  Otherwise, it behaves just like svn_ra_svn_get_editor().
+ */
+void
+svn_ra_svn__get_editor(const svn_delta_editor_t **editor,
+                       void **edit_baton,
+                       svn_ra_svn_conn_t *conn,
+                       apr_pool_t *pool,
+                       svn_ra_svn_edit_callback callback,
+                       void *callback_baton,
+                       svn_ra_svn__file_storage_func_t storage_func,
+                       void *storage_baton);
+
 /**
  * @defgroup ra_svn_deprecated ra_svn low-level functions
  * @{
@@ -127,6 +285,27 @@ svn_error_t *
 svn_ra_svn__flush(svn_ra_svn_conn_t *conn,
                   apr_pool_t *pool);
 
+/** Return a new connection object, allocated in @a result_pool, that
+ * appends all data written to it to @a buffer instead of sending it.
+ * It uses the capabilities and compression settings of @a conn, so the
+ * contents of @a buffer may later be sent over @a conn verbatim using
+ * svn_ra_svn__write_spillbuf().  The new connection cannot receive any
+ * data, so nothing that expects a response may be written to it.  Call
+ * svn_ra_svn__flush() on it before using the contents of @a buffer.
+ */
+svn_ra_svn_conn_t *
+svn_ra_svn__create_spill_conn(svn_ra_svn_conn_t *conn,
+                              svn_spillbuf_t *buffer,
+                              apr_pool_t *result_pool);
+
+/** Write the whole contents of @a buffer to @a conn verbatim, draining
+ * @a buffer in the process.  Use @a pool for temporary allocations.
+ */
+svn_error_t *
+svn_ra_svn__write_spillbuf(svn_ra_svn_conn_t *conn,
+                           svn_spillbuf_t *buffer,
+                           apr_pool_t *pool);
+
 /** Write a tuple, using a printf-like interface.
  *
  * The format string @a fmt may contain:
@@ -268,6 +447,18 @@ svn_ra_svn__has_command(svn_boolean_t *has_command,
                         svn_ra_svn_conn_t *conn,
                         apr_pool_t *pool);
 
+/** Like svn_ra_svn__has_command() but set @a *has_command only if the
+ * receive buffer of @a conn contains a complete command, reading from the
+ * socket as far as that is possible without blocking.  Commands too large
+ * for the receive buffer count as complete once the buffer is full.
+ * Pending output in @a conn will be flushed.
+ */
+svn_error_t *
+svn_ra_svn__has_complete_command(svn_boolean_t *has_command,
+                                 svn_boolean_t *terminated,
+                                 svn_ra_svn_conn_t *conn,
+                                 apr_pool_t *pool);
+
 /** Accept a single command from @a conn and handle them according
  * to @a cmd_hash.  Command handlers will be passed @a conn, @a pool,
  * the parameters of the command, and @a baton.  @a *terminate will be
@@ -499,6 +690,21 @@ svn_ra_svn__write_cmd_textdelta_chunk(svn_ra_svn_conn_t *conn,
                                       const char *token,
                                       const svn_string_t *chunk);
 
+/** Like svn_ra_svn__write_cmd_textdelta_chunk() but the chunk consists
+ * of @a prefix, which may be @c NULL, followed by @a len bytes read from
+ * @a file starting at @a offset.  The latter don't pass through the
+ * write buffer and will be sent using sendfile() where possible.
+ * Use @a pool for allocations.
+ */
+svn_error_t *
+svn_ra_svn__write_cmd_textdelta_chunk_from_file(svn_ra_svn_conn_t *conn,
+                                                apr_pool_t *pool,
+                                                const char *token,
+                                                const svn_string_t *prefix,
+                                                apr_file_t *file,
+                                                apr_off_t offset,
+                                                apr_size_t len);
+
 /** Send a "textdelta-end" command over connection @a conn.  Ends the
  * series of text deltas to be applied to the file identified by @a token.
  * Use @a pool for allocations.
@@ -862,6 +1068,13 @@ svn_ra_svn__write_cmd_get_iprops(svn_ra_svn_conn_t *conn,
                                  const char *path,
                                  svn_revnum_t revision);
 
+/** Send a "get-session-ticket" command over connection @a conn.
+ * Use @a pool for allocations.
+ */
+svn_error_t *
+svn_ra_svn__write_cmd_get_session_ticket(svn_ra_svn_conn_t *conn,
+                                         apr_pool_t *pool);
+
 /** Send a "finish-replay" command over connection @a conn.
  * Use @a pool for allocations.
  */
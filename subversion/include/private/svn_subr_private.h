@@ -554,6 +554,22 @@ svn__decompress(svn_stringbuf_t *in,
                 svn_stringbuf_t *out,
                 apr_size_t limit);
 
+/* Get the data from IN, compress it using LZ4 and write the result to
+ * OUT.  Like svn__compress(), the original size is prepended and the data
+ * will be stored uncompressed if compression does not make it smaller.
+ */
+svn_error_t *
+svn__compress_lz4(svn_stringbuf_t *in,
+                  svn_stringbuf_t *out);
+
+/* Get the LZ4 compressed data from IN, decompress it and write the result
+ * to OUT.  Return an error if the decompressed size is larger than LIMIT.
+ */
+svn_error_t *
+svn__decompress_lz4(svn_stringbuf_t *in,
+                    svn_stringbuf_t *out,
+                    apr_size_t limit);
+
 /** @} */
 
 /**
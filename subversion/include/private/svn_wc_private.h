@@ -988,7 +988,10 @@ svn_wc__node_get_md5_from_sha1(const svn_checksum_t **md5_checksum,
 /* Like svn_wc_get_pristine_contents2(), but keyed on the CHECKSUM
    rather than on the local absolute path of the working file.
    WRI_ABSPATH is any versioned path of the working copy in whose
-   pristine database we'll be looking for these contents.  */
+   pristine database we'll be looking for these contents.  If that working
+   copy doesn't have them, look in the pristine store shared between
+   working copies, if one is configured.  Texts from that store are only
+   used if they match CHECKSUM.  */
 svn_error_t *
 svn_wc__get_pristine_contents_by_checksum(svn_stream_t **contents,
                                           svn_wc_context_t *wc_ctx,
@@ -1847,6 +1850,26 @@ svn_wc__diff7(const char **root_relpath,
               apr_pool_t *result_pool,
               apr_pool_t *scratch_pool);
 
+/* Watch the working copy containing LOCAL_ABSPATH for changes until
+ * CANCEL_FUNC returns an error, which is then returned.
+ *
+ * While this runs, it maintains a change journal in the working copy's
+ * administrative area that allows svn_wc_walk_status() to reuse what it
+ * found during earlier runs for all directories that have not changed
+ * since.  Only one watcher may run per working copy.
+ *
+ * Return SVN_ERR_UNSUPPORTED_FEATURE if this platform does not provide
+ * change notifications.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_wc__journal_watch(svn_wc_context_t *wc_ctx,
+                      const char *local_abspath,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -508,6 +508,11 @@ svn_txdelta_apply(svn_stream_t *source,
  * version is @a svndiff_version. @a compression_level is the zlib
  * compression level from 0 (no compression) and 9 (maximum compression).
  *
+ * Version 0 stores the data uncompressed, version 1 compresses it with
+ * zlib and version 2 uses the much faster LZ4 algorithm instead.  For
+ * the latter, @a compression_level will be ignored.  Version 2 has been
+ * introduced in Subversion 1.10.
+ *
  * @since New in 1.7.
  */
 void
@@ -1075,6 +1075,58 @@ svn_ra_get_file(svn_ra_session_t *session,
                 apr_hash_t **props,
                 apr_pool_t *pool);
 
+/**
+ * Callback type to be used with svn_ra_get_files().  It will be invoked
+ * once for every file, before the file's contents are being transmitted.
+ *
+ * @a path is the file's path as given to svn_ra_get_files() and
+ * @a revision is the revision that was actually retrieved.  @a props
+ * contains @em all properties of the file, just like svn_ra_get_file()
+ * would return them.
+ *
+ * Set @a *stream to the stream that shall receive the file contents or
+ * to @c NULL to discard them.  The RA layer will not close @a *stream.
+ *
+ * The callback and the stream handlers may not perform any RA operations
+ * using the session that svn_ra_get_files() was called on.  @a pool
+ * remains valid until the file contents have been written to @a *stream.
+ *
+ * @since New in 1.10.
+ */
+typedef svn_error_t *(*svn_ra_file_receiver_t)(void *baton,
+                                               const char *path,
+                                               svn_revnum_t revision,
+                                               apr_hash_t *props,
+                                               svn_stream_t **stream,
+                                               apr_pool_t *pool);
+
+/**
+ * Fetch the contents and properties of multiple files in a single
+ * request where the RA layer supports that.
+ *
+ * @a path_revs is a hash whose keys are the file paths (<tt>const char
+ * *</tt>), relative to the URL in @a session, and whose values are the
+ * revisions (<tt>svn_revnum_t *</tt>) to fetch them in.  A revision of
+ * @c SVN_INVALID_REVNUM indicates that the HEAD revision should be used.
+ *
+ * Call @a receiver with @a receiver_baton for each file, in no particular
+ * order.  If a file cannot be retrieved, return an error; @a receiver may
+ * or may not have been called for some of the other files at that point.
+ *
+ * RA layers and servers that have no native support for this, will be
+ * served by fetching the files one by one.
+ *
+ * Use @a pool for temporary allocations.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_ra_get_files(svn_ra_session_t *session,
+                 apr_hash_t *path_revs,
+                 svn_ra_file_receiver_t receiver,
+                 void *receiver_baton,
+                 apr_pool_t *pool);
+
 /**
  * If @a dirents is non @c NULL, set @a *dirents to contain all the entries
  * of directory @a path at @a revision.  The keys of @a dirents will be
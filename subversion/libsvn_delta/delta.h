@@ -88,6 +88,20 @@ void svn_txdelta__xdelta(svn_txdelta__ops_baton_t *build_baton,
                          apr_size_t target_len,
                          apr_pool_t *pool);
 
+/* Encode WINDOW as svndiff version VERSION, using COMPRESSION_LEVEL where
+   applicable.  Return the window header, the (possibly compressed)
+   instructions and new data sections in *HEADER_P, *INSTRUCTIONS_P and
+   *NEW_DATA_P, respectively.  The svndiff stream header is not included.
+   Allocate the results in POOL. */
+svn_error_t *
+svn_txdelta__encode_window(svn_stringbuf_t **header_p,
+                           svn_stringbuf_t **instructions_p,
+                           const svn_string_t **new_data_p,
+                           const svn_txdelta_window_t *window,
+                           int version,
+                           int compression_level,
+                           apr_pool_t *pool);
+
 
 #ifdef __cplusplus
 }
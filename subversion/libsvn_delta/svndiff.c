@@ -135,56 +135,70 @@ send_simple_insertion_window(svn_txdelta_window_t *window,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t *
-window_handler(svn_txdelta_window_t *window, void *baton)
+svn_string_t *
+svn_txdelta__insertion_window_header(apr_size_t len,
+                                     svn_boolean_t stream_header,
+                                     apr_pool_t *pool)
 {
-  struct encoder_baton *eb = baton;
-  apr_pool_t *pool;
-  svn_stringbuf_t *instructions;
-  svn_stringbuf_t *i1;
-  svn_stringbuf_t *header;
-  const svn_string_t *newdata;
-  unsigned char ibuf[MAX_INSTRUCTION_LEN], *ip;
-  const svn_txdelta_op_t *op;
-  apr_size_t len;
-
-  /* use specialized code if there is no source */
-  if (window && !window->src_ops && window->num_ops == 1 && !eb->version)
-    return svn_error_trace(send_simple_insertion_window(window, eb));
+  unsigned char headers[4 + 5 * SVN__MAX_ENCODED_UINT_LEN
+                          + MAX_INSTRUCTION_LEN];
+  unsigned char *header_current = headers;
+  unsigned char ibuf[MAX_INSTRUCTION_LEN];
+  apr_size_t ip_len, i;
 
-  /* Make sure we write the header.  */
-  if (!eb->header_done)
+  if (stream_header)
     {
-      char svnver[4] = {'S','V','N','\0'};
-      len = 4;
-      svnver[3] = (char)eb->version;
-      SVN_ERR(svn_stream_write(eb->output, svnver, &len));
-      eb->header_done = TRUE;
+      header_current[0] = 'S';
+      header_current[1] = 'V';
+      header_current[2] = 'N';
+      header_current[3] = 0;
+      header_current += 4;
     }
 
-  if (window == NULL)
+  /* Encode the action code and length, just like
+   * send_simple_insertion_window() does. */
+  if (len >> 6 == 0)
     {
-      svn_stream_t *output = eb->output;
+      ibuf[0] = (unsigned char)(len + (0x2 << 6));
+      ip_len = 1;
+    }
+  else
+    {
+      ibuf[0] = (0x2 << 6);
+      ip_len = svn__encode_uint(ibuf + 1, len) - ibuf;
+    }
 
-      /* We're done; clean up.
+  /* empty source view, LEN bytes of target view, all of it new data */
+  header_current = svn__encode_uint(header_current, 0);
+  header_current = svn__encode_uint(header_current, 0);
+  header_current = svn__encode_uint(header_current, len);
+  header_current[0] = (unsigned char)ip_len;  /* 1 instruction */
+  header_current = svn__encode_uint(&header_current[1], len);
 
-         We clean our pool first. Given that the output stream was passed
-         TO us, we'll assume it has a longer lifetime, and that it will not
-         be affected by our pool destruction.
+  for (i = 0; i < ip_len; ++i)
+    *header_current++ = ibuf[i];
 
-         The contrary point of view (close the stream first): that could
-         tell our user that everything related to the output stream is done,
-         and a cleanup of the user pool should occur. However, that user
-         pool could include the subpool we created for our work (eb->pool),
-         which would then make our call to svn_pool_destroy() puke.
-       */
-      svn_pool_destroy(eb->pool);
+  return svn_string_ncreate((const char *)headers, header_current - headers,
+                            pool);
+}
 
-      return svn_stream_close(output);
-    }
+svn_error_t *
+svn_txdelta__encode_window(svn_stringbuf_t **header_p,
+                           svn_stringbuf_t **instructions_p,
+                           const svn_string_t **new_data_p,
+                           const svn_txdelta_window_t *window,
+                           int version,
+                           int compression_level,
+                           apr_pool_t *pool)
+{
+  svn_stringbuf_t *instructions;
+  svn_stringbuf_t *i1;
+  svn_stringbuf_t *header;
+  const svn_string_t *newdata;
+  unsigned char ibuf[MAX_INSTRUCTION_LEN], *ip;
+  const svn_txdelta_op_t *op;
 
   /* create the necessary data buffers */
-  pool = svn_pool_create(eb->pool);
   instructions = svn_stringbuf_create_empty(pool);
   i1 = svn_stringbuf_create_empty(pool);
   header = svn_stringbuf_create_empty(pool);
@@ -213,13 +227,18 @@ window_handler(svn_txdelta_window_t *window, void *baton)
   append_encoded_int(header, window->sview_offset);
   append_encoded_int(header, window->sview_len);
   append_encoded_int(header, window->tview_len);
-  if (eb->version == 1)
+  if (version == 1)
+    {
+      SVN_ERR(svn__compress(instructions, i1, compression_level));
+      instructions = i1;
+    }
+  else if (version == 2)
     {
-      SVN_ERR(svn__compress(instructions, i1, eb->compression_level));
+      SVN_ERR(svn__compress_lz4(instructions, i1));
       instructions = i1;
     }
   append_encoded_int(header, instructions->len);
-  if (eb->version == 1)
+  if (version == 1 || version == 2)
     {
       svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *original = svn_stringbuf_create_empty(pool);
@@ -227,7 +246,11 @@ window_handler(svn_txdelta_window_t *window, void *baton)
       original->len = window->new_data->len;
       original->blocksize = window->new_data->len + 1;
 
-      SVN_ERR(svn__compress(original, compressed, eb->compression_level));
+      if (version == 1)
+        SVN_ERR(svn__compress(original, compressed, compression_level));
+      else
+        SVN_ERR(svn__compress_lz4(original, compressed));
+
       newdata = svn_stringbuf__morph_into_string(compressed);
     }
   else
@@ -235,6 +258,63 @@ window_handler(svn_txdelta_window_t *window, void *baton)
 
   append_encoded_int(header, newdata->len);
 
+  *header_p = header;
+  *instructions_p = instructions;
+  *new_data_p = newdata;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+window_handler(svn_txdelta_window_t *window, void *baton)
+{
+  struct encoder_baton *eb = baton;
+  apr_pool_t *pool;
+  svn_stringbuf_t *instructions;
+  svn_stringbuf_t *header;
+  const svn_string_t *newdata;
+  apr_size_t len;
+
+  /* use specialized code if there is no source */
+  if (window && !window->src_ops && window->num_ops == 1 && !eb->version)
+    return svn_error_trace(send_simple_insertion_window(window, eb));
+
+  /* Make sure we write the header.  */
+  if (!eb->header_done)
+    {
+      char svnver[4] = {'S','V','N','\0'};
+      len = 4;
+      svnver[3] = (char)eb->version;
+      SVN_ERR(svn_stream_write(eb->output, svnver, &len));
+      eb->header_done = TRUE;
+    }
+
+  if (window == NULL)
+    {
+      svn_stream_t *output = eb->output;
+
+      /* We're done; clean up.
+
+         We clean our pool first. Given that the output stream was passed
+         TO us, we'll assume it has a longer lifetime, and that it will not
+         be affected by our pool destruction.
+
+         The contrary point of view (close the stream first): that could
+         tell our user that everything related to the output stream is done,
+         and a cleanup of the user pool should occur. However, that user
+         pool could include the subpool we created for our work (eb->pool),
+         which would then make our call to svn_pool_destroy() puke.
+       */
+      svn_pool_destroy(eb->pool);
+
+      return svn_stream_close(output);
+    }
+
+  pool = svn_pool_create(eb->pool);
+  SVN_ERR(svn_txdelta__encode_window(&header, &instructions, &newdata,
+                                     window, eb->version,
+                                     eb->compression_level, pool));
+
   /* Write out the window.  */
   len = header->len;
   SVN_ERR(svn_stream_write(eb->output, header->data, &len));
@@ -483,9 +563,12 @@ count_and_verify_instructions(int *ninst,
   return SVN_NO_ERROR;
 }
 
+/* Decompress the INLEN bytes at IN into OUT using the secondary
+   compression scheme of svndiff VERSION, i.e. zlib for svndiff1 and LZ4
+   for svndiff2.  Return an error if the result exceeds LIMIT bytes. */
 static svn_error_t *
-zlib_decode(const unsigned char *in, apr_size_t inLen, svn_stringbuf_t *out,
-            apr_size_t limit)
+decompress(const unsigned char *in, apr_size_t inLen, svn_stringbuf_t *out,
+           apr_size_t limit, unsigned int version)
 {
   /* construct a fake string buffer as parameter to svn__decompress.
      This is fine as that function never writes to it. */
@@ -495,6 +578,9 @@ zlib_decode(const unsigned char *in, apr_size_t inLen, svn_stringbuf_t *out,
   compressed.len = inLen;
   compressed.blocksize = inLen + 1;
 
+  if (version == 2)
+    return svn__decompress_lz4(&compressed, out, limit);
+
   return svn__decompress(&compressed, out, limit);
 }
 
@@ -521,15 +607,15 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   insend = data + inslen;
 
-  if (version == 1)
+  if (version == 1 || version == 2)
     {
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
-      SVN_ERR(zlib_decode(insend, newlen, ndout,
-                          SVN_DELTA_WINDOW_SIZE));
-      SVN_ERR(zlib_decode(data, insend - data, instout,
-                          MAX_INSTRUCTION_SECTION_LEN));
+      SVN_ERR(decompress(insend, newlen, ndout,
+                         SVN_DELTA_WINDOW_SIZE, version));
+      SVN_ERR(decompress(data, insend - data, instout,
+                         MAX_INSTRUCTION_SECTION_LEN, version));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -580,6 +666,7 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
 static const char SVNDIFF_V0[] = { 'S', 'V', 'N', 0 };
 static const char SVNDIFF_V1[] = { 'S', 'V', 'N', 1 };
+static const char SVNDIFF_V2[] = { 'S', 'V', 'N', 2 };
 #define SVNDIFF_HEADER_SIZE (sizeof(SVNDIFF_V0))
 
 static svn_error_t *
@@ -603,6 +690,8 @@ write_handler(void *baton,
         db->version = 0;
       else if (memcmp(buffer, SVNDIFF_V1 + db->header_bytes, nheader) == 0)
         db->version = 1;
+      else if (memcmp(buffer, SVNDIFF_V2 + db->header_bytes, nheader) == 0)
+        db->version = 2;
       else
         return svn_error_create(SVN_ERR_SVNDIFF_INVALID_HEADER, NULL,
                                 _("Svndiff has invalid header"));
@@ -657,7 +746,7 @@ write_handler(void *baton,
 
       if (tview_len > SVN_DELTA_WINDOW_SIZE ||
           sview_len > SVN_DELTA_WINDOW_SIZE ||
-          /* for svndiff1, newlen includes the original length */
+          /* for svndiff1/2, newlen includes the original length */
           newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
           inslen > MAX_INSTRUCTION_SECTION_LEN)
         return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
@@ -846,7 +935,7 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
 
   if (*tview_len > SVN_DELTA_WINDOW_SIZE ||
       *sview_len > SVN_DELTA_WINDOW_SIZE ||
-      /* for svndiff1, newlen includes the original length */
+      /* for svndiff1/2, newlen includes the original length */
       *newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
       *inslen > MAX_INSTRUCTION_SECTION_LEN)
     return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
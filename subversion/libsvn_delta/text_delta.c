@@ -27,11 +27,17 @@
 
 #include <apr_general.h>        /* for APR_INLINE */
 #include <apr_md5.h>            /* for, um...MD5 stuff */
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
 
 #include "svn_delta.h"
 #include "svn_io.h"
 #include "svn_pools.h"
 #include "svn_checksum.h"
+#include "svn_private_config.h"
+
+#include "private/svn_delta_private.h"
 
 #include "delta.h"
 
@@ -603,6 +609,652 @@ svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
 }
 
 
+/* Functions for computing delta windows on multiple threads. */
+
+#if APR_HAS_THREADS
+
+/* Number of windows per worker thread that may be in flight at any given
+ * time.  Each of them holds 2 * SVN_DELTA_WINDOW_SIZE bytes of input. */
+#define WINDOWS_PER_THREAD 2
+
+/* Life cycle of a delta_job_t. */
+typedef enum job_state_t
+{
+  job_free,
+  job_queued,
+  job_busy,
+  job_done
+} job_state_t;
+
+/* A single delta window to compute and, optionally, encode. */
+typedef struct delta_job_t
+{
+  /* Source data followed by target data. */
+  char *buf;
+  apr_size_t source_len;
+  apr_size_t target_len;
+  svn_filesize_t source_offset;
+
+  /* Where this job is in its life cycle. */
+  job_state_t state;
+
+  /* Root pool for the results.  Only ever used by the thread that
+   * currently owns the job. */
+  apr_pool_t *pool;
+
+  /* The delta window. */
+  svn_txdelta_window_t *window;
+
+  /* If the pipeline encodes svndiff, the encoded sections of WINDOW. */
+  svn_stringbuf_t *header;
+  svn_stringbuf_t *instructions;
+  const svn_string_t *new_data;
+
+  /* Error returned while encoding. */
+  svn_error_t *err;
+} delta_job_t;
+
+/* A pool of worker threads and a ring buffer of windows for them to
+ * compute.  Windows get queued and picked up in target order. */
+typedef struct delta_pipeline_t
+{
+  /* The ring buffer of JOB_COUNT jobs.  The FILLED jobs starting at index
+   * FIRST have been queued.  The one after them may currently be filled
+   * with input data. */
+  delta_job_t *jobs;
+  int job_count;
+  int first;
+  int filled;
+
+  /* If not negative, encode the windows in this svndiff version. */
+  int svndiff_version;
+  int compression_level;
+
+  /* Start at most MAX_THREADS workers.  THREAD_COUNT of them are running. */
+  int max_threads;
+  int thread_count;
+  apr_thread_t **threads;
+
+  /* Serializes access to the job states, FIRST, FILLED and STOP once
+   * workers are running. */
+  apr_thread_mutex_t *mutex;
+
+  /* Signaled whenever a job has been queued or completed. */
+  apr_thread_cond_t *changed;
+
+  /* If set, workers shall terminate. */
+  svn_boolean_t stop;
+
+  /* Allocates the pipeline, the input buffers and the threads. */
+  apr_pool_t *pool;
+} delta_pipeline_t;
+
+/* Compute the window for JOB in PIPELINE and encode it, if requested.
+ * JOB must be owned by the current thread. */
+static void
+process_job(delta_pipeline_t *pipeline,
+            delta_job_t *job)
+{
+  job->window = compute_window(job->buf, job->source_len, job->target_len,
+                               job->source_offset, job->pool);
+
+  if (pipeline->svndiff_version >= 0)
+    job->err = svn_txdelta__encode_window(&job->header, &job->instructions,
+                                          &job->new_data, job->window,
+                                          pipeline->svndiff_version,
+                                          pipeline->compression_level,
+                                          job->pool);
+}
+
+/* Thread function for workers of the delta_pipeline_t given as DATA.
+ * Process queued jobs in order until the pipeline gets stopped. */
+static void * APR_THREAD_FUNC
+pipeline_worker_thread(apr_thread_t *thread,
+                       void *data)
+{
+  delta_pipeline_t *pipeline = data;
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  while (!pipeline->stop)
+    {
+      delta_job_t *job = NULL;
+      int i;
+
+      for (i = 0; i < pipeline->filled; ++i)
+        {
+          delta_job_t *candidate
+            = &pipeline->jobs[(pipeline->first + i) % pipeline->job_count];
+          if (candidate->state == job_queued)
+            {
+              job = candidate;
+              break;
+            }
+        }
+
+      if (job == NULL)
+        {
+          apr_thread_cond_wait(pipeline->changed, pipeline->mutex);
+          continue;
+        }
+
+      /* JOB is ours until we mark it as "done". */
+      job->state = job_busy;
+      apr_thread_mutex_unlock(pipeline->mutex);
+
+      process_job(pipeline, job);
+
+      apr_thread_mutex_lock(pipeline->mutex);
+      job->state = job_done;
+      apr_thread_cond_broadcast(pipeline->changed);
+    }
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  /* Don't call apr_thread_exit() here.  It would destroy the thread's
+   * pool, which is a sub-pool of PIPELINE->POOL. */
+  return NULL;
+}
+
+/* Start the worker threads for PIPELINE.  If that fails, stop those that
+ * have already been started and return the error. */
+static svn_error_t *
+start_pipeline_workers(delta_pipeline_t *pipeline)
+{
+  apr_status_t status = APR_SUCCESS;
+
+  pipeline->threads = apr_pcalloc(pipeline->pool,
+                                  pipeline->max_threads
+                                    * sizeof(*pipeline->threads));
+
+  /* Once the first thread runs, we must use the mutex. */
+  while (!status && pipeline->thread_count < pipeline->max_threads)
+    {
+      status = apr_thread_create(&pipeline->threads[pipeline->thread_count],
+                                 NULL, pipeline_worker_thread, pipeline,
+                                 pipeline->pool);
+      if (!status)
+        ++pipeline->thread_count;
+    }
+
+  /* Any number of workers will do. */
+  if (pipeline->thread_count)
+    return SVN_NO_ERROR;
+
+  return svn_error_wrap_apr(status, _("Can't create thread"));
+}
+
+/* Tell all workers of PIPELINE to terminate and wait for them to do so. */
+static void
+stop_pipeline_workers(delta_pipeline_t *pipeline)
+{
+  apr_status_t retval;
+  int i;
+
+  if (pipeline->thread_count == 0)
+    return;
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  pipeline->stop = TRUE;
+  apr_thread_cond_broadcast(pipeline->changed);
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  for (i = 0; i < pipeline->thread_count; ++i)
+    apr_thread_join(&retval, pipeline->threads[i]);
+
+  pipeline->thread_count = 0;
+}
+
+/* Pool cleanup function for the delta_pipeline_t given as DATA.  Stop
+ * all workers and release all job pools. */
+static apr_status_t
+cleanup_pipeline(void *data)
+{
+  delta_pipeline_t *pipeline = data;
+  int i;
+
+  stop_pipeline_workers(pipeline);
+
+  for (i = 0; i < pipeline->job_count; ++i)
+    {
+      delta_job_t *job = &pipeline->jobs[i];
+      svn_error_clear(job->err);
+      job->err = SVN_NO_ERROR;
+
+      if (job->pool)
+        {
+          svn_pool_destroy(job->pool);
+          job->pool = NULL;
+        }
+    }
+
+  return APR_SUCCESS;
+}
+
+/* Return a new pipeline that will use up to MAX_THREADS worker threads.
+ * Encode the windows as svndiff version SVNDIFF_VERSION with
+ * COMPRESSION_LEVEL, unless SVNDIFF_VERSION is negative.  The pipeline
+ * lives until POOL gets cleaned up. */
+static delta_pipeline_t *
+create_pipeline(int max_threads,
+                int svndiff_version,
+                int compression_level,
+                apr_pool_t *pool)
+{
+  delta_pipeline_t *pipeline = apr_pcalloc(pool, sizeof(*pipeline));
+
+  pipeline->max_threads = max_threads;
+  pipeline->job_count = max_threads * WINDOWS_PER_THREAD;
+  pipeline->jobs = apr_pcalloc(pool,
+                               pipeline->job_count * sizeof(*pipeline->jobs));
+  pipeline->svndiff_version = svndiff_version;
+  pipeline->compression_level = compression_level;
+  pipeline->pool = pool;
+
+  /* Create the synchronization objects before registering our cleanup.
+   * They will then get destroyed only after all workers have stopped.
+   * Without them, we simply don't use any worker threads. */
+  if (   apr_thread_mutex_create(&pipeline->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                 pool)
+      || apr_thread_cond_create(&pipeline->changed, pool))
+    pipeline->max_threads = 0;
+
+  apr_pool_cleanup_register(pool, pipeline, cleanup_pipeline,
+                            apr_pool_cleanup_null);
+
+  return pipeline;
+}
+
+/* Return TRUE if PIPELINE has no room for another job. */
+static svn_boolean_t
+pipeline_is_full(delta_pipeline_t *pipeline)
+{
+  return pipeline->filled == pipeline->job_count;
+}
+
+/* Return the next job in PIPELINE to fill with input data.  PIPELINE must
+ * not be full.  The job's buffer will be allocated but its contents are
+ * undefined. */
+static delta_job_t *
+pipeline_next_job(delta_pipeline_t *pipeline)
+{
+  delta_job_t *job
+    = &pipeline->jobs[(pipeline->first + pipeline->filled)
+                      % pipeline->job_count];
+
+  /* Allocate buffers only as needed.  Most texts fit into one window. */
+  if (job->buf == NULL)
+    {
+      job->buf = apr_palloc(pipeline->pool, 2 * SVN_DELTA_WINDOW_SIZE);
+      job->pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+    }
+
+  job->source_len = 0;
+  job->target_len = 0;
+
+  return job;
+}
+
+/* Queue JOB, which has been returned by pipeline_next_job() for PIPELINE
+ * and then been filled.  Start the workers as soon as there is more than
+ * one window to compute. */
+static void
+pipeline_submit(delta_pipeline_t *pipeline,
+                delta_job_t *job)
+{
+  if (pipeline->thread_count)
+    {
+      apr_thread_mutex_lock(pipeline->mutex);
+      job->state = job_queued;
+      ++pipeline->filled;
+      apr_thread_cond_broadcast(pipeline->changed);
+      apr_thread_mutex_unlock(pipeline->mutex);
+    }
+  else
+    {
+      job->state = job_queued;
+      ++pipeline->filled;
+
+      /* Without workers, we simply process all jobs in this thread. */
+      if (pipeline->filled > 1 && pipeline->max_threads > 1)
+        {
+          svn_error_t *err = start_pipeline_workers(pipeline);
+          if (err)
+            {
+              svn_error_clear(err);
+              pipeline->max_threads = 0;
+            }
+        }
+    }
+}
+
+/* Return the oldest job in PIPELINE after it has been processed.  Call
+ * pipeline_release_oldest() once its results have been consumed. */
+static delta_job_t *
+pipeline_oldest(delta_pipeline_t *pipeline)
+{
+  delta_job_t *job = &pipeline->jobs[pipeline->first];
+
+  if (pipeline->thread_count)
+    {
+      apr_thread_mutex_lock(pipeline->mutex);
+      while (job->state != job_done)
+        apr_thread_cond_wait(pipeline->changed, pipeline->mutex);
+      apr_thread_mutex_unlock(pipeline->mutex);
+    }
+  else
+    {
+      process_job(pipeline, job);
+      job->state = job_done;
+    }
+
+  return job;
+}
+
+/* Remove the oldest job from PIPELINE and release its results. */
+static void
+pipeline_release_oldest(delta_pipeline_t *pipeline)
+{
+  delta_job_t *job = &pipeline->jobs[pipeline->first];
+
+  svn_error_clear(job->err);
+  job->err = SVN_NO_ERROR;
+  svn_pool_clear(job->pool);
+
+  if (pipeline->thread_count)
+    apr_thread_mutex_lock(pipeline->mutex);
+
+  job->state = job_free;
+  pipeline->first = (pipeline->first + 1) % pipeline->job_count;
+  --pipeline->filled;
+
+  if (pipeline->thread_count)
+    apr_thread_mutex_unlock(pipeline->mutex);
+}
+
+/* Send the oldest window in PIPELINE to HANDLER with HANDLER_BATON. */
+static svn_error_t *
+pipeline_send_oldest(delta_pipeline_t *pipeline,
+                     svn_txdelta_window_handler_t handler,
+                     void *handler_baton)
+{
+  delta_job_t *job = pipeline_oldest(pipeline);
+  svn_error_t *err = handler(job->window, handler_baton);
+
+  pipeline_release_oldest(pipeline);
+  return svn_error_trace(err);
+}
+
+#endif /* APR_HAS_THREADS */
+
+svn_error_t *
+svn_txdelta__run(svn_stream_t *source,
+                 svn_stream_t *target,
+                 svn_txdelta_window_handler_t handler,
+                 void *handler_baton,
+                 svn_checksum_kind_t checksum_kind,
+                 svn_checksum_t **checksum,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 int thread_count,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  apr_pool_t *pipeline_pool;
+  delta_pipeline_t *pipeline;
+  svn_checksum_ctx_t *context = NULL;
+  svn_boolean_t more_source = TRUE;
+  svn_filesize_t pos = 0;
+
+  if (thread_count > 1)
+    {
+      pipeline_pool = svn_pool_create(scratch_pool);
+      pipeline = create_pipeline(thread_count, -1, 0, pipeline_pool);
+
+      if (checksum != NULL)
+        context = svn_checksum_ctx_create(checksum_kind, scratch_pool);
+
+      while (TRUE)
+        {
+          delta_job_t *job;
+
+          /* Make room for the next window. */
+          if (pipeline_is_full(pipeline))
+            SVN_ERR(pipeline_send_oldest(pipeline, handler, handler_baton));
+
+          /* Read the next window's worth of source and target data. */
+          job = pipeline_next_job(pipeline);
+          if (more_source)
+            {
+              job->source_len = SVN_DELTA_WINDOW_SIZE;
+              SVN_ERR(svn_stream_read_full(source, job->buf,
+                                           &job->source_len));
+              more_source = (job->source_len == SVN_DELTA_WINDOW_SIZE);
+            }
+
+          job->target_len = SVN_DELTA_WINDOW_SIZE;
+          SVN_ERR(svn_stream_read_full(target, job->buf + job->source_len,
+                                       &job->target_len));
+          if (job->target_len == 0)
+            break;
+
+          if (context != NULL)
+            SVN_ERR(svn_checksum_update(context,
+                                        job->buf + job->source_len,
+                                        job->target_len));
+
+          job->source_offset = pos;
+          pos += job->source_len;
+          pipeline_submit(pipeline, job);
+
+          if (cancel_func)
+            SVN_ERR(cancel_func(cancel_baton));
+        }
+
+      /* Send the remaining windows in order and then the final one. */
+      while (pipeline->filled)
+        SVN_ERR(pipeline_send_oldest(pipeline, handler, handler_baton));
+
+      svn_pool_destroy(pipeline_pool);
+      SVN_ERR(handler(NULL, handler_baton));
+
+      if (checksum != NULL)
+        SVN_ERR(svn_checksum_final(checksum, context, result_pool));
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  return svn_error_trace(svn_txdelta_run(source, target,
+                                         handler, handler_baton,
+                                         checksum_kind, checksum,
+                                         cancel_func, cancel_baton,
+                                         result_pool, scratch_pool));
+}
+
+#if APR_HAS_THREADS
+
+/* Target-push stream that writes svndiff data using a delta pipeline. */
+struct tpush_svndiff_baton
+{
+  /* These are copied from the parameters passed to
+   * svn_txdelta__target_push_svndiff. */
+  svn_stream_t *source;
+  svn_stream_t *output;
+  int svndiff_version;
+
+  /* Private data */
+  delta_pipeline_t *pipeline;
+  delta_job_t *job;             /* Window currently being filled or NULL. */
+  svn_filesize_t source_offset;
+  svn_boolean_t source_done;
+  svn_boolean_t header_done;
+};
+
+/* Write the svndiff stream header to TB's output, if that has not been
+ * done yet. */
+static svn_error_t *
+write_svndiff_header(struct tpush_svndiff_baton *tb)
+{
+  char svnver[4] = {'S','V','N','\0'};
+  apr_size_t len = sizeof(svnver);
+
+  if (tb->header_done)
+    return SVN_NO_ERROR;
+
+  svnver[3] = (char)tb->svndiff_version;
+  SVN_ERR(svn_stream_write(tb->output, svnver, &len));
+  tb->header_done = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the oldest window in TB's pipeline to TB's output. */
+static svn_error_t *
+write_oldest_window(struct tpush_svndiff_baton *tb)
+{
+  delta_job_t *job = pipeline_oldest(tb->pipeline);
+  svn_error_t *err = svn_error_dup(job->err);
+  apr_size_t len;
+
+  if (!err)
+    err = write_svndiff_header(tb);
+  if (!err)
+    {
+      len = job->header->len;
+      err = svn_stream_write(tb->output, job->header->data, &len);
+    }
+  if (!err && job->instructions->len > 0)
+    {
+      len = job->instructions->len;
+      err = svn_stream_write(tb->output, job->instructions->data, &len);
+    }
+  if (!err && job->new_data->len > 0)
+    {
+      len = job->new_data->len;
+      err = svn_stream_write(tb->output, job->new_data->data, &len);
+    }
+
+  pipeline_release_oldest(tb->pipeline);
+  return svn_error_trace(err);
+}
+
+/* This is the write handler for a pipelined target-push delta stream.
+ * It works like tpush_write_handler but queues the windows for
+ * computation and writes out the finished ones in order. */
+static svn_error_t *
+tpush_svndiff_write_handler(void *baton, const char *data, apr_size_t *len)
+{
+  struct tpush_svndiff_baton *tb = baton;
+  apr_size_t chunk_len, data_len = *len;
+
+  while (data_len > 0)
+    {
+      delta_job_t *job = tb->job;
+
+      /* Start a new window, reading the corresponding source data. */
+      if (job == NULL)
+        {
+          if (pipeline_is_full(tb->pipeline))
+            SVN_ERR(write_oldest_window(tb));
+
+          job = pipeline_next_job(tb->pipeline);
+          if (!tb->source_done)
+            {
+              job->source_len = SVN_DELTA_WINDOW_SIZE;
+              SVN_ERR(svn_stream_read_full(tb->source, job->buf,
+                                           &job->source_len));
+              if (job->source_len < SVN_DELTA_WINDOW_SIZE)
+                tb->source_done = TRUE;
+            }
+
+          job->source_offset = tb->source_offset;
+          tb->job = job;
+        }
+
+      /* Copy in the target data, up to SVN_DELTA_WINDOW_SIZE. */
+      chunk_len = SVN_DELTA_WINDOW_SIZE - job->target_len;
+      if (chunk_len > data_len)
+        chunk_len = data_len;
+      memcpy(job->buf + job->source_len + job->target_len, data, chunk_len);
+      data += chunk_len;
+      data_len -= chunk_len;
+      job->target_len += chunk_len;
+
+      /* If we're full of target data, queue the window. */
+      if (job->target_len == SVN_DELTA_WINDOW_SIZE)
+        {
+          tb->source_offset += job->source_len;
+          pipeline_submit(tb->pipeline, job);
+          tb->job = NULL;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* This is the close handler for a pipelined target-push delta stream.
+ * It queues the final window, writes all remaining windows and closes
+ * the output stream. */
+static svn_error_t *
+tpush_svndiff_close_handler(void *baton)
+{
+  struct tpush_svndiff_baton *tb = baton;
+
+  /* Queue the final window if we have any residual target data. */
+  if (tb->job)
+    {
+      pipeline_submit(tb->pipeline, tb->job);
+      tb->job = NULL;
+    }
+
+  while (tb->pipeline->filled)
+    SVN_ERR(write_oldest_window(tb));
+
+  /* Even an empty delta needs the svndiff header. */
+  SVN_ERR(write_svndiff_header(tb));
+
+  apr_pool_cleanup_run(tb->pipeline->pool, tb->pipeline, cleanup_pipeline);
+  return svn_error_trace(svn_stream_close(tb->output));
+}
+
+#endif /* APR_HAS_THREADS */
+
+svn_stream_t *
+svn_txdelta__target_push_svndiff(svn_stream_t *source,
+                                 svn_stream_t *output,
+                                 int svndiff_version,
+                                 int compression_level,
+                                 int thread_count,
+                                 apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+#if APR_HAS_THREADS
+  if (thread_count > 1)
+    {
+      struct tpush_svndiff_baton *tb = apr_pcalloc(pool, sizeof(*tb));
+      svn_stream_t *stream;
+
+      tb->source = source;
+      tb->output = output;
+      tb->svndiff_version = svndiff_version;
+      tb->pipeline = create_pipeline(thread_count, svndiff_version,
+                                     compression_level, pool);
+
+      stream = svn_stream_create(tb, pool);
+      svn_stream_set_write(stream, tpush_svndiff_write_handler);
+      svn_stream_set_close(stream, tpush_svndiff_close_handler);
+      return stream;
+    }
+#endif
+
+  svn_txdelta_to_svndiff3(&handler, &handler_baton, output, svndiff_version,
+                          compression_level, pool);
+  return svn_txdelta_target_push(handler, handler_baton, source, pool);
+}
+
+
 
 /* Functions for applying deltas.  */
 
@@ -1447,6 +1447,31 @@ svn_fs_try_process_file_contents(svn_boolean_t *success,
                          processor, baton, pool));
 }
 
+svn_error_t *
+svn_fs__get_file_storage(apr_file_t **file,
+                         apr_off_t *offset,
+                         svn_filesize_t *length,
+                         int *svndiff_version,
+                         svn_fs_root_t *root,
+                         const char *path,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  /* if the FS doesn't implement this function, report "not available" */
+  if (root->vtable->get_file_storage == NULL)
+    {
+      *file = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(root->vtable->get_file_storage(file, offset,
+                                                        length,
+                                                        svndiff_version,
+                                                        root, path,
+                                                        result_pool,
+                                                        scratch_pool));
+}
+
 svn_error_t *
 svn_fs_make_file(svn_fs_root_t *root, const char *path, apr_pool_t *pool)
 {
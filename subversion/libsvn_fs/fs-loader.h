@@ -423,6 +423,16 @@ typedef struct root_vtable_t
                                 svn_boolean_t adjust_inherited_mergeinfo,
                                 apr_pool_t *result_pool,
                                 apr_pool_t *scratch_pool);
+
+  /* Storage.  May be NULL. */
+  svn_error_t *(*get_file_storage)(apr_file_t **file,
+                                   apr_off_t *offset,
+                                   svn_filesize_t *length,
+                                   int *svndiff_version,
+                                   svn_fs_root_t *root,
+                                   const char *path,
+                                   apr_pool_t *result_pool,
+                                   apr_pool_t *scratch_pool);
 } root_vtable_t;
 
 
@@ -5523,7 +5523,7 @@ static root_vtable_t root_vtable = {
   base_contents_changed,
   base_get_file_delta_stream,
   base_merge,
-  base_get_mergeinfo,
+  base_get_mergeinfo,  NULL /* get_file_storage */
 };
 
 
@@ -107,6 +107,24 @@ svn_fs_fs__try_process_file_contents(svn_boolean_t *success,
                                      void* baton,
                                      apr_pool_t *pool);
 
+/* Find the on-disk location of the text representation of NODEREV in
+   filesystem FS.  If it is a PLAIN or self-delta representation within
+   a revision or pack file, set *FILE to that file, opened in RESULT_POOL,
+   and set *OFFSET and *LENGTH to the range within *FILE that contains the
+   fulltext or svndiff data, respectively.  Set *SVNDIFF_VERSION to the
+   svndiff version or to -1 for PLAIN representations.  In all other
+   cases, set *FILE to NULL.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__get_contents_storage(apr_file_t **file,
+                                apr_off_t *offset,
+                                svn_filesize_t *length,
+                                int *svndiff_version,
+                                svn_fs_t *fs,
+                                node_revision_t *noderev,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool);
+
 /* Set *STREAM_P to a delta stream turning the contents of the file SOURCE into
    the contents of the file TARGET, allocated in POOL.
    If SOURCE is null, the empty string will be used. */
@@ -334,6 +334,44 @@ create_cache(svn_cache__t **cache_p,
   return SVN_NO_ERROR;
 }
 
+/* If DISK_CACHE is not NULL, make the persistent DISK_CACHE a second
+ * level behind *CACHE_P.  SERIALIZER, DESERIALIZER and KLEN must match
+ * those of *CACHE_P.  PREFIX identifies the entries in DISK_CACHE.
+ *
+ * Unless NO_HANDLER is true, errors in the persistent tier are reported
+ * as warnings to the FS warning callback and then ignored.
+ *
+ * Allocate the result in RESULT_POOL.
+ */
+static svn_error_t *
+add_disk_tier(svn_cache__t **cache_p,
+              svn_disk_cache_t *disk_cache,
+              svn_cache__serialize_func_t serializer,
+              svn_cache__deserialize_func_t deserializer,
+              apr_ssize_t klen,
+              const char *prefix,
+              svn_fs_t *fs,
+              svn_boolean_t no_handler,
+              apr_pool_t *result_pool)
+{
+  svn_cache__t *second;
+
+  if (disk_cache == NULL || *cache_p == NULL)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cache__create_disk_cache(&second, disk_cache,
+                                       serializer, deserializer, klen,
+                                       prefix, result_pool));
+  SVN_ERR(init_callbacks(second, fs,
+                         no_handler ? NULL
+                                    : warn_and_continue_on_cache_errors,
+                         result_pool));
+  SVN_ERR(svn_cache__create_tiered_cache(cache_p, *cache_p, second,
+                                         result_pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__initialize_caches(svn_fs_t *fs,
                              apr_pool_t *pool)
@@ -345,6 +383,8 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                                    ":",
                                    SVN_VA_NULL);
   svn_membuffer_t *membuffer;
+  svn_disk_cache_t *disk_cache = NULL;
+  const char *disk_prefix = NULL;
   svn_boolean_t no_handler = ffd->fail_stop;
   svn_boolean_t cache_txdeltas;
   svn_boolean_t cache_fulltexts;
@@ -361,6 +401,23 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
 
   membuffer = svn_cache__get_global_membuffer_cache();
 
+  /* The persistent cache outlives this process and may even outlive the
+   * repository.  Tie its entries to this very instance of the repository
+   * so that we never pick up data of a restored or re-created one. */
+  if (ffd->disk_cache_size)
+    {
+      svn_error_t *err = svn_cache__open_disk_cache(&disk_cache,
+                                                    ffd->disk_cache_path,
+                                                    ffd->disk_cache_size,
+                                                    pool);
+      if (err && !no_handler)
+        err = warn_and_continue_on_cache_errors(err, fs, pool);
+
+      SVN_ERR(err);
+      disk_prefix = apr_pstrcat(pool, prefix, ffd->instance_id, ":",
+                                SVN_VA_NULL);
+    }
+
   /* General rules for assigning cache priorities:
    *
    * - Data that can be reconstructed from other elements has low prio
@@ -508,6 +565,15 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            fs,
                            no_handler,
                            fs->pool, pool));
+      SVN_ERR(add_disk_tier(&(ffd->fulltext_cache),
+                            disk_cache,
+                            NULL, NULL,
+                            sizeof(pair_cache_key_t),
+                            apr_pstrcat(pool, disk_prefix, "TEXT",
+                                        SVN_VA_NULL),
+                            fs,
+                            no_handler,
+                            fs->pool));
 
       SVN_ERR(create_cache(&(ffd->properties_cache),
                            NULL,
@@ -589,6 +655,16 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            fs,
                            no_handler,
                            fs->pool, pool));
+      SVN_ERR(add_disk_tier(&(ffd->txdelta_window_cache),
+                            disk_cache,
+                            svn_fs_fs__serialize_txdelta_window,
+                            svn_fs_fs__deserialize_txdelta_window,
+                            sizeof(window_cache_key_t),
+                            apr_pstrcat(pool, disk_prefix, "TXDELTA_WINDOW",
+                                        SVN_VA_NULL),
+                            fs,
+                            no_handler,
+                            fs->pool));
 
       SVN_ERR(create_cache(&(ffd->combined_window_cache),
                            NULL,
@@ -603,6 +679,15 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            fs,
                            no_handler,
                            fs->pool, pool));
+      SVN_ERR(add_disk_tier(&(ffd->combined_window_cache),
+                            disk_cache,
+                            NULL, NULL,
+                            sizeof(window_cache_key_t),
+                            apr_pstrcat(pool, disk_prefix, "COMBINED_WINDOW",
+                                        SVN_VA_NULL),
+                            fs,
+                            no_handler,
+                            fs->pool));
     }
   else
     {
@@ -1021,6 +1021,32 @@ svn_fs_fs__dag_try_process_file_contents(svn_boolean_t *success,
 }
 
 
+svn_error_t *
+svn_fs_fs__dag_get_file_storage(apr_file_t **file,
+                                apr_off_t *offset,
+                                svn_filesize_t *length,
+                                int *svndiff_version,
+                                dag_node_t *node,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool)
+{
+  node_revision_t *noderev;
+
+  if (node->kind != svn_node_file)
+    return svn_error_createf
+      (SVN_ERR_FS_NOT_FILE, NULL,
+       "Attempted to get textual contents of a *non*-file node");
+
+  /* Go get a fresh node-revision for FILE. */
+  SVN_ERR(get_node_revision(&noderev, node));
+
+  return svn_fs_fs__get_contents_storage(file, offset, length,
+                                         svndiff_version, node->fs,
+                                         noderev, result_pool,
+                                         scratch_pool);
+}
+
+
 svn_error_t *
 svn_fs_fs__dag_file_length(svn_filesize_t *length,
                            dag_node_t *file,
@@ -426,6 +426,21 @@ svn_fs_fs__dag_try_process_file_contents(svn_boolean_t *success,
                                          void* baton,
                                          apr_pool_t *pool);
 
+/* Find the location of the contents of NODE within the repository.
+   See svn_fs__get_file_storage() for the meaning of FILE, OFFSET,
+   LENGTH and SVNDIFF_VERSION.
+
+   Allocate *FILE in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+svn_fs_fs__dag_get_file_storage(apr_file_t **file,
+                                apr_off_t *offset,
+                                svn_filesize_t *length,
+                                int *svndiff_version,
+                                dag_node_t *node,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool);
+
 
 /* Set *STREAM_P to a delta stream that will turn the contents of SOURCE into
    the contents of TARGET, allocated in POOL.  If SOURCE is null, the empty
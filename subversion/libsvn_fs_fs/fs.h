@@ -78,6 +78,8 @@ extern "C" {
                                                     to-log index */
 /* If you change this, look at tests/svn_test_fs.c(maybe_install_fsfs_conf) */
 #define PATH_CONFIG           "fsfs.conf"        /* Configuration */
+#define PATH_DISK_CACHE       "fscache"          /* Default persistent
+                                                    cache file */
 
 /* Names of special files and file extensions for transactions */
 #define PATH_CHANGES       "changes"       /* Records changes made so far */
@@ -102,14 +104,20 @@ extern "C" {
 /* Names of sections and options in fsfs.conf. */
 #define CONFIG_SECTION_CACHES            "caches"
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
+#define CONFIG_OPTION_DISK_CACHE_SIZE    "disk-cache-size"
+#define CONFIG_OPTION_DISK_CACHE_PATH    "disk-cache-path"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
+#define CONFIG_OPTION_REP_CACHE_BATCH_SIZE "rep-cache-batch-size"
+#define CONFIG_OPTION_REP_CACHE_FILTER   "enable-rep-cache-filter"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
 #define CONFIG_OPTION_ENABLE_DIR_DELTIFICATION   "enable-dir-deltification"
 #define CONFIG_OPTION_ENABLE_PROPS_DELTIFICATION "enable-props-deltification"
 #define CONFIG_OPTION_MAX_DELTIFICATION_WALK     "max-deltification-walk"
 #define CONFIG_OPTION_MAX_LINEAR_DELTIFICATION   "max-linear-deltification"
 #define CONFIG_OPTION_COMPRESSION_LEVEL  "compression-level"
+#define CONFIG_OPTION_COMPRESSION        "compression"
+#define CONFIG_OPTION_DELTA_THREADS      "delta-threads"
 #define CONFIG_SECTION_PACKED_REVPROPS   "packed-revprops"
 #define CONFIG_OPTION_REVPROP_PACK_SIZE  "revprop-pack-size"
 #define CONFIG_OPTION_COMPRESS_PACKED_REVPROPS  "compress-packed-revprops"
@@ -117,6 +125,10 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_MMAP_PACK_FILES    "mmap-pack-files"
+#define CONFIG_SECTION_PACK              "pack"
+#define CONFIG_OPTION_CONCURRENCY        "concurrency"
+#define CONFIG_OPTION_MAX_MEM            "max-mem"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 
@@ -127,7 +139,14 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   7
+#define SVN_FS_FS__FORMAT_NUMBER   8
+
+/* Upper limits for the [pack] concurrency and max-mem (in MB) settings. */
+#define SVN_FS_FS__MAX_PACK_CONCURRENCY 64
+#define SVN_FS_FS__MAX_PACK_MAX_MEM     0x10000
+
+/* Upper limit for the [deltification] delta-threads setting. */
+#define SVN_FS_FS__MAX_DELTA_THREADS    64
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -182,6 +201,9 @@ extern "C" {
 /* Minimum format number that supports per-instance filesystem IDs. */
 #define SVN_FS_FS__MIN_INSTANCE_ID_FORMAT 7
 
+/* Minimum format number that supports svndiff version 2. */
+#define SVN_FS_FS__MIN_SVNDIFF2_FORMAT 8
+
 /* The minimum format number that supports a configuration file (fsfs.conf) */
 #define SVN_FS_FS__MIN_CONFIG_FILE 4
 
@@ -255,6 +277,23 @@ typedef struct fs_fs_shared_data_t
      txn-current file. */
   svn_mutex__t *txn_current_lock;
 
+  /* Bloom filter over the SHA1 keys in the rep-cache database, or NULL
+     if it has not been built yet.  See rep-cache.c.  All access to it
+     as well as REP_CACHE_LOOKUPS is synchronised under REP_CACHE_LOCK. */
+  struct rep_cache_filter_t *rep_cache_filter;
+
+  /* Number of rep-cache lookups that had to consult the database. */
+  apr_int64_t rep_cache_lookups;
+
+  /* Time at which REP_CACHE_FILTER has last been built or brought up to
+     date, or 0 if that never happened. */
+  apr_time_t rep_cache_filter_updated;
+
+  /* A lock for intra-process synchronization when accessing the rep-cache
+     filter.  It may be acquired while holding any of the above locks but
+     no other lock may be taken out while holding it. */
+  svn_mutex__t *rep_cache_lock;
+
   /* The common pool, under which this object is allocated, subpools
      of which are used to allocate the transaction objects. */
   apr_pool_t *common_pool;
@@ -291,6 +330,20 @@ typedef struct window_cache_key_t
   apr_uint64_t item_index;
 } window_cache_key_t;
 
+/* Secondary compression schemes that may be used when writing txdelta
+   representations. */
+typedef enum compression_type_t
+{
+  /* Store the svndiff data uncompressed (svndiff0). */
+  compression_type_none,
+
+  /* Compress with zlib (svndiff1). */
+  compression_type_zlib,
+
+  /* Compress with LZ4 (svndiff2). */
+  compression_type_lz4
+} compression_type_t;
+
 /* Private (non-shared) FSFS-specific data for each svn_fs_t object.
    Any caches in here may be NULL. */
 typedef struct fs_fs_data_t
@@ -333,6 +386,12 @@ typedef struct fs_fs_data_t
      e.g. memcached may be ignored as caching is an optional feature. */
   svn_boolean_t fail_stop;
 
+  /* Size of the persistent cache file in bytes.  0 disables it. */
+  apr_uint64_t disk_cache_size;
+
+  /* Absolute path of the persistent cache file. */
+  const char *disk_cache_path;
+
   /* A cache of revision root IDs, mapping from (svn_revnum_t *) to
      (svn_fs_id_t *).  (Not threadsafe.) */
   svn_cache__t *rev_root_id_cache;
@@ -429,6 +488,20 @@ typedef struct fs_fs_data_t
   /* Thread-safe boolean */
   svn_atomic_t rep_cache_db_opened;
 
+  /* Rep-cache entries of committed revisions that have not been written
+     to REP_CACHE_DB yet.  Maps SHA1 digests to representation_t *.  The
+     entries are allocated in REP_CACHE_PENDING_POOL.  May be NULL. */
+  apr_hash_t *rep_cache_pending;
+  apr_pool_t *rep_cache_pending_pool;
+
+  /* Write pending rep-cache entries to REP_CACHE_DB once there are at
+     least this many of them.  1 means "after every commit". */
+  apr_int64_t rep_cache_batch_size;
+
+  /* Whether lookups in REP_CACHE_DB shall be accelerated by a process-wide
+     Bloom filter over its keys. */
+  svn_boolean_t rep_cache_filter_enabled;
+
   /* The oldest revision not in a pack file.  It also applies to revprops
    * if revprop packing has been enabled by the FSFS format version. */
   svn_revnum_t min_unpacked_rev;
@@ -457,12 +530,35 @@ typedef struct fs_fs_data_t
    * deltification history after which skip deltas will be used. */
   apr_int64_t max_linear_deltification;
 
-  /* Compression level to use with txdelta storage format in new revs. */
+  /* Compression type to use with txdelta storage format in new revs. */
+  compression_type_t delta_compression_type;
+
+  /* Compression level (currently, only used with compression_type_zlib). */
   int delta_compression_level;
 
+  /* Maximum number of threads computing delta windows when writing a
+   * single file representation.  1 means "single-threaded". */
+  int delta_threads;
+
+  /* Whether pack files shall be read through memory mappings. */
+  svn_boolean_t mmap_pack_files;
+
+  /* Read-only mappings of pack files, keyed by the first revision in the
+   * respective pack file.  Values are apr_mmap_t *.  Allocated lazily in
+   * the FS pool. */
+  apr_hash_t *pack_file_mappings;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
+  /* Maximum number of rev shards that svn_fs_fs__pack() packs in
+   * parallel.  1 means "pack sequentially". */
+  int pack_concurrency;
+
+  /* Memory budget in bytes that a single shard packing job may use for
+   * its placement information. */
+  apr_size_t pack_max_mem;
+
   /* Per-instance filesystem ID, which provides an additional level of
      uniqueness for filesystems that share the same UUID, but should
      still be distinguishable (e.g. backups produced by svn_fs_hotcopy()
@@ -681,6 +681,57 @@ verify_block_size(apr_int64_t block_size,
   return SVN_NO_ERROR;
 }
 
+/* Parse the VALUE of the "compression" option in fsfs.conf and set
+ * *COMPRESSION_TYPE and *COMPRESSION_LEVEL accordingly.  Valid values
+ * are "none", "lz4", "zlib" and "zlib-N" with N being the zlib
+ * compression level from 1 to 9.
+ */
+static svn_error_t *
+parse_compression_option(compression_type_t *compression_type,
+                         int *compression_level,
+                         const char *value)
+{
+  if (strcmp(value, "none") == 0)
+    {
+      *compression_type = compression_type_none;
+      *compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
+    }
+  else if (strcmp(value, "lz4") == 0)
+    {
+      *compression_type = compression_type_lz4;
+      *compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+    }
+  else if (strcmp(value, "zlib") == 0)
+    {
+      *compression_type = compression_type_zlib;
+      *compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+    }
+  else if (strncmp(value, "zlib-", 5) == 0)
+    {
+      int level;
+      svn_error_t *err = svn_cstring_atoi(&level, value + 5);
+
+      if (err || level <= SVN_DELTA_COMPRESSION_LEVEL_NONE
+              || level > SVN_DELTA_COMPRESSION_LEVEL_MAX)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, err,
+                                 _("Invalid zlib compression level in "
+                                   "fsfs.conf setting '%s' = '%s'"),
+                                 CONFIG_OPTION_COMPRESSION, value);
+
+      *compression_type = compression_type_zlib;
+      *compression_level = level;
+    }
+  else
+    {
+      return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                               _("Invalid value in fsfs.conf setting "
+                                 "'%s' = '%s'"),
+                               CONFIG_OPTION_COMPRESSION, value);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the configuration information of the file system at FS_PATH
  * and set the respective values in FFD.  Use pools as usual.
  */
@@ -704,6 +755,26 @@ read_config(fs_fs_data_t *ffd,
   else
     ffd->rep_sharing_allowed = FALSE;
 
+  if (ffd->rep_sharing_allowed)
+    {
+      SVN_ERR(svn_config_get_int64(config, &ffd->rep_cache_batch_size,
+                                   CONFIG_SECTION_REP_SHARING,
+                                   CONFIG_OPTION_REP_CACHE_BATCH_SIZE, 1));
+      if (ffd->rep_cache_batch_size < 1)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("'%s' must be positive"),
+                                 CONFIG_OPTION_REP_CACHE_BATCH_SIZE);
+
+      SVN_ERR(svn_config_get_bool(config, &ffd->rep_cache_filter_enabled,
+                                  CONFIG_SECTION_REP_SHARING,
+                                  CONFIG_OPTION_REP_CACHE_FILTER, FALSE));
+    }
+  else
+    {
+      ffd->rep_cache_batch_size = 1;
+      ffd->rep_cache_filter_enabled = FALSE;
+    }
+
   /* Initialize deltification settings in ffd. */
   if (ffd->format >= SVN_FS_FS__MIN_DELTIFICATION_FORMAT)
     {
@@ -743,6 +814,60 @@ read_config(fs_fs_data_t *ffd,
       ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
     }
 
+  /* Select the secondary compression scheme for txdelta reps.  Older
+     formats use zlib, if they support svndiff1 at all.  Format 8 adds
+     LZ4, which becomes the default unless the "compression" option or
+     the legacy "compression-level" option says otherwise. */
+  if (ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT)
+    {
+      const char *compression_val;
+      const char *compression_level_val;
+
+      svn_config_get(config, &compression_val,
+                     CONFIG_SECTION_DELTIFICATION,
+                     CONFIG_OPTION_COMPRESSION, NULL);
+      svn_config_get(config, &compression_level_val,
+                     CONFIG_SECTION_DELTIFICATION,
+                     CONFIG_OPTION_COMPRESSION_LEVEL, NULL);
+
+      if (compression_val)
+        SVN_ERR(parse_compression_option(&ffd->delta_compression_type,
+                                         &ffd->delta_compression_level,
+                                         compression_val));
+      else if (compression_level_val)
+        ffd->delta_compression_type
+          = ffd->delta_compression_level == SVN_DELTA_COMPRESSION_LEVEL_NONE
+          ? compression_type_none
+          : compression_type_zlib;
+      else
+        ffd->delta_compression_type = compression_type_lz4;
+    }
+  else if (ffd->format >= SVN_FS_FS__MIN_SVNDIFF1_FORMAT)
+    {
+      ffd->delta_compression_type = compression_type_zlib;
+    }
+  else
+    {
+      ffd->delta_compression_type = compression_type_none;
+    }
+
+  /* Number of threads that may compute the delta of a single file. */
+  {
+    apr_int64_t delta_threads;
+
+    SVN_ERR(svn_config_get_int64(config, &delta_threads,
+                                 CONFIG_SECTION_DELTIFICATION,
+                                 CONFIG_OPTION_DELTA_THREADS,
+                                 1));
+    if (delta_threads < 1 || delta_threads > SVN_FS_FS__MAX_DELTA_THREADS)
+      return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                               _("'%s' must be between 1 and %d"),
+                               CONFIG_OPTION_DELTA_THREADS,
+                               SVN_FS_FS__MAX_DELTA_THREADS);
+
+    ffd->delta_threads = (int)delta_threads;
+  }
+
   /* Initialize revprop packing settings in ffd. */
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
     {
@@ -803,6 +928,19 @@ read_config(fs_fs_data_t *ffd,
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
     }
 
+  /* Pack files are immutable and may be mapped into memory. */
+#if APR_HAS_MMAP
+  if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
+    SVN_ERR(svn_config_get_bool(config, &ffd->mmap_pack_files,
+                                CONFIG_SECTION_IO,
+                                CONFIG_OPTION_MMAP_PACK_FILES,
+                                FALSE));
+  else
+    ffd->mmap_pack_files = FALSE;
+#else
+  ffd->mmap_pack_files = FALSE;
+#endif
+
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     {
       SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
@@ -815,6 +953,41 @@ read_config(fs_fs_data_t *ffd,
       ffd->pack_after_commit = FALSE;
     }
 
+  /* Pack settings.  The memory budget is given in MB. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
+    {
+      apr_int64_t concurrency;
+      apr_int64_t max_mem;
+
+      SVN_ERR(svn_config_get_int64(config, &concurrency,
+                                   CONFIG_SECTION_PACK,
+                                   CONFIG_OPTION_CONCURRENCY,
+                                   1));
+      SVN_ERR(svn_config_get_int64(config, &max_mem,
+                                   CONFIG_SECTION_PACK,
+                                   CONFIG_OPTION_MAX_MEM,
+                                   64));
+
+      if (concurrency < 1 || concurrency > SVN_FS_FS__MAX_PACK_CONCURRENCY)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("'%s' must be between 1 and %d"),
+                                 CONFIG_OPTION_CONCURRENCY,
+                                 SVN_FS_FS__MAX_PACK_CONCURRENCY);
+      if (max_mem < 1 || max_mem > SVN_FS_FS__MAX_PACK_MAX_MEM)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("'%s' must be between 1 and %d"),
+                                 CONFIG_OPTION_MAX_MEM,
+                                 SVN_FS_FS__MAX_PACK_MAX_MEM);
+
+      ffd->pack_concurrency = (int)concurrency;
+      ffd->pack_max_mem = (apr_size_t)max_mem * 1024 * 1024;
+    }
+  else
+    {
+      ffd->pack_concurrency = 1;
+      ffd->pack_max_mem = 64 * 1024 * 1024;
+    }
+
   /* memcached configuration */
   SVN_ERR(svn_cache__make_memcache_from_config(&ffd->memcache, config,
                                                result_pool, scratch_pool));
@@ -823,6 +996,40 @@ read_config(fs_fs_data_t *ffd,
                               CONFIG_SECTION_CACHES, CONFIG_OPTION_FAIL_STOP,
                               FALSE));
 
+  /* Persistent cache configuration.  Without instance IDs, we could not
+   * tell a restored or re-created repository from the original. */
+  if (ffd->format >= SVN_FS_FS__MIN_INSTANCE_ID_FORMAT)
+    {
+      apr_int64_t disk_cache_size;
+      const char *disk_cache_path;
+
+      SVN_ERR(svn_config_get_int64(config, &disk_cache_size,
+                                   CONFIG_SECTION_CACHES,
+                                   CONFIG_OPTION_DISK_CACHE_SIZE,
+                                   0));
+      if (disk_cache_size < 0)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("'%s' must not be negative"),
+                                 CONFIG_OPTION_DISK_CACHE_SIZE);
+
+      svn_config_get(config, &disk_cache_path, CONFIG_SECTION_CACHES,
+                     CONFIG_OPTION_DISK_CACHE_PATH, NULL);
+
+      ffd->disk_cache_size = (apr_uint64_t)disk_cache_size * 1024 * 1024;
+      ffd->disk_cache_path
+        = disk_cache_path
+        ? svn_dirent_join(fs_path,
+                          svn_dirent_internal_style(disk_cache_path,
+                                                    scratch_pool),
+                          result_pool)
+        : svn_dirent_join(fs_path, PATH_DISK_CACHE, result_pool);
+    }
+  else
+    {
+      ffd->disk_cache_size = 0;
+      ffd->disk_cache_path = NULL;
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -855,6 +1062,19 @@ write_config(svn_fs_t *fs,
 "### configured (and ignoring it with file:// access).  To make"             NL
 "### Subversion never ignore cache errors, uncomment this line."             NL
 "# " CONFIG_OPTION_FAIL_STOP " = true"                                       NL
+"### The contents of fulltexts and text deltas may also be kept in a"        NL
+"### persistent cache file that survives server restarts and is shared"      NL
+"### between all processes serving this repository.  It acts as a second"    NL
+"### level behind the in-memory caches and is most useful for servers"       NL
+"### that restart frequently or run many short-lived processes, e.g."        NL
+"### svnserve in inetd mode.  The following option sets the size of that"    NL
+"### file in MB.  It is 0, i.e. disabled, by default.  The persistent"       NL
+"### cache is only supported for repositories of format 7 or newer."         NL
+"# " CONFIG_OPTION_DISK_CACHE_SIZE " = 1024"                                 NL
+"### The cache file defaults to \"" PATH_DISK_CACHE "\" in this directory."  NL
+"### Relative paths are interpreted relative to this directory."             NL
+"### Repositories may share the same cache file."                            NL
+"# " CONFIG_OPTION_DISK_CACHE_PATH " = /var/cache/svn/fscache"               NL
 ""                                                                           NL
 "[" CONFIG_SECTION_REP_SHARING "]"                                           NL
 "### To conserve space, the filesystem can optionally avoid storing"         NL
@@ -871,6 +1091,27 @@ write_config(svn_fs_t *fs,
 "### 'svnadmin verify' will check the rep-cache regardless of this setting." NL
 "### rep-sharing is enabled by default."                                     NL
 "# " CONFIG_OPTION_ENABLE_REP_SHARING " = true"                              NL
+"###"                                                                        NL
+"### New rep-cache entries are normally written to the database right"       NL
+"### after each commit.  Bulk operations like 'svnadmin load' can be sped"   NL
+"### up considerably by collecting entries from several commits and"         NL
+"### writing them in a single database transaction.  This option sets the"   NL
+"### number of entries to collect before writing them.  Pending entries"     NL
+"### are also written when the repository gets closed.  They are not"        NL
+"### visible to other processes until then and will be lost if the"          NL
+"### process gets killed, reducing the space savings but never causing"      NL
+"### corruption.  The default is 1, i.e. no batching."                       NL
+"# " CONFIG_OPTION_REP_CACHE_BATCH_SIZE " = 1"                               NL
+"###"                                                                        NL
+"### Most rep-cache lookups during commits and loads find no match.  When"   NL
+"### this option is enabled, long-running processes keep an in-memory"       NL
+"### filter over the rep-cache keys that lets them skip most of these"       NL
+"### database queries.  Building and updating the filter requires a scan"    NL
+"### of the whole database, which happens at most once a minute per"         NL
+"### process.  It pays off for 'svnadmin load' and busy servers with a"      NL
+"### large rep-cache.  Commits by other processes are only picked up with"   NL
+"### the next update.  The filter is disabled by default."                   NL
+"# " CONFIG_OPTION_REP_CACHE_FILTER " = false"                               NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DELTIFICATION "]"                                         NL
 "### To conserve space, the filesystem stores data as differences against"   NL
@@ -933,9 +1174,27 @@ write_config(svn_fs_t *fs,
 "### For 1.8, the default value is 16; earlier versions use 1."              NL
 "# " CONFIG_OPTION_MAX_LINEAR_DELTIFICATION " = 16"                          NL
 "###"                                                                        NL
-"### After deltification, we compress the data through zlib to minimize on-" NL
-"### disk size.  That can be an expensive and ineffective process.  This"    NL
-"### setting controls the usage of zlib in future revisions."                NL
+"### After deltification, we compress the data to minimize on-disk size."    NL
+"### This setting controls the compression algorithm used in future"         NL
+"### revisions.  It can be used to either disable compression or to select"  NL
+"### between the available algorithms:  zlib is a general-purpose"           NL
+"### compression library.  lz4 is a fast compression algorithm that trades"  NL
+"### a slightly larger on-disk size for much lower CPU usage when writing"   NL
+"### and reading data."                                                      NL
+"### Valid values are 'none' (disables compression), 'zlib' (zlib at its"    NL
+"### default level 5), 'zlib-N' (zlib at level N, 1 being the fastest"       NL
+"### and 9 the strongest setting) and 'lz4'.  lz4 requires format 8"         NL
+"### repositories and is the default for them.  If this option has not"      NL
+"### been set, the 'compression-level' setting below will be used."          NL
+"# " CONFIG_OPTION_COMPRESSION " = lz4"                                      NL
+"###"                                                                        NL
+"### DEPRECATED: The 'compression' option deprecates the 'compression-"      NL
+"### level' option, which only configures zlib compression.  For"            NL
+"### compatibility with previous versions of Subversion, this option can"    NL
+"### still be used and results in zlib compression at the given level."      NL
+"###"                                                                        NL
+"### zlib compression can be an expensive and ineffective process."          NL
+"### This setting controls the usage of zlib in future revisions."           NL
 "### Revisions with highly compressible data in them may shrink in size"     NL
 "### if the setting is increased but may take much longer to commit.  The"   NL
 "### time taken to uncompress that data again is widely independent of the"  NL
@@ -950,6 +1209,13 @@ write_config(svn_fs_t *fs,
 "### and 0 disabling it altogether."                                         NL
 "### The default value is 5."                                                NL
 "# " CONFIG_OPTION_COMPRESSION_LEVEL " = 5"                                  NL
+"###"                                                                        NL
+"### The following option lets the server compute the delta windows of"      NL
+"### large files on up to the given number of threads in parallel.  The"     NL
+"### resulting data is identical to single-threaded deltification.  Files"   NL
+"### smaller than 100 kBytes will always be processed by a single thread."   NL
+"### Valid values are 1 to 64.  The default is 1, i.e. no extra threads."    NL
+"# " CONFIG_OPTION_DELTA_THREADS " = 1"                                      NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
@@ -1018,6 +1284,33 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### Packed shards never change.  Reading them through memory mappings"      NL
+"### instead of file I/O saves system calls and keeps their contents"        NL
+"### in the OS file cache only rather than in both, file cache and"          NL
+"### process memory.  This requires a 64 bit system for larger"              NL
+"### repositories as every pack file being read occupies its full size"      NL
+"### in the process address space.  Don't enable this while pack files"      NL
+"### may get modified by 'svnfsfs load-index'."                              NL
+"### mmap-pack-files is disabled by default."                                NL
+"# " CONFIG_OPTION_MMAP_PACK_FILES " = false"                                NL
+""                                                                           NL
+"[" CONFIG_SECTION_PACK "]"                                                  NL
+"### Parameters in this section control 'svnadmin pack'."                    NL
+"### Packing a shard of revisions is mostly CPU-bound.  When many shards"    NL
+"### are waiting to be packed, e.g. after importing a large history,"        NL
+"### several shards may be packed in parallel.  The shards still become"     NL
+"### visible as packed in order and one at a time.  Only has an effect if"   NL
+"### APR has been built with thread support.  Values between 1 and 64 are"   NL
+"### allowed; the default is to pack shards sequentially."                   NL
+"# " CONFIG_OPTION_CONCURRENCY " = 1"                                        NL
+"###"                                                                        NL
+"### Every shard being packed keeps placement information for its items"     NL
+"### in memory.  This limits that amount per shard,  i.e. the total may"     NL
+"### be up to 'concurrency' times this value.  Larger values allow for"      NL
+"### better item placement in very large shards."                            NL
+"### max-mem is given in MBytes and with a default of 64 MBytes."            NL
+"# " CONFIG_OPTION_MAX_MEM " = 64"                                           NL
 ;
 #undef NL
   return svn_io_file_create(svn_dirent_join(fs->path, PATH_CONFIG, pool),
@@ -1800,6 +2093,9 @@ svn_fs_fs__create(svn_fs_t *fs,
           case 8: format = 6;
                   break;
 
+          case 9: format = 7;
+                  break;
+
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
 
@@ -2151,8 +2447,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 7:
       (*supports_version)->minor = 9;
       break;
+    case 8:
+      (*supports_version)->minor = 10;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 7
+# if SVN_FS_FS__FORMAT_NUMBER != 8
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
@@ -160,7 +160,12 @@ digest_path_from_path(const char **digest_path,
    empty, if the versioned path in FS represented by DIGEST_PATH has
    no children) and LOCK (which may be NULL if that versioned path is
    lock itself locked).  Set the permissions of DIGEST_PATH to those of
-   PERMS_REFERENCE.  Use POOL for all allocations.
+   PERMS_REFERENCE.
+
+   KNOWN_DIRS, if not NULL, maps the digest directories that are known to
+   exist to themselves.  Batch operations use it to create each of them
+   only once instead of once per digest file.  Use POOL for all
+   allocations.
  */
 static svn_error_t *
 write_digest_file(apr_hash_t *children,
@@ -168,6 +173,7 @@ write_digest_file(apr_hash_t *children,
                   const char *fs_path,
                   const char *digest_path,
                   const char *perms_reference,
+                  apr_hash_t *known_dirs,
                   apr_pool_t *pool)
 {
   svn_error_t *err = SVN_NO_ERROR;
@@ -175,11 +181,22 @@ write_digest_file(apr_hash_t *children,
   apr_hash_index_t *hi;
   apr_hash_t *hash = apr_hash_make(pool);
   const char *tmp_path;
+  const char *digest_dir = svn_dirent_dirname(digest_path, pool);
+
+  if (!known_dirs || !svn_hash_gets(known_dirs, digest_dir))
+    {
+      SVN_ERR(svn_fs_fs__ensure_dir_exists(svn_dirent_join(fs_path,
+                                                           PATH_LOCKS_DIR,
+                                                           pool),
+                                           fs_path, pool));
+      SVN_ERR(svn_fs_fs__ensure_dir_exists(digest_dir, fs_path, pool));
 
-  SVN_ERR(svn_fs_fs__ensure_dir_exists(svn_dirent_join(fs_path, PATH_LOCKS_DIR,
-                                                       pool), fs_path, pool));
-  SVN_ERR(svn_fs_fs__ensure_dir_exists(svn_dirent_dirname(digest_path, pool),
-                                       fs_path, pool));
+      if (known_dirs)
+        {
+          digest_dir = apr_pstrdup(apr_hash_pool_get(known_dirs), digest_dir);
+          svn_hash_sets(known_dirs, digest_dir, digest_dir);
+        }
+    }
 
   if (lock)
     {
@@ -218,7 +235,7 @@ write_digest_file(apr_hash_t *children,
     }
 
   SVN_ERR(svn_stream_open_unique(&stream, &tmp_path,
-                                 svn_dirent_dirname(digest_path, pool),
+                                 digest_dir,
                                  svn_io_file_del_none, pool, pool));
   if ((err = svn_hash_write2(hash, stream, SVN_HASH_TERMINATOR, pool)))
     {
@@ -339,11 +356,13 @@ read_digest_file(apr_hash_t **children_p,
 /* Write LOCK in FS to the actual OS filesystem.
 
    Use PERMS_REFERENCE for the permissions of any digest files.
+   KNOWN_DIRS is as for write_digest_file().
  */
 static svn_error_t *
 set_lock(const char *fs_path,
          svn_lock_t *lock,
          const char *perms_reference,
+         apr_hash_t *known_dirs,
          apr_pool_t *pool)
 {
   const char *digest_path;
@@ -356,7 +375,7 @@ set_lock(const char *fs_path,
   SVN_ERR(read_digest_file(&children, NULL, fs_path, digest_path, pool));
 
   SVN_ERR(write_digest_file(children, lock, fs_path, digest_path,
-                            perms_reference, pool));
+                            perms_reference, known_dirs, pool));
 
   return SVN_NO_ERROR;
 }
@@ -375,11 +394,16 @@ delete_lock(const char *fs_path,
   return SVN_NO_ERROR;
 }
 
+/* Add the digest file names DIGEST_FILES to the children list of the
+   digest file for INDEX_PATH in FS.  PERMS_REFERENCE and KNOWN_DIRS are
+   as for write_digest_file().
+ */
 static svn_error_t *
 add_to_digest(const char *fs_path,
-              apr_array_header_t *paths,
+              apr_array_header_t *digest_files,
               const char *index_path,
               const char *perms_reference,
+              apr_hash_t *known_dirs,
               apr_pool_t *pool)
 {
   const char *index_digest_path;
@@ -394,28 +418,28 @@ add_to_digest(const char *fs_path,
 
   original_count = apr_hash_count(children);
 
-  for (i = 0; i < paths->nelts; ++i)
-    {
-      const char *path = APR_ARRAY_IDX(paths, i, const char *);
-      const char *digest_path, *digest_file;
-
-      SVN_ERR(digest_path_from_path(&digest_path, fs_path, path, pool));
-      digest_file = svn_dirent_basename(digest_path, NULL);
-      svn_hash_sets(children, digest_file, (void *)1);
-    }
+  for (i = 0; i < digest_files->nelts; ++i)
+    svn_hash_sets(children, APR_ARRAY_IDX(digest_files, i, const char *),
+                  (void *)1);
 
   if (apr_hash_count(children) != original_count)
     SVN_ERR(write_digest_file(children, lock, fs_path, index_digest_path,
-                              perms_reference, pool));
+                              perms_reference, known_dirs, pool));
 
   return SVN_NO_ERROR;
 }
 
+/* Remove the digest file names DIGEST_FILES from the children list of
+   the digest file for INDEX_PATH in FS and delete that file once it has
+   become empty.  PERMS_REFERENCE and KNOWN_DIRS are as for
+   write_digest_file().
+ */
 static svn_error_t *
 delete_from_digest(const char *fs_path,
-                   apr_array_header_t *paths,
+                   apr_array_header_t *digest_files,
                    const char *index_path,
                    const char *perms_reference,
+                   apr_hash_t *known_dirs,
                    apr_pool_t *pool)
 {
   const char *index_digest_path;
@@ -427,19 +451,13 @@ delete_from_digest(const char *fs_path,
 
   SVN_ERR(read_digest_file(&children, &lock, fs_path, index_digest_path, pool));
 
-  for (i = 0; i < paths->nelts; ++i)
-    {
-      const char *path = APR_ARRAY_IDX(paths, i, const char *);
-      const char *digest_path, *digest_file;
-
-      SVN_ERR(digest_path_from_path(&digest_path, fs_path, path, pool));
-      digest_file = svn_dirent_basename(digest_path, NULL);
-      svn_hash_sets(children, digest_file, NULL);
-    }
+  for (i = 0; i < digest_files->nelts; ++i)
+    svn_hash_sets(children, APR_ARRAY_IDX(digest_files, i, const char *),
+                  NULL);
 
   if (apr_hash_count(children) || lock)
     SVN_ERR(write_digest_file(children, lock, fs_path, index_digest_path,
-                              perms_reference, pool));
+                              perms_reference, known_dirs, pool));
   else
     SVN_ERR(svn_io_remove_file2(index_digest_path, TRUE, pool));
 
@@ -670,15 +688,19 @@ svn_fs_fs__allow_locked_operation(const char *path,
 
 /* Helper function called from the lock and unlock code.
    UPDATES is a map from "const char *" parent paths to "apr_array_header_t *"
-   arrays of child paths.  For all of the parent paths of PATH this function
-   adds PATH to the corresponding array of child paths. */
-static void
+   arrays of child digest file names.  For all of the parent paths of PATH
+   this function adds the digest file name of PATH to the corresponding
+   array.  That name gets calculated only once per PATH. */
+static svn_error_t *
 schedule_index_update(apr_hash_t *updates,
                       const char *path,
                       apr_pool_t *scratch_pool)
 {
   apr_pool_t *hashpool = apr_hash_pool_get(updates);
   const char *parent_path = path;
+  const char *digest_file;
+
+  SVN_ERR(make_digest(&digest_file, path, hashpool));
 
   while (! svn_fspath__is_root(parent_path, strlen(parent_path)))
     {
@@ -693,8 +715,10 @@ schedule_index_update(apr_hash_t *updates,
           svn_hash_sets(updates, apr_pstrdup(hashpool, parent_path), children);
         }
 
-      APR_ARRAY_PUSH(children, const char *) = path;
+      APR_ARRAY_PUSH(children, const char *) = digest_file;
     }
+
+  return SVN_NO_ERROR;
 }
 
 /* The effective arguments for lock_body() below. */
@@ -843,6 +867,7 @@ lock_body(void *baton, apr_pool_t *pool)
   const char *rev_0_path;
   int i;
   apr_hash_t *index_updates = apr_hash_make(pool);
+  apr_hash_t *known_dirs = apr_hash_make(pool);
   apr_hash_index_t *hi;
   apr_pool_t *iterpool = svn_pool_create(pool);
 
@@ -871,7 +896,7 @@ lock_body(void *baton, apr_pool_t *pool)
       /* If no error occurred while pre-checking, schedule the index updates for
          this path. */
       if (!info.fs_err)
-        schedule_index_update(index_updates, info.path, iterpool);
+        SVN_ERR(schedule_index_update(index_updates, info.path, iterpool));
 
       APR_ARRAY_PUSH(lb->infos, struct lock_info_t) = info;
     }
@@ -894,7 +919,7 @@ lock_body(void *baton, apr_pool_t *pool)
 
       svn_pool_clear(iterpool);
       SVN_ERR(add_to_digest(lb->fs->path, children, path, rev_0_path,
-                            iterpool));
+                            known_dirs, iterpool));
     }
 
   for (i = 0; i < lb->infos->nelts; ++i)
@@ -926,7 +951,7 @@ lock_body(void *baton, apr_pool_t *pool)
           info->lock->expiration_date = lb->expiration_date;
 
           info->fs_err = set_lock(lb->fs->path, info->lock, rev_0_path,
-                                  iterpool);
+                                  known_dirs, iterpool);
         }
     }
 
@@ -995,6 +1020,7 @@ unlock_body(void *baton, apr_pool_t *pool)
   const char *rev_0_path;
   int i;
   apr_hash_t *indices_updates = apr_hash_make(pool);
+  apr_hash_t *known_dirs = apr_hash_make(pool);
   apr_hash_index_t *hi;
   apr_pool_t *iterpool = svn_pool_create(pool);
 
@@ -1021,7 +1047,7 @@ unlock_body(void *baton, apr_pool_t *pool)
       /* If no error occurred while pre-checking, schedule the index updates for
          this path. */
       if (!info.fs_err)
-        schedule_index_update(indices_updates, info.path, iterpool);
+        SVN_ERR(schedule_index_update(indices_updates, info.path, iterpool));
 
       APR_ARRAY_PUSH(ub->infos, struct unlock_info_t) = info;
     }
@@ -1052,7 +1078,7 @@ unlock_body(void *baton, apr_pool_t *pool)
 
       svn_pool_clear(iterpool);
       SVN_ERR(delete_from_digest(ub->fs->path, children, path, rev_0_path,
-                                 iterpool));
+                                 known_dirs, iterpool));
     }
 
   svn_pool_destroy(iterpool);
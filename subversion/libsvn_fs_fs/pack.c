@@ -22,9 +22,14 @@
 #include <assert.h>
 #include <string.h>
 
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+
 #include "svn_pools.h"
 #include "svn_dirent_uri.h"
 #include "svn_sorts.h"
+#include "svn_cache_config.h"
 #include "private/svn_temp_serializer.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
@@ -84,11 +89,6 @@
  * Finally, after the last range of revisions, create the final indexes.
  */
 
-/* Maximum amount of memory we allocate for placement information during
- * the pack process.
- */
-#define DEFAULT_MAX_MEM (64 * 1024 * 1024)
-
 /* Data structure describing a node change at PATH, REVISION.
  * We will sort these instances by PATH and NODE_ID such that we can combine
  * similar nodes in the same reps container and store containers in path
@@ -1862,6 +1862,33 @@ synced_pack_shard(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* The packed rev shard described by BATON has been written.  Make it
+ * replace the non-packed one, pack the respective revprops and notify
+ * the caller that the shard has been completed.
+ */
+static svn_error_t *
+switch_to_packed_shard(struct pack_baton *baton,
+                       apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = baton->fs->fsap_data;
+
+  /* For newer repo formats, we only acquired the pack lock so far.
+     Before modifying the repo state by switching over to the packed
+     data, we need to acquire the global (write) lock. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
+    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
+                                       pool));
+  else
+    SVN_ERR(synced_pack_shard(baton, pool));
+
+  /* Notify caller we're starting to pack this shard. */
+  if (baton->notify_func)
+    SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
+                               svn_fs_pack_notify_end, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Pack the shard described by BATON.
  *
  * If for some reason we detect a partial packing already performed,
@@ -1894,26 +1921,344 @@ pack_shard(struct pack_baton *baton,
   /* pack the revision content */
   SVN_ERR(pack_rev_shard(baton->fs, rev_pack_file_dir, baton->rev_shard_path,
                          baton->shard, ffd->max_files_per_dir,
-                         DEFAULT_MAX_MEM, baton->cancel_func,
+                         ffd->pack_max_mem, baton->cancel_func,
                          baton->cancel_baton, pool));
 
-  /* For newer repo formats, we only acquired the pack lock so far.
-     Before modifying the repo state by switching over to the packed
-     data, we need to acquire the global (write) lock. */
-  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
-    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
-                                       pool));
-  else
-    SVN_ERR(synced_pack_shard(baton, pool));
+  return svn_error_trace(switch_to_packed_shard(baton, pool));
+}
 
-  /* Notify caller we're starting to pack this shard. */
-  if (baton->notify_func)
-    SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
-                               svn_fs_pack_notify_end, pool));
+#if APR_HAS_THREADS
+
+/* Number of rev shards per worker that may be packed ahead of the oldest
+ * one not yet switched over to.  Every one of those temporarily doubles
+ * the disk space used by its revisions. */
+#define PACK_SHARDS_PER_JOB 2
+
+/* A single rev shard to be packed by some worker thread. */
+typedef struct pack_job_t
+{
+  /* The shard to pack. */
+  apr_int64_t shard;
+
+  /* Set once the worker is done with this shard. */
+  svn_boolean_t done;
+
+  /* Result of pack_rev_shard() for this shard. */
+  svn_error_t *err;
+} pack_job_t;
+
+/* State shared between the pack_body() thread and the workers.  Access
+ * to all non-constant members must be serialized with MUTEX. */
+typedef struct pack_queue_t
+{
+  /* Serializes access to this struct and the JOBS elements. */
+  apr_thread_mutex_t *mutex;
+
+  /* Signaled whenever a job has been completed or any of the counters
+   * below changed. */
+  apr_thread_cond_t *changed;
+
+  /* Shards to pack, in ascending order.  Elements are pack_job_t. */
+  apr_array_header_t *jobs;
+
+  /* Index of the next job to hand out to a worker. */
+  int next_job;
+
+  /* Index of the oldest job whose shard has not been switched over to. */
+  int next_to_switch;
+
+  /* Maximum value of NEXT_JOB - NEXT_TO_SWITCH. */
+  int window_size;
+
+  /* If set, workers shall not pick up new jobs. */
+  svn_boolean_t stop;
+
+  /* Constant per-pack settings. */
+  const char *revs_dir;
+  int max_files_per_dir;
+  apr_size_t max_mem;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} pack_queue_t;
+
+/* A worker thread and the data it owns. */
+typedef struct pack_worker_t
+{
+  /* The queue to get jobs from. */
+  pack_queue_t *queue;
+
+  /* Private FS instance.  FS caches are not thread-safe. */
+  svn_fs_t *fs;
+
+  /* Root pool owned by this worker.  Also contains FS. */
+  apr_pool_t *pool;
+
+  /* The thread running this worker. */
+  apr_thread_t *thread;
+} pack_worker_t;
+
+/* Set *WORKER_FS to a new instance of the already open FS, allocated in
+ * RESULT_POOL.  Both will share the FS-global data but not their caches.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+open_worker_fs(svn_fs_t **worker_fs,
+               svn_fs_t *fs,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_data_t *worker_ffd = apr_pcalloc(result_pool, sizeof(*worker_ffd));
+  svn_fs_t *result = apr_pcalloc(result_pool, sizeof(*result));
+
+  result->pool = result_pool;
+  result->warning = fs->warning;
+  result->warning_baton = fs->warning_baton;
+  result->config = fs->config;
+  result->vtable = fs->vtable;
+  result->fsap_data = worker_ffd;
+
+  worker_ffd->shared = ffd->shared;
+  worker_ffd->svn_fs_open_ = ffd->svn_fs_open_;
+
+  SVN_ERR(svn_fs_fs__open(result, fs->path, scratch_pool));
+  SVN_ERR(svn_fs_fs__initialize_caches(result, scratch_pool));
 
+  *worker_fs = result;
   return SVN_NO_ERROR;
 }
 
+/* Thread function implementing the pack_worker_t given as DATA.
+ * Pack rev shards from the queue until there are none left or the queue
+ * has been stopped. */
+static void * APR_THREAD_FUNC
+pack_worker_thread(apr_thread_t *thread,
+                   void *data)
+{
+  pack_worker_t *worker = data;
+  pack_queue_t *queue = worker->queue;
+  apr_pool_t *iterpool = svn_pool_create(worker->pool);
+
+  while (TRUE)
+    {
+      pack_job_t *job;
+      const char *shard_str;
+      svn_error_t *err;
+
+      /* Get the next shard to pack.  Don't get too far ahead of the
+       * thread switching over to the packed shards. */
+      apr_thread_mutex_lock(queue->mutex);
+      while (   !queue->stop
+             && queue->next_job < queue->jobs->nelts
+             && queue->next_job
+                  >= queue->next_to_switch + queue->window_size)
+        apr_thread_cond_wait(queue->changed, queue->mutex);
+
+      if (queue->stop || queue->next_job >= queue->jobs->nelts)
+        {
+          apr_thread_mutex_unlock(queue->mutex);
+          break;
+        }
+
+      job = &APR_ARRAY_IDX(queue->jobs, queue->next_job, pack_job_t);
+      queue->next_job++;
+      apr_thread_mutex_unlock(queue->mutex);
+
+      /* JOB is ours until we mark it as "done". */
+      svn_pool_clear(iterpool);
+      shard_str = apr_psprintf(iterpool, "%" APR_INT64_T_FMT, job->shard);
+      err = pack_rev_shard(worker->fs,
+                           svn_dirent_join(queue->revs_dir,
+                                           apr_pstrcat(iterpool, shard_str,
+                                                       PATH_EXT_PACKED_SHARD,
+                                                       SVN_VA_NULL),
+                                           iterpool),
+                           svn_dirent_join(queue->revs_dir, shard_str,
+                                           iterpool),
+                           job->shard, queue->max_files_per_dir,
+                           queue->max_mem, queue->cancel_func,
+                           queue->cancel_baton, iterpool);
+
+      /* There is no point in starting new jobs after a failure. */
+      apr_thread_mutex_lock(queue->mutex);
+      job->err = err;
+      job->done = TRUE;
+      if (err)
+        queue->stop = TRUE;
+      apr_thread_cond_broadcast(queue->changed);
+      apr_thread_mutex_unlock(queue->mutex);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Don't call apr_thread_exit() here.  It would destroy the thread's
+   * pool, which is a sub-pool of one owned by the pack_body() thread. */
+  return NULL;
+}
+
+/* Tell all workers in QUEUE to stop and wait for the COUNT threads in
+ * WORKERS to terminate.  Release the worker pools and clear all errors
+ * left in the jobs of QUEUE. */
+static void
+stop_pack_workers(pack_queue_t *queue,
+                  pack_worker_t *workers,
+                  int count)
+{
+  int i;
+  apr_status_t retval;
+
+  apr_thread_mutex_lock(queue->mutex);
+  queue->stop = TRUE;
+  apr_thread_cond_broadcast(queue->changed);
+  apr_thread_mutex_unlock(queue->mutex);
+
+  for (i = 0; i < count; ++i)
+    apr_thread_join(&retval, workers[i].thread);
+
+  for (i = 0; i < count; ++i)
+    svn_pool_destroy(workers[i].pool);
+
+  for (i = 0; i < queue->jobs->nelts; ++i)
+    svn_error_clear(APR_ARRAY_IDX(queue->jobs, i, pack_job_t).err);
+}
+
+/* Pack the rev shards FIRST_SHARD up to but not including END_SHARD as
+ * described by PB using up to CONCURRENCY worker threads.  Each worker
+ * gets its own instance of PB->FS.  The shards get switched over to and
+ * notifications are sent from this thread in shard order.  Use POOL for
+ * temporary allocations. */
+static svn_error_t *
+pack_shards_in_parallel(struct pack_baton *pb,
+                        apr_int64_t first_shard,
+                        apr_int64_t end_shard,
+                        int concurrency,
+                        apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = pb->fs->fsap_data;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  pack_queue_t *queue = apr_pcalloc(pool, sizeof(*queue));
+  pack_worker_t *workers;
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_status_t status;
+  apr_int64_t shard;
+  int started = 0;
+  int i;
+
+  /* Don't start more threads than there are shards to pack. */
+  if (concurrency > end_shard - first_shard)
+    concurrency = (int)(end_shard - first_shard);
+
+  queue->jobs = apr_array_make(pool, (int)(end_shard - first_shard),
+                               sizeof(pack_job_t));
+  for (shard = first_shard; shard < end_shard; ++shard)
+    {
+      pack_job_t *job = apr_array_push(queue->jobs);
+      job->shard = shard;
+      job->done = FALSE;
+      job->err = SVN_NO_ERROR;
+    }
+
+  queue->window_size = concurrency * PACK_SHARDS_PER_JOB;
+  queue->revs_dir = pb->revs_dir;
+  queue->max_files_per_dir = ffd->max_files_per_dir;
+  queue->max_mem = ffd->pack_max_mem;
+  queue->cancel_func = pb->cancel_func;
+  queue->cancel_baton = pb->cancel_baton;
+
+  status = apr_thread_mutex_create(&queue->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                   pool);
+  if (!status)
+    status = apr_thread_cond_create(&queue->changed, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create pack queue"));
+
+  /* Open a separate FS instance for each worker. */
+  workers = apr_pcalloc(pool, concurrency * sizeof(*workers));
+  for (i = 0; i < concurrency; ++i)
+    {
+      workers[i].queue = queue;
+      workers[i].pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+      err = open_worker_fs(&workers[i].fs, pb->fs, workers[i].pool,
+                           iterpool);
+      if (err)
+        break;
+    }
+
+  /* Start the workers. */
+  for (started = 0; !err && started < concurrency; ++started)
+    {
+      status = apr_thread_create(&workers[started].thread, NULL,
+                                 pack_worker_thread, &workers[started],
+                                 pool);
+      if (status)
+        err = svn_error_wrap_apr(status, _("Can't create thread"));
+    }
+
+  if (err)
+    {
+      if (started)
+        --started;
+
+      stop_pack_workers(queue, workers, started);
+      for (i = started; i < concurrency; ++i)
+        if (workers[i].pool)
+          svn_pool_destroy(workers[i].pool);
+
+      return svn_error_trace(err);
+    }
+
+  /* Switch over to the packed shards in order as they become available. */
+  for (i = 0; i < queue->jobs->nelts; ++i)
+    {
+      pack_job_t *job = &APR_ARRAY_IDX(queue->jobs, i, pack_job_t);
+      svn_pool_clear(iterpool);
+
+      apr_thread_mutex_lock(queue->mutex);
+      while (!job->done && !(queue->stop && i >= queue->next_job))
+        apr_thread_cond_wait(queue->changed, queue->mutex);
+      apr_thread_mutex_unlock(queue->mutex);
+
+      /* Job has not been picked up because another one failed?
+       * Then, we will have reported that failure already. */
+      if (!job->done)
+        break;
+
+      err = job->err;
+      job->err = SVN_NO_ERROR;
+      if (err)
+        break;
+
+      pb->shard = job->shard;
+      pb->rev_shard_path
+        = svn_dirent_join(pb->revs_dir,
+                          apr_psprintf(iterpool, "%" APR_INT64_T_FMT,
+                                       job->shard),
+                          iterpool);
+
+      if (pb->notify_func)
+        err = pb->notify_func(pb->notify_baton, pb->shard,
+                              svn_fs_pack_notify_start, iterpool);
+      if (!err)
+        err = switch_to_packed_shard(pb, iterpool);
+      if (err)
+        break;
+
+      /* Allow the workers to proceed to the next shards. */
+      apr_thread_mutex_lock(queue->mutex);
+      queue->next_to_switch = i + 1;
+      apr_thread_cond_broadcast(queue->changed);
+      apr_thread_mutex_unlock(queue->mutex);
+    }
+
+  stop_pack_workers(queue, workers, concurrency);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
+#endif /* APR_HAS_THREADS */
+
 /* The work-horse for svn_fs_fs__pack, called with the FS write lock.
    This implements the svn_fs_fs__with_write_lock() 'body' callback
    type.  BATON is a 'struct pack_baton *'.
@@ -1964,6 +2309,19 @@ pack_body(void *baton,
     pb->revsprops_dir = svn_dirent_join(pb->fs->path, PATH_REVPROPS_DIR,
                                         pool);
 
+#if APR_HAS_THREADS
+  /* Worker threads need their own FS instances, which share the global
+   * caches.  That is only possible if those are thread-safe. */
+  if (   ffd->pack_concurrency > 1
+      && !svn_cache_config_get()->single_threaded
+      && ffd->min_unpacked_rev / ffd->max_files_per_dir + 1
+           < completed_shards)
+    return svn_error_trace(pack_shards_in_parallel(pb,
+                              ffd->min_unpacked_rev / ffd->max_files_per_dir,
+                              completed_shards, ffd->pack_concurrency,
+                              pool));
+#endif
+
   iterpool = svn_pool_create(pool);
   for (pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
        pb->shard < completed_shards;
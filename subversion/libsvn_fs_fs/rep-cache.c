@@ -21,6 +21,7 @@
  */
 
 #include "svn_pools.h"
+#include "svn_sorts.h"
 
 #include "svn_private_config.h"
 
@@ -39,8 +40,56 @@
 /* A few magic values */
 #define REP_CACHE_SCHEMA_FORMAT   1
 
+/* (Re-)build the rep-cache filter once this many lookups had to consult
+   the database.  Building it requires a full scan of the database, which
+   only pays off for bulk operations and long-running servers. */
+#define REP_CACHE_FILTER_THRESHOLD    1000
+
+/* Don't scan the database for the rep-cache filter more often than this.
+   Commits by other processes make the filter stale every time, which
+   must not turn every 1000th lookup into a full database scan. */
+#define REP_CACHE_FILTER_UPDATE_INTERVAL apr_time_from_sec(60)
+
+/* Size the filter for at least this many entries. */
+#define REP_CACHE_FILTER_MIN_ENTRIES  0x10000
+
+/* Number of filter bits per entry and number of bits set per entry.
+   This results in a false positive rate of about 0.25%. */
+#define REP_CACHE_FILTER_BITS_PER_ENTRY 16
+#define REP_CACHE_FILTER_HASHES         4
+
 REP_CACHE_DB_SQL_DECLARE_STATEMENTS(statements);
 
+/* A Bloom filter over the SHA1 digests in the rep-cache database.  It is
+   shared between all svn_fs_t instances of a repository within the
+   process.  A negative answer means that there is no such entry in the
+   database and we can skip the query.  Since digests are uniformly
+   distributed, we simply derive the bit positions from the digest itself.
+
+   Entries added by other processes are only picked up when the filter
+   gets updated.  Until then, the filter is considered stale as soon as
+   a newer revision than REVISION has been seen and it will not be used.
+   An update may still miss entries that get written after the revision
+   itself has been committed.  That only reduces rep-sharing but never
+   produces wrong results. */
+typedef struct rep_cache_filter_t
+{
+  /* The bit array.  Its size in bits is BIT_MASK + 1, a power of 2. */
+  apr_uint32_t *bits;
+  apr_uint64_t bit_mask;
+
+  /* Number of digests added so far and the number at which the false
+     positive rate becomes high enough to warrant a rebuild. */
+  apr_int64_t entries;
+  apr_int64_t capacity;
+
+  /* The filter contains all entries for revisions up to this one. */
+  svn_revnum_t revision;
+
+  /* Root pool owning this filter. */
+  apr_pool_t *pool;
+} rep_cache_filter_t;
+
 
 
 /** Helper functions. **/
@@ -52,6 +101,246 @@ path_rep_cache_db(const char *fs_path,
 }
 
 
+/* Add DIGEST to FILTER. */
+static void
+filter_add(rep_cache_filter_t *filter,
+           const unsigned char *digest)
+{
+  apr_uint64_t h1, h2;
+  int i;
+
+  memcpy(&h1, digest, sizeof(h1));
+  memcpy(&h2, digest + sizeof(h1), sizeof(h2));
+
+  for (i = 0; i < REP_CACHE_FILTER_HASHES; ++i, h1 += h2)
+    {
+      apr_uint64_t bit = h1 & filter->bit_mask;
+      filter->bits[bit / 32] |= (apr_uint32_t)1 << (bit % 32);
+    }
+
+  ++filter->entries;
+}
+
+/* Return TRUE if DIGEST may have been added to FILTER. */
+static svn_boolean_t
+filter_contains(rep_cache_filter_t *filter,
+                const unsigned char *digest)
+{
+  apr_uint64_t h1, h2;
+  int i;
+
+  memcpy(&h1, digest, sizeof(h1));
+  memcpy(&h2, digest + sizeof(h1), sizeof(h2));
+
+  for (i = 0; i < REP_CACHE_FILTER_HASHES; ++i, h1 += h2)
+    {
+      apr_uint64_t bit = h1 & filter->bit_mask;
+      if ((filter->bits[bit / 32] & ((apr_uint32_t)1 << (bit % 32))) == 0)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Walker function for walk_rep_reference() that adds REP to the
+   rep_cache_filter_t given as BATON. */
+static svn_error_t *
+add_to_filter(representation_t *rep,
+              void *baton,
+              svn_fs_t *fs,
+              apr_pool_t *scratch_pool)
+{
+  filter_add(baton, rep->sha1_digest);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+walk_rep_reference(svn_fs_t *fs,
+                   svn_revnum_t start,
+                   svn_revnum_t end,
+                   svn_error_t *(*walker)(representation_t *,
+                                          void *,
+                                          svn_fs_t *,
+                                          apr_pool_t *),
+                   void *walker_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool);
+
+/* Set *FILTER_P to a new filter containing all entries in the rep-cache
+   of FS for revisions up to YOUNGEST.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+build_filter(rep_cache_filter_t **filter_p,
+             svn_fs_t *fs,
+             svn_revnum_t youngest,
+             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_sqlite__stmt_t *stmt;
+  apr_int64_t count;
+  apr_uint64_t bit_count = 64;
+  apr_pool_t *pool;
+  rep_cache_filter_t *filter;
+  svn_error_t *err;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
+                                    STMT_GET_REP_COUNT));
+  SVN_ERR(svn_sqlite__step_row(stmt));
+  count = svn_sqlite__column_int64(stmt, 0);
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  /* The filter may outlive FS.  Leave room for growth. */
+  pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  filter = apr_pcalloc(pool, sizeof(*filter));
+  filter->capacity = MAX(2 * count, REP_CACHE_FILTER_MIN_ENTRIES);
+  while (bit_count < filter->capacity * REP_CACHE_FILTER_BITS_PER_ENTRY)
+    bit_count *= 2;
+
+  filter->bits = apr_pcalloc(pool, (apr_size_t)(bit_count / 8));
+  filter->bit_mask = bit_count - 1;
+  filter->revision = youngest;
+  filter->pool = pool;
+
+  err = walk_rep_reference(fs, 0, youngest, add_to_filter, filter,
+                           NULL, NULL, scratch_pool);
+  if (err)
+    {
+      svn_pool_destroy(pool);
+      return svn_error_trace(err);
+    }
+
+  *filter_p = filter;
+  return SVN_NO_ERROR;
+}
+
+/* Body of filter_lookup(), to be called while holding the rep-cache
+   lock. */
+static svn_error_t *
+filter_lookup_body(svn_boolean_t *maybe,
+                   svn_fs_t *fs,
+                   const unsigned char *digest,
+                   apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_shared_data_t *ffsd = ffd->shared;
+  rep_cache_filter_t *filter = ffsd->rep_cache_filter;
+  svn_boolean_t usable;
+  apr_time_t now;
+
+  usable = filter && filter->revision >= ffd->youngest_rev_cache;
+  if (usable)
+    {
+      *maybe = filter_contains(filter, digest);
+      if (!*maybe)
+        return SVN_NO_ERROR;
+
+      /* Even a perfect filter needs no rebuild for true positives. */
+      if (filter->entries <= filter->capacity)
+        return SVN_NO_ERROR;
+    }
+
+  /* We will have to consult the database.  Don't let that happen too
+     often if a new or updated filter could prevent it. */
+  *maybe = TRUE;
+  if (++ffsd->rep_cache_lookups < REP_CACHE_FILTER_THRESHOLD)
+    return SVN_NO_ERROR;
+
+  now = apr_time_now();
+  if (   ffsd->rep_cache_filter_updated
+      && now - ffsd->rep_cache_filter_updated
+           < REP_CACHE_FILTER_UPDATE_INTERVAL)
+    return SVN_NO_ERROR;
+
+  ffsd->rep_cache_filter_updated = now;
+  ffsd->rep_cache_lookups = 0;
+
+  if (filter && filter->entries <= filter->capacity)
+    {
+      /* The filter is merely stale.  Add the entries that other processes
+         wrote since, instead of starting from scratch. */
+      SVN_ERR(walk_rep_reference(fs, filter->revision + 1,
+                                 ffd->youngest_rev_cache,
+                                 add_to_filter, filter, NULL, NULL,
+                                 scratch_pool));
+      filter->revision = ffd->youngest_rev_cache;
+    }
+  else
+    {
+      if (filter)
+        {
+          ffsd->rep_cache_filter = NULL;
+          svn_pool_destroy(filter->pool);
+        }
+
+      SVN_ERR(build_filter(&filter, fs, ffd->youngest_rev_cache,
+                           scratch_pool));
+      ffsd->rep_cache_filter = filter;
+    }
+
+  *maybe = filter_contains(filter, digest);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *MAYBE to FALSE, if the rep-cache of FS definitely does not contain
+   an entry for DIGEST.  Otherwise, set it to TRUE.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+filter_lookup(svn_boolean_t *maybe,
+              svn_fs_t *fs,
+              const unsigned char *digest,
+              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  SVN_MUTEX__WITH_LOCK(ffd->shared->rep_cache_lock,
+                       filter_lookup_body(maybe, fs, digest, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Body of filter_add_reps(), to be called while holding the rep-cache
+   lock. */
+static svn_error_t *
+filter_add_reps_body(svn_fs_t *fs,
+                     const apr_array_header_t *reps,
+                     svn_revnum_t revision)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  rep_cache_filter_t *filter = ffd->shared->rep_cache_filter;
+  int i;
+
+  if (filter == NULL)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < reps->nelts; ++i)
+    filter_add(filter, APR_ARRAY_IDX(reps, i, representation_t *)
+                         ->sha1_digest);
+
+  /* If no other process committed in between, the filter is still
+     complete. */
+  if (filter->revision == revision - 1)
+    filter->revision = revision;
+
+  return SVN_NO_ERROR;
+}
+
+/* Add the representation_t * in REPS, which have just been committed
+   to FS as part of REVISION, to the rep-cache filter, if there is one. */
+static svn_error_t *
+filter_add_reps(svn_fs_t *fs,
+                const apr_array_header_t *reps,
+                svn_revnum_t revision)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  SVN_MUTEX__WITH_LOCK(ffd->shared->rep_cache_lock,
+                       filter_add_reps_body(fs, reps, revision));
+
+  return SVN_NO_ERROR;
+}
+
+
 /** Library-private API's. **/
 
 /* Body of svn_fs_fs__open_rep_cache().
@@ -138,18 +427,19 @@ svn_fs_fs__exists_rep_cache(svn_boolean_t *exists,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_fs_fs__walk_rep_reference(svn_fs_t *fs,
-                              svn_revnum_t start,
-                              svn_revnum_t end,
-                              svn_error_t *(*walker)(representation_t *,
-                                                     void *,
-                                                     svn_fs_t *,
-                                                     apr_pool_t *),
-                              void *walker_baton,
-                              svn_cancel_func_t cancel_func,
-                              void *cancel_baton,
-                              apr_pool_t *pool)
+/* Body of svn_fs_fs__walk_rep_reference() that ignores pending entries. */
+static svn_error_t *
+walk_rep_reference(svn_fs_t *fs,
+                   svn_revnum_t start,
+                   svn_revnum_t end,
+                   svn_error_t *(*walker)(representation_t *,
+                                          void *,
+                                          svn_fs_t *,
+                                          apr_pool_t *),
+                   void *walker_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   svn_sqlite__stmt_t *stmt;
@@ -234,6 +524,27 @@ svn_fs_fs__walk_rep_reference(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__walk_rep_reference(svn_fs_t *fs,
+                              svn_revnum_t start,
+                              svn_revnum_t end,
+                              svn_error_t *(*walker)(representation_t *,
+                                                     void *,
+                                                     svn_fs_t *,
+                                                     apr_pool_t *),
+                              void *walker_baton,
+                              svn_cancel_func_t cancel_func,
+                              void *cancel_baton,
+                              apr_pool_t *pool)
+{
+  SVN_ERR(svn_fs_fs__flush_rep_references(fs, pool));
+
+  return svn_error_trace(walk_rep_reference(fs, start, end,
+                                            walker, walker_baton,
+                                            cancel_func, cancel_baton,
+                                            pool));
+}
+
 
 /* This function's caller ignores most errors it returns.
    If you extend this function, check the callsite to see if you have
@@ -247,6 +558,7 @@ svn_fs_fs__get_rep_reference(representation_t **rep,
   fs_fs_data_t *ffd = fs->fsap_data;
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
+  svn_boolean_t maybe;
 
   SVN_ERR_ASSERT(ffd->rep_sharing_allowed);
   if (! ffd->rep_cache_db)
@@ -258,6 +570,30 @@ svn_fs_fs__get_rep_reference(representation_t **rep,
                             _("Only SHA1 checksums can be used as keys in the "
                               "rep_cache table.\n"));
 
+  /* Entries that have not been written to the database yet. */
+  if (ffd->rep_cache_pending)
+    {
+      representation_t *pending = apr_hash_get(ffd->rep_cache_pending,
+                                               checksum->digest,
+                                               APR_SHA1_DIGESTSIZE);
+      if (pending)
+        {
+          *rep = apr_pmemdup(pool, pending, sizeof(*pending));
+          return SVN_NO_ERROR;
+        }
+    }
+
+  /* Skip the database lookup for most keys that are not in there. */
+  if (ffd->rep_cache_filter_enabled)
+    {
+      SVN_ERR(filter_lookup(&maybe, fs, checksum->digest, pool));
+      if (!maybe)
+        {
+          *rep = NULL;
+          return SVN_NO_ERROR;
+        }
+    }
+
   SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db, STMT_GET_REP));
   SVN_ERR(svn_sqlite__bindf(stmt, "s",
                             svn_checksum_to_cstring(checksum, pool)));
@@ -353,6 +689,144 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Write all pending rep-cache entries of FS to the database.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_pending_reps(svn_fs_t *fs,
+                   apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(scratch_pool, ffd->rep_cache_pending);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_fs__set_rep_reference(fs, apr_hash_this_val(hi),
+                                           iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Write all pending rep-cache entries of FS in a single SQLite
+   transaction.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+flush_pending_reps(svn_fs_t *fs,
+                   apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  /* We use an sqlite transaction to speed things up;
+   * see <http://www.sqlite.org/faq.html#q19>. */
+  SVN_SQLITE__WITH_TXN(write_pending_reps(fs, scratch_pool),
+                       ffd->rep_cache_db);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__flush_rep_references(svn_fs_t *fs,
+                                apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err;
+
+  if (!ffd->rep_cache_pending || apr_hash_count(ffd->rep_cache_pending) == 0)
+    return SVN_NO_ERROR;
+
+  /* Like with unbatched writes, entries that could not be written are
+     lost.  That does not affect the integrity of the repository. */
+  err = flush_pending_reps(fs, scratch_pool);
+  svn_pool_clear(ffd->rep_cache_pending_pool);
+  ffd->rep_cache_pending = NULL;
+
+  return svn_error_trace(err);
+}
+
+/* Pool cleanup function writing all pending rep-cache entries of the
+   svn_fs_t given as BATON.  Errors are ignored. */
+static apr_status_t
+flush_pending_on_close(void *baton)
+{
+  svn_fs_t *fs = baton;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_pool_t *scratch_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+  svn_error_clear(svn_fs_fs__flush_rep_references(fs, scratch_pool));
+
+  svn_pool_destroy(scratch_pool);
+  svn_pool_destroy(ffd->rep_cache_pending_pool);
+  ffd->rep_cache_pending_pool = NULL;
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+svn_fs_fs__add_rep_references(svn_fs_t *fs,
+                              const apr_array_header_t *reps,
+                              svn_revnum_t revision,
+                              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  int i;
+
+  SVN_ERR_ASSERT(ffd->rep_sharing_allowed);
+  if (! ffd->rep_cache_db)
+    SVN_ERR(svn_fs_fs__open_rep_cache(fs, scratch_pool));
+
+  if (!ffd->rep_cache_pending_pool)
+    {
+      /* The pending entries must survive until the cleanup of FS->POOL,
+         which will run before the database gets closed. */
+      ffd->rep_cache_pending_pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      apr_pool_cleanup_register(fs->pool, fs, flush_pending_on_close,
+                                apr_pool_cleanup_null);
+    }
+
+  if (!ffd->rep_cache_pending)
+    ffd->rep_cache_pending = apr_hash_make(ffd->rep_cache_pending_pool);
+
+  for (i = 0; i < reps->nelts; ++i)
+    {
+      representation_t *rep = APR_ARRAY_IDX(reps, i, representation_t *);
+      representation_t *pending;
+
+      /* We only allow SHA1 checksums in this table. */
+      if (! rep->has_sha1)
+        return svn_error_create(SVN_ERR_BAD_CHECKSUM_KIND, NULL,
+                                _("Only SHA1 checksums can be used as keys "
+                                  "in the rep_cache table.\n"));
+
+      /* Keep only what is stored in the database. */
+      pending = apr_pcalloc(ffd->rep_cache_pending_pool, sizeof(*pending));
+      svn_fs_fs__id_txn_reset(&pending->txn_id);
+      memcpy(pending->sha1_digest, rep->sha1_digest,
+             sizeof(pending->sha1_digest));
+      pending->has_sha1 = TRUE;
+      pending->revision = rep->revision;
+      pending->item_index = rep->item_index;
+      pending->size = rep->size;
+      pending->expanded_size = rep->expanded_size;
+
+      apr_hash_set(ffd->rep_cache_pending, pending->sha1_digest,
+                   APR_SHA1_DIGESTSIZE, pending);
+    }
+
+  SVN_ERR(filter_add_reps(fs, reps, revision));
+
+  if (apr_hash_count(ffd->rep_cache_pending) >= ffd->rep_cache_batch_size)
+    SVN_ERR(svn_fs_fs__flush_rep_references(fs, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 
 svn_error_t *
 svn_fs_fs__del_rep_reference(svn_fs_t *fs,
@@ -366,6 +840,7 @@ svn_fs_fs__del_rep_reference(svn_fs_t *fs,
   if (! ffd->rep_cache_db)
     SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
 
+  SVN_ERR(svn_fs_fs__flush_rep_references(fs, pool));
   SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
                                     STMT_DEL_REPS_YOUNGER_THAN_REV));
   SVN_ERR(svn_sqlite__bindf(stmt, "r", youngest));
@@ -383,6 +858,7 @@ svn_fs_fs__lock_rep_cache(svn_fs_t *fs,
   if (! ffd->rep_cache_db)
     SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
 
+  SVN_ERR(svn_fs_fs__flush_rep_references(fs, pool));
   SVN_ERR(svn_sqlite__exec_statements(ffd->rep_cache_db, STMT_LOCK_REP));
 
   return SVN_NO_ERROR;
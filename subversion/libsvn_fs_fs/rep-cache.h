@@ -79,6 +79,24 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
                              representation_t *rep,
                              apr_pool_t *pool);
 
+/* Add the representations in REPS (representation_t *), which have been
+   committed to FS as part of REVISION, to the rep cache database.  The
+   entries may be collected and written together with those of later
+   commits, depending on the configuration.  They will be visible to
+   svn_fs_fs__get_rep_reference() in FS right away, though.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__add_rep_references(svn_fs_t *fs,
+                              const apr_array_header_t *reps,
+                              svn_revnum_t revision,
+                              apr_pool_t *scratch_pool);
+
+/* Write all entries collected by svn_fs_fs__add_rep_references() for FS
+   to the rep cache database.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__flush_rep_references(svn_fs_t *fs,
+                                apr_pool_t *scratch_pool);
+
 /* Delete from the cache all reps corresponding to revisions younger
    than YOUNGEST. */
 svn_error_t *
@@ -20,6 +20,8 @@
  * ====================================================================
  */
 
+#include <apr_mmap.h>
+
 #include "rev_file.h"
 #include "fs_fs.h"
 #include "index.h"
@@ -28,9 +30,15 @@
 
 #include "../libsvn_fs/fs-loader.h"
 
+#include "svn_sorts.h"
 #include "private/svn_io_private.h"
 #include "svn_private_config.h"
 
+/* Maximum number of pack files that we keep mapped per svn_fs_t.
+ * Keeps us well below typical per-process limits for the number of
+ * mappings.  Once reached, further pack files will be read normally. */
+#define MAX_MAPPED_PACK_FILES 1024
+
 /* Initialize the *FILE structure for REVISION in filesystem FS.  Set its
  * pool member to the provided POOL. */
 static void
@@ -46,6 +54,9 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
 
   file->file = NULL;
   file->stream = NULL;
+  file->mapped_data = NULL;
+  file->mapped_size = 0;
+  file->mapped_offset = 0;
   file->p2l_stream = NULL;
   file->l2p_stream = NULL;
   file->block_size = ffd->block_size;
@@ -120,6 +131,183 @@ auto_make_writable(const char *path,
   return SVN_NO_ERROR;
 }
 
+/* svn_stream_mark_t for streams reading from mapped rev files. */
+typedef struct mapped_stream_mark_t
+{
+  apr_off_t offset;
+} mapped_stream_mark_t;
+
+/* Implements svn_read_fn_t for svn_fs_fs__revision_file_t batons with
+ * a mapped pack file. */
+static svn_error_t *
+read_handler_mapped(void *baton,
+                    char *buffer,
+                    apr_size_t *len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  apr_off_t left = file->mapped_size - file->mapped_offset;
+
+  if (left < 0)
+    left = 0;
+  if ((apr_off_t)*len > left)
+    *len = (apr_size_t)left;
+
+  memcpy(buffer, file->mapped_data + file->mapped_offset, *len);
+  file->mapped_offset += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_skip_fn_t for svn_fs_fs__revision_file_t batons
+ * with a mapped pack file. */
+static svn_error_t *
+skip_handler_mapped(void *baton,
+                    apr_size_t len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  file->mapped_offset = MIN(file->mapped_offset + (apr_off_t)len,
+                            file->mapped_size);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_mark_fn_t for svn_fs_fs__revision_file_t batons
+ * with a mapped pack file. */
+static svn_error_t *
+mark_handler_mapped(void *baton,
+                    svn_stream_mark_t **mark,
+                    apr_pool_t *pool)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  mapped_stream_mark_t *marker = apr_palloc(pool, sizeof(*marker));
+
+  marker->offset = file->mapped_offset;
+  *mark = (svn_stream_mark_t *)marker;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_seek_fn_t for svn_fs_fs__revision_file_t batons
+ * with a mapped pack file. */
+static svn_error_t *
+seek_handler_mapped(void *baton,
+                    const svn_stream_mark_t *mark)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  file->mapped_offset = mark
+                      ? ((const mapped_stream_mark_t *)mark)->offset
+                      : 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_data_available_fn_t for svn_fs_fs__revision_file_t
+ * batons with a mapped pack file. */
+static svn_error_t *
+data_available_handler_mapped(void *baton,
+                              svn_boolean_t *data_available)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  *data_available = file->mapped_offset < file->mapped_size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream__is_buffered_fn_t for svn_fs_fs__revision_file_t
+ * batons with a mapped pack file. */
+static svn_boolean_t
+is_buffered_handler_mapped(void *baton)
+{
+  return TRUE;
+}
+
+/* If enabled for FS, make FILE, which must be an open pack file, read its
+ * contents through a memory mapping.  Mappings are kept and re-used for
+ * the lifetime of FS.  If the file cannot be mapped, silently continue
+ * to read it through FILE->FILE.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+auto_map_pack_file(svn_fs_fs__revision_file_t *file,
+                   svn_fs_t *fs,
+                   apr_pool_t *scratch_pool)
+{
+#if APR_HAS_MMAP
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_mmap_t *mapping;
+
+  if (!ffd->mmap_pack_files || !file->is_packed)
+    return SVN_NO_ERROR;
+
+  if (ffd->pack_file_mappings == NULL)
+    ffd->pack_file_mappings = apr_hash_make(fs->pool);
+
+  mapping = apr_hash_get(ffd->pack_file_mappings, &file->start_revision,
+                         sizeof(file->start_revision));
+  if (mapping == NULL)
+    {
+      apr_finfo_t finfo;
+      svn_revnum_t *key;
+
+      if (apr_hash_count(ffd->pack_file_mappings) >= MAX_MAPPED_PACK_FILES)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(svn_io_file_info_get(&finfo, APR_FINFO_SIZE, file->file,
+                                   scratch_pool));
+      if (finfo.size <= 0 || (apr_uint64_t)finfo.size > APR_SIZE_MAX)
+        return SVN_NO_ERROR;
+
+      /* Running out of address space is not an error.  We simply won't
+       * use a mapping for this file. */
+      if (apr_mmap_create(&mapping, file->file, 0, (apr_size_t)finfo.size,
+                          APR_MMAP_READ, fs->pool))
+        return SVN_NO_ERROR;
+
+      key = apr_pmemdup(fs->pool, &file->start_revision,
+                        sizeof(file->start_revision));
+      apr_hash_set(ffd->pack_file_mappings, key, sizeof(*key), mapping);
+    }
+
+  file->mapped_data = mapping->mm;
+  file->mapped_size = (apr_off_t)mapping->size;
+  file->mapped_offset = 0;
+
+  file->stream = svn_stream_create(file, file->pool);
+  svn_stream_set_read2(file->stream, read_handler_mapped,
+                       read_handler_mapped);
+  svn_stream_set_skip(file->stream, skip_handler_mapped);
+  svn_stream_set_mark(file->stream, mark_handler_mapped);
+  svn_stream_set_seek(file->stream, seek_handler_mapped);
+  svn_stream_set_data_available(file->stream,
+                                data_available_handler_mapped);
+  svn_stream__set_is_buffered(file->stream, is_buffered_handler_mapped);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Drop the mapping of the pack file starting at START_REVISION in FS,
+ * if there is one.  Used before modifying that file. */
+static void
+unmap_pack_file(svn_fs_t *fs,
+                svn_revnum_t start_revision)
+{
+#if APR_HAS_MMAP
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_mmap_t *mapping;
+
+  if (ffd->pack_file_mappings == NULL)
+    return;
+
+  mapping = apr_hash_get(ffd->pack_file_mappings, &start_revision,
+                         sizeof(start_revision));
+  if (mapping)
+    {
+      apr_hash_set(ffd->pack_file_mappings, &start_revision,
+                   sizeof(start_revision), NULL);
+      apr_mmap_delete(mapping);
+    }
+#endif
+}
+
 /* Core implementation of svn_fs_fs__open_pack_or_rev_file working on an
  * existing, initialized FILE structure.  If WRITABLE is TRUE, give write
  * access to the file - temporarily resetting the r/o state if necessary.
@@ -160,7 +348,16 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
                                                   result_pool);
           file->is_packed = svn_fs_fs__is_packed_rev(fs, rev);
 
-          return SVN_NO_ERROR;
+          /* Mappings would not see any modifications. */
+          if (writable)
+            {
+              if (file->is_packed)
+                unmap_pack_file(fs, file->start_revision);
+              return SVN_NO_ERROR;
+            }
+
+          return svn_error_trace(auto_map_pack_file(file, fs,
+                                                    scratch_pool));
         }
 
       if (err && APR_STATUS_IS_ENOENT(err->apr_err))
@@ -273,6 +470,7 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                apr_pool_t* result_pool,
                                apr_pool_t *scratch_pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   apr_file_t *apr_file;
   SVN_ERR(svn_io_file_open(&apr_file,
                            svn_fs_fs__path_txn_proto_rev(fs, txn_id,
@@ -284,11 +482,75 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
   (*file)->file = apr_file;
   (*file)->is_packed = FALSE;
   (*file)->start_revision = SVN_INVALID_REVNUM;
+  (*file)->block_size = ffd->block_size;
+  (*file)->pool = result_pool;
   (*file)->stream = svn_stream_from_aprfile2(apr_file, TRUE, result_pool);
 
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset,
+                         apr_pool_t *pool)
+{
+  if (file->mapped_data)
+    {
+      if (buffer_start)
+        *buffer_start = file->block_size
+                      ? offset - offset % file->block_size
+                      : offset;
+
+      file->mapped_offset = offset;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_aligned_seek(file->file,
+                                                  file->block_size,
+                                                  buffer_start, offset,
+                                                  pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file,
+                           apr_pool_t *pool)
+{
+  if (file->mapped_data)
+    {
+      *offset = file->mapped_offset;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_fs_fs__get_file_offset(offset, file->file,
+                                                    pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buffer,
+                         apr_size_t len,
+                         apr_pool_t *pool)
+{
+  if (file->mapped_data)
+    {
+      if (   file->mapped_offset < 0
+          || file->mapped_size - file->mapped_offset < (apr_off_t)len)
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Unexpected end of pack file at offset "
+                                   "%s"),
+                                 apr_off_t_toa(pool, file->mapped_offset));
+
+      memcpy(buffer, file->mapped_data + file->mapped_offset, len);
+      file->mapped_offset += len;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_read_full2(file->file, buffer, len,
+                                                NULL, NULL, pool));
+}
+
 svn_error_t *
 svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 {
@@ -299,6 +561,7 @@ svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 
   file->file = NULL;
   file->stream = NULL;
+  file->mapped_data = NULL;
   file->l2p_stream = NULL;
   file->p2l_stream = NULL;
 
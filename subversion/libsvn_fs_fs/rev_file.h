@@ -54,9 +54,21 @@ typedef struct svn_fs_fs__revision_file_t
   /* rev / pack file */
   apr_file_t *file;
 
-  /* stream based on FILE and not NULL exactly when FILE is not NULL */
+  /* stream based on FILE and not NULL exactly when FILE is not NULL.
+   * If MAPPED_DATA is not NULL, this reads from there instead. */
   svn_stream_t *stream;
 
+  /* Contents of FILE mapped into memory or NULL.  Only ever set for pack
+   * files.  The mapping is owned by the svn_fs_t and shared between all
+   * instances of this structure for the same pack file. */
+  const char *mapped_data;
+
+  /* Number of bytes in MAPPED_DATA. */
+  apr_off_t mapped_size;
+
+  /* Read position within MAPPED_DATA.  Only valid if that is not NULL. */
+  apr_off_t mapped_offset;
+
   /* the opened P2L index stream or NULL.  Always NULL for txns. */
   svn_fs_fs__packed_number_stream_t *p2l_stream;
 
@@ -137,6 +149,36 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                apr_pool_t* result_pool,
                                apr_pool_t *scratch_pool);
 
+/* Position FILE at OFFSET for the next read from FILE->STREAM or via
+ * svn_fs_fs__rev_file_read.  If BUFFER_START is not NULL, set it to the
+ * begin of the data block that contains OFFSET.  Use POOL for temporary
+ * allocations.
+ *
+ * Use this function instead of seeking FILE->FILE directly, which does
+ * not affect FILE->STREAM if the file has been memory-mapped.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset,
+                         apr_pool_t *pool);
+
+/* Set *OFFSET to the current read position in FILE.  Use POOL for
+ * temporary allocations. */
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file,
+                           apr_pool_t *pool);
+
+/* Read exactly LEN bytes from the current position in FILE into BUFFER
+ * and advance the position accordingly.  Use POOL for temporary
+ * allocations. */
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buffer,
+                         apr_size_t len,
+                         apr_pool_t *pool);
+
 /* Close all files and streams in FILE.
  */
 svn_error_t *
@@ -92,6 +92,17 @@ typedef struct rep_stats_t
   /* classification of the representation. values of rep_kind_t */
   char kind;
 
+  /* revision containing the delta base representation.
+   * SVN_INVALID_REVNUM for PLAIN and self-delta reps. */
+  svn_revnum_t base_revision;
+
+  /* offset / item index of the delta base within BASE_REVISION */
+  apr_uint64_t base_item;
+
+  /* number of representations that need to be combined to reconstruct
+   * the contents of this one, including itself.  0 if not known, yet. */
+  apr_uint32_t chain_length;
+
 } rep_stats_t;
 
 /* Represents a single revision.
@@ -407,6 +418,24 @@ find_representation(int *idx,
   return NULL;
 }
 
+/* Set the header-derived information in REPRESENTATION from HEADER.
+ */
+static void
+set_rep_header(rep_stats_t *representation,
+               const svn_fs_fs__rep_header_t *header)
+{
+  representation->header_size = (apr_uint16_t)header->header_size;
+  if (header->type == svn_fs_fs__rep_delta)
+    {
+      representation->base_revision = header->base_revision;
+      representation->base_item = (apr_uint64_t)header->base_item_index;
+    }
+  else
+    {
+      representation->base_revision = SVN_INVALID_REVNUM;
+    }
+}
+
 /* Find / auto-construct the representation stats for REP in QUERY and
  * return it in *REPRESENTATION.
  *
@@ -436,9 +465,8 @@ parse_representation(rep_stats_t **representation,
        */
       result = apr_pcalloc(result_pool, sizeof(*result));
       result->revision = rep->revision;
-      result->expanded_size = rep->expanded_size;
       result->offset = (apr_off_t)rep->item_index;
-      result->size = rep->size;
+      result->base_revision = SVN_INVALID_REVNUM;
 
       /* In phys. addressing mode, follow link to the actual representation.
        * In log. addressing mode, we will find it already as part of our
@@ -449,18 +477,26 @@ parse_representation(rep_stats_t **representation,
           apr_off_t offset = revision_info->offset + result->offset;
 
           SVN_ERR_ASSERT(revision_info->rev_file);
-          SVN_ERR(svn_io_file_seek(revision_info->rev_file->file, APR_SET,
-                                   &offset, scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_seek(revision_info->rev_file, NULL,
+                                           offset, scratch_pool));
           SVN_ERR(svn_fs_fs__read_rep_header(&header,
                                              revision_info->rev_file->stream,
                                              scratch_pool, scratch_pool));
 
-          result->header_size = header->header_size;
+          set_rep_header(result, header);
         }
 
       svn_sort__array_insert(revision_info->representations, &result, idx);
     }
 
+  /* In log. addressing mode, our linear walk may have created the rep
+   * object already.  The sizes are only known to the referencing noderev. */
+  if (result->ref_count == 0)
+    {
+      result->expanded_size = rep->expanded_size;
+      result->size = rep->size;
+    }
+
   *representation = result;
 
   return SVN_NO_ERROR;
@@ -500,8 +536,8 @@ read_phsy_noderev(svn_stringbuf_t **noderev,
   SVN_ERR_ASSERT(revision_info->rev_file);
 
   offset += revision_info->offset;
-  SVN_ERR(svn_io_file_seek(revision_info->rev_file->file, APR_SET,
-                           &offset, scratch_pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(revision_info->rev_file, NULL, offset,
+                                   scratch_pool));
 
   /* Read it (terminated by an empty line) */
   do
@@ -884,6 +920,45 @@ read_item(svn_stringbuf_t **contents,
   return SVN_NO_ERROR;
 }
 
+/* Read the header of the representation described by ENTRY from REV_FILE
+ * and store the delta base info in the respective rep object in QUERY.
+ * Create that object in RESULT_POOL if it does not exist, yet.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+read_log_rep_header(query_t *query,
+                    svn_fs_fs__revision_file_t *rev_file,
+                    svn_fs_fs__p2l_entry_t *entry,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__rep_header_t *header;
+  revision_info_t *info = NULL;
+  rep_stats_t *representation;
+  int idx;
+
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, entry->offset,
+                                   scratch_pool));
+  SVN_ERR(svn_fs_fs__read_rep_header(&header, rev_file->stream,
+                                     scratch_pool, scratch_pool));
+
+  representation = find_representation(&idx, query, &info,
+                                       entry->item.revision,
+                                       (apr_off_t)entry->item.number);
+  if (!representation)
+    {
+      /* Not referenced by any noderev we read so far. */
+      representation = apr_pcalloc(result_pool, sizeof(*representation));
+      representation->revision = entry->item.revision;
+      representation->offset = (apr_off_t)entry->item.number;
+      svn_sort__array_insert(info->representations, &representation, idx);
+    }
+
+  set_rep_header(representation, header);
+
+  return SVN_NO_ERROR;
+}
+
 /* Process the logically addressed revision contents of revisions BASE to
  * BASE + COUNT - 1 in QUERY.
  *
@@ -978,6 +1053,12 @@ read_log_rev_or_packfile(query_t *query,
                 = get_log_change_count(item->data + 0, item->len);
               info->changes_len += entry->size;
             }
+          else if (   entry->type >= SVN_FS_FS__ITEM_TYPE_FILE_REP
+                   && entry->type <= SVN_FS_FS__ITEM_TYPE_DIR_PROPS)
+            {
+              SVN_ERR(read_log_rep_header(query, rev_file, entry,
+                                          result_pool, iterpool));
+            }
 
           /* advance offset */
           offset += entry->size;
@@ -1148,6 +1229,10 @@ aggregate_stats(const apr_array_header_t *revisions,
           rep_stats_t *rep = APR_ARRAY_IDX(revision->representations, k,
                                            rep_stats_t *);
 
+          /* skip reps that are only used as delta bases */
+          if (rep->ref_count == 0)
+            continue;
+
           /* accumulate in the right bucket */
           switch(rep->kind)
             {
@@ -1172,6 +1257,151 @@ aggregate_stats(const apr_array_header_t *revisions,
     }
 }
 
+/* Number of entries to keep in svn_fs_fs__stats_t.longest_chains. */
+#define LONGEST_CHAINS_COUNT 16
+
+/* Set REP->CHAIN_LENGTH and that of all reps in its delta chain in QUERY,
+ * if not known already.  STACK is an array of rep_stats_t * to be used as
+ * temporary storage.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+determine_chain_length(query_t *query,
+                       rep_stats_t *rep,
+                       apr_array_header_t *stack,
+                       apr_pool_t *scratch_pool)
+{
+  apr_uint32_t length = 0;
+
+  /* Walk the chain until we reach a rep with known length.  Chains may
+   * be long, hence don't recurse. */
+  apr_array_clear(stack);
+  while (!length)
+    {
+      rep_stats_t *base;
+      int idx;
+
+      if (rep->chain_length)
+        {
+          length = rep->chain_length;
+        }
+      else if (!SVN_IS_VALID_REVNUM(rep->base_revision))
+        {
+          rep->chain_length = 1;
+          length = 1;
+        }
+      else
+        {
+          APR_ARRAY_PUSH(stack, rep_stats_t *) = rep;
+          base = find_representation(&idx, query, NULL, rep->base_revision,
+                                     (apr_off_t)rep->base_item);
+          if (base)
+            {
+              rep = base;
+            }
+          else
+            {
+              /* In phys. addressing mode, we don't see reps that are not
+               * referenced by any noderev.  Let the FS follow the rest of
+               * the chain. */
+              representation_t base_rep = { 0 };
+              int chain_length, shard_count;
+
+              base_rep.revision = rep->base_revision;
+              base_rep.item_index = rep->base_item;
+              svn_fs_fs__id_txn_reset(&base_rep.txn_id);
+
+              SVN_ERR(svn_fs_fs__rep_chain_length(&chain_length,
+                                                  &shard_count, &base_rep,
+                                                  query->fs, scratch_pool));
+              length = chain_length;
+            }
+        }
+    }
+
+  /* Update all reps in the chain that we walked. */
+  while (stack->nelts)
+    {
+      rep = *(rep_stats_t **)apr_array_pop(stack);
+      rep->chain_length = ++length;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Add REP to the longest delta chains list in STATS, if it is among them.
+ */
+static void
+add_longest_chain(svn_fs_fs__stats_t *stats,
+                  rep_stats_t *rep)
+{
+  apr_array_header_t *chains = stats->longest_chains;
+  svn_fs_fs__chain_info_t *info;
+  int i;
+
+  /* Find the insertion position. */
+  for (i = chains->nelts; i > 0; --i)
+    if (APR_ARRAY_IDX(chains, i - 1, svn_fs_fs__chain_info_t *)->length
+        >= rep->chain_length)
+      break;
+
+  if (i >= LONGEST_CHAINS_COUNT)
+    return;
+
+  /* Recycle the shortest entry if the list is full. */
+  if (chains->nelts == LONGEST_CHAINS_COUNT)
+    info = *(svn_fs_fs__chain_info_t **)apr_array_pop(chains);
+  else
+    info = apr_pcalloc(chains->pool, sizeof(*info));
+
+  info->revision = rep->revision;
+  info->item_index = (apr_uint64_t)rep->offset;
+  info->length = rep->chain_length;
+
+  svn_sort__array_insert(chains, &info, i);
+}
+
+/* Determine the delta chain lengths of all used reps in QUERY and
+ * aggregate them in QUERY->STATS.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+aggregate_chain_stats(query_t *query,
+                      apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_array_header_t *stack = apr_array_make(scratch_pool, 16,
+                                             sizeof(rep_stats_t *));
+  int i, k;
+
+  for (i = 0; i < query->revisions->nelts; ++i)
+    {
+      revision_info_t *revision = APR_ARRAY_IDX(query->revisions, i,
+                                                revision_info_t *);
+
+      if (query->cancel_func)
+        SVN_ERR(query->cancel_func(query->cancel_baton));
+
+      for (k = 0; k < revision->representations->nelts; ++k)
+        {
+          rep_stats_t *rep = APR_ARRAY_IDX(revision->representations, k,
+                                           rep_stats_t *);
+          if (rep->ref_count == 0)
+            continue;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(determine_chain_length(query, rep, stack, iterpool));
+
+          add_to_histogram(&query->stats->chain_length_histogram,
+                           rep->chain_length);
+          add_longest_chain(query->stats, rep);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Return a new svn_fs_fs__stats_t instance, allocated in RESULT_POOL.
  */
 static svn_fs_fs__stats_t *
@@ -1180,6 +1410,8 @@ create_stats(apr_pool_t *result_pool)
   svn_fs_fs__stats_t *stats = apr_pcalloc(result_pool, sizeof(*stats));
 
   initialize_largest_changes(stats, 64, result_pool);
+  stats->longest_chains = apr_array_make(result_pool, LONGEST_CHAINS_COUNT,
+                                         sizeof(svn_fs_fs__chain_info_t *));
   stats->by_extension = apr_hash_make(result_pool);
 
   return stats;
@@ -1249,6 +1481,7 @@ svn_fs_fs__get_stats(svn_fs_fs__stats_t **stats,
                        scratch_pool));
   SVN_ERR(read_revisions(query, scratch_pool, scratch_pool));
   aggregate_stats(query->revisions, *stats);
+  SVN_ERR(aggregate_chain_stats(query, scratch_pool));
 
   return SVN_NO_ERROR;
 }
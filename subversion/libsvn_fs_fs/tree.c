@@ -2887,6 +2887,32 @@ fs_try_process_file_contents(svn_boolean_t *success,
 
 /* --- End machinery for svn_fs_try_process_file_contents() ---  */
 
+/* Implement root_vtable_t.get_file_storage(). */
+static svn_error_t *
+fs_get_file_storage(apr_file_t **file,
+                    apr_off_t *offset,
+                    svn_filesize_t *length,
+                    int *svndiff_version,
+                    svn_fs_root_t *root,
+                    const char *path,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  dag_node_t *node;
+
+  /* Txn contents may still change underneath us. */
+  if (root->is_txn_root)
+    {
+      *file = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(get_dag(&node, root, path, scratch_pool));
+  return svn_fs_fs__dag_get_file_storage(file, offset, length,
+                                         svndiff_version, node,
+                                         result_pool, scratch_pool);
+}
+
 
 /* --- Machinery for svn_fs_apply_textdelta() ---  */
 
@@ -4268,6 +4294,7 @@ static root_vtable_t root_vtable = {
   fs_get_file_delta_stream,
   fs_merge,
   fs_get_mergeinfo,
+  fs_get_file_storage,
 };
 
 /* Construct a new root object in FS, allocated from POOL.  */
@@ -4244,7 +4244,7 @@ static root_vtable_t root_vtable = {
   x_contents_changed,
   x_get_file_delta_stream,
   x_merge,
-  x_get_mergeinfo,
+  x_get_mergeinfo,  NULL /* get_file_storage */
 };
 
 /* Construct a new root object in FS, allocated from RESULT_POOL.  */
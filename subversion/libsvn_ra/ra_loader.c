@@ -625,6 +625,77 @@ svn_error_t *svn_ra_get_file(svn_ra_session_t *session,
                                    fetched_rev, props, pool);
 }
 
+/* Fallback implementation of svn_ra_get_files() for RA layers and
+   servers without native support for it:  Fetch the files one by one.
+   All parameters are as for svn_ra_get_files(). */
+static svn_error_t *
+get_files_compat(svn_ra_session_t *session,
+                 apr_hash_t *path_revs,
+                 svn_ra_file_receiver_t receiver,
+                 void *receiver_baton,
+                 apr_pool_t *pool)
+{
+  apr_hash_index_t *hi;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  for (hi = apr_hash_first(pool, path_revs); hi; hi = apr_hash_next(hi))
+    {
+      const char *path = apr_hash_this_key(hi);
+      svn_revnum_t *revision = apr_hash_this_val(hi);
+      svn_revnum_t fetched_rev;
+      apr_hash_t *props;
+      svn_stream_t *stream = NULL;
+
+      svn_pool_clear(iterpool);
+
+      /* The receiver needs the props before it provides the stream. */
+      SVN_ERR(session->vtable->get_file(session, path, *revision, NULL,
+                                        &fetched_rev, &props, iterpool));
+      SVN_ERR(receiver(receiver_baton, path, fetched_rev, props, &stream,
+                       iterpool));
+      if (stream)
+        SVN_ERR(session->vtable->get_file(session, path, fetched_rev, stream,
+                                          NULL, NULL, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *svn_ra_get_files(svn_ra_session_t *session,
+                              apr_hash_t *path_revs,
+                              svn_ra_file_receiver_t receiver,
+                              void *receiver_baton,
+                              apr_pool_t *pool)
+{
+  apr_hash_index_t *hi;
+  svn_error_t *err;
+
+  for (hi = apr_hash_first(pool, path_revs); hi; hi = apr_hash_next(hi))
+    {
+      const char *path = apr_hash_this_key(hi);
+
+      SVN_ERR_ASSERT(svn_relpath_is_canonical(path));
+    }
+
+  if (session->vtable->get_files == NULL)
+    return svn_error_trace(get_files_compat(session, path_revs, receiver,
+                                            receiver_baton, pool));
+
+  err = session->vtable->get_files(session, path_revs, receiver,
+                                   receiver_baton, pool);
+  if (err && err->apr_err == SVN_ERR_RA_NOT_IMPLEMENTED)
+    {
+      svn_error_clear(err);
+
+      /* Fallback for legacy servers. */
+      err = get_files_compat(session, path_revs, receiver, receiver_baton,
+                             pool);
+    }
+
+  return svn_error_trace(err);
+}
+
 svn_error_t *svn_ra_get_dir2(svn_ra_session_t *session,
                              apr_hash_t **dirents,
                              svn_revnum_t *fetched_rev,
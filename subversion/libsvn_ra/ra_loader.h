@@ -349,6 +349,13 @@ typedef struct svn_ra__vtable_t {
     void *replay_baton,
     apr_pool_t *scratch_pool);
 
+  /* See svn_ra_get_files().  May be NULL. */
+  svn_error_t *(*get_files)(svn_ra_session_t *session,
+                            apr_hash_t *path_revs,
+                            svn_ra_file_receiver_t receiver,
+                            void *receiver_baton,
+                            apr_pool_t *pool);
+
 } svn_ra__vtable_t;
 
 /* The RA session object. */
@@ -31,6 +31,7 @@
 #include <apr_strings.h>
 #include <apr_network_io.h>
 #include <apr_uri.h>
+#include <apr_md5.h>
 
 #include "svn_hash.h"
 #include "svn_types.h"
@@ -236,6 +237,18 @@ svn_error_t *svn_ra_svn__auth_response(svn_ra_svn_conn_t *conn,
   return svn_error_trace(svn_ra_svn__write_tuple(conn, pool, "w(?c)", mech, mech_arg));
 }
 
+/* Return TRUE if authenticating SESS with one of the mechanisms in
+ * MECHLIST would require a password and the server offers session
+ * tickets to avoid that. */
+static svn_boolean_t
+session_ticket_usable(svn_ra_svn__session_baton_t *sess,
+                      const apr_array_header_t *mechlist)
+{
+  return svn_ra_svn__find_mech(mechlist, "TICKET")
+      && !svn_ra_svn__find_mech(mechlist, "ANONYMOUS")
+      && !(sess->is_tunneled && svn_ra_svn__find_mech(mechlist, "EXTERNAL"));
+}
+
 static svn_error_t *handle_auth_request(svn_ra_svn__session_baton_t *sess,
                                         apr_pool_t *pool)
 {
@@ -246,9 +259,53 @@ static svn_error_t *handle_auth_request(svn_ra_svn__session_baton_t *sess,
   SVN_ERR(svn_ra_svn__read_cmd_response(conn, pool, "lc", &mechlist, &realm));
   if (mechlist->nelts == 0)
     return SVN_NO_ERROR;
+
+  /* Skip the password exchange if an earlier session got us a ticket.
+   * Otherwise, ask for one once this session has been established. */
+  if (session_ticket_usable(sess, mechlist))
+    {
+      svn_boolean_t success;
+
+      SVN_ERR(svn_ra_svn__do_ticket_auth(&success, sess, realm, pool));
+      if (success)
+        return SVN_NO_ERROR;
+
+      sess->ticket_realm = apr_pstrdup(sess->pool, realm);
+    }
+
   return DO_AUTH(sess, mechlist, realm, pool);
 }
 
+/* Request a session ticket for SESS->TICKET_REALM from the server and
+ * remember it for later sessions.  Use POOL for temporary allocations. */
+static svn_error_t *fetch_session_ticket(svn_ra_svn__session_baton_t *sess,
+                                         apr_pool_t *pool)
+{
+  const char *user, *ticket;
+  apr_uint64_t lifetime;
+  svn_error_t *err;
+
+  SVN_ERR(svn_ra_svn__write_cmd_get_session_ticket(sess->conn, pool));
+  SVN_ERR(handle_auth_request(sess, pool));
+  err = svn_ra_svn__read_cmd_response(sess->conn, pool, "ccn",
+                                      &user, &ticket, &lifetime);
+
+  /* The server may refuse to issue a ticket, e.g. because we did not
+   * authenticate with a password.  That's not a problem. */
+  if (err && err->apr_err == SVN_ERR_RA_NOT_AUTHORIZED)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  return svn_error_trace(
+           svn_ra_svn__remember_session_ticket(sess, sess->ticket_realm,
+                                               user, ticket,
+                                               apr_time_from_sec(lifetime),
+                                               pool));
+}
+
 /* --- REPORTER IMPLEMENTATION --- */
 
 static svn_error_t *ra_svn_set_path(void *baton, const char *path,
@@ -640,6 +697,7 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
   sess->callbacks_baton = callbacks_baton;
   sess->bytes_read = sess->bytes_written = 0;
   sess->auth_baton = auth_baton;
+  sess->ticket_realm = NULL;
 
   if (config)
     SVN_ERR(svn_config_copy_config(&sess->config, config, pool));
@@ -738,10 +796,11 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
    * capability list, and the URL, and subsequently there is an auth
    * request. */
   /* Client-side capabilities list: */
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwww)cc(?c)",
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwwww)cc(?c)",
                                   (apr_uint64_t) 2,
                                   SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                   SVN_RA_SVN_CAP_SVNDIFF1,
+                                  SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED,
                                   SVN_RA_SVN_CAP_ABSENT_ENTRIES,
                                   SVN_RA_SVN_CAP_DEPTH,
                                   SVN_RA_SVN_CAP_MERGEINFO,
@@ -773,6 +832,13 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
                                   "server"));
     }
 
+  /* We authenticated with a password; let later sessions skip that. */
+  if (sess->ticket_realm)
+    {
+      SVN_ERR(fetch_session_ticket(sess, pool));
+      sess->ticket_realm = NULL;
+    }
+
   *sess_p = sess;
 
   return SVN_NO_ERROR;
@@ -1328,6 +1394,132 @@ static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *ra_svn_get_files(svn_ra_session_t *session,
+                                     apr_hash_t *path_revs,
+                                     svn_ra_file_receiver_t receiver,
+                                     void *receiver_baton,
+                                     apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  apr_pool_t *file_pool, *chunk_pool;
+  apr_hash_index_t *hi;
+
+  /* If the server can't do it, use the implementation in libsvn_ra. */
+  if (!svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_GET_FILES))
+    return svn_error_create(SVN_ERR_RA_NOT_IMPLEMENTED, NULL, NULL);
+
+  /* One sub-pool for each file and one for each svndiff chunk. */
+  file_pool = svn_pool_create(pool);
+  chunk_pool = svn_pool_create(pool);
+
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w((!", "get-files"));
+  for (hi = apr_hash_first(pool, path_revs); hi; hi = apr_hash_next(hi))
+    {
+      const char *path = apr_hash_this_key(hi);
+      svn_revnum_t *revision = apr_hash_this_val(hi);
+
+      svn_pool_clear(file_pool);
+      SVN_ERR(svn_ra_svn__write_tuple(conn, file_pool, "c(?r)", path,
+                                      *revision));
+    }
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "!))"));
+
+  SVN_ERR(handle_auth_request(sess_baton, pool));
+
+  while (1)
+    {
+      svn_ra_svn_item_t *item;
+      apr_array_header_t *proplist;
+      apr_hash_t *props;
+      const char *path, *expected_digest;
+      svn_revnum_t rev;
+      svn_stream_t *stream = NULL;
+      svn_stream_t *svndiff_stream = NULL;
+      unsigned char digest[APR_MD5_DIGESTSIZE];
+
+      svn_pool_clear(file_pool);
+      SVN_ERR(svn_ra_svn__read_item(conn, file_pool, &item));
+      if (item->kind == SVN_RA_SVN_WORD && strcmp(item->u.word, "done") == 0)
+        break;
+      if (item->kind != SVN_RA_SVN_LIST)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("File entry not a list"));
+
+      SVN_ERR(svn_ra_svn__parse_tuple(item->u.list, file_pool, "crlc",
+                                      &path, &rev, &proplist,
+                                      &expected_digest));
+      SVN_ERR(svn_ra_svn__parse_proplist(proplist, file_pool, &props));
+
+      SVN_ERR(receiver(receiver_baton, path, rev, props, &stream,
+                       file_pool));
+
+      /* The contents come as svndiff against the empty stream. */
+      if (stream)
+        {
+          svn_txdelta_window_handler_t d_handler;
+          void *d_baton;
+
+          svn_txdelta_apply(svn_stream_empty(file_pool),
+                            svn_stream_disown(stream, file_pool),
+                            digest, path, file_pool, &d_handler, &d_baton);
+          svndiff_stream = svn_txdelta_parse_svndiff(d_handler, d_baton,
+                                                     TRUE, file_pool);
+        }
+
+      while (1)
+        {
+          svn_pool_clear(chunk_pool);
+          SVN_ERR(svn_ra_svn__read_item(conn, chunk_pool, &item));
+
+          /* The server failed to send the contents.  The command
+             response will tell us why. */
+          if (item->kind == SVN_RA_SVN_WORD
+              && strcmp(item->u.word, "done") == 0)
+            {
+              SVN_ERR(svn_ra_svn__read_cmd_response(conn, pool, ""));
+              return svn_error_createf(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                       _("Incomplete contents for '%s'"),
+                                       path);
+            }
+
+          if (item->kind != SVN_RA_SVN_STRING)
+            return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                    _("Text delta chunk not a string"));
+          if (item->u.string->len == 0)
+            break;
+
+          if (svndiff_stream)
+            SVN_ERR(svn_stream_write(svndiff_stream, item->u.string->data,
+                                     &item->u.string->len));
+        }
+
+      if (svndiff_stream)
+        {
+          svn_checksum_t *expected_checksum;
+          svn_checksum_t *checksum;
+
+          SVN_ERR(svn_stream_close(svndiff_stream));
+
+          SVN_ERR(svn_checksum_parse_hex(&expected_checksum, svn_checksum_md5,
+                                         expected_digest, file_pool));
+          checksum = svn_checksum__from_digest_md5(digest, file_pool);
+          if (!svn_checksum_match(checksum, expected_checksum))
+            return svn_checksum_mismatch_err(expected_checksum, checksum,
+                                             file_pool,
+                                             _("Checksum mismatch for '%s'"),
+                                             path);
+        }
+    }
+
+  SVN_ERR(svn_ra_svn__read_cmd_response(conn, pool, ""));
+
+  svn_pool_destroy(chunk_pool);
+  svn_pool_destroy(file_pool);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *ra_svn_get_dir(svn_ra_session_t *session,
                                    apr_hash_t **dirents,
                                    svn_revnum_t *fetched_rev,
@@ -2937,7 +3129,10 @@ static const svn_ra__vtable_t ra_svn_vtable = {
   ra_svn_replay_range,
   ra_svn_get_deleted_rev,
   ra_svn_register_editor_shim_callbacks,
-  ra_svn_get_inherited_props
+  ra_svn_get_inherited_props,
+  NULL /* get_commit_ev2 */,
+  NULL /* replay_range_ev2 */,
+  ra_svn_get_files
 };
 
 svn_error_t *
@@ -131,19 +131,40 @@ static apr_status_t make_nonce(apr_uint64_t *nonce)
 #endif
 }
 
-svn_error_t *svn_ra_svn_cram_server(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
-                                    svn_config_t *pwdb, const char **user,
-                                    svn_boolean_t *success)
+/* Return TRUE if the digests A and B are equal.  Take the same time
+ * regardless of where they differ. */
+static svn_boolean_t digests_equal(const unsigned char *a,
+                                   const unsigned char *b)
+{
+  unsigned char diff = 0;
+  int i;
+
+  for (i = 0; i < APR_MD5_DIGESTSIZE; i++)
+    diff |= a[i] ^ b[i];
+
+  return diff == 0;
+}
+
+/* Send a challenge over CONN and read the client's response.  If that
+ * is well-formed, set *CHALLENGE, *USER and CDIGEST to the challenge, the
+ * user name and the digest from the response and set *RECEIVED to TRUE.
+ * Otherwise, report failure to the client if appropriate and set
+ * *RECEIVED to FALSE.  Use POOL for allocations. */
+static svn_error_t *cram_exchange(svn_boolean_t *received,
+                                  const char **challenge,
+                                  const char **user,
+                                  unsigned char *cdigest,
+                                  svn_ra_svn_conn_t *conn,
+                                  apr_pool_t *pool)
 {
   apr_status_t status;
   apr_uint64_t nonce;
   char hostbuf[APRMAXHOSTLEN + 1];
-  unsigned char cdigest[APR_MD5_DIGESTSIZE], sdigest[APR_MD5_DIGESTSIZE];
-  const char *challenge, *sep, *password;
+  const char *sep;
   svn_ra_svn_item_t *item;
   svn_string_t *resp;
 
-  *success = FALSE;
+  *received = FALSE;
 
   /* Send a challenge. */
   status = make_nonce(&nonce);
@@ -151,10 +172,10 @@ svn_error_t *svn_ra_svn_cram_server(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
     status = apr_gethostname(hostbuf, sizeof(hostbuf), pool);
   if (status)
     return fail(conn, pool, "Internal server error in authentication");
-  challenge = apr_psprintf(pool,
-                           "<%" APR_UINT64_T_FMT ".%" APR_TIME_T_FMT "@%s>",
-                           nonce, apr_time_now(), hostbuf);
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w(c)", "step", challenge));
+  *challenge = apr_psprintf(pool,
+                            "<%" APR_UINT64_T_FMT ".%" APR_TIME_T_FMT "@%s>",
+                            nonce, apr_time_now(), hostbuf);
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w(c)", "step", *challenge));
 
   /* Read the client's response and decode it into *user and cdigest. */
   SVN_ERR(svn_ra_svn__read_item(conn, pool, &item));
@@ -167,12 +188,30 @@ svn_error_t *svn_ra_svn_cram_server(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
     return fail(conn, pool, "Malformed client response in authentication");
   *user = apr_pstrmemdup(pool, resp->data, sep - resp->data);
 
+  *received = TRUE;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *svn_ra_svn_cram_server(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
+                                    svn_config_t *pwdb, const char **user,
+                                    svn_boolean_t *success)
+{
+  unsigned char cdigest[APR_MD5_DIGESTSIZE], sdigest[APR_MD5_DIGESTSIZE];
+  const char *challenge, *password;
+  svn_boolean_t received;
+
+  *success = FALSE;
+
+  SVN_ERR(cram_exchange(&received, &challenge, user, cdigest, conn, pool));
+  if (!received)
+    return SVN_NO_ERROR;
+
   /* Verify the digest against the password in pwfile. */
   svn_config_get(pwdb, &password, SVN_CONFIG_SECTION_USERS, *user, NULL);
   if (!password)
     return fail(conn, pool, "Username not found");
   compute_digest(sdigest, challenge, password);
-  if (memcmp(cdigest, sdigest, sizeof(sdigest)) != 0)
+  if (!digests_equal(cdigest, sdigest))
     return fail(conn, pool, "Password incorrect");
 
   *success = TRUE;
@@ -219,3 +258,108 @@ svn_error_t *svn_ra_svn__cram_client(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   *message = NULL;
   return SVN_NO_ERROR;
 }
+
+/* Set HEX to the session ticket signature for USER, REALM, PASSWORD and
+ * the textual expiry time EXPIRY_STR, using SECRET as the key.  Covering
+ * the password invalidates all tickets once it changes.  HEX must have
+ * room for 2 * APR_MD5_DIGESTSIZE + 1 chars.  Use POOL for temporaries. */
+static void ticket_signature(char *hex, const char *secret,
+                             const char *user, const char *realm,
+                             const char *password, const char *expiry_str,
+                             apr_pool_t *pool)
+{
+  unsigned char digest[APR_MD5_DIGESTSIZE];
+  const char *data = apr_psprintf(pool, "%s\n%s\n%s\n%s", user, realm,
+                                  expiry_str, password);
+
+  compute_digest(digest, data, secret);
+  hex_encode(hex, digest);
+  hex[2 * APR_MD5_DIGESTSIZE] = '\0';
+}
+
+const char *
+svn_ra_svn__session_ticket_create(const char *secret,
+                                  const char *user,
+                                  const char *realm,
+                                  const char *password,
+                                  apr_time_t expiry,
+                                  apr_pool_t *pool)
+{
+  char hex[2 * APR_MD5_DIGESTSIZE + 1];
+  const char *expiry_str = apr_psprintf(pool, "%" APR_UINT64_T_HEX_FMT,
+                                        (apr_uint64_t) expiry);
+
+  ticket_signature(hex, secret, user, realm, password, expiry_str, pool);
+
+  return apr_psprintf(pool, "%s:%s", expiry_str, hex);
+}
+
+svn_error_t *
+svn_ra_svn__session_ticket_server(svn_ra_svn_conn_t *conn,
+                                  apr_pool_t *pool,
+                                  const char *expiry_str,
+                                  const char *secret,
+                                  const char *realm,
+                                  svn_config_t *pwdb,
+                                  apr_time_t now,
+                                  const char **user,
+                                  svn_boolean_t *success)
+{
+  unsigned char cdigest[APR_MD5_DIGESTSIZE], sdigest[APR_MD5_DIGESTSIZE];
+  char signature[2 * APR_MD5_DIGESTSIZE + 1];
+  const char *challenge, *password;
+  apr_uint64_t expiry;
+  svn_boolean_t received;
+  svn_error_t *err;
+
+  *success = FALSE;
+
+  err = svn_cstring_strtoui64(&expiry, expiry_str, 0, APR_UINT64_MAX, 16);
+  if (err)
+    {
+      svn_error_clear(err);
+      return fail(conn, pool, "Malformed session ticket");
+    }
+  if (expiry <= (apr_uint64_t) now)
+    return fail(conn, pool, "Session ticket expired");
+
+  /* The signature part of the ticket is the client's password for a
+   * CRAM-MD5 exchange, so it never gets sent again. */
+  SVN_ERR(cram_exchange(&received, &challenge, user, cdigest, conn, pool));
+  if (!received)
+    return SVN_NO_ERROR;
+
+  svn_config_get(pwdb, &password, SVN_CONFIG_SECTION_USERS, *user, NULL);
+  if (!password)
+    return fail(conn, pool, "Invalid session ticket");
+  ticket_signature(signature, secret, *user, realm, password, expiry_str,
+                   pool);
+  compute_digest(sdigest, challenge, signature);
+  if (!digests_equal(cdigest, sdigest))
+    return fail(conn, pool, "Invalid session ticket");
+
+  *success = TRUE;
+  return svn_ra_svn__write_tuple(conn, pool, "w()", "success");
+}
+
+svn_error_t *
+svn_ra_svn__session_ticket_client(svn_ra_svn_conn_t *conn,
+                                  apr_pool_t *pool,
+                                  const char *user,
+                                  const char *ticket,
+                                  const char **message)
+{
+  const char *sep = strchr(ticket, ':');
+
+  if (!sep)
+    {
+      *message = _("Malformed session ticket");
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_ra_svn__auth_response(conn, pool, "TICKET",
+                                    apr_pstrmemdup(pool, ticket,
+                                                   sep - ticket)));
+  return svn_error_trace(svn_ra_svn__cram_client(conn, pool, user, sep + 1,
+                                                 message));
+}
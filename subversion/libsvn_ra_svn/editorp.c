@@ -37,10 +37,12 @@
 #include "svn_ra_svn.h"
 #include "svn_path.h"
 #include "svn_pools.h"
+#include "svn_sorts.h"
 #include "svn_private_config.h"
 
 #include "private/svn_fspath.h"
 #include "private/svn_editor.h"
+#include "private/svn_delta_private.h"
 
 #include "ra_svn.h"
 
@@ -59,6 +61,12 @@ typedef struct ra_svn_edit_baton_t {
   void *callback_baton;
   int next_token;
   svn_boolean_t got_status;
+
+  /* Where to find file contents that we may send as they are stored.
+   * STORAGE_FUNC may be NULL. */
+  svn_ra_svn__file_storage_func_t storage_func;
+  void *storage_baton;
+  svn_revnum_t target_rev;
 } ra_svn_edit_baton_t;
 
 /* Works for both directories and files. */
@@ -67,8 +75,14 @@ typedef struct ra_svn_baton_t {
   apr_pool_t *pool;
   ra_svn_edit_baton_t *eb;
   const char *token;
+  const char *path;  /* Edit path of files added without history,
+                        only set if we have a STORAGE_FUNC in EB. */
 } ra_svn_baton_t;
 
+/* Maximum number of bytes to send in a single textdelta-chunk when
+ * sending contents straight from storage. */
+#define STORAGE_CHUNK_SIZE 0x100000
+
 typedef struct ra_svn_driver_state_t {
   const svn_delta_editor_t *editor;
   void *edit_baton;
@@ -118,6 +132,7 @@ static ra_svn_baton_t *ra_svn_make_baton(svn_ra_svn_conn_t *conn,
   b->pool = pool;
   b->eb = eb;
   b->token = token;
+  b->path = NULL;
   return b;
 }
 
@@ -164,6 +179,7 @@ static svn_error_t *ra_svn_target_rev(void *edit_baton, svn_revnum_t rev,
 
   SVN_ERR(check_for_error(eb, pool));
   SVN_ERR(svn_ra_svn__write_cmd_target_rev(eb->conn, pool, rev));
+  eb->target_rev = rev;
   return SVN_NO_ERROR;
 }
 
@@ -273,6 +289,12 @@ static svn_error_t *ra_svn_add_file(const char *path,
   SVN_ERR(svn_ra_svn__write_cmd_add_file(b->conn, pool,  path, b->token,
                                          token, copy_path, copy_rev));
   *file_baton = ra_svn_make_baton(b->conn, pool, b->eb, token);
+
+  /* Without a copy source, any text delta will be against the empty
+   * source, i.e. we might send the contents as they are stored. */
+  if (b->eb->storage_func && !copy_path)
+    ((ra_svn_baton_t *)*file_baton)->path = apr_pstrdup(pool, path);
+
   return SVN_NO_ERROR;
 }
 
@@ -314,6 +336,93 @@ static svn_error_t *ra_svn_svndiff_close_handler(void *baton)
   return SVN_NO_ERROR;
 }
 
+/* If the contents of the file for baton B are stored in a form that
+ * the peer accepts and that matches our compression settings, send them
+ * from storage as a text delta against the empty source and set *SENT.
+ * Otherwise, send nothing and set *SENT to FALSE.
+ * Use POOL for temporary allocations. */
+static svn_error_t *send_stored_contents(svn_boolean_t *sent,
+                                         ra_svn_baton_t *b,
+                                         apr_pool_t *pool)
+{
+  ra_svn_edit_baton_t *eb = b->eb;
+  apr_file_t *file;
+  apr_off_t offset;
+  svn_filesize_t length;
+  int svndiff_version;
+  int wire_version = svn_ra_svn__svndiff_version(b->conn);
+
+  *sent = FALSE;
+  if (!SVN_IS_VALID_REVNUM(eb->target_rev))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(eb->storage_func(&file, &offset, &length, &svndiff_version,
+                           eb->storage_baton, b->path, eb->target_rev,
+                           pool));
+  if (!file || length == 0)
+    return SVN_NO_ERROR;
+
+  /* Fulltexts will be sent as svndiff0 and, just as svndiff0 data, only
+   * on uncompressed connections.  Compressed svndiff data can go out to
+   * compressing connections that would not use an older svndiff version,
+   * provided the peer understands it. */
+  if (svndiff_version <= 0)
+    {
+      if (wire_version != 0)
+        return SVN_NO_ERROR;
+    }
+  else if (   wire_version == 0
+           || svndiff_version > wire_version
+           || (   svndiff_version == 1
+               && !svn_ra_svn_has_capability(b->conn,
+                                             SVN_RA_SVN_CAP_SVNDIFF1)))
+    {
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(check_for_error(eb, pool));
+  SVN_ERR(svn_ra_svn__write_cmd_apply_textdelta(b->conn, pool, b->token,
+                                                NULL));
+
+  if (svndiff_version < 0)
+    {
+      /* Frame the fulltext as a series of svndiff0 insertion windows. */
+      svn_boolean_t first = TRUE;
+      while (length > 0)
+        {
+          apr_size_t len = (apr_size_t)MIN(length, SVN_DELTA_WINDOW_SIZE);
+          const svn_string_t *header
+            = svn_txdelta__insertion_window_header(len, first, pool);
+
+          SVN_ERR(check_for_error(eb, pool));
+          SVN_ERR(svn_ra_svn__write_cmd_textdelta_chunk_from_file(
+                    b->conn, pool, b->token, header, file, offset, len));
+          offset += len;
+          length -= len;
+          first = FALSE;
+        }
+    }
+  else
+    {
+      /* The svndiff data is self-contained and can be split anywhere. */
+      while (length > 0)
+        {
+          apr_size_t len = (apr_size_t)MIN(length, STORAGE_CHUNK_SIZE);
+
+          SVN_ERR(check_for_error(eb, pool));
+          SVN_ERR(svn_ra_svn__write_cmd_textdelta_chunk_from_file(
+                    b->conn, pool, b->token, NULL, file, offset, len));
+          offset += len;
+          length -= len;
+        }
+    }
+
+  SVN_ERR(svn_ra_svn__write_cmd_textdelta_end(b->conn, pool, b->token));
+  *sent = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *ra_svn_apply_textdelta(void *file_baton,
                                            const char *base_checksum,
                                            apr_pool_t *pool,
@@ -323,6 +432,21 @@ static svn_error_t *ra_svn_apply_textdelta(void *file_baton,
   ra_svn_baton_t *b = file_baton;
   svn_stream_t *diff_stream;
 
+  /* Short-cut deltas against the empty source if the contents are
+   * stored in a form we can send as is. */
+  if (b->path && !base_checksum)
+    {
+      svn_boolean_t sent;
+
+      SVN_ERR(send_stored_contents(&sent, b, pool));
+      if (sent)
+        {
+          *wh = svn_delta_noop_window_handler;
+          *wh_baton = NULL;
+          return SVN_NO_ERROR;
+        }
+    }
+
   /* Tell the other side we're starting a text delta. */
   SVN_ERR(check_for_error(b->eb, pool));
   SVN_ERR(svn_ra_svn__write_cmd_apply_textdelta(b->conn, pool, b->token,
@@ -335,15 +459,11 @@ static svn_error_t *ra_svn_apply_textdelta(void *file_baton,
   svn_stream_set_write(diff_stream, ra_svn_svndiff_handler);
   svn_stream_set_close(diff_stream, ra_svn_svndiff_close_handler);
 
-  /* If the connection does not support SVNDIFF1 or if we don't want to use
-   * compression, use the non-compressing "version 0" implementation */
-  if (   svn_ra_svn_compression_level(b->conn) > 0
-      && svn_ra_svn_has_capability(b->conn, SVN_RA_SVN_CAP_SVNDIFF1))
-    svn_txdelta_to_svndiff3(wh, wh_baton, diff_stream, 1,
-                            b->conn->compression_level, pool);
-  else
-    svn_txdelta_to_svndiff3(wh, wh_baton, diff_stream, 0,
-                            b->conn->compression_level, pool);
+  /* Use whatever the connection's compression method and the peer's
+   * capabilities allow for. */
+  svn_txdelta_to_svndiff3(wh, wh_baton, diff_stream,
+                          svn_ra_svn__svndiff_version(b->conn),
+                          b->conn->compression_level, pool);
   return SVN_NO_ERROR;
 }
 
@@ -424,6 +544,18 @@ void svn_ra_svn_get_editor(const svn_delta_editor_t **editor,
                            apr_pool_t *pool,
                            svn_ra_svn_edit_callback callback,
                            void *callback_baton)
+{
+  svn_ra_svn__get_editor(editor, edit_baton, conn, pool,
+                         callback, callback_baton, NULL, NULL);
+}
+
+void svn_ra_svn__get_editor(const svn_delta_editor_t **editor,
+                            void **edit_baton, svn_ra_svn_conn_t *conn,
+                            apr_pool_t *pool,
+                            svn_ra_svn_edit_callback callback,
+                            void *callback_baton,
+                            svn_ra_svn__file_storage_func_t storage_func,
+                            void *storage_baton)
 {
   svn_delta_editor_t *ra_svn_editor = svn_delta_default_editor(pool);
   ra_svn_edit_baton_t *eb;
@@ -434,6 +566,9 @@ void svn_ra_svn_get_editor(const svn_delta_editor_t **editor,
   eb->callback_baton = callback_baton;
   eb->next_token = 0;
   eb->got_status = FALSE;
+  eb->storage_func = storage_func;
+  eb->storage_baton = storage_baton;
+  eb->target_rev = SVN_INVALID_REVNUM;
 
   ra_svn_editor->set_target_revision = ra_svn_target_rev;
   ra_svn_editor->open_root = ra_svn_open_root;
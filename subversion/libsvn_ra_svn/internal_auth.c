@@ -34,6 +34,12 @@
 #include "svn_error.h"
 #include "svn_ra.h"
 #include "svn_ra_svn.h"
+#include "svn_hash.h"
+#include "svn_pools.h"
+#include "svn_user.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
 
 #include "ra_svn.h"
 
@@ -119,3 +125,196 @@ svn_ra_svn__do_internal_auth(svn_ra_svn__session_baton_t *sess,
   else
     return svn_error_create(SVN_ERR_RA_SVN_NO_MECHANISMS, NULL, NULL);
 }
+
+
+/* A session ticket issued to some earlier session of this process. */
+typedef struct session_ticket_t
+{
+  /* The opaque ticket string, as sent by the server. */
+  const char *ticket;
+
+  /* Our estimate of when the server will stop accepting the ticket. */
+  apr_time_t expiry;
+
+  /* The pool that the key and all members are allocated in. */
+  apr_pool_t *pool;
+} session_ticket_t;
+
+/* All session tickets known to this process, mapping the keys created by
+ * ticket_key() to session_ticket_t *.  The tickets are shared among all
+ * sessions and threads, so they must only be accessed while holding
+ * TICKET_CACHE_MUTEX. */
+static volatile svn_atomic_t ticket_cache_status = 0;
+static apr_pool_t *ticket_cache_pool = NULL;
+static svn_mutex__t *ticket_cache_mutex = NULL;
+static apr_hash_t *ticket_cache = NULL;
+
+/* Implements svn_atomic__err_init_func_t, initializing the ticket cache. */
+static svn_error_t *
+init_ticket_cache(void *baton, apr_pool_t *pool)
+{
+  ticket_cache_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  SVN_ERR(svn_mutex__init(&ticket_cache_mutex, TRUE, ticket_cache_pool));
+  ticket_cache = apr_hash_make(ticket_cache_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the name of the user that SESS authenticates as unless told
+ * otherwise: the default user name of its auth baton or, if that is not
+ * set, the name of the user running this process.  Return NULL if
+ * neither is known.  Allocate the result in POOL. */
+static const char *
+ticket_user(svn_ra_svn__session_baton_t *sess,
+            apr_pool_t *pool)
+{
+  const char *user = NULL;
+
+  if (sess->auth_baton)
+    user = svn_auth_get_parameter(sess->auth_baton,
+                                  SVN_AUTH_PARAM_DEFAULT_USERNAME);
+
+  return user ? user : svn_user_get_name(pool);
+}
+
+/* Return the ticket cache key for USER at the server's REALM as seen by
+ * SESS.  Allocate the result in POOL. */
+static const char *
+ticket_key(svn_ra_svn__session_baton_t *sess,
+           const char *realm,
+           const char *user,
+           apr_pool_t *pool)
+{
+  return apr_psprintf(pool, "%s %s\n%s", sess->realm_prefix, realm, user);
+}
+
+/* Drop all tickets that expire before NOW from the cache.  The caller
+ * must hold TICKET_CACHE_MUTEX. */
+static void
+sweep_tickets(apr_time_t now)
+{
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(NULL, ticket_cache); hi; hi = apr_hash_next(hi))
+    {
+      session_ticket_t *entry = apr_hash_this_val(hi);
+
+      if (entry->expiry <= now)
+        {
+          svn_hash_sets(ticket_cache, apr_hash_this_key(hi), NULL);
+          svn_pool_destroy(entry->pool);
+        }
+    }
+}
+
+/* Set *TICKET to a copy of the still valid session ticket cached under
+ * KEY, allocated in RESULT_POOL, or to NULL if there is no such ticket.
+ * The caller must hold TICKET_CACHE_MUTEX. */
+static svn_error_t *
+lookup_ticket(const char **ticket,
+              const char *key,
+              apr_pool_t *result_pool)
+{
+  session_ticket_t *entry;
+
+  sweep_tickets(apr_time_now());
+  entry = svn_hash_gets(ticket_cache, key);
+  *ticket = entry ? apr_pstrdup(result_pool, entry->ticket) : NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Replace the session ticket cached under KEY with TICKET, valid until
+ * EXPIRY.  If TICKET is NULL, just drop the cached ticket.  The caller
+ * must hold TICKET_CACHE_MUTEX. */
+static svn_error_t *
+store_ticket(const char *key,
+             const char *ticket,
+             apr_time_t expiry)
+{
+  session_ticket_t *entry;
+
+  sweep_tickets(apr_time_now());
+  entry = svn_hash_gets(ticket_cache, key);
+  if (entry)
+    {
+      svn_hash_sets(ticket_cache, key, NULL);
+      svn_pool_destroy(entry->pool);
+    }
+
+  if (ticket)
+    {
+      apr_pool_t *pool = svn_pool_create(ticket_cache_pool);
+
+      entry = apr_pcalloc(pool, sizeof(*entry));
+      entry->ticket = apr_pstrdup(pool, ticket);
+      entry->expiry = expiry;
+      entry->pool = pool;
+      svn_hash_sets(ticket_cache, apr_pstrdup(pool, key), entry);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_svn__do_ticket_auth(svn_boolean_t *success,
+                           svn_ra_svn__session_baton_t *sess,
+                           const char *realm,
+                           apr_pool_t *pool)
+{
+  const char *key, *user, *ticket, *message;
+
+  *success = FALSE;
+
+  user = ticket_user(sess, pool);
+  if (!user)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_atomic__init_once(&ticket_cache_status, init_ticket_cache,
+                                NULL, pool));
+  key = ticket_key(sess, realm, user, pool);
+  SVN_MUTEX__WITH_LOCK(ticket_cache_mutex,
+                       lookup_ticket(&ticket, key, pool));
+  if (!ticket)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_ra_svn__session_ticket_client(sess->conn, pool, user, ticket,
+                                            &message));
+  if (!message)
+    {
+      *success = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  /* The ticket expired or got invalidated on the server.  Don't try it
+   * again and let the caller fall back to the other mechanisms. */
+  SVN_MUTEX__WITH_LOCK(ticket_cache_mutex,
+                       store_ticket(key, NULL, 0));
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_svn__remember_session_ticket(svn_ra_svn__session_baton_t *sess,
+                                    const char *realm,
+                                    const char *user,
+                                    const char *ticket,
+                                    apr_interval_time_t lifetime,
+                                    apr_pool_t *pool)
+{
+  const char *key;
+  const char *expected_user = ticket_user(sess, pool);
+
+  /* Later sessions look for tickets of the user they authenticate as by
+   * default.  Don't let them pick up a ticket for anybody else. */
+  if (!expected_user || strcmp(user, expected_user) != 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_atomic__init_once(&ticket_cache_status, init_ticket_cache,
+                                NULL, pool));
+  key = ticket_key(sess, realm, user, pool);
+  SVN_MUTEX__WITH_LOCK(ticket_cache_mutex,
+                       store_ticket(key, ticket, apr_time_now() + lifetime));
+
+  return SVN_NO_ERROR;
+}
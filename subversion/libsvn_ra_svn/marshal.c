@@ -102,13 +102,23 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn4(apr_socket_t *sock,
   conn->session = NULL;
   conn->read_ptr = conn->read_buf;
   conn->read_end = conn->read_buf;
+  conn->write_buf = conn->initial_write_buf;
+  conn->write_buf_size = sizeof(conn->initial_write_buf);
   conn->write_pos = 0;
+  conn->write_buf_pool = NULL;
+  conn->bytes_received = 0;
+  conn->bytes_sent = 0;
+  conn->command_observer = NULL;
+  conn->command_observer_baton = NULL;
+  conn->in_command = FALSE;
   conn->written_since_error_check = 0;
   conn->error_check_interval = error_check_interval;
   conn->may_check_for_error = error_check_interval == 0;
   conn->block_handler = NULL;
   conn->block_baton = NULL;
   conn->capabilities = apr_hash_make(result_pool);
+  conn->compression = compression_level > 0 ? svn_ra_svn__compression_lz4
+                                            : svn_ra_svn__compression_none;
   conn->compression_level = compression_level;
   conn->zero_copy_limit = zero_copy_limit;
   conn->pool = result_pool;
@@ -177,6 +187,91 @@ svn_ra_svn_compression_level(svn_ra_svn_conn_t *conn)
   return conn->compression_level;
 }
 
+svn_error_t *
+svn_ra_svn__parse_compression(svn_ra_svn__compression_t *method,
+                              int *level,
+                              const char *value)
+{
+  if (strcmp(value, "none") == 0)
+    {
+      *method = svn_ra_svn__compression_none;
+      *level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
+    }
+  else if (strcmp(value, "lz4") == 0)
+    {
+      *method = svn_ra_svn__compression_lz4;
+      *level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+    }
+  else if (strcmp(value, "zlib") == 0)
+    {
+      *method = svn_ra_svn__compression_zlib;
+      *level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+    }
+  else if (strncmp(value, "zlib-", 5) == 0)
+    {
+      int zlib_level;
+      svn_error_t *err = svn_cstring_atoi(&zlib_level, value + 5);
+
+      if (err || zlib_level <= SVN_DELTA_COMPRESSION_LEVEL_NONE
+              || zlib_level > SVN_DELTA_COMPRESSION_LEVEL_MAX)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, err,
+                                 _("Invalid zlib compression level '%s'"),
+                                 value);
+
+      *method = svn_ra_svn__compression_zlib;
+      *level = zlib_level;
+    }
+  else
+    {
+      return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                               _("Invalid compression method '%s'"),
+                               value);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+void
+svn_ra_svn__set_compression(svn_ra_svn_conn_t *conn,
+                            svn_ra_svn__compression_t method,
+                            int level)
+{
+  conn->compression = method;
+  conn->compression_level = method == svn_ra_svn__compression_none
+                          ? SVN_DELTA_COMPRESSION_LEVEL_NONE
+                          : level;
+}
+
+void
+svn_ra_svn__set_command_observer(svn_ra_svn_conn_t *conn,
+                                 svn_ra_svn__command_observer_t observer,
+                                 void *baton)
+{
+  conn->command_observer = observer;
+  conn->command_observer_baton = baton;
+}
+
+int
+svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn)
+{
+  switch (conn->compression)
+    {
+      case svn_ra_svn__compression_lz4:
+        if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED))
+          return 2;
+        /* Fall through to zlib. */
+
+      case svn_ra_svn__compression_zlib:
+        if (   conn->compression_level > 0
+            && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF1))
+          return 1;
+        return 0;
+
+      default:
+        return 0;
+    }
+}
+
 apr_size_t
 svn_ra_svn_zero_copy_limit(svn_ra_svn_conn_t *conn)
 {
@@ -206,23 +301,44 @@ svn_error_t *svn_ra_svn__data_available(svn_ra_svn_conn_t *conn,
 
 /* --- WRITE BUFFER MANAGEMENT --- */
 
-/* Write data to socket or output file as appropriate. */
-static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
-                                    const char *data, apr_size_t len)
+/* Write the NVEC data blocks in VEC to socket or output file as
+ * appropriate, using as few system calls as possible.  VEC will be
+ * modified in the process. */
+static svn_error_t *writebuf_outputv(svn_ra_svn_conn_t *conn,
+                                     apr_pool_t *pool,
+                                     struct iovec *vec,
+                                     int nvec)
 {
-  const char *end = data + len;
-  apr_size_t count;
+  apr_size_t count = 0;
+  apr_size_t len = 0;
   apr_pool_t *subpool = NULL;
   svn_ra_svn__session_baton_t *session = conn->session;
+  int i;
+
+  for (i = 0; i < nvec; ++i)
+    len += vec[i].iov_len;
 
-  while (data < end)
+  while (TRUE)
     {
-      count = end - data;
+      /* Skip everything that has been written already. */
+      while (nvec > 0 && count >= vec->iov_len)
+        {
+          count -= vec->iov_len;
+          ++vec;
+          --nvec;
+        }
+
+      if (nvec == 0)
+        break;
+
+      vec->iov_base = (char *)vec->iov_base + count;
+      vec->iov_len -= count;
 
       if (session && session->callbacks && session->callbacks->cancel_func)
         SVN_ERR((session->callbacks->cancel_func)(session->callbacks_baton));
 
-      SVN_ERR(svn_ra_svn__stream_write(conn->stream, data, &count));
+      SVN_ERR(svn_ra_svn__stream_writev(conn->stream, vec, nvec, &count));
+      conn->bytes_sent += count;
       if (count == 0)
         {
           if (!subpool)
@@ -231,7 +347,6 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
             svn_pool_clear(subpool);
           SVN_ERR(conn->block_handler(conn, subpool, conn->block_baton));
         }
-      data += count;
 
       if (session)
         {
@@ -256,29 +371,75 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 /* Write data from the write buffer out to the socket. */
 static svn_error_t *writebuf_flush(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
 {
-  apr_size_t write_pos = conn->write_pos;
+  struct iovec vec;
+  vec.iov_base = conn->write_buf;
+  vec.iov_len = conn->write_pos;
 
   /* Clear conn->write_pos first in case the block handler does a read. */
   conn->write_pos = 0;
-  SVN_ERR(writebuf_output(conn, pool, conn->write_buf, write_pos));
+  SVN_ERR(writebuf_outputv(conn, pool, &vec, 1));
+  return SVN_NO_ERROR;
+}
+
+/* Like writebuf_flush but also make sure that the network layer does not
+ * hold back any of the data.  Use this when the other side is supposed to
+ * act upon what we have sent so far. */
+static svn_error_t *writebuf_push(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
+{
+  if (conn->write_pos)
+    SVN_ERR(writebuf_flush(conn, pool));
+
+  svn_ra_svn__stream_cork(conn->stream, FALSE);
+  return SVN_NO_ERROR;
+}
+
+/* The write buffer is full and more data is about to come, i.e. we are
+ * streaming bulk data.  Flush the buffer, let the network layer coalesce
+ * the data into full packets and grow the buffer to save system calls. */
+static svn_error_t *writebuf_spill(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
+{
+  svn_ra_svn__stream_cork(conn->stream, TRUE);
+  SVN_ERR(writebuf_flush(conn, pool));
+
+  /* The buffer is empty, so its contents need not be preserved.
+   * Release the outgrown buffer before allocating its replacement. */
+  if (   conn->write_pos == 0
+      && conn->write_buf_size < SVN_RA_SVN__MAX_WRITEBUF_SIZE)
+    {
+      if (conn->write_buf_pool)
+        svn_pool_clear(conn->write_buf_pool);
+      else
+        conn->write_buf_pool = svn_pool_create(conn->pool);
+
+      conn->write_buf_size *= 2;
+      conn->write_buf = apr_palloc(conn->write_buf_pool,
+                                   conn->write_buf_size);
+    }
+
   return SVN_NO_ERROR;
 }
 
 static svn_error_t *writebuf_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                                    const char *data, apr_size_t len)
 {
-  /* data >= 8k is sent immediately */
-  if (len >= sizeof(conn->write_buf) / 2)
+  /* Large data blocks are sent immediately, together with whatever is
+   * in the buffer already. */
+  if (len >= conn->write_buf_size / 2)
     {
-      if (conn->write_pos > 0)
-        SVN_ERR(writebuf_flush(conn, pool));
-
-      return writebuf_output(conn, pool, data, len);
+      struct iovec vec[2];
+      vec[0].iov_base = conn->write_buf;
+      vec[0].iov_len = conn->write_pos;
+      vec[1].iov_base = (void *)data;
+      vec[1].iov_len = len;
+
+      /* Clear conn->write_pos first in case the block handler does a read. */
+      conn->write_pos = 0;
+      return writebuf_outputv(conn, pool, vec, 2);
     }
 
   /* ensure room for the data to add */
-  if (conn->write_pos + len > sizeof(conn->write_buf))
-    SVN_ERR(writebuf_flush(conn, pool));
+  if (conn->write_pos + len > conn->write_buf_size)
+    SVN_ERR(writebuf_spill(conn, pool));
 
   /* buffer the new data block as well */
   memcpy(conn->write_buf + conn->write_pos, data, len);
@@ -287,6 +448,59 @@ static svn_error_t *writebuf_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
+/* Write LEN bytes from FILE, starting at OFFSET, to the connection.
+ * Anything still in the write buffer gets sent first. */
+static svn_error_t *writebuf_write_file(svn_ra_svn_conn_t *conn,
+                                        apr_pool_t *pool,
+                                        apr_file_t *file,
+                                        apr_off_t offset,
+                                        apr_size_t len)
+{
+  apr_size_t count;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_ra_svn__session_baton_t *session = conn->session;
+
+  /* Send the command header along with the first file data packet. */
+  svn_ra_svn__stream_cork(conn->stream, TRUE);
+  if (conn->write_pos > 0)
+    SVN_ERR(writebuf_flush(conn, pool));
+
+  conn->written_since_error_check += len;
+  while (len > 0)
+    {
+      svn_pool_clear(iterpool);
+      count = len;
+
+      if (session && session->callbacks && session->callbacks->cancel_func)
+        SVN_ERR((session->callbacks->cancel_func)(session->callbacks_baton));
+
+      SVN_ERR(svn_ra_svn__stream_write_file(conn->stream, file, offset,
+                                            &count, iterpool));
+      conn->bytes_sent += count;
+      if (count == 0)
+        SVN_ERR(conn->block_handler(conn, iterpool, conn->block_baton));
+
+      offset += count;
+      len -= count;
+
+      if (session)
+        {
+          const svn_ra_callbacks2_t *cb = session->callbacks;
+          session->bytes_written += count;
+
+          if (cb && cb->progress_func)
+            (cb->progress_func)(session->bytes_written + session->bytes_read,
+                                -1, cb->progress_baton, iterpool);
+        }
+    }
+
+  conn->may_check_for_error
+    = conn->written_since_error_check >= conn->error_check_interval;
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 /* Write STRING_LITERAL, which is a string literal argument.
 
    Note: The purpose of the empty string "" in the macro definition is to
@@ -298,7 +512,7 @@ static svn_error_t *writebuf_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 static APR_INLINE svn_error_t *
 writebuf_writechar(svn_ra_svn_conn_t *conn, apr_pool_t *pool, char data)
 {
-  if (conn->write_pos < sizeof(conn->write_buf))
+  if (conn->write_pos < conn->write_buf_size)
   {
     conn->write_buf[conn->write_pos] = data;
     conn->write_pos++;
@@ -340,6 +554,8 @@ static svn_error_t *readbuf_input(svn_ra_svn_conn_t *conn, char *data,
   if (*len == 0)
     return svn_error_create(SVN_ERR_RA_SVN_CONNECTION_CLOSED, NULL, NULL);
 
+  conn->bytes_received += *len;
+
   if (session)
     {
       const svn_ra_callbacks2_t *cb = session->callbacks;
@@ -370,6 +586,7 @@ static svn_error_t *readbuf_skip(svn_ra_svn_conn_t *conn, apr_uint64_t len)
     if (buflen == 0)
       return svn_error_create(SVN_ERR_RA_SVN_CONNECTION_CLOSED, NULL, NULL);
 
+    conn->bytes_received += buflen;
     conn->read_end = conn->read_buf + buflen;
     conn->read_ptr = conn->read_buf;
   }
@@ -384,8 +601,7 @@ static svn_error_t *readbuf_fill(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
   apr_size_t len;
 
   SVN_ERR_ASSERT(conn->read_ptr == conn->read_end);
-  if (conn->write_pos)
-    SVN_ERR(writebuf_flush(conn, pool));
+  SVN_ERR(writebuf_push(conn, pool));
 
   len = sizeof(conn->read_buf);
   SVN_ERR(readbuf_input(conn, conn->read_buf, &len, pool));
@@ -430,7 +646,7 @@ static svn_error_t *readbuf_read(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   /* Read large chunks directly into buffer. */
   while (end - data > (apr_ssize_t)sizeof(conn->read_buf))
     {
-      SVN_ERR(writebuf_flush(conn, pool));
+      SVN_ERR(writebuf_push(conn, pool));
       count = end - data;
       SVN_ERR(readbuf_input(conn, data, &count, pool));
       data += count;
@@ -494,8 +710,8 @@ static svn_error_t *write_number(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 
   /* SVN_INT64_BUFFER_SIZE includes space for a terminating NUL that
    * svn__ui64toa will always append. */
-  if (conn->write_pos + SVN_INT64_BUFFER_SIZE >= sizeof(conn->write_buf))
-    SVN_ERR(writebuf_flush(conn, pool));
+  if (conn->write_pos + SVN_INT64_BUFFER_SIZE >= conn->write_buf_size)
+    SVN_ERR(writebuf_spill(conn, pool));
 
   written = svn__ui64toa(conn->write_buf + conn->write_pos, number);
   conn->write_buf[conn->write_pos + written] = follow;
@@ -609,7 +825,7 @@ svn_error_t *
 svn_ra_svn__start_list(svn_ra_svn_conn_t *conn,
                        apr_pool_t *pool)
 {
-  if (conn->write_pos + 2 <= sizeof(conn->write_buf))
+  if (conn->write_pos + 2 <= conn->write_buf_size)
     {
       conn->write_buf[conn->write_pos] = '(';
       conn->write_buf[conn->write_pos+1] = ' ';
@@ -624,7 +840,7 @@ svn_error_t *
 svn_ra_svn__end_list(svn_ra_svn_conn_t *conn,
                      apr_pool_t *pool)
 {
-  if (conn->write_pos + 2 <= sizeof(conn->write_buf))
+  if (conn->write_pos + 2 <= conn->write_buf_size)
   {
     conn->write_buf[conn->write_pos] = ')';
     conn->write_buf[conn->write_pos+1] = ' ';
@@ -639,12 +855,61 @@ svn_error_t *
 svn_ra_svn__flush(svn_ra_svn_conn_t *conn,
                   apr_pool_t *pool)
 {
-  SVN_ERR(writebuf_flush(conn, pool));
+  SVN_ERR(writebuf_push(conn, pool));
   conn->may_check_for_error = TRUE;
 
   return SVN_NO_ERROR;
 }
 
+svn_ra_svn_conn_t *
+svn_ra_svn__create_spill_conn(svn_ra_svn_conn_t *conn,
+                              svn_spillbuf_t *buffer,
+                              apr_pool_t *result_pool)
+{
+  /* Never check for incoming data as there won't be any. */
+  svn_ra_svn_conn_t *spill_conn
+    = svn_ra_svn_create_conn4(NULL, svn_stream_empty(result_pool),
+                              svn_stream__from_spillbuf(buffer, result_pool),
+                              conn->compression_level, 0, APR_SIZE_MAX,
+                              result_pool);
+
+  /* Produce exactly what CONN would send.  Copying the hash does not
+   * modify CONN, so this is safe to do from any thread. */
+  spill_conn->capabilities = apr_hash_copy(result_pool, conn->capabilities);
+  spill_conn->compression = conn->compression;
+  spill_conn->shim_callbacks = NULL;
+
+  return spill_conn;
+}
+
+/* Implements svn_spillbuf_read_t.  Write DATA of LEN bytes to the
+ * svn_ra_svn_conn_t given as BATON. */
+static svn_error_t *
+write_spillbuf_block(svn_boolean_t *stop,
+                     void *baton,
+                     const char *data,
+                     apr_size_t len,
+                     apr_pool_t *scratch_pool)
+{
+  svn_ra_svn_conn_t *conn = baton;
+
+  *stop = FALSE;
+  return svn_error_trace(writebuf_write(conn, scratch_pool, data, len));
+}
+
+svn_error_t *
+svn_ra_svn__write_spillbuf(svn_ra_svn_conn_t *conn,
+                           svn_spillbuf_t *buffer,
+                           apr_pool_t *pool)
+{
+  svn_boolean_t exhausted;
+
+  SVN_ERR(svn_spillbuf__process(&exhausted, buffer, write_spillbuf_block,
+                                conn, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* --- WRITING TUPLES --- */
 
 static svn_error_t *
@@ -1247,8 +1512,7 @@ svn_ra_svn__has_item(svn_boolean_t *has_item,
       if (conn->read_ptr == conn->read_end)
         {
           svn_boolean_t available;
-          if (conn->write_pos)
-            SVN_ERR(writebuf_flush(conn, pool));
+          SVN_ERR(writebuf_push(conn, pool));
 
           SVN_ERR(svn_ra_svn__data_available(conn, &available));
           if (!available)
@@ -1569,6 +1833,126 @@ svn_ra_svn__has_command(svn_boolean_t *has_command,
   return svn_error_trace(err);
 }
 
+/* Return TRUE if the unprocessed data in CONN's read buffer starts with
+ * a complete item, i.e. a fully balanced list.  Malformed data counts as
+ * complete as well such that the actual parser gets to report it.  So do
+ * items that could never fit into the read buffer; the parser will simply
+ * block until the remainder arrives.
+ */
+static svn_boolean_t
+readbuf_has_complete_item(svn_ra_svn_conn_t *conn)
+{
+  const char *p = conn->read_ptr;
+  const char *end = conn->read_end;
+  int level = 0;
+
+  while (p < end)
+    {
+      char c = *p;
+      if (c == '(')
+        {
+          ++level;
+          ++p;
+        }
+      else if (c == ')')
+        {
+          if (--level <= 0)
+            return TRUE;
+          ++p;
+        }
+      else if (svn_ctype_isdigit(c))
+        {
+          /* Number or string.  Skip string contents based on their
+           * length prefix.  Only string lengths matter and anything
+           * longer than our buffer is as good as infinite, so saturate
+           * instead of overflowing. */
+          apr_size_t val = 0;
+          for (; p < end && svn_ctype_isdigit(*p); ++p)
+            if (val <= sizeof(conn->read_buf))
+              val = val * 10 + (*p - '0');
+
+          if (p < end && *p == ':')
+            {
+              ++p;
+
+              /* Don't wait for data that the buffer can't hold. */
+              if (val > sizeof(conn->read_buf) - (p - conn->read_ptr))
+                return TRUE;
+
+              if (val > (apr_size_t)(end - p))
+                return FALSE;
+
+              p += val;
+            }
+        }
+      else if (level == 0 && !svn_iswhitespace(c))
+        {
+          /* Commands are lists.  Let the parser deal with this. */
+          return TRUE;
+        }
+      else
+        {
+          ++p;
+        }
+    }
+
+  return FALSE;
+}
+
+svn_error_t *
+svn_ra_svn__has_complete_command(svn_boolean_t *has_command,
+                                 svn_boolean_t *terminated,
+                                 svn_ra_svn_conn_t *conn,
+                                 apr_pool_t *pool)
+{
+  *has_command = FALSE;
+  *terminated = FALSE;
+
+  /* The caller is about to stop processing this connection.  Make sure
+   * the client sees all our responses. */
+  SVN_ERR(writebuf_push(conn, pool));
+
+  while (!readbuf_has_complete_item(conn))
+    {
+      svn_boolean_t available;
+      svn_error_t *err;
+      apr_size_t len;
+
+      /* Move unprocessed data to the start of the buffer to make room. */
+      if (conn->read_ptr != conn->read_buf)
+        {
+          len = conn->read_end - conn->read_ptr;
+          memmove(conn->read_buf, conn->read_ptr, len);
+          conn->read_ptr = conn->read_buf;
+          conn->read_end = conn->read_buf + len;
+        }
+
+      /* Commands that don't fit into the buffer can't be checked.
+       * The parser will simply read the remainder as it arrives. */
+      len = sizeof(conn->read_buf) - (conn->read_end - conn->read_buf);
+      if (len == 0)
+        break;
+
+      SVN_ERR(svn_ra_svn__data_available(conn, &available));
+      if (!available)
+        return SVN_NO_ERROR;
+
+      err = readbuf_input(conn, conn->read_end, &len, pool);
+      if (err && err->apr_err == SVN_ERR_RA_SVN_CONNECTION_CLOSED)
+        {
+          *terminated = TRUE;
+          svn_error_clear(err);
+          return SVN_NO_ERROR;
+        }
+      SVN_ERR(err);
+
+      conn->read_end += len;
+    }
+
+  *has_command = TRUE;
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__handle_command(svn_boolean_t *terminate,
                            apr_hash_t *cmd_hash,
@@ -1581,6 +1965,9 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
   svn_error_t *err, *write_err;
   apr_array_header_t *params;
   const svn_ra_svn_cmd_entry_t *command;
+  svn_boolean_t observe = conn->command_observer && !conn->in_command;
+  apr_uint64_t bytes_received = conn->bytes_received;
+  apr_uint64_t bytes_sent = conn->bytes_sent;
 
   *terminate = FALSE;
   err = svn_ra_svn__read_tuple(conn, pool, "wl", &cmdname, &params);
@@ -1597,7 +1984,21 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
     }
 
   command = svn_hash_gets(cmd_hash, cmdname);
-  if (command)
+  if (command && observe)
+    {
+      apr_time_t start = apr_time_now();
+
+      conn->in_command = TRUE;
+      err = (*command->handler)(conn, pool, params, baton);
+      conn->in_command = FALSE;
+      *terminate = command->terminate;
+
+      conn->command_observer(conn->command_observer_baton, cmdname,
+                             apr_time_now() - start, err != NULL,
+                             conn->bytes_received - bytes_received,
+                             conn->bytes_sent - bytes_sent);
+    }
+  else if (command)
     {
       err = (*command->handler)(conn, pool, params, baton);
       *terminate = command->terminate;
@@ -1863,6 +2264,30 @@ svn_ra_svn__write_cmd_textdelta_chunk(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_ra_svn__write_cmd_textdelta_chunk_from_file(svn_ra_svn_conn_t *conn,
+                                                apr_pool_t *pool,
+                                                const char *token,
+                                                const svn_string_t *prefix,
+                                                apr_file_t *file,
+                                                apr_off_t offset,
+                                                apr_size_t len)
+{
+  apr_size_t prefix_len = prefix ? prefix->len : 0;
+
+  SVN_ERR(writebuf_write_literal(conn, pool, "( textdelta-chunk ( "));
+  SVN_ERR(write_tuple_cstring(conn, pool, token));
+
+  /* Same as svn_ra_svn__write_string() but with the data split in two. */
+  SVN_ERR(write_number(conn, pool, prefix_len + len, ':'));
+  if (prefix_len)
+    SVN_ERR(writebuf_write(conn, pool, prefix->data, prefix_len));
+  SVN_ERR(writebuf_write_file(conn, pool, file, offset, len));
+  SVN_ERR(writebuf_write_literal(conn, pool, " ) ) "));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__write_cmd_textdelta_end(svn_ra_svn_conn_t *conn,
                                     apr_pool_t *pool,
@@ -2382,6 +2807,13 @@ svn_ra_svn__write_cmd_get_iprops(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_ra_svn__write_cmd_get_session_ticket(svn_ra_svn_conn_t *conn,
+                                         apr_pool_t *pool)
+{
+  return writebuf_write_literal(conn, pool, "( get-session-ticket ( ) ) ");
+}
+
 svn_error_t *
 svn_ra_svn__write_cmd_finish_replay(svn_ra_svn_conn_t *conn,
                                     apr_pool_t *pool)
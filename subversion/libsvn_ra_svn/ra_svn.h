@@ -67,6 +67,9 @@ typedef svn_error_t *(*ra_svn_block_handler_t)(svn_ra_svn_conn_t *conn,
 #define SVN_RA_SVN__READBUF_SIZE (4 * SVN_RA_SVN__PAGE_SIZE)
 #define SVN_RA_SVN__WRITEBUF_SIZE (4 * SVN_RA_SVN__PAGE_SIZE)
 
+/* While streaming bulk data, the write buffer grows up to this size. */
+#define SVN_RA_SVN__MAX_WRITEBUF_SIZE (64 * SVN_RA_SVN__PAGE_SIZE)
+
 /* Create forward reference */
 typedef struct svn_ra_svn__session_baton_t svn_ra_svn__session_baton_t;
 
@@ -74,12 +77,17 @@ typedef struct svn_ra_svn__session_baton_t svn_ra_svn__session_baton_t;
  * first few fields during setup and cleanup. */
 struct svn_ra_svn_conn_st {
 
-  /* I/O buffers */
-  char write_buf[SVN_RA_SVN__WRITEBUF_SIZE];
+  /* I/O buffers.  WRITE_BUF starts as INITIAL_WRITE_BUF and gets
+     replaced by larger buffers when we stream bulk data.  Those get
+     allocated in WRITE_BUF_POOL, which is NULL until then. */
+  char initial_write_buf[SVN_RA_SVN__WRITEBUF_SIZE];
   char read_buf[SVN_RA_SVN__READBUF_SIZE];
   char *read_ptr;
   char *read_end;
+  char *write_buf;
+  apr_size_t write_buf_size;
   apr_size_t write_pos;
+  apr_pool_t *write_buf_pool;
 
   svn_ra_svn__stream_t *stream;
   svn_ra_svn__session_baton_t *session;
@@ -91,6 +99,13 @@ struct svn_ra_svn_conn_st {
   svn_boolean_t encrypted;
 #endif
 
+  /* traffic counters and the optional command observer */
+  apr_uint64_t bytes_received;
+  apr_uint64_t bytes_sent;
+  svn_ra_svn__command_observer_t command_observer;
+  void *command_observer_baton;
+  svn_boolean_t in_command;
+
   /* abortion check control */
   apr_size_t written_since_error_check;
   apr_size_t error_check_interval;
@@ -106,6 +121,7 @@ struct svn_ra_svn_conn_st {
 
   /* server settings */
   apr_hash_t *capabilities;
+  svn_ra_svn__compression_t compression;
   int compression_level;
   apr_size_t zero_copy_limit;
 
@@ -136,6 +152,8 @@ struct svn_ra_svn__session_baton_t {
   apr_off_t bytes_read, bytes_written; /* apr_off_t's because that's what
                                           the callback interface uses */
   const char *useragent;
+  const char *ticket_realm; /* If not NULL, request a session ticket for
+                               this realm once the session is open. */
 };
 
 /* Set a callback for blocked writes on conn.  This handler may
@@ -193,6 +211,27 @@ svn_ra_svn__stream_t *svn_ra_svn__stream_create(svn_stream_t *in_stream,
 svn_error_t *svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
                                       const char *data, apr_size_t *len);
 
+/* Write the NVEC data blocks in VEC to STREAM, returning the total number
+ * of bytes written in *LEN.  Use a single vectored write if STREAM writes
+ * directly to a socket.
+ */
+svn_error_t *svn_ra_svn__stream_writev(svn_ra_svn__stream_t *stream,
+                                       const struct iovec *vec,
+                                       int nvec,
+                                       apr_size_t *len);
+
+/* Write up to *LEN bytes from FILE, starting at OFFSET, to STREAM and
+ * return the number of bytes written in *LEN.  Use sendfile() if STREAM
+ * writes directly to a socket and the platform supports it.  The current
+ * position of FILE is undefined afterwards.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+svn_error_t *svn_ra_svn__stream_write_file(svn_ra_svn__stream_t *stream,
+                                           apr_file_t *file,
+                                           apr_off_t offset,
+                                           apr_size_t *len,
+                                           apr_pool_t *scratch_pool);
+
 /* Read *LEN bytes from STREAM into DATA, returning the number of bytes
  * read in *LEN.
  */
@@ -210,6 +249,12 @@ svn_error_t *svn_ra_svn__read_command_only(svn_ra_svn_conn_t *conn,
 void svn_ra_svn__stream_timeout(svn_ra_svn__stream_t *stream,
                                 apr_interval_time_t interval);
 
+/* If CORK is set, allow the network layer of STREAM to hold back partial
+ * packets until more data has been written.  Otherwise, send everything
+ * written so far immediately.  This is a no-op for non-socket streams. */
+void svn_ra_svn__stream_cork(svn_ra_svn__stream_t *stream,
+                             svn_boolean_t cork);
+
 /* Return whether or not there is data pending on STREAM. */
 svn_error_t *
 svn_ra_svn__stream_data_available(svn_ra_svn__stream_t *stream,
@@ -232,6 +277,30 @@ svn_ra_svn__do_internal_auth(svn_ra_svn__session_baton_t *sess,
                              const apr_array_header_t *mechlist,
                              const char *realm, apr_pool_t *pool);
 
+/* If the process remembers a session ticket for the server's REALM and
+ * the user that SESS authenticates as by default, try to authenticate
+ * with it using the TICKET mechanism.  Set *SUCCESS to TRUE if the server accepted the ticket.
+ * Otherwise, forget the ticket and set *SUCCESS to FALSE, in which case
+ * the server still expects an auth response. */
+svn_error_t *
+svn_ra_svn__do_ticket_auth(svn_boolean_t *success,
+                           svn_ra_svn__session_baton_t *sess,
+                           const char *realm,
+                           apr_pool_t *pool);
+
+/* Remember TICKET, which authenticates USER to the server's REALM for
+ * LIFETIME, for all later sessions of this process that authenticate as
+ * USER by default.  Ignore tickets for users other than the default user
+ * of SESS.  Expired tickets get dropped.  Use POOL for temporary
+ * allocations. */
+svn_error_t *
+svn_ra_svn__remember_session_ticket(svn_ra_svn__session_baton_t *sess,
+                                    const char *realm,
+                                    const char *user,
+                                    const char *ticket,
+                                    apr_interval_time_t lifetime,
+                                    apr_pool_t *pool);
+
 /* Having picked a mechanism, start authentication by writing out an
  * auth response.  MECH_ARG may be NULL for mechanisms with no
  * initial client response. */
@@ -31,6 +31,7 @@
 #include "svn_error.h"
 #include "svn_pools.h"
 #include "svn_io.h"
+#include "svn_sorts.h"
 #include "svn_private_config.h"
 
 #include "private/svn_io_private.h"
@@ -42,6 +43,13 @@ struct svn_ra_svn__stream_st {
   svn_stream_t *out_stream;
   void *timeout_baton;
   ra_svn_timeout_fn_t timeout_fn;
+
+  /* The socket that OUT_STREAM writes to unmodified.  NULL if the stream
+   * is not socket-based or if the data gets transformed, e.g. encrypted. */
+  apr_socket_t *sock;
+
+  /* Whether SOCK currently holds back partial packets. */
+  svn_boolean_t corked;
 };
 
 typedef struct sock_baton_t {
@@ -167,18 +175,27 @@ svn_ra_svn__stream_from_sock(apr_socket_t *sock,
 {
   sock_baton_t *b = apr_palloc(result_pool, sizeof(*b));
   svn_stream_t *sock_stream;
+  svn_ra_svn__stream_t *stream;
 
   b->sock = sock;
   b->pool = svn_pool_create(result_pool);
 
+  /* We flush explicitly at the end of each request or response and cork
+   * the socket while streaming, so Nagle's algorithm would only delay
+   * the last packet of each message.  Failure to disable it is harmless. */
+  apr_socket_opt_set(sock, APR_TCP_NODELAY, 1);
+
   sock_stream = svn_stream_create(b, result_pool);
 
   svn_stream_set_read2(sock_stream, sock_read_cb, NULL /* use default */);
   svn_stream_set_write(sock_stream, sock_write_cb);
   svn_stream_set_data_available(sock_stream, sock_pending_cb);
 
-  return svn_ra_svn__stream_create(sock_stream, sock_stream,
-                                   b, sock_timeout_cb, result_pool);
+  stream = svn_ra_svn__stream_create(sock_stream, sock_stream,
+                                     b, sock_timeout_cb, result_pool);
+  stream->sock = sock;
+
+  return stream;
 }
 
 svn_ra_svn__stream_t *
@@ -193,6 +210,8 @@ svn_ra_svn__stream_create(svn_stream_t *in_stream,
   s->out_stream = out_stream;
   s->timeout_baton = timeout_baton;
   s->timeout_fn = timeout_cb;
+  s->sock = NULL;
+  s->corked = FALSE;
   return s;
 }
 
@@ -203,6 +222,71 @@ svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
   return svn_error_trace(svn_stream_write(stream->out_stream, data, len));
 }
 
+svn_error_t *
+svn_ra_svn__stream_writev(svn_ra_svn__stream_t *stream,
+                          const struct iovec *vec,
+                          int nvec,
+                          apr_size_t *len)
+{
+  int i;
+
+  if (stream->sock)
+    {
+      apr_status_t status = apr_socket_sendv(stream->sock, vec, nvec, len);
+      if (status && !APR_STATUS_IS_EAGAIN(status))
+        return svn_error_wrap_apr(status, _("Can't write to connection"));
+
+      return SVN_NO_ERROR;
+    }
+
+  /* Write one block after the other until one of them comes up short. */
+  *len = 0;
+  for (i = 0; i < nvec; ++i)
+    {
+      apr_size_t count = vec[i].iov_len;
+      SVN_ERR(svn_stream_write(stream->out_stream, vec[i].iov_base, &count));
+
+      *len += count;
+      if (count < vec[i].iov_len)
+        break;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_svn__stream_write_file(svn_ra_svn__stream_t *stream,
+                              apr_file_t *file,
+                              apr_off_t offset,
+                              apr_size_t *len,
+                              apr_pool_t *scratch_pool)
+{
+  char *buffer;
+
+#if APR_HAS_SENDFILE
+  if (stream->sock)
+    {
+      /* Let the kernel copy the data.  A non-blocking socket may accept
+       * only part of it, which is fine as we report the amount sent. */
+      apr_status_t status = apr_socket_sendfile(stream->sock, file, NULL,
+                                                &offset, len, 0);
+      if (status && !APR_STATUS_IS_EAGAIN(status))
+        return svn_error_wrap_apr(status, _("Can't write to connection"));
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  /* Fall back to reading and writing the data one chunk at a time. */
+  *len = MIN(*len, SVN__STREAM_CHUNK_SIZE);
+  buffer = apr_palloc(scratch_pool, *len);
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(file, buffer, *len, NULL, NULL,
+                                 scratch_pool));
+
+  return svn_error_trace(svn_stream_write(stream->out_stream, buffer, len));
+}
+
 svn_error_t *
 svn_ra_svn__stream_read(svn_ra_svn__stream_t *stream, char *data,
                         apr_size_t *len)
@@ -222,6 +306,18 @@ svn_ra_svn__stream_timeout(svn_ra_svn__stream_t *stream,
   stream->timeout_fn(stream->timeout_baton, interval);
 }
 
+void
+svn_ra_svn__stream_cork(svn_ra_svn__stream_t *stream,
+                        svn_boolean_t cork)
+{
+  if (stream->sock && stream->corked != cork)
+    {
+      /* Not all platforms support this.  It is just an optimization. */
+      apr_socket_opt_set(stream->sock, APR_TCP_NOPUSH, cork ? 1 : 0);
+      stream->corked = cork;
+    }
+}
+
 svn_error_t *
 svn_ra_svn__stream_data_available(svn_ra_svn__stream_t *stream,
                                   svn_boolean_t *data_available)
@@ -23,6 +23,10 @@
 
 #include <stdarg.h>
 
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+
 #include "svn_private_config.h"
 #include "svn_pools.h"
 #include "svn_error.h"
@@ -2359,13 +2363,386 @@ verify_fs2_notify_func(svn_revnum_t revision,
                             notify_baton->notify, pool);
 }
 
+#if APR_HAS_THREADS
+
+/* Number of revisions per job that may be verified ahead of the oldest
+ * revision whose result has not been reported, yet.  This limits the
+ * amount of buffered results while keeping all workers busy even if some
+ * revisions take much longer to verify than others. */
+#define VERIFY_REVS_PER_JOB 16
+
+/* Result of the verification of a single revision by a worker thread. */
+typedef struct verify_result_t
+{
+  /* Set once the worker is done with this revision. */
+  svn_boolean_t done;
+
+  /* Verification result. */
+  svn_error_t *err;
+
+  /* Notifications (svn_repos_notify_t *) sent during verification,
+   * in the order they were received.  NULL if there were none. */
+  apr_array_header_t *notifications;
+
+  /* Root pool containing NOTIFICATIONS.  NULL if there were none. */
+  apr_pool_t *pool;
+} verify_result_t;
+
+/* State shared between the worker threads and the reporting thread. */
+typedef struct verify_queue_t
+{
+  /* Serializes access to all members that are not read-only. */
+  apr_thread_mutex_t *mutex;
+
+  /* Broadcast whenever a result became available, a result has been
+   * reported or the workers shall stop. */
+  apr_thread_cond_t *changed;
+
+  /* Next revision to hand out to a worker. */
+  svn_revnum_t next_rev;
+
+  /* Oldest revision whose result has not been reported, yet. */
+  svn_revnum_t next_to_report;
+
+  /* If set, workers won't start verifying further revisions. */
+  svn_boolean_t stop;
+
+  /* Ring buffer of WINDOW_SIZE results, indexed by revision. */
+  verify_result_t *results;
+  int window_size;
+
+  /* Verification parameters.  These are read-only. */
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+  svn_boolean_t check_normalization;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} verify_queue_t;
+
+/* Per worker thread data. */
+typedef struct verify_worker_t
+{
+  /* Work queue shared with all other workers. */
+  verify_queue_t *queue;
+
+  /* The worker's private file system instance. */
+  svn_fs_t *fs;
+
+  /* Pool to use for FS and all temporaries. */
+  apr_pool_t *pool;
+
+  /* The thread executing this worker. */
+  apr_thread_t *thread;
+} verify_worker_t;
+
+/* Return the result slot for REV in QUEUE. */
+static verify_result_t *
+get_verify_result(verify_queue_t *queue,
+                  svn_revnum_t rev)
+{
+  return &queue->results[(rev - queue->start_rev) % queue->window_size];
+}
+
+/* Implements svn_repos_notify_func_t.  Append a copy of NOTIFY to the
+ * notifications of the verify_result_t given as BATON.
+ */
+static void
+buffer_verify_notification(void *baton,
+                           const svn_repos_notify_t *notify,
+                           apr_pool_t *scratch_pool)
+{
+  verify_result_t *result = baton;
+  svn_repos_notify_t *copy;
+
+  /* Most revisions don't produce any notifications. */
+  if (result->pool == NULL)
+    {
+      apr_allocator_t *allocator = svn_pool_create_allocator(FALSE);
+      result->pool = apr_allocator_owner_get(allocator);
+      result->notifications = apr_array_make(result->pool, 4, sizeof(copy));
+    }
+
+  copy = apr_pmemdup(result->pool, notify, sizeof(*notify));
+  copy->warning_str = apr_pstrdup(result->pool, notify->warning_str);
+  copy->path = apr_pstrdup(result->pool, notify->path);
+  copy->err = svn_error_dup(notify->err);
+
+  APR_ARRAY_PUSH(result->notifications, svn_repos_notify_t *) = copy;
+}
+
+/* Release all resources held by RESULT and mark it as unused. */
+static void
+reset_verify_result(verify_result_t *result)
+{
+  if (result->notifications)
+    {
+      int i;
+      for (i = 0; i < result->notifications->nelts; ++i)
+        svn_error_clear(APR_ARRAY_IDX(result->notifications, i,
+                                      svn_repos_notify_t *)->err);
+    }
+
+  if (result->pool)
+    svn_pool_destroy(result->pool);
+
+  svn_error_clear(result->err);
+
+  result->done = FALSE;
+  result->err = SVN_NO_ERROR;
+  result->notifications = NULL;
+  result->pool = NULL;
+}
+
+/* Thread function verifying revisions from the verify_queue_t of the
+ * verify_worker_t given as DATA until all revisions have been handed out
+ * or we are asked to stop.
+ */
+static void * APR_THREAD_FUNC
+verify_worker_thread(apr_thread_t *thread,
+                     void *data)
+{
+  verify_worker_t *worker = data;
+  verify_queue_t *queue = worker->queue;
+  apr_pool_t *iterpool = svn_pool_create(worker->pool);
+
+  while (TRUE)
+    {
+      svn_revnum_t rev;
+      verify_result_t *result;
+      svn_error_t *err;
+
+      /* Get the next revision to verify.  Don't get too far ahead of the
+       * reporting thread. */
+      apr_thread_mutex_lock(queue->mutex);
+      while (   !queue->stop
+             && queue->next_rev <= queue->end_rev
+             && queue->next_rev
+                  >= queue->next_to_report + queue->window_size)
+        apr_thread_cond_wait(queue->changed, queue->mutex);
+
+      if (queue->stop || queue->next_rev > queue->end_rev)
+        {
+          apr_thread_mutex_unlock(queue->mutex);
+          break;
+        }
+
+      rev = queue->next_rev++;
+      apr_thread_mutex_unlock(queue->mutex);
+
+      /* The result slot for REV is ours until we mark it as "done". */
+      svn_pool_clear(iterpool);
+      result = get_verify_result(queue, rev);
+      err = verify_one_revision(worker->fs, rev,
+                                buffer_verify_notification, result,
+                                queue->start_rev, queue->check_normalization,
+                                queue->cancel_func, queue->cancel_baton,
+                                iterpool);
+
+      apr_thread_mutex_lock(queue->mutex);
+      result->err = err;
+      result->done = TRUE;
+      apr_thread_cond_broadcast(queue->changed);
+      apr_thread_mutex_unlock(queue->mutex);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Don't call apr_thread_exit() here.  It would destroy the thread's
+   * pool, which is a sub-pool of one owned by the reporting thread. */
+  return NULL;
+}
+
+/* Tell all workers in QUEUE to stop and wait for the COUNT threads in
+ * WORKERS to terminate.  Release all resources held by QUEUE and WORKERS.
+ */
+static void
+stop_verify_workers(verify_queue_t *queue,
+                    verify_worker_t *workers,
+                    int count)
+{
+  int i;
+  apr_status_t retval;
+
+  apr_thread_mutex_lock(queue->mutex);
+  queue->stop = TRUE;
+  apr_thread_cond_broadcast(queue->changed);
+  apr_thread_mutex_unlock(queue->mutex);
+
+  for (i = 0; i < count; ++i)
+    apr_thread_join(&retval, workers[i].thread);
+
+  for (i = 0; i < count; ++i)
+    svn_pool_destroy(workers[i].pool);
+
+  for (i = 0; i < queue->window_size; ++i)
+    reset_verify_result(&queue->results[i]);
+}
+
+/* Verify revisions START_REV to END_REV in FS using JOBS worker threads,
+ * each with its own instance of FS.  Notifications are sent from this
+ * thread in revision order.  Set *FOUND_CORRUPTION if any revision failed
+ * verification.  The remaining parameters match svn_repos_verify_fs4().
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+verify_revisions_in_parallel(svn_boolean_t *found_corruption,
+                             svn_fs_t *fs,
+                             svn_revnum_t start_rev,
+                             svn_revnum_t end_rev,
+                             int jobs,
+                             svn_boolean_t keep_going,
+                             svn_boolean_t check_normalization,
+                             svn_repos_notify_func_t notify_func,
+                             void *notify_baton,
+                             svn_cancel_func_t cancel_func,
+                             void *cancel_baton,
+                             apr_pool_t *scratch_pool)
+{
+  const char *fs_path = svn_fs_path(fs, scratch_pool);
+  apr_hash_t *fs_config = svn_fs_config(fs, scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_repos_notify_t *notify = NULL;
+  verify_queue_t *queue = apr_pcalloc(scratch_pool, sizeof(*queue));
+  verify_worker_t *workers;
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_status_t status;
+  svn_revnum_t rev;
+  int started = 0;
+  int i;
+
+  /* Don't start more threads than there are revisions to verify. */
+  if (jobs > end_rev - start_rev + 1)
+    jobs = (int)(end_rev - start_rev + 1);
+
+  queue->next_rev = start_rev;
+  queue->next_to_report = start_rev;
+  queue->window_size = jobs * VERIFY_REVS_PER_JOB;
+  queue->results = apr_pcalloc(scratch_pool,
+                               queue->window_size * sizeof(*queue->results));
+  queue->start_rev = start_rev;
+  queue->end_rev = end_rev;
+  queue->check_normalization = check_normalization;
+  queue->cancel_func = cancel_func;
+  queue->cancel_baton = cancel_baton;
+
+  status = apr_thread_mutex_create(&queue->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                   scratch_pool);
+  if (!status)
+    status = apr_thread_cond_create(&queue->changed, scratch_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create verification queue"));
+
+  /* Open a separate FS instance for each worker.  They may share their
+   * caches but nothing else. */
+  workers = apr_pcalloc(scratch_pool, jobs * sizeof(*workers));
+  for (i = 0; i < jobs; ++i)
+    {
+      workers[i].queue = queue;
+      workers[i].pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+      err = svn_fs_open2(&workers[i].fs, fs_path, fs_config,
+                         workers[i].pool, iterpool);
+      if (err)
+        break;
+    }
+
+  /* Start the workers. */
+  for (started = 0; !err && started < jobs; ++started)
+    {
+      status = apr_thread_create(&workers[started].thread, NULL,
+                                 verify_worker_thread, &workers[started],
+                                 scratch_pool);
+      if (status)
+        err = svn_error_wrap_apr(status, _("Can't create thread"));
+    }
+
+  if (err)
+    {
+      if (started)
+        --started;
+
+      stop_verify_workers(queue, workers, started);
+      for (i = started; i < jobs; ++i)
+        if (workers[i].pool)
+          svn_pool_destroy(workers[i].pool);
+
+      return svn_error_trace(err);
+    }
+
+  if (notify_func)
+    notify = svn_repos_notify_create(svn_repos_notify_verify_rev_end,
+                                     scratch_pool);
+
+  /* Report results in revision order as they become available. */
+  for (rev = start_rev; rev <= end_rev; ++rev)
+    {
+      verify_result_t *result = get_verify_result(queue, rev);
+      svn_pool_clear(iterpool);
+
+      apr_thread_mutex_lock(queue->mutex);
+      while (!result->done)
+        apr_thread_cond_wait(queue->changed, queue->mutex);
+      apr_thread_mutex_unlock(queue->mutex);
+
+      /* Forward what the worker had to say about REV. */
+      if (notify_func && result->notifications)
+        for (i = 0; i < result->notifications->nelts; ++i)
+          notify_func(notify_baton,
+                      APR_ARRAY_IDX(result->notifications, i,
+                                    svn_repos_notify_t *),
+                      iterpool);
+
+      err = result->err;
+      result->err = SVN_NO_ERROR;
+
+      /* Make the slot available for the next revision. */
+      apr_thread_mutex_lock(queue->mutex);
+      reset_verify_result(result);
+      queue->next_to_report = rev + 1;
+      apr_thread_cond_broadcast(queue->changed);
+      apr_thread_mutex_unlock(queue->mutex);
+
+      if (err)
+        {
+          if (err->apr_err == SVN_ERR_CANCELLED)
+            break;
+
+          *found_corruption = TRUE;
+          notify_verification_error(rev, err, notify_func, notify_baton,
+                                    iterpool);
+          svn_error_clear(err);
+          err = SVN_NO_ERROR;
+
+          if (keep_going)
+            continue;
+          else
+            break;
+        }
+
+      if (notify_func)
+        {
+          notify->revision = rev;
+          notify_func(notify_baton, notify, iterpool);
+        }
+    }
+
+  stop_verify_workers(queue, workers, jobs);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
+#endif /* APR_HAS_THREADS */
+
 svn_error_t *
-svn_repos_verify_fs3(svn_repos_t *repos,
+svn_repos_verify_fs4(svn_repos_t *repos,
                      svn_revnum_t start_rev,
                      svn_revnum_t end_rev,
                      svn_boolean_t keep_going,
                      svn_boolean_t check_normalization,
                      svn_boolean_t metadata_only,
+                     int jobs,
                      svn_repos_notify_func_t notify_func,
                      void *notify_baton,
                      svn_cancel_func_t cancel_func,
@@ -2453,6 +2830,16 @@ svn_repos_verify_fs3(svn_repos_t *repos,
       svn_error_clear(err);
     }
 
+#if APR_HAS_THREADS
+  if (!metadata_only && jobs > 1 && start_rev < end_rev)
+    SVN_ERR(verify_revisions_in_parallel(&found_corruption, fs,
+                                         start_rev, end_rev, jobs,
+                                         keep_going, check_normalization,
+                                         notify_func, notify_baton,
+                                         cancel_func, cancel_baton,
+                                         iterpool));
+  else
+#endif
   if (!metadata_only)
     for (rev = start_rev; rev <= end_rev; rev++)
       {
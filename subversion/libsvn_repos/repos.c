@@ -873,6 +873,11 @@ create_conf(svn_repos_t *repos, apr_pool_t *pool)
 "### Unless you specify an absolute path, the file's location is relative"   NL
 "### to the directory containing this file."                                 NL
 "# hooks-env = " SVN_REPOS__CONF_HOOKS_ENV                                   NL
+"### The compression option overrides the network compression method"       NL
+"### svnserve has been configured with.  Valid values are \"none\", \"lz4\"" NL
+"### (which falls back to zlib for older clients), \"zlib\" and \"zlib-N\"" NL
+"### with N being the zlib compression level between 1 and 9."              NL
+"# compression = lz4"                                                        NL
 ""                                                                           NL
 "[sasl]"                                                                     NL
 "### This option specifies whether you want to use the Cyrus SASL"           NL
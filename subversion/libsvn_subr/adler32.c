@@ -26,6 +26,11 @@
 #include <zlib.h>
 
 #include "private/svn_adler32.h"
+#include "private/svn_dep_compat.h"
+
+#if SVN__HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 /**
  * An Adler-32 implementation per RFC1950.
@@ -72,6 +77,41 @@ svn__adler32(apr_uint32_t checksum, const char *data, apr_off_t len)
       apr_uint32_t s2 = checksum >> 16;
       apr_uint32_t b;
 
+#if SVN__HAVE_SSE2
+
+      /* Process 16 bytes per iteration:
+       *
+       *   s2 += 16 * s1 + sum((16 - i) * input[i])
+       *   s1 += sum(input[i])
+       *
+       * No intermediate modulo is needed because LEN is small.
+       */
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i weights_lo = _mm_setr_epi16(16, 15, 14, 13,
+                                                12, 11, 10,  9);
+      const __m128i weights_hi = _mm_setr_epi16( 8,  7,  6,  5,
+                                                 4,  3,  2,  1);
+
+      for (; len >= 16; len -= 16, input += 16)
+        {
+          __m128i chunk = _mm_loadu_si128((const __m128i *)input);
+          __m128i sum = _mm_sad_epu8(chunk, zero);
+          __m128i weighted
+            = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(chunk, zero),
+                                           weights_lo),
+                            _mm_madd_epi16(_mm_unpackhi_epi8(chunk, zero),
+                                           weights_hi));
+
+          weighted = _mm_add_epi32(weighted, _mm_srli_si128(weighted, 8));
+          weighted = _mm_add_epi32(weighted, _mm_srli_si128(weighted, 4));
+          sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+
+          s2 += 16 * s1 + (apr_uint32_t)_mm_cvtsi128_si32(weighted);
+          s1 += (apr_uint32_t)_mm_cvtsi128_si32(sum);
+        }
+
+#endif
+
       /* Some loop unrolling
        * (approx. one clock tick per byte + 2 ticks loop overhead)
        */
@@ -0,0 +1,1016 @@
+/*
+ * cache-disk.c: persistent, file-backed caching for Subversion
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_hash.h>
+#include <apr_strings.h>
+
+#include "svn_hash.h"
+#include "svn_pools.h"
+#include "svn_io.h"
+#include "svn_dirent_uri.h"
+#include "svn_sorts.h"
+
+#include "svn_private_config.h"
+#include "private/svn_cache.h"
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+#include "private/svn_subr_private.h"
+
+#include "cache.h"
+
+/* A note on the file format:
+
+   The cache file consists of three sections.  All numbers are stored
+   in native byte order since the file is only ever shared between
+   processes on the same machine.
+
+   * A fixed-size header (header_t) describing the geometry of the file
+     and the position at which the next entry will be written.
+
+   * A direct-mapped index of BUCKET_COUNT bucket_t elements.  Each key
+     hashes to exactly one bucket.  Newer entries simply replace older
+     ones in the same bucket.
+
+   * A data section of DATA_SIZE bytes that is used as a ring buffer.
+     Each entry consists of the 32 bit length of the full key, followed
+     by the full key, zero padding up to APR_ALIGN_DEFAULT and the
+     serialized value.  The padding keeps the value properly aligned for
+     deserializers that work in-place.  New entries are appended
+     at WRITE_POS; if they don't fit, WRITE_POS wraps around to 0 and
+     the oldest data gets overwritten.
+
+   Since overwritten entries are not removed from the index, every read
+   validates the checksum stored in the bucket as well as the full key
+   before handing out any data.  The same check catches torn reads
+   while another process is writing to the file.
+
+
+   A note on concurrency:
+
+   Within a process, all access to a given cache file is serialized by
+   the MUTEX in svn_disk_cache_t and all svn_cache__t instances for the
+   same file share that object.  Between processes, writers take a
+   non-blocking exclusive lock on the file and simply drop the new entry
+   if some other process holds it.  Readers don't lock at all but rely
+   on the checksums instead.
+*/
+
+/* Identifies the file format.  Bump it whenever the layout changes. */
+#define DISK_CACHE_MAGIC "SVNDC01\n"
+
+/* Alignment of the data section within the file. */
+#define DATA_ALIGNMENT 0x1000
+
+/* Expected average size of a cache entry.  Used to size the index. */
+#define AVERAGE_ENTRY_SIZE 0x1000
+
+/* Upper limit for the number of index buckets. */
+#define MAX_BUCKET_COUNT 0x1000000
+
+/* Lower limit for the size of the data section. */
+#define MIN_DATA_SIZE 0x10000
+
+/* Upper limit for the size of a single entry. */
+#define MAX_ENTRY_SIZE 0x4000000
+
+/* The cache file header. */
+typedef struct header_t
+{
+  /* DISK_CACHE_MAGIC */
+  char magic[8];
+
+  /* Number of bucket_t elements in the index. */
+  apr_uint64_t bucket_count;
+
+  /* Size of the ring buffer in bytes. */
+  apr_uint64_t data_size;
+
+  /* Offset within the ring buffer at which the next entry is written. */
+  apr_uint64_t write_pos;
+} header_t;
+
+/* An index entry. */
+typedef struct bucket_t
+{
+  /* Hash value of the full key. */
+  apr_uint64_t key_hash;
+
+  /* Offset of the entry within the ring buffer. */
+  apr_uint64_t offset;
+
+  /* Size of the entry in bytes, including the key.  0 for unused. */
+  apr_uint32_t size;
+
+  /* FNV-1a checksum over the SIZE bytes at OFFSET. */
+  apr_uint32_t checksum;
+} bucket_t;
+
+/* The shared cache file object. */
+struct svn_disk_cache_t
+{
+  /* Absolute path of the cache file. */
+  const char *path;
+
+  /* The open cache file.  Access must be serialized through MUTEX. */
+  apr_file_t *file;
+
+  /* Serializes all access to FILE within this process. */
+  svn_mutex__t *mutex;
+
+  /* Geometry of the file, see header_t. */
+  apr_uint64_t bucket_count;
+  apr_uint64_t data_size;
+
+  /* Offset of the ring buffer within the file. */
+  apr_off_t data_start;
+
+  /* Largest entry that we will store. */
+  apr_size_t max_entry_size;
+
+  /* Pool that FILE has been allocated in.  Used for temporary lock
+   * sub-pools while holding MUTEX. */
+  apr_pool_t *pool;
+};
+
+/* The (internal) cache object. */
+typedef struct disk_cache_t
+{
+  /* The shared cache file. */
+  svn_disk_cache_t *storage;
+
+  /* A prefix used to differentiate our data from any other data in
+   * the cache file. */
+  const char *prefix;
+
+  /* The size of the key: either a fixed number of bytes or
+   * APR_HASH_KEY_STRING. */
+  apr_ssize_t klen;
+
+  /* Used to marshal values in and out of the cache. */
+  svn_cache__serialize_func_t serialize_func;
+  svn_cache__deserialize_func_t deserialize_func;
+} disk_cache_t;
+
+
+/*** Process-global registry of open cache files. ***/
+
+/* Root pool, mutex and map of path -> svn_disk_cache_t *. */
+static apr_pool_t *registry_pool = NULL;
+static svn_mutex__t *registry_mutex = NULL;
+static apr_hash_t *registry = NULL;
+
+/* Implements svn_atomic__init_once's callback. */
+static svn_error_t *
+init_registry(void *baton,
+              apr_pool_t *unused_pool)
+{
+  registry_pool = svn_pool_create(NULL);
+  registry = apr_hash_make(registry_pool);
+  SVN_ERR(svn_mutex__init(&registry_mutex, TRUE, registry_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the 64 bit FNV-1a hash over the LEN bytes at DATA, continuing
+ * from HASH.  Start with 0xcbf29ce484222325. */
+static apr_uint64_t
+hash64(apr_uint64_t hash,
+       const void *data,
+       apr_size_t len)
+{
+  const unsigned char *p = data;
+  const unsigned char *end = p + len;
+
+  for (; p != end; ++p)
+    hash = (hash ^ *p) * APR_UINT64_C(0x100000001b3);
+
+  return hash;
+}
+
+/* Write the initial header and an empty index to the file in CACHE,
+ * truncating any previous contents.  The caller must hold the file lock.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+reset_cache_file(svn_disk_cache_t *cache,
+                 apr_pool_t *scratch_pool)
+{
+  header_t header = { { 0 } };
+  apr_off_t offset = 0;
+
+  memcpy(header.magic, DISK_CACHE_MAGIC, sizeof(header.magic));
+  header.bucket_count = cache->bucket_count;
+  header.data_size = cache->data_size;
+  header.write_pos = 0;
+
+  /* Truncating to 0 first guarantees that the index is all zeros. */
+  SVN_ERR(svn_io_file_trunc(cache->file, 0, scratch_pool));
+  SVN_ERR(svn_io_file_trunc(cache->file,
+                            cache->data_start + (apr_off_t)cache->data_size,
+                            scratch_pool));
+  SVN_ERR(svn_io_file_seek(cache->file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(cache->file, &header, sizeof(header),
+                                 NULL, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Read LEN bytes at file OFFSET in CACHE into BUFFER.  Set *COMPLETE to
+ * FALSE if the file is too short.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+read_at(svn_boolean_t *complete,
+        svn_disk_cache_t *cache,
+        apr_off_t offset,
+        void *buffer,
+        apr_size_t len,
+        apr_pool_t *scratch_pool)
+{
+  apr_size_t bytes_read;
+  svn_boolean_t eof;
+
+  SVN_ERR(svn_io_file_seek(cache->file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(cache->file, buffer, len, &bytes_read,
+                                 &eof, scratch_pool));
+  *complete = bytes_read == len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Write LEN bytes from BUFFER at file OFFSET in CACHE.
+ * Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+write_at(svn_disk_cache_t *cache,
+         apr_off_t offset,
+         const void *buffer,
+         apr_size_t len,
+         apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_io_file_seek(cache->file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(cache->file, buffer, len, NULL,
+                                 scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Open the file for CACHE->PATH and make sure it has the expected
+ * geometry.  Allocate the file in CACHE->POOL and use SCRATCH_POOL for
+ * temporaries. */
+static svn_error_t *
+open_cache_file(svn_disk_cache_t *cache,
+                apr_pool_t *scratch_pool)
+{
+  header_t header;
+  svn_boolean_t complete;
+  apr_pool_t *lock_pool;
+  svn_error_t *err;
+
+  SVN_ERR(svn_io_file_open(&cache->file, cache->path,
+                           APR_READ | APR_WRITE | APR_CREATE | APR_BINARY,
+                           APR_OS_DEFAULT, cache->pool));
+
+  /* Block until no other process is modifying the file. */
+  lock_pool = svn_pool_create(cache->pool);
+  err = svn_io_lock_open_file(cache->file, TRUE, FALSE, lock_pool);
+  if (err)
+    {
+      svn_pool_destroy(lock_pool);
+      return svn_error_trace(err);
+    }
+
+  err = read_at(&complete, cache, 0, &header, sizeof(header),
+                scratch_pool);
+  if (!err && (   !complete
+               || memcmp(header.magic, DISK_CACHE_MAGIC, sizeof(header.magic))
+               || header.bucket_count != cache->bucket_count
+               || header.data_size != cache->data_size))
+    err = reset_cache_file(cache, scratch_pool);
+
+  err = svn_error_compose_create(err,
+                                 svn_io_unlock_open_file(cache->file,
+                                                         lock_pool));
+  svn_pool_destroy(lock_pool);
+
+  return svn_error_trace(err);
+}
+
+/* Set *CACHE_P to the registry entry for PATH, creating and opening it
+ * if necessary with BUCKET_COUNT buckets, an index of INDEX_SIZE bytes
+ * and a total file size of SIZE.  The caller must hold REGISTRY_MUTEX.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_or_open(svn_disk_cache_t **cache_p,
+            const char *path,
+            apr_uint64_t bucket_count,
+            apr_uint64_t index_size,
+            apr_uint64_t size,
+            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *pool;
+  svn_disk_cache_t *cache;
+  svn_error_t *err;
+
+  *cache_p = svn_hash_gets(registry, path);
+  if (*cache_p)
+    return SVN_NO_ERROR;
+
+  pool = svn_pool_create(registry_pool);
+  cache = apr_pcalloc(pool, sizeof(*cache));
+  cache->pool = pool;
+  cache->path = apr_pstrdup(pool, path);
+  cache->bucket_count = bucket_count;
+  cache->data_start = (apr_off_t)index_size;
+  cache->data_size = size - index_size;
+  cache->max_entry_size
+    = (apr_size_t)MIN(cache->data_size / 16, MAX_ENTRY_SIZE);
+
+  err = svn_mutex__init(&cache->mutex, TRUE, pool);
+  if (!err)
+    err = open_cache_file(cache, scratch_pool);
+
+  if (err)
+    {
+      svn_pool_destroy(pool);
+      return svn_error_trace(err);
+    }
+
+  svn_hash_sets(registry, cache->path, cache);
+  *cache_p = cache;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__open_disk_cache(svn_disk_cache_t **cache_p,
+                           const char *path,
+                           apr_uint64_t size,
+                           apr_pool_t *scratch_pool)
+{
+  static svn_atomic_t initialized = 0;
+  apr_uint64_t bucket_count;
+  apr_uint64_t index_size;
+
+  SVN_ERR(svn_atomic__init_once(&initialized, init_registry, NULL,
+                                scratch_pool));
+
+  /* Determine the file geometry. */
+  bucket_count = size / AVERAGE_ENTRY_SIZE;
+  if (bucket_count > MAX_BUCKET_COUNT)
+    bucket_count = MAX_BUCKET_COUNT;
+
+  index_size = sizeof(header_t) + bucket_count * sizeof(bucket_t);
+  index_size = (index_size + DATA_ALIGNMENT - 1)
+             & ~(apr_uint64_t)(DATA_ALIGNMENT - 1);
+  if (bucket_count == 0 || size < index_size + MIN_DATA_SIZE)
+    return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("Disk cache size %s is too small"),
+                             apr_psprintf(scratch_pool,
+                                          "%" APR_UINT64_T_FMT, size));
+
+  path = svn_dirent_canonicalize(path, scratch_pool);
+  SVN_MUTEX__WITH_LOCK(registry_mutex,
+                       get_or_open(cache_p, path, bucket_count, index_size,
+                                   size, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+
+/*** Reading and writing entries.  The caller must hold CACHE->MUTEX. ***/
+
+/* Construct the full key for KEY in CACHE, i.e. the prefix followed by
+ * the raw key data.  Return it in *FULL_KEY and its length in *LEN.
+ * Allocate it in RESULT_POOL. */
+static void
+build_key(const char **full_key,
+          apr_size_t *len,
+          disk_cache_t *cache,
+          const void *key,
+          apr_pool_t *result_pool)
+{
+  apr_size_t prefix_len = strlen(cache->prefix);
+  apr_size_t key_len = cache->klen == APR_HASH_KEY_STRING
+                     ? strlen(key)
+                     : (apr_size_t)cache->klen;
+  char *result = apr_palloc(result_pool, prefix_len + key_len);
+
+  memcpy(result, cache->prefix, prefix_len);
+  memcpy(result + prefix_len, key, key_len);
+
+  *full_key = result;
+  *len = prefix_len + key_len;
+}
+
+/* Return the file offset of the bucket for HASH in CACHE. */
+static apr_off_t
+bucket_offset(svn_disk_cache_t *cache,
+              apr_uint64_t hash)
+{
+  return (apr_off_t)(sizeof(header_t)
+                     + (hash % cache->bucket_count) * sizeof(bucket_t));
+}
+
+/* Look up the entry for the FULL_KEY of length KEY_LEN in STORAGE.  If
+ * found, return a copy of its value in *DATA and its size in *SIZE, both
+ * allocated in RESULT_POOL.  Otherwise, set *DATA to NULL. */
+static svn_error_t *
+read_entry(char **data,
+           apr_size_t *size,
+           svn_disk_cache_t *storage,
+           const char *full_key,
+           apr_size_t key_len,
+           apr_pool_t *result_pool)
+{
+  apr_uint64_t hash = hash64(APR_UINT64_C(0xcbf29ce484222325),
+                             full_key, key_len);
+  bucket_t bucket;
+  apr_uint32_t stored_key_len;
+  apr_size_t value_offset
+    = APR_ALIGN_DEFAULT(sizeof(stored_key_len) + key_len);
+  svn_boolean_t complete;
+  char *buffer;
+
+  *data = NULL;
+
+  SVN_ERR(read_at(&complete, storage, bucket_offset(storage, hash),
+                  &bucket, sizeof(bucket), result_pool));
+
+  /* Empty, colliding or corrupt bucket? */
+  if (   !complete
+      || bucket.key_hash != hash
+      || bucket.size < value_offset
+      || bucket.size > storage->max_entry_size
+      || bucket.offset > storage->data_size - bucket.size)
+    return SVN_NO_ERROR;
+
+  /* Read the whole entry and verify that it has not been overwritten. */
+  buffer = apr_palloc(result_pool, bucket.size);
+  SVN_ERR(read_at(&complete, storage,
+                  storage->data_start + (apr_off_t)bucket.offset,
+                  buffer, bucket.size, result_pool));
+  if (   !complete
+      || svn__fnv1a_32x4(buffer, bucket.size) != bucket.checksum)
+    return SVN_NO_ERROR;
+
+  memcpy(&stored_key_len, buffer, sizeof(stored_key_len));
+  if (   stored_key_len != key_len
+      || memcmp(buffer + sizeof(stored_key_len), full_key, key_len))
+    return SVN_NO_ERROR;
+
+  *data = buffer + value_offset;
+  *size = bucket.size - value_offset;
+
+  return SVN_NO_ERROR;
+}
+
+/* Store LEN bytes of DATA under FULL_KEY of length KEY_LEN in STORAGE.
+ * Silently do nothing if another process is currently writing to the
+ * cache file.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_entry(svn_disk_cache_t *storage,
+            const char *full_key,
+            apr_size_t key_len,
+            const void *data,
+            apr_size_t len,
+            apr_pool_t *scratch_pool)
+{
+  apr_uint32_t stored_key_len = (apr_uint32_t)key_len;
+  apr_size_t value_offset
+    = APR_ALIGN_DEFAULT(sizeof(stored_key_len) + key_len);
+  apr_size_t entry_size = value_offset + len;
+  header_t header;
+  bucket_t bucket;
+  svn_boolean_t complete;
+  char *buffer;
+  apr_pool_t *lock_pool;
+  svn_error_t *err;
+
+  if (entry_size > storage->max_entry_size)
+    return SVN_NO_ERROR;
+
+  /* Assemble the entry in memory so we can write it in one go. */
+  buffer = apr_palloc(scratch_pool, entry_size);
+  memcpy(buffer, &stored_key_len, sizeof(stored_key_len));
+  memcpy(buffer + sizeof(stored_key_len), full_key, key_len);
+  memset(buffer + sizeof(stored_key_len) + key_len, 0,
+         value_offset - sizeof(stored_key_len) - key_len);
+  memcpy(buffer + value_offset, data, len);
+
+  bucket.key_hash = hash64(APR_UINT64_C(0xcbf29ce484222325),
+                           full_key, key_len);
+  bucket.size = (apr_uint32_t)entry_size;
+  bucket.checksum = svn__fnv1a_32x4(buffer, entry_size);
+
+  /* Caching is optional; don't wait for other writers. */
+  lock_pool = svn_pool_create(storage->pool);
+  err = svn_io_lock_open_file(storage->file, TRUE, TRUE, lock_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      svn_pool_destroy(lock_pool);
+      return SVN_NO_ERROR;
+    }
+
+  /* Another process may have advanced the write position. */
+  err = read_at(&complete, storage, 0, &header, sizeof(header),
+                scratch_pool);
+  if (!err && complete)
+    {
+      if (header.write_pos > storage->data_size - entry_size)
+        header.write_pos = 0;
+      bucket.offset = header.write_pos;
+
+      /* Data first, then the index and the header.  Readers that see
+       * the new bucket before the data has been written will detect the
+       * checksum mismatch. */
+      err = write_at(storage, storage->data_start + (apr_off_t)bucket.offset,
+                     buffer, entry_size, scratch_pool);
+      if (!err)
+        err = write_at(storage, bucket_offset(storage, bucket.key_hash),
+                       &bucket, sizeof(bucket), scratch_pool);
+      if (!err)
+        {
+          header.write_pos += entry_size;
+          err = write_at(storage, 0, &header, sizeof(header), scratch_pool);
+        }
+    }
+
+  err = svn_error_compose_create(err,
+                                 svn_io_unlock_open_file(storage->file,
+                                                         lock_pool));
+  svn_pool_destroy(lock_pool);
+
+  return svn_error_trace(err);
+}
+
+/* Core functionality of our getter functions: fetch DATA from the cache
+ * file given by CACHE_VOID and identified by KEY.  Indicate success in
+ * FOUND and allocate DATA in POOL.
+ */
+static svn_error_t *
+disk_cache_internal_get(char **data,
+                        apr_size_t *size,
+                        svn_boolean_t *found,
+                        void *cache_void,
+                        const void *key,
+                        apr_pool_t *pool)
+{
+  disk_cache_t *cache = cache_void;
+  const char *full_key;
+  apr_size_t key_len;
+
+  if (key == NULL)
+    {
+      *found = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  build_key(&full_key, &key_len, cache, key, pool);
+  SVN_MUTEX__WITH_LOCK(cache->storage->mutex,
+                       read_entry(data, size, cache->storage, full_key,
+                                  key_len, pool));
+
+  *found = *data != NULL;
+  return SVN_NO_ERROR;
+}
+
+/* Core functionality of our setter functions: store LEN bytes of DATA
+ * to be identified by KEY in the cache file given by CACHE_VOID.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+disk_cache_internal_set(void *cache_void,
+                        const void *key,
+                        const void *data,
+                        apr_size_t len,
+                        apr_pool_t *scratch_pool)
+{
+  disk_cache_t *cache = cache_void;
+  const char *full_key;
+  apr_size_t key_len;
+
+  build_key(&full_key, &key_len, cache, key, scratch_pool);
+  SVN_MUTEX__WITH_LOCK(cache->storage->mutex,
+                       write_entry(cache->storage, full_key, key_len,
+                                   data, len, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+
+/*** The svn_cache__t vtable for disk caches. ***/
+
+static svn_error_t *
+disk_cache_get(void **value_p,
+               svn_boolean_t *found,
+               void *cache_void,
+               const void *key,
+               apr_pool_t *result_pool)
+{
+  disk_cache_t *cache = cache_void;
+  char *data;
+  apr_size_t data_len;
+  SVN_ERR(disk_cache_internal_get(&data,
+                                  &data_len,
+                                  found,
+                                  cache_void,
+                                  key,
+                                  result_pool));
+
+  /* If we found it, de-serialize it. */
+  if (*found)
+    {
+      if (cache->deserialize_func)
+        {
+          SVN_ERR((cache->deserialize_func)(value_p, data, data_len,
+                                            result_pool));
+        }
+      else
+        {
+          svn_stringbuf_t *value = svn_stringbuf_create_empty(result_pool);
+          value->data = data;
+          value->blocksize = data_len;
+          value->len = data_len - 1; /* account for trailing NUL */
+          *value_p = value;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement vtable.has_key in terms of the getter.
+ */
+static svn_error_t *
+disk_cache_has_key(svn_boolean_t *found,
+                   void *cache_void,
+                   const void *key,
+                   apr_pool_t *scratch_pool)
+{
+  char *data;
+  apr_size_t data_len;
+  SVN_ERR(disk_cache_internal_get(&data,
+                                  &data_len,
+                                  found,
+                                  cache_void,
+                                  key,
+                                  scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+disk_cache_set(void *cache_void,
+               const void *key,
+               void *value,
+               apr_pool_t *scratch_pool)
+{
+  disk_cache_t *cache = cache_void;
+  apr_pool_t *subpool;
+  void *data;
+  apr_size_t data_len;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  if (key == NULL)
+    return SVN_NO_ERROR;
+
+  subpool = svn_pool_create(scratch_pool);
+  if (cache->serialize_func)
+    {
+      err = (cache->serialize_func)(&data, &data_len, value, subpool);
+    }
+  else
+    {
+      svn_stringbuf_t *value_str = value;
+      data = value_str->data;
+      data_len = value_str->len + 1; /* copy trailing NUL */
+    }
+
+  if (!err)
+    err = disk_cache_internal_set(cache_void, key, data, data_len, subpool);
+
+  svn_pool_destroy(subpool);
+  return svn_error_trace(err);
+}
+
+static svn_error_t *
+disk_cache_get_partial(void **value_p,
+                       svn_boolean_t *found,
+                       void *cache_void,
+                       const void *key,
+                       svn_cache__partial_getter_func_t func,
+                       void *baton,
+                       apr_pool_t *result_pool)
+{
+  char *data;
+  apr_size_t size;
+  SVN_ERR(disk_cache_internal_get(&data,
+                                  &size,
+                                  found,
+                                  cache_void,
+                                  key,
+                                  result_pool));
+
+  /* If we found it, de-serialize it. */
+  return *found
+    ? func(value_p, data, size, baton, result_pool)
+    : SVN_NO_ERROR;
+}
+
+static svn_error_t *
+disk_cache_set_partial(void *cache_void,
+                       const void *key,
+                       svn_cache__partial_setter_func_t func,
+                       void *baton,
+                       apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+
+  void *data;
+  apr_size_t size;
+  svn_boolean_t found = FALSE;
+
+  apr_pool_t *subpool = svn_pool_create(scratch_pool);
+  err = disk_cache_internal_get((char **)&data,
+                                &size,
+                                &found,
+                                cache_void,
+                                key,
+                                subpool);
+
+  /* If we found it, modify it and write it back to cache */
+  if (!err && found)
+    {
+      err = func(&data, &size, baton, subpool);
+      if (!err)
+        err = disk_cache_internal_set(cache_void, key, data, size, subpool);
+    }
+
+  svn_pool_destroy(subpool);
+  return svn_error_trace(err);
+}
+
+static svn_error_t *
+disk_cache_iter(svn_boolean_t *completed,
+                void *cache_void,
+                svn_iter_apr_hash_cb_t user_cb,
+                void *user_baton,
+                apr_pool_t *scratch_pool)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Can't iterate a disk cache"));
+}
+
+static svn_boolean_t
+disk_cache_is_cachable(void *cache_void, apr_size_t size)
+{
+  disk_cache_t *cache = cache_void;
+
+  /* Leave some room for the key. */
+  return size + 0x100 < cache->storage->max_entry_size;
+}
+
+static svn_error_t *
+disk_cache_get_info(void *cache_void,
+                    svn_cache__info_t *info,
+                    svn_boolean_t reset,
+                    apr_pool_t *result_pool)
+{
+  disk_cache_t *cache = cache_void;
+
+  info->id = apr_pstrdup(result_pool, cache->prefix);
+  info->total_size = cache->storage->data_size;
+  info->total_entries = cache->storage->bucket_count;
+
+  /* we don't track actual usage */
+
+  return SVN_NO_ERROR;
+}
+
+static svn_cache__vtable_t disk_cache_vtable = {
+  disk_cache_get,
+  disk_cache_has_key,
+  disk_cache_set,
+  disk_cache_iter,
+  disk_cache_is_cachable,
+  disk_cache_get_partial,
+  disk_cache_set_partial,
+  disk_cache_get_info
+};
+
+svn_error_t *
+svn_cache__create_disk_cache(svn_cache__t **cache_p,
+                             svn_disk_cache_t *storage,
+                             svn_cache__serialize_func_t serialize_func,
+                             svn_cache__deserialize_func_t deserialize_func,
+                             apr_ssize_t klen,
+                             const char *prefix,
+                             apr_pool_t *result_pool)
+{
+  svn_cache__t *wrapper = apr_pcalloc(result_pool, sizeof(*wrapper));
+  disk_cache_t *cache = apr_pcalloc(result_pool, sizeof(*cache));
+
+  cache->serialize_func = serialize_func;
+  cache->deserialize_func = deserialize_func;
+  cache->klen = klen;
+  cache->prefix = apr_pstrcat(result_pool, prefix, ":", SVN_VA_NULL);
+  cache->storage = storage;
+
+  wrapper->vtable = &disk_cache_vtable;
+  wrapper->cache_internal = cache;
+  wrapper->error_handler = 0;
+  wrapper->error_baton = 0;
+  wrapper->pretend_empty = !!getenv("SVN_X_DOES_NOT_MARK_THE_SPOT");
+
+  *cache_p = wrapper;
+  return SVN_NO_ERROR;
+}
+
+
+/*** Two-level caches. ***/
+
+/* The (internal) cache object. */
+typedef struct tiered_cache_t
+{
+  /* The fast, volatile cache that is always consulted first. */
+  svn_cache__t *first;
+
+  /* The slower fallback.  Hits in here get copied into FIRST. */
+  svn_cache__t *second;
+} tiered_cache_t;
+
+static svn_error_t *
+tiered_cache_get(void **value_p,
+                 svn_boolean_t *found,
+                 void *cache_void,
+                 const void *key,
+                 apr_pool_t *result_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__get(value_p, found, cache->first, key, result_pool));
+  if (*found)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cache__get(value_p, found, cache->second, key, result_pool));
+  if (*found)
+    {
+      apr_pool_t *subpool = svn_pool_create(result_pool);
+      SVN_ERR(svn_cache__set(cache->first, key, *value_p, subpool));
+      svn_pool_destroy(subpool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_has_key(svn_boolean_t *found,
+                     void *cache_void,
+                     const void *key,
+                     apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__has_key(found, cache->first, key, scratch_pool));
+  if (!*found)
+    SVN_ERR(svn_cache__has_key(found, cache->second, key, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_set(void *cache_void,
+                 const void *key,
+                 void *value,
+                 apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__set(cache->first, key, value, scratch_pool));
+  SVN_ERR(svn_cache__set(cache->second, key, value, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_get_partial(void **value_p,
+                         svn_boolean_t *found,
+                         void *cache_void,
+                         const void *key,
+                         svn_cache__partial_getter_func_t func,
+                         void *baton,
+                         apr_pool_t *result_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__get_partial(value_p, found, cache->first, key,
+                                 func, baton, result_pool));
+  if (!*found)
+    SVN_ERR(svn_cache__get_partial(value_p, found, cache->second, key,
+                                   func, baton, result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_set_partial(void *cache_void,
+                         const void *key,
+                         svn_cache__partial_setter_func_t func,
+                         void *baton,
+                         apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__set_partial(cache->first, key, func, baton,
+                                 scratch_pool));
+  SVN_ERR(svn_cache__set_partial(cache->second, key, func, baton,
+                                 scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_iter(svn_boolean_t *completed,
+                  void *cache_void,
+                  svn_iter_apr_hash_cb_t user_cb,
+                  void *user_baton,
+                  apr_pool_t *scratch_pool)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Can't iterate a tiered cache"));
+}
+
+static svn_boolean_t
+tiered_cache_is_cachable(void *cache_void, apr_size_t size)
+{
+  tiered_cache_t *cache = cache_void;
+
+  return svn_cache__is_cachable(cache->first, size)
+      || svn_cache__is_cachable(cache->second, size);
+}
+
+static svn_error_t *
+tiered_cache_get_info(void *cache_void,
+                      svn_cache__info_t *info,
+                      svn_boolean_t reset,
+                      apr_pool_t *result_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  /* Report the first level only.  Its statistics are what the users
+   * of the cache statistics care about. */
+  return svn_error_trace(svn_cache__get_info(cache->first, info, reset,
+                                             result_pool));
+}
+
+static svn_cache__vtable_t tiered_cache_vtable = {
+  tiered_cache_get,
+  tiered_cache_has_key,
+  tiered_cache_set,
+  tiered_cache_iter,
+  tiered_cache_is_cachable,
+  tiered_cache_get_partial,
+  tiered_cache_set_partial,
+  tiered_cache_get_info
+};
+
+svn_error_t *
+svn_cache__create_tiered_cache(svn_cache__t **cache_p,
+                               svn_cache__t *first,
+                               svn_cache__t *second,
+                               apr_pool_t *result_pool)
+{
+  svn_cache__t *wrapper = apr_pcalloc(result_pool, sizeof(*wrapper));
+  tiered_cache_t *cache = apr_pcalloc(result_pool, sizeof(*cache));
+
+  cache->first = first;
+  cache->second = second;
+
+  wrapper->vtable = &tiered_cache_vtable;
+  wrapper->cache_internal = cache;
+  wrapper->error_handler = 0;
+  wrapper->error_baton = 0;
+  wrapper->pretend_empty = FALSE;
+
+  *cache_p = wrapper;
+  return SVN_NO_ERROR;
+}
@@ -22,7 +22,9 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <apr_md5.h>
+#include <apr_shm.h>
 #include <apr_thread_rwlock.h>
 
 #include "svn_pools.h"
@@ -131,6 +133,47 @@
 #  define USE_SIMPLE_MUTEX 0
 #endif
 
+/* With many threads hammering the same segments, even the read locks
+ * become a bottleneck because every rdlock / unlock pair modifies the
+ * lock's state and bounces its cache line between CPU cores.
+ *
+ * Therefore, full item reads will first try to work without any lock:
+ * Every segment has a sequence counter that writers increment before and
+ * after modifying the segment (i.e. it is odd while a modification is
+ * in progress).  A reader samples the counter, looks up the entry and
+ * copies its data into a private buffer.  If the counter is still
+ * unchanged afterwards, the copy is consistent.  Otherwise, the result is
+ * discarded and the lookup is repeated with the read lock held.
+ *
+ * This requires explicit memory ordering which APR does not provide.
+ * So, we only support it for compilers with the __atomic builtins and
+ * skip it when the expensive consistency checks are enabled.
+ */
+#if (   APR_HAS_THREADS && !USE_SIMPLE_MUTEX \
+     && !defined(SVN_DEBUG_CACHE_MEMBUFFER) \
+     && (   defined(__clang__) \
+         || (defined(__GNUC__) \
+             && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))))
+#  define USE_OPTIMISTIC_READS 1
+#else
+#  define USE_OPTIMISTIC_READS 0
+#endif
+
+/* Caches shared between processes need a lock that works across process
+ * boundaries.  It must also be robust, i.e. a process dying while holding
+ * it must not block all others forever.  Robust process-shared pthread
+ * mutexes are the only portable implementation of that and come with
+ * EOWNERDEAD.  Without them, caches cannot be shared.
+ */
+#if APR_HAS_PROC_PTHREAD_SERIALIZE && defined(EOWNERDEAD)
+#  define USE_ROBUST_PROCESS_LOCK 1
+#  include <pthread.h>
+typedef pthread_mutex_t process_lock_t;
+#else
+#  define USE_ROBUST_PROCESS_LOCK 0
+typedef struct process_lock_t process_lock_t;
+#endif
+
 /* For more efficient copy operations, let's align all data items properly.
  * Must be a power of 2.
  */
@@ -587,6 +630,42 @@ struct svn_membuffer_t
    */
   apr_uint64_t total_hits;
 
+  /* Total number of calls to membuffer_cache_get that have been served
+   * without acquiring LOCK.  These are not included in TOTAL_READS.
+   * Purely statistical information that may be used for profiling only.
+   * Since no lock is being held, updates must be atomic.
+   */
+  svn_atomic_t lock_free_reads;
+
+  /* Number of hits among LOCK_FREE_READS.  These are not included in
+   * TOTAL_HITS.
+   * Purely statistical information that may be used for profiling only.
+   * Since no lock is being held, updates must be atomic.
+   */
+  svn_atomic_t lock_free_hits;
+
+  /* Number of lock-free reads that had to be retried under LOCK because
+   * of a concurrent modification.
+   * Purely statistical information that may be used for profiling only.
+   * Since no lock is being held, updates must be atomic.
+   */
+  svn_atomic_t lock_free_retries;
+
+#if USE_OPTIMISTIC_READS
+  /* Modification counter used to validate lock-free reads.  Writers
+   * increment it before and after modifying this segment, i.e. it is
+   * odd while a modification is in progress.  Only to be modified while
+   * holding the write lock.
+   */
+  apr_uint32_t write_sequence;
+#endif
+
+  /* A robust lock for inter-process synchronization if this segment lives
+   * in shared memory, NULL otherwise.  The mutex itself is in shared
+   * memory as well.  If set, LOCK will not be used.
+   */
+  process_lock_t *process_lock;
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   /* A lock for intra-process synchronization to the cache, or NULL if
    * the cache's creator doesn't feel the cache needs to be
@@ -613,11 +692,121 @@ struct svn_membuffer_t
  */
 #define ALIGN_POINTER(pointer) ((void*)ALIGN_VALUE((apr_size_t)(char*)(pointer)))
 
+/* Signal the start of a modification of CACHE to lock-free readers.
+ * The caller must hold the write lock for CACHE.
+ */
+static APR_INLINE void
+begin_modification(svn_membuffer_t *cache)
+{
+#if USE_OPTIMISTIC_READS
+  apr_uint32_t sequence = __atomic_load_n(&cache->write_sequence,
+                                          __ATOMIC_RELAXED);
+  __atomic_store_n(&cache->write_sequence, sequence + 1, __ATOMIC_RELAXED);
+
+  /* Make the odd sequence number visible before any of our changes. */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+/* Signal the end of a modification of CACHE to lock-free readers.
+ * The caller must still hold the write lock for CACHE.  Return ERR.
+ */
+static APR_INLINE svn_error_t *
+end_modification(svn_membuffer_t *cache, svn_error_t *err)
+{
+#if USE_OPTIMISTIC_READS
+  apr_uint32_t sequence = __atomic_load_n(&cache->write_sequence,
+                                          __ATOMIC_RELAXED);
+
+  /* All our changes must become visible before the new sequence number. */
+  __atomic_store_n(&cache->write_sequence, sequence + 1, __ATOMIC_RELEASE);
+#endif
+
+  return err;
+}
+
+/* Remove all contents from the cache SEGMENT.  The caller must hold the
+ * write lock and signal the modification to lock-free readers.
+ */
+static void
+reset_segment(svn_membuffer_t *segment)
+{
+  /* Length of the group_initialized array in bytes.
+     See also svn_cache__membuffer_cache_create(). */
+  apr_size_t group_init_size
+    = 1 + (segment->group_count + segment->spare_group_count)
+            / (8 * GROUP_INIT_GRANULARITY);
+
+  /* Mark all groups as "not initialized", which implies "empty". */
+  segment->first_spare_group = NO_INDEX;
+  segment->max_spare_used = 0;
+
+  memset(segment->group_initialized, 0, group_init_size);
+
+  /* Unlink L1 contents. */
+  segment->l1.first = NO_INDEX;
+  segment->l1.last = NO_INDEX;
+  segment->l1.next = NO_INDEX;
+  segment->l1.current_data = segment->l1.start_offset;
+
+  /* Unlink L2 contents. */
+  segment->l2.first = NO_INDEX;
+  segment->l2.last = NO_INDEX;
+  segment->l2.next = NO_INDEX;
+  segment->l2.current_data = segment->l2.start_offset;
+
+  /* Reset content counters. */
+  segment->data_used = 0;
+  segment->used_entries = 0;
+}
+
+#if USE_ROBUST_PROCESS_LOCK
+
+/* Acquire the inter-process lock of CACHE.  Since there is no portable
+ * shared read-write lock, readers and writers get exclusive access.
+ *
+ * If the previous owner of the lock died while holding it, the segment
+ * may be in any state.  Drop all its contents and continue.
+ */
+static svn_error_t *
+process_lock_cache(svn_membuffer_t *cache)
+{
+  int status = pthread_mutex_lock(cache->process_lock);
+  if (status == EOWNERDEAD)
+    {
+#if USE_OPTIMISTIC_READS
+      /* Close the modification that the previous owner may have left
+       * open, such that lock-free readers will see a consistent state
+       * again after the reset below. */
+      if (__atomic_load_n(&cache->write_sequence, __ATOMIC_RELAXED) & 1)
+        begin_modification(cache);
+#endif
+
+      begin_modification(cache);
+      reset_segment(cache);
+      end_modification(cache, SVN_NO_ERROR);
+
+      status = pthread_mutex_consistent(cache->process_lock);
+    }
+
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't lock cache mutex"));
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
 /* If locking is supported for CACHE, acquire a read lock for it.
  */
 static svn_error_t *
 read_lock_cache(svn_membuffer_t *cache)
 {
+#if USE_ROBUST_PROCESS_LOCK
+  if (cache->process_lock)
+    return process_lock_cache(cache);
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -641,6 +830,11 @@ read_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 {
+#if USE_ROBUST_PROCESS_LOCK
+  if (cache->process_lock)
+    return process_lock_cache(cache);
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -678,6 +872,11 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 static svn_error_t *
 force_write_lock_cache(svn_membuffer_t *cache)
 {
+#if USE_ROBUST_PROCESS_LOCK
+  if (cache->process_lock)
+    return process_lock_cache(cache);
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -698,6 +897,20 @@ force_write_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 {
+#if USE_ROBUST_PROCESS_LOCK
+  if (cache->process_lock)
+    {
+      int status = pthread_mutex_unlock(cache->process_lock);
+      if (err)
+        return err;
+
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unlock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__unlock(cache->lock, err);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -749,7 +962,9 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  begin_modification(cache);                                    \
+  SVN_ERR(unlock_cache(cache,                                   \
+                       end_modification(cache, (expr))));       \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -1611,16 +1826,35 @@ static void* secure_aligned_alloc(apr_pool_t *pool,
   return memory;
 }
 
-svn_error_t *
-svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
-                                  apr_size_t total_size,
-                                  apr_size_t directory_size,
-                                  apr_size_t segment_count,
-                                  svn_boolean_t thread_safe,
-                                  svn_boolean_t allow_blocking_writes,
-                                  apr_pool_t *pool)
+/* Return the next SIZE bytes from the pre-allocated block at *NEXT and
+ * advance *NEXT accordingly, keeping it aligned to ITEM_ALIGNMENT.
+ */
+static void *
+carve_aligned(char **next, apr_size_t size)
+{
+  void *memory = *next;
+  *next += ALIGN_VALUE(size);
+
+  return memory;
+}
+
+/* Implement svn_cache__membuffer_cache_create and
+ * svn_cache__membuffer_cache_create_shared.  If SHARED is set, allocate
+ * all segment data in anonymous shared memory and synchronize access
+ * across processes, ignoring THREAD_SAFE and ALLOW_BLOCKING_WRITES.
+ */
+static svn_error_t *
+membuffer_cache_create(svn_membuffer_t **cache,
+                       apr_size_t total_size,
+                       apr_size_t directory_size,
+                       apr_size_t segment_count,
+                       svn_boolean_t thread_safe,
+                       svn_boolean_t allow_blocking_writes,
+                       svn_boolean_t shared,
+                       apr_pool_t *pool)
 {
   svn_membuffer_t *c;
+  char *shared_memory = NULL;
 
   apr_uint32_t seg;
   apr_uint32_t group_count;
@@ -1682,9 +1916,6 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
          && segment_count < MAX_SEGMENT_COUNT)
     segment_count *= 2;
 
-  /* allocate cache as an array of segments / cache objects */
-  c = apr_palloc(pool, segment_count * sizeof(*c));
-
   /* Split total cache size into segments of equal size
    */
   total_size /= segment_count;
@@ -1735,6 +1966,42 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   assert(spare_group_count > 0 && main_group_count > 0);
 
   group_init_size = 1 + group_count / (8 * GROUP_INIT_GRANULARITY);
+
+  /* allocate cache as an array of segments / cache objects */
+  if (shared)
+    {
+#if USE_ROBUST_PROCESS_LOCK
+      /* Everything goes into a single block of shared memory that will
+       * be mapped to the same address in all processes forked from this
+       * one.  Hence, all our pointers remain valid there.  Fresh shared
+       * memory is zero-initialized. */
+      apr_shm_t *shm;
+      apr_size_t shm_size
+        = ALIGN_VALUE(segment_count * sizeof(*c))
+        + segment_count * (  ALIGN_VALUE(group_count * sizeof(entry_group_t))
+                           + ALIGN_VALUE(group_init_size)
+                           + ALIGN_VALUE((apr_size_t)data_size)
+                           + ALIGN_VALUE(sizeof(pthread_mutex_t)))
+        + ITEM_ALIGNMENT;
+
+      apr_status_t status = apr_shm_create(&shm, shm_size, NULL, pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create shared memory for cache"));
+
+      shared_memory = ALIGN_POINTER(apr_shm_baseaddr_get(shm));
+      c = carve_aligned(&shared_memory, segment_count * sizeof(*c));
+#else
+      return svn_error_create(APR_ENOTIMPL, NULL,
+                              _("Shared caches require robust "
+                                "inter-process mutexes"));
+#endif
+    }
+  else
+    {
+      c = apr_palloc(pool, segment_count * sizeof(*c));
+    }
+
   for (seg = 0; seg < segment_count; ++seg)
     {
       /* allocate buffers and initialize cache members
@@ -1746,12 +2013,22 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].first_spare_group = NO_INDEX;
       c[seg].max_spare_used = 0;
 
-      c[seg].directory = apr_pcalloc(pool,
-                                     group_count * sizeof(entry_group_t));
-
       /* Allocate and initialize directory entries as "not initialized",
          hence "unused" */
-      c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+      if (shared_memory)
+        {
+          c[seg].directory
+            = carve_aligned(&shared_memory,
+                            group_count * sizeof(entry_group_t));
+          c[seg].group_initialized = carve_aligned(&shared_memory,
+                                                   group_init_size);
+        }
+      else
+        {
+          c[seg].directory = apr_pcalloc(pool,
+                                         group_count * sizeof(entry_group_t));
+          c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+        }
 
       /* Allocate 1/4th of the data buffer to L1
        */
@@ -1771,7 +2048,9 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].l2.size = data_size - c[seg].l1.size;
       c[seg].l2.current_data = c[seg].l2.start_offset;
 
-      c[seg].data = secure_aligned_alloc(pool, (apr_size_t)data_size, FALSE);
+      c[seg].data = shared_memory
+                  ? carve_aligned(&shared_memory, (apr_size_t)data_size)
+                  : secure_aligned_alloc(pool, (apr_size_t)data_size, FALSE);
       c[seg].data_used = 0;
       c[seg].max_entry_size = max_entry_size;
 
@@ -1779,6 +2058,12 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].total_reads = 0;
       c[seg].total_writes = 0;
       c[seg].total_hits = 0;
+      c[seg].lock_free_reads = 0;
+      c[seg].lock_free_hits = 0;
+      c[seg].lock_free_retries = 0;
+#if USE_OPTIMISTIC_READS
+      c[seg].write_sequence = 0;
+#endif
 
       /* were allocations successful?
        * If not, initialize a minimal cache structure.
@@ -1790,6 +2075,38 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
           return svn_error_wrap_apr(APR_ENOMEM, "OOM");
         }
 
+      /* Shared caches are only protected by an inter-process lock.
+       * It serializes access by threads of the same process as well. */
+      c[seg].process_lock = NULL;
+#if USE_ROBUST_PROCESS_LOCK
+      if (shared)
+        {
+          pthread_mutexattr_t attr;
+          int status = pthread_mutexattr_init(&attr);
+          if (status == 0)
+            {
+              status = pthread_mutexattr_setpshared(&attr,
+                                                    PTHREAD_PROCESS_SHARED);
+              if (status == 0)
+                status = pthread_mutexattr_setrobust(&attr,
+                                                     PTHREAD_MUTEX_ROBUST);
+
+              c[seg].process_lock
+                = carve_aligned(&shared_memory, sizeof(pthread_mutex_t));
+              if (status == 0)
+                status = pthread_mutex_init(c[seg].process_lock, &attr);
+
+              pthread_mutexattr_destroy(&attr);
+            }
+
+          if (status)
+            return svn_error_wrap_apr(status, _("Can't create cache mutex"));
+
+          thread_safe = FALSE;
+          allow_blocking_writes = TRUE;
+        }
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
       /* A lock for intra-process synchronization to the cache, or NULL if
        * the cache's creator doesn't feel the cache needs to be
@@ -1819,18 +2136,43 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
+                                  apr_size_t total_size,
+                                  apr_size_t directory_size,
+                                  apr_size_t segment_count,
+                                  svn_boolean_t thread_safe,
+                                  svn_boolean_t allow_blocking_writes,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count,
+                                                thread_safe,
+                                                allow_blocking_writes,
+                                                FALSE, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         apr_pool_t *result_pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count,
+                                                FALSE, TRUE, TRUE,
+                                                result_pool));
+}
+
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache)
 {
   apr_size_t seg;
   apr_size_t segment_count = cache->segment_count;
 
-  /* Length of the group_initialized array in bytes.
-     See also svn_cache__membuffer_cache_create(). */
-  apr_size_t group_init_size
-    = 1 + (cache->group_count + cache->spare_group_count)
-            / (8 * GROUP_INIT_GRANULARITY);
-
   /* Clear segment by segment.  This implies that other thread may read
      and write to other segments after we cleared them and before the
      last segment is done.
@@ -1843,31 +2185,13 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
     {
       /* Unconditionally acquire the write lock. */
       SVN_ERR(force_write_lock_cache(&cache[seg]));
+      begin_modification(&cache[seg]);
 
-      /* Mark all groups as "not initialized", which implies "empty". */
-      cache[seg].first_spare_group = NO_INDEX;
-      cache[seg].max_spare_used = 0;
-
-      memset(cache[seg].group_initialized, 0, group_init_size);
-
-      /* Unlink L1 contents. */
-      cache[seg].l1.first = NO_INDEX;
-      cache[seg].l1.last = NO_INDEX;
-      cache[seg].l1.next = NO_INDEX;
-      cache[seg].l1.current_data = cache[seg].l1.start_offset;
-
-      /* Unlink L2 contents. */
-      cache[seg].l2.first = NO_INDEX;
-      cache[seg].l2.last = NO_INDEX;
-      cache[seg].l2.next = NO_INDEX;
-      cache[seg].l2.current_data = cache[seg].l2.start_offset;
-
-      /* Reset content counters. */
-      cache[seg].data_used = 0;
-      cache[seg].used_entries = 0;
+      reset_segment(&cache[seg]);
 
       /* Segment may be used again. */
-      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+      SVN_ERR(unlock_cache(&cache[seg],
+                           end_modification(&cache[seg], SVN_NO_ERROR)));
     }
 
   /* done here */
@@ -2167,6 +2491,128 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+/* Lock-free variant of membuffer_cache_get_internal.  Look for the cache
+ * entry in group GROUP_INDEX of CACHE, identified by the hash value
+ * TO_FIND.  If no item has been stored for KEY, *BUFFER will be NULL.
+ * Otherwise, return a copy of the serialized data in *BUFFER and return
+ * its size in *ITEM_SIZE.  Allocations will be done in POOL.
+ *
+ * The caller must not hold any lock on CACHE.  If a concurrent
+ * modification prevented us from getting a consistent result, return
+ * FALSE and leave *BUFFER and *ITEM_SIZE untouched.  The caller should
+ * then repeat the lookup with the read lock held.  Return TRUE upon
+ * success.
+ */
+static svn_boolean_t
+membuffer_cache_get_lock_free(svn_membuffer_t *cache,
+                              apr_uint32_t group_index,
+                              entry_key_t to_find,
+                              char **buffer,
+                              apr_size_t *item_size,
+                              apr_pool_t *result_pool)
+{
+#if USE_OPTIMISTIC_READS
+  apr_uint32_t sequence;
+  apr_uint32_t chain_length;
+  apr_uint64_t data_size = cache->l1.size + cache->l2.size;
+  apr_uint32_t total_groups = cache->group_count + cache->spare_group_count;
+  entry_t *entry = NULL;
+  apr_uint64_t offset = 0;
+  apr_uint32_t size = 0;
+  char *copy = NULL;
+
+  /* Without a lock, there is no contention that we could avoid. */
+  if (cache->lock == NULL && cache->process_lock == NULL)
+    return FALSE;
+
+  /* Don't even try while a writer is active. */
+  sequence = __atomic_load_n(&cache->write_sequence, __ATOMIC_ACQUIRE);
+  if (sequence & 1)
+    {
+      svn_atomic_inc(&cache->lock_free_retries);
+      return FALSE;
+    }
+
+  /* Same as find_entry() but we must not trust any of the directory data
+   * as it may change under our feet.  Hence, all indexes and sizes get
+   * range-checked before we use them. */
+  if (is_group_initialized(cache, group_index))
+    {
+      entry_group_t *group = &cache->directory[group_index];
+      for (chain_length = 0;
+           chain_length <= MAX_GROUP_CHAIN_LENGTH;
+           ++chain_length)
+        {
+          apr_uint32_t i;
+          apr_uint32_t used = group->header.used;
+          apr_uint32_t next = group->header.next;
+
+          for (i = 0; i < MIN(used, GROUP_SIZE); ++i)
+            if (   to_find[0] == group->entries[i].key[0]
+                && to_find[1] == group->entries[i].key[1])
+              {
+                entry = &group->entries[i];
+                break;
+              }
+
+          if (entry || next >= total_groups)
+            break;
+
+          group = &cache->directory[next];
+        }
+    }
+
+  if (entry)
+    {
+      offset = entry->offset;
+      size = entry->size;
+
+      /* Only copy data that lies within our buffer. */
+      if (   offset > data_size
+          || ALIGN_VALUE((apr_uint64_t)size) > data_size - offset)
+        {
+          svn_atomic_inc(&cache->lock_free_retries);
+          return FALSE;
+        }
+
+      copy = ALIGN_POINTER(apr_palloc(result_pool,
+                                      ALIGN_VALUE(size) + ITEM_ALIGNMENT-1));
+      memcpy(copy, (const char*)cache->data + offset, ALIGN_VALUE(size));
+    }
+
+  /* All of the above reads must be complete before we re-check the
+   * sequence number. */
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&cache->write_sequence, __ATOMIC_RELAXED) != sequence)
+    {
+      svn_atomic_inc(&cache->lock_free_retries);
+      return FALSE;
+    }
+
+  /* We got a consistent snapshot.  Other readers may be here as well,
+   * so all counter updates must be atomic. */
+  svn_atomic_inc(&cache->lock_free_reads);
+  if (entry)
+    {
+      /* ENTRY may have been re-used in the meantime.  Then, we will simply
+       * count the hit for the wrong item, which is harmless. */
+      svn_atomic_inc(&entry->hit_count);
+      svn_atomic_inc(&cache->lock_free_hits);
+      *buffer = copy;
+      *item_size = size;
+    }
+  else
+    {
+      *buffer = NULL;
+      *item_size = 0;
+    }
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
 /* Look for the *ITEM identified by KEY. If no item has been stored
  * for KEY, *ITEM will be NULL. Otherwise, the DESERIALIZER is called
  * re-construct the proper object from the serialized data.
@@ -2187,14 +2633,16 @@ membuffer_cache_get(svn_membuffer_t *cache,
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, key);
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_get_internal(cache,
-                                              group_index,
-                                              key,
-                                              &buffer,
-                                              &size,
-                                              DEBUG_CACHE_MEMBUFFER_TAG
-                                              result_pool));
+  if (!membuffer_cache_get_lock_free(cache, group_index, key, &buffer, &size,
+                                     result_pool))
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_get_internal(cache,
+                                                group_index,
+                                                key,
+                                                &buffer,
+                                                &size,
+                                                DEBUG_CACHE_MEMBUFFER_TAG
+                                                result_pool));
 
   /* re-construct the original data object from its serialized form.
    */
@@ -2907,6 +3355,9 @@ svn_membuffer_get_segment_info(svn_membuffer_t *segment,
   info->used_entries += segment->used_entries;
   info->total_entries += segment->group_count * GROUP_SIZE;
 
+  info->lock_free_gets += segment->lock_free_reads;
+  info->lock_free_retries += segment->lock_free_retries;
+
   if (include_histogram)
     for (i = 0; i < segment->group_count; ++i)
       if (is_group_initialized(segment, i))
@@ -3189,9 +3640,9 @@ static svn_error_t *
 svn_membuffer_get_global_segment_info(svn_membuffer_t *segment,
                                       svn_cache__info_t *info)
 {
-  info->gets += segment->total_reads;
+  info->gets += segment->total_reads + segment->lock_free_reads;
   info->sets += segment->total_writes;
-  info->hits += segment->total_hits;
+  info->hits += segment->total_hits + segment->lock_free_hits;
 
   WITH_READ_LOCK(segment,
                   svn_membuffer_get_segment_info(segment, info, TRUE));
@@ -258,6 +258,7 @@ svn_cache__format_info(const svn_cache__info_t *info,
                  / (double)(info->total_entries ? info->total_entries : 1);
 
   const char *histogram = "";
+  const char *lock_free = "";
   if (!access_only)
     {
       svn_stringbuf_t *text = svn_stringbuf_create_empty(result_pool);
@@ -275,6 +276,13 @@ svn_cache__format_info(const svn_cache__info_t *info,
                                        text->data, info->histogram[i], i);
 
       histogram = text->data;
+
+      if (info->lock_free_gets || info->lock_free_retries)
+        lock_free = apr_psprintf(result_pool,
+                                 "lock-free: %" APR_UINT64_T_FMT " gets"
+                                 ", %" APR_UINT64_T_FMT " retries\n",
+                                 info->lock_free_gets,
+                                 info->lock_free_retries);
     }
 
   return access_only
@@ -296,6 +304,7 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             "sets    : %" APR_UINT64_T_FMT
                             " (%5.2f%% of misses)\n"
                             "failures: %" APR_UINT64_T_FMT "\n"
+                            "%s"
                             "used    : %" APR_UINT64_T_FMT " MB (%5.2f%%)"
                             " of %" APR_UINT64_T_FMT " MB data cache"
                             " / %" APR_UINT64_T_FMT " MB total cache memory\n"
@@ -308,6 +317,7 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             info->hits, hit_rate,
                             info->sets, write_rate,
                             info->failures,
+                            lock_free,
 
                             info->used_size / _1MB, data_usage_rate,
                             info->data_size / _1MB,
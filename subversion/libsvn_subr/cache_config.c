@@ -28,6 +28,7 @@
 
 #include "svn_pools.h"
 #include "svn_sorts.h"
+#include "svn_private_config.h"
 
 /* The cache settings as a process-wide singleton.
  */
@@ -64,6 +65,19 @@ static svn_cache_config_t cache_settings =
 #endif
 };
 
+/* The process-global (singleton) membuffer cache and its initialization
+ * state as used by svn_atomic__init_once.
+ */
+static svn_membuffer_t *global_cache = NULL;
+static volatile svn_atomic_t global_cache_initialized = 0;
+
+/* If set, initialize_cache() shall put the cache into shared memory. */
+static svn_boolean_t share_global_cache = FALSE;
+
+/* Set to TRUE by initialize_cache() if it put the cache into shared memory.
+ */
+static svn_boolean_t global_cache_is_shared = FALSE;
+
 /* Get the current FSFS cache configuration. */
 const svn_cache_config_t *
 svn_cache_config_get(void)
@@ -120,14 +134,22 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
         return SVN_NO_ERROR;
       apr_allocator_owner_set(allocator, pool);
 
-      err = svn_cache__membuffer_cache_create(
-          &cache,
-          (apr_size_t)cache_size,
-          (apr_size_t)(cache_size / 5),
-          0,
-          ! svn_cache_config_get()->single_threaded,
-          FALSE,
-          pool);
+      if (share_global_cache)
+        err = svn_cache__membuffer_cache_create_shared(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            pool);
+      else
+        err = svn_cache__membuffer_cache_create(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            ! svn_cache_config_get()->single_threaded,
+            FALSE,
+            pool);
 
       /* Some error occurred. Most likely it's an OOM error but we don't
        * really care. Simply release all cache memory and disable caching
@@ -145,6 +167,7 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
 
       /* done */
       *cache_p = cache;
+      global_cache_is_shared = share_global_cache;
     }
 
   return SVN_NO_ERROR;
@@ -158,11 +181,9 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
 svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void)
 {
-  static svn_membuffer_t *cache = NULL;
-  static svn_atomic_t initialized = 0;
-
-  svn_error_t *err
-    = svn_atomic__init_once(&initialized, initialize_cache, &cache, NULL);
+  svn_error_t *err = svn_atomic__init_once(&global_cache_initialized,
+                                           initialize_cache,
+                                           &global_cache, NULL);
   if (err)
     {
       /* no caches today ... */
@@ -170,7 +191,22 @@ svn_cache__get_global_membuffer_cache(void)
       return NULL;
     }
 
-  return cache;
+  return global_cache;
+}
+
+svn_error_t *
+svn_cache__share_global_membuffer_cache(void)
+{
+  share_global_cache = TRUE;
+  SVN_ERR(svn_atomic__init_once(&global_cache_initialized, initialize_cache,
+                                &global_cache, NULL));
+
+  if (global_cache && !global_cache_is_shared)
+    return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                            _("The in-memory cache is already in use "
+                              "and cannot be shared anymore"));
+
+  return SVN_NO_ERROR;
 }
 
 void
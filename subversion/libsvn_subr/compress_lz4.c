@@ -0,0 +1,411 @@
+/*
+ * compress_lz4.c:  LZ4 data compression routines
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#include <string.h>
+#include <assert.h>
+
+#include "private/svn_subr_private.h"
+
+#include "svn_private_config.h"
+
+/* This is a compact implementation of the LZ4 block format as described
+ * in https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md .
+ * We only need the raw block format because svndiff windows are bounded
+ * in size and carry their own length information.  Being fully
+ * compatible with the reference implementation, the data may also be
+ * decoded by any other LZ4 block decoder.
+ *
+ * LZ4 trades compression ratio for speed:  Compared to zlib, it is an
+ * order of magnitude faster to compress and to decompress.
+ */
+
+/* Size of the hash table used to find matches, as a power of 2. */
+#define LZ4_HASH_LOG 12
+
+/* Every match has at least this length. */
+#define LZ4_MIN_MATCH 4
+
+/* The last sequence of a block consists of at least this many literals. */
+#define LZ4_LAST_LITERALS 5
+
+/* No match may start within this many bytes from the end of a block. */
+#define LZ4_MF_LIMIT 12
+
+/* Match offsets are stored as 16 bit unsigned integers. */
+#define LZ4_MAX_OFFSET 0xffff
+
+/* Length nibble values of 15 indicate that extension bytes follow. */
+#define LZ4_RUN_MASK 15
+
+/* Return the 4 bytes at P as an unsigned integer. */
+static APR_INLINE apr_uint32_t
+read_u32(const unsigned char *p)
+{
+  apr_uint32_t value;
+  memcpy(&value, p, sizeof(value));
+
+  return value;
+}
+
+/* Map the 4 byte SEQUENCE to a slot in the match finder hash table. */
+static APR_INLINE apr_uint32_t
+hash_sequence(apr_uint32_t sequence)
+{
+  return (sequence * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+/* Write the extension bytes for LENGTH, a literal or match length from
+ * which the value stored in the token nibble has already been subtracted,
+ * to *OP and return the position behind them. */
+static APR_INLINE unsigned char *
+write_length(unsigned char *op, apr_size_t length)
+{
+  while (length >= 255)
+    {
+      *op++ = 255;
+      length -= 255;
+    }
+  *op++ = (unsigned char)length;
+
+  return op;
+}
+
+/* Return the maximum number of bytes that lz4_compress_block() may
+ * produce for an input of LEN bytes. */
+static apr_size_t
+lz4_compress_bound(apr_size_t len)
+{
+  return len + len / 255 + 16;
+}
+
+/* Compress the LEN bytes at SRC into the LZ4 block format and write the
+ * result to DST, which must provide lz4_compress_bound(LEN) bytes.
+ * Return the number of bytes written. */
+static apr_size_t
+lz4_compress_block(unsigned char *dst,
+                   const unsigned char *src,
+                   apr_size_t len)
+{
+  apr_uint32_t table[1 << LZ4_HASH_LOG];
+  const unsigned char *ip = src;
+  const unsigned char *anchor = src;
+  const unsigned char *end = src + len;
+  unsigned char *op = dst;
+  apr_size_t literals;
+
+  /* Very short blocks consist of a single literal run. */
+  if (len > LZ4_MF_LIMIT)
+    {
+      const unsigned char *mf_limit = end - LZ4_MF_LIMIT;
+      const unsigned char *match_limit = end - LZ4_LAST_LITERALS;
+
+      memset(table, 0, sizeof(table));
+      while (ip < mf_limit)
+        {
+          apr_uint32_t sequence = read_u32(ip);
+          apr_uint32_t slot = hash_sequence(sequence);
+          const unsigned char *ref = src + table[slot];
+          const unsigned char *match_end;
+          unsigned char *token;
+          apr_size_t match_len;
+          apr_size_t offset;
+
+          table[slot] = (apr_uint32_t)(ip - src);
+          if (   ref >= ip
+              || ip - ref > LZ4_MAX_OFFSET
+              || read_u32(ref) != sequence)
+            {
+              /* Skip faster through incompressible data. */
+              ip += 1 + ((ip - anchor) >> 6);
+              continue;
+            }
+
+          /* Extend the match backwards into the pending literals ... */
+          while (ip > anchor && ref > src && ip[-1] == ref[-1])
+            {
+              --ip;
+              --ref;
+            }
+
+          /* ... and forward as far as the block format permits. */
+          match_end = ip + LZ4_MIN_MATCH;
+          ref += LZ4_MIN_MATCH;
+          while (match_end < match_limit && *match_end == *ref)
+            {
+              ++match_end;
+              ++ref;
+            }
+
+          /* Emit the sequence: token, literals, offset, match length. */
+          literals = ip - anchor;
+          match_len = match_end - ip - LZ4_MIN_MATCH;
+          offset = match_end - ref;
+
+          token = op++;
+          if (literals >= LZ4_RUN_MASK)
+            {
+              *token = LZ4_RUN_MASK << 4;
+              op = write_length(op, literals - LZ4_RUN_MASK);
+            }
+          else
+            {
+              *token = (unsigned char)(literals << 4);
+            }
+
+          memcpy(op, anchor, literals);
+          op += literals;
+
+          *op++ = (unsigned char)(offset & 0xff);
+          *op++ = (unsigned char)(offset >> 8);
+
+          if (match_len >= LZ4_RUN_MASK)
+            {
+              *token |= LZ4_RUN_MASK;
+              op = write_length(op, match_len - LZ4_RUN_MASK);
+            }
+          else
+            {
+              *token |= (unsigned char)match_len;
+            }
+
+          ip = match_end;
+          anchor = ip;
+
+          /* Make the position just before the next search visible to the
+           * match finder as well.  This improves the compression ratio
+           * for repetitive data at very little cost. */
+          if (ip < mf_limit)
+            table[hash_sequence(read_u32(ip - 2))]
+              = (apr_uint32_t)(ip - 2 - src);
+        }
+    }
+
+  /* The remainder of the input becomes the final literal run. */
+  literals = end - anchor;
+  if (literals >= LZ4_RUN_MASK)
+    {
+      *op++ = LZ4_RUN_MASK << 4;
+      op = write_length(op, literals - LZ4_RUN_MASK);
+    }
+  else
+    {
+      *op++ = (unsigned char)(literals << 4);
+    }
+
+  memcpy(op, anchor, literals);
+  op += literals;
+
+  return op - dst;
+}
+
+/* Read the extension bytes of a literal or match length from *IP, not
+ * reading beyond END, and add them to *LENGTH.  Return the position
+ * behind the extension bytes or NULL if the data is corrupt. */
+static APR_INLINE const unsigned char *
+read_length(apr_size_t *length,
+            const unsigned char *ip,
+            const unsigned char *end)
+{
+  unsigned char value;
+  do
+    {
+      if (ip >= end)
+        return NULL;
+
+      value = *ip++;
+      *length += value;
+    }
+  while (value == 255);
+
+  return ip;
+}
+
+/* Decompress the LEN bytes of LZ4 block data at SRC into DST, which has
+ * a capacity of CAPACITY bytes.  Return the number of bytes written to
+ * DST in *DST_LEN.  Return FALSE if the input is corrupt or would
+ * decompress to more than CAPACITY bytes. */
+static svn_boolean_t
+lz4_decompress_block(apr_size_t *dst_len,
+                     unsigned char *dst,
+                     apr_size_t capacity,
+                     const unsigned char *src,
+                     apr_size_t len)
+{
+  const unsigned char *ip = src;
+  const unsigned char *end = src + len;
+  unsigned char *op = dst;
+  unsigned char *op_end = dst + capacity;
+
+  while (ip < end)
+    {
+      unsigned token = *ip++;
+      apr_size_t literals = token >> 4;
+      apr_size_t match_len = token & LZ4_RUN_MASK;
+      apr_size_t offset;
+      const unsigned char *ref;
+
+      if (literals == LZ4_RUN_MASK)
+        {
+          ip = read_length(&literals, ip, end);
+          if (ip == NULL)
+            return FALSE;
+        }
+
+      if (literals > (apr_size_t)(end - ip)
+          || literals > (apr_size_t)(op_end - op))
+        return FALSE;
+
+      memcpy(op, ip, literals);
+      op += literals;
+      ip += literals;
+
+      /* The last sequence consists of literals only. */
+      if (ip == end)
+        break;
+
+      if (end - ip < 2)
+        return FALSE;
+
+      offset = ip[0] | ((apr_size_t)ip[1] << 8);
+      ip += 2;
+      if (offset == 0 || offset > (apr_size_t)(op - dst))
+        return FALSE;
+
+      if (match_len == LZ4_RUN_MASK)
+        {
+          ip = read_length(&match_len, ip, end);
+          if (ip == NULL)
+            return FALSE;
+        }
+
+      match_len += LZ4_MIN_MATCH;
+      if (match_len > (apr_size_t)(op_end - op))
+        return FALSE;
+
+      /* Matches may overlap with the data they produce. */
+      ref = op - offset;
+      if (offset >= match_len)
+        {
+          memcpy(op, ref, match_len);
+          op += match_len;
+        }
+      else
+        {
+          while (match_len--)
+            *op++ = *ref++;
+        }
+    }
+
+  *dst_len = op - dst;
+  return TRUE;
+}
+
+/* Data shorter than this will not be compressed because the savings
+ * won't outweigh the overhead of the compressed data header. */
+#define MIN_COMPRESS_SIZE 32
+
+svn_error_t *
+svn__compress_lz4(svn_stringbuf_t *in,
+                  svn_stringbuf_t *out)
+{
+  apr_size_t hdrlen;
+  unsigned char buf[SVN__MAX_ENCODED_UINT_LEN], *p;
+
+  /* First thing in the output is the original length. */
+  svn_stringbuf_setempty(out);
+  p = svn__encode_uint(buf, (apr_uint64_t)in->len);
+  svn_stringbuf_appendbytes(out, (const char *)buf, p - buf);
+  hdrlen = out->len;
+
+  if (in->len >= MIN_COMPRESS_SIZE)
+    {
+      apr_size_t compressed_len;
+
+      svn_stringbuf_ensure(out, hdrlen + lz4_compress_bound(in->len));
+      compressed_len = lz4_compress_block((unsigned char *)out->data + hdrlen,
+                                          (const unsigned char *)in->data,
+                                          in->len);
+
+      /* Use the compressed data only if it actually saves space.
+       * Otherwise, readers could not tell it from uncompressed data. */
+      if (compressed_len < in->len)
+        {
+          out->len = hdrlen + compressed_len;
+          out->data[out->len] = 0;
+
+          return SVN_NO_ERROR;
+        }
+    }
+
+  /* Store the data uncompressed. */
+  svn_stringbuf_appendbytes(out, in->data, in->len);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn__decompress_lz4(svn_stringbuf_t *in,
+                    svn_stringbuf_t *out,
+                    apr_size_t limit)
+{
+  apr_size_t len;
+  apr_size_t decompressed_len;
+  apr_uint64_t size;
+  const unsigned char *data = (const unsigned char *)in->data;
+  const unsigned char *end = data + in->len;
+
+  /* First thing in the string is the original length.  */
+  data = svn__decode_uint(&size, data, end);
+  len = (apr_size_t)size;
+  if (data == NULL || len != size)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                            _("Decompression of LZ4 compressed data "
+                              "failed: no size"));
+  if (len > limit)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                            _("Decompression of LZ4 compressed data "
+                              "failed: size too large"));
+
+  svn_stringbuf_ensure(out, len);
+
+  /* If the remaining data has the original length, it is uncompressed. */
+  if ((apr_size_t)(end - data) == len)
+    {
+      memcpy(out->data, data, len);
+    }
+  else if (!lz4_decompress_block(&decompressed_len,
+                                 (unsigned char *)out->data, len,
+                                 data, end - data)
+           || decompressed_len != len)
+    {
+      return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                              _("Decompression of LZ4 compressed data "
+                                "failed: corrupt data"));
+    }
+
+  out->data[len] = 0;
+  out->len = len;
+
+  return SVN_NO_ERROR;
+}
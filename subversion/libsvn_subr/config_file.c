@@ -1343,6 +1343,28 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### returning an error.  The default is 10000, i.e. 10 seconds."    NL
         "### Longer values may be useful when exclusive locking is enabled." NL
         "# busy-timeout = 10000"                                             NL
+        "### Set shared-pristine-store to a directory to share the pristine" NL
+        "### copies of files between all working copies using this setting." NL
+        "### Texts found there are not downloaded again over http(s):// if"  NL
+        "### the server provides their checksums, and working copies on the" NL
+        "### same file system link to them instead of storing a copy."       NL
+        "### All users of the store need write access to that directory."    NL
+        "### 'svn cleanup' removes the texts that no working copy has used"  NL
+        "### for a day."                                                     NL
+        "# shared-pristine-store = /var/cache/svn-pristines"                 NL
+        "### Set delta-threads to the number of threads used to compute the"NL
+        "### deltas of large modified files during commit.  Only files"      NL
+        "### larger than 100 kBytes benefit from more than one thread."      NL
+        "### The default is 1."                                              NL
+        "# delta-threads = 1"                                                NL
+        "### Set install-threads to the number of threads used to write the" NL
+        "### files fetched by checkout, update and switch into the working"  NL
+        "### copy.  The default is 1."                                       NL
+        "# install-threads = 1"                                              NL
+        "### Set status-threads to the number of threads used to read the"   NL
+        "### directories of the working copy during status and commit.  This"NL
+        "### helps mostly on network file systems.  The default is 1."       NL
+        "# status-threads = 1"                                               NL
         ;
 
       err = svn_io_file_open(&f, path,
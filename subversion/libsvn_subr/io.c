@@ -759,6 +759,33 @@ svn_io_copy_link(const char *src,
 #endif
 }
 
+
+svn_error_t *
+svn_io__file_link(const char *from_path,
+                  const char *to_path,
+                  apr_pool_t *scratch_pool)
+{
+#if APR_VERSION_AT_LEAST(1, 4, 0)
+  const char *from_path_apr, *to_path_apr;
+  apr_status_t status;
+
+  SVN_ERR(cstring_from_utf8(&from_path_apr, from_path, scratch_pool));
+  SVN_ERR(cstring_from_utf8(&to_path_apr, to_path, scratch_pool));
+
+  status = apr_file_link(from_path_apr, to_path_apr);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create hard link '%s' to '%s'"),
+                              svn_dirent_local_style(to_path, scratch_pool),
+                              svn_dirent_local_style(from_path, scratch_pool));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Hard links are not supported with this "
+                            "version of APR"));
+#endif
+}
+
 /* Temporary directory name cache for svn_io_temp_dir() */
 static volatile svn_atomic_t temp_dir_init_state = 0;
 static const char *temp_dir;
@@ -35,6 +35,10 @@
 #include "private/svn_dep_compat.h"
 #include "private/svn_string_private.h"
 
+#if SVN__HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "svn_private_config.h"
 
 
@@ -1413,6 +1417,22 @@ svn_cstring__match_length(const char *a,
 {
   apr_size_t pos = 0;
 
+#if SVN__HAVE_SSE2
+
+  /* Compare 16 bytes at once.  SSE2 has no alignment requirements for
+   * the loads used here.  The remainder of the mismatching chunk will
+   * be handled by the loops below.
+   */
+  for (; pos + sizeof(__m128i) <= max_len; pos += sizeof(__m128i))
+    {
+      __m128i chunk_a = _mm_loadu_si128((const __m128i *)(a + pos));
+      __m128i chunk_b = _mm_loadu_si128((const __m128i *)(b + pos));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_a, chunk_b)) != 0xffff)
+        break;
+    }
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
@@ -1441,6 +1461,21 @@ svn_cstring__reverse_match_length(const char *a,
 {
   apr_size_t pos = 0;
 
+#if SVN__HAVE_SSE2
+
+  /* Same as in svn_cstring__match_length but going backwards. */
+  for (pos = sizeof(__m128i); pos <= max_len; pos += sizeof(__m128i))
+    {
+      __m128i chunk_a = _mm_loadu_si128((const __m128i *)(a - pos));
+      __m128i chunk_b = _mm_loadu_si128((const __m128i *)(b - pos));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_a, chunk_b)) != 0xffff)
+        break;
+    }
+
+  pos -= sizeof(__m128i);
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
@@ -1449,7 +1484,7 @@ svn_cstring__reverse_match_length(const char *a,
    * because A and B will probably have different alignment. So, skipping
    * the first few chars until alignment is reached is not an option.
    */
-  for (pos = sizeof(apr_size_t); pos <= max_len; pos += sizeof(apr_size_t))
+  for (pos += sizeof(apr_size_t); pos <= max_len; pos += sizeof(apr_size_t))
     if (*(const apr_size_t*)(a - pos) != *(const apr_size_t*)(b - pos))
       break;
 
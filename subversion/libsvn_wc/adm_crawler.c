@@ -39,6 +39,7 @@
 #include "svn_dirent_uri.h"
 #include "svn_path.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_wc_private.h"
 
 #include "wc.h"
@@ -1105,11 +1106,13 @@ svn_wc__internal_transmit_text_deltas(const char **tempfile,
   }
 
   /* Run diff processing, throwing windows at the handler. */
-  err = svn_txdelta_run(base_stream, local_stream,
-                        handler, wh_baton,
-                        svn_checksum_md5, &local_md5_checksum,
-                        NULL, NULL,
-                        scratch_pool, scratch_pool);
+  err = svn_txdelta__run(base_stream, local_stream,
+                         handler, wh_baton,
+                         svn_checksum_md5, &local_md5_checksum,
+                         NULL, NULL,
+                         svn_wc__db_get_thread_count(
+                           db, SVN_CONFIG_OPTION_DELTA_THREADS),
+                         scratch_pool, scratch_pool);
 
   /* Close the two streams to force writing the digest */
   err = svn_error_compose_create(err, svn_stream_close(base_stream));
@@ -0,0 +1,977 @@
+/*
+ * change_journal.c :  reuse directory listings of unchanged directories
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* All data lives in the WATCH_DIR subdirectory of the wcroot's
+ * administrative area:
+ *
+ *   LOCK_FILE     Locked exclusively for as long as the watcher runs.
+ *
+ *   JOURNAL_FILE  Appended to by the watcher only.  The first line is
+ *                 "E <epoch>", identifying this instance of the journal.
+ *                 Each following line is one of
+ *
+ *                   "D <relpath>"  The entries of directory RELPATH, or
+ *                                  their sizes or timestamps, changed.
+ *                   "O"            Changes may have been missed.  Nothing
+ *                                  recorded before this line can be
+ *                                  trusted.
+ *                   "S <token>"    All changes made before TOKEN got
+ *                                  written to SYNC_FILE are reported in
+ *                                  the lines before this one.
+ *
+ *   SYNC_FILE     Written by readers to request an "S" line.
+ *
+ *   CACHE_FILE    Written by the status walker.  The first line is
+ *                 "E <epoch> <offset>".  All listings stored in this file
+ *                 were read after the journal of that EPOCH had reached
+ *                 OFFSET.  Each listing starts with a line "@ <relpath>",
+ *                 followed by one line per directory entry of the form
+ *                 "<kind><special> <size> <mtime> <name>".
+ *
+ * A listing remains valid for as long as the journal it refers to does
+ * not report its directory as changed after its OFFSET.
+ */
+
+#include <string.h>
+
+#include <apr_pools.h>
+#include <apr_strings.h>
+
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
+#include "svn_wc.h"
+
+#include "wc.h"
+#include "adm_files.h"
+#include "change_journal.h"
+
+#include "svn_private_config.h"
+#include "private/svn_wc_private.h"
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+#define WATCH_DIR "watch"
+#define LOCK_FILE "lock"
+#define JOURNAL_FILE "journal"
+#define SYNC_FILE "sync"
+#define CACHE_FILE "cache"
+
+/* How long a reader waits for the watcher to acknowledge its sync
+   request before it gives up on the journal. */
+#define SYNC_TIMEOUT apr_time_from_msec(500)
+
+/* The watcher starts a new journal once the current one exceeds this
+   size.  Readers then have to read all directories once more. */
+#define JOURNAL_MAX_SIZE (1024 * 1024)
+
+struct svn_wc__journal_t
+{
+  /* The wcroot whose changes get recorded. */
+  const char *wcroot_abspath;
+
+  /* Where to store the listings. */
+  const char *cache_abspath;
+
+  /* The journal instance and the position in it that all listings
+     read during this status run are valid for. */
+  const char *epoch;
+  apr_size_t offset;
+
+  /* Valid listings from CACHE_FILE.
+     Maps const char * relpaths to svn_string_t * entry lines. */
+  apr_hash_t *cached;
+
+  /* Listings read during this status run, formatted as in CACHE_FILE,
+     and the relpaths they are for. */
+  svn_stringbuf_t *fresh;
+  apr_hash_t *fresh_dirs;
+
+  /* Whether CACHE_FILE needs to be rewritten. */
+  svn_boolean_t modified;
+
+  apr_pool_t *pool;
+};
+
+/* Set *LINE and *LEN to the line starting at *POS, excluding its newline,
+   and advance *POS to the start of the next line.  Return FALSE if there
+   is no complete line before END. */
+static svn_boolean_t
+next_line(const char **line,
+          apr_size_t *len,
+          const char **pos,
+          const char *end)
+{
+  const char *eol = memchr(*pos, '\n', end - *pos);
+  if (eol == NULL)
+    return FALSE;
+
+  *line = *pos;
+  *len = eol - *pos;
+  *pos = eol + 1;
+
+  return TRUE;
+}
+
+/* Return TRUE if a watcher holds the lock in WATCH_ABSPATH. */
+static svn_boolean_t
+watcher_running(const char *watch_abspath,
+                apr_pool_t *scratch_pool)
+{
+  apr_pool_t *lock_pool = svn_pool_create(scratch_pool);
+  svn_error_t *err;
+  svn_boolean_t running;
+
+  /* We can only get a shared lock if nobody holds the exclusive one. */
+  err = svn_io_file_lock2(svn_dirent_join(watch_abspath, LOCK_FILE,
+                                          lock_pool),
+                          FALSE, TRUE, lock_pool);
+  running = err && !APR_STATUS_IS_ENOENT(err->apr_err);
+
+  svn_error_clear(err);
+  svn_pool_destroy(lock_pool);
+
+  return running;
+}
+
+svn_error_t *
+svn_wc__journal_sync(svn_stringbuf_t **contents,
+                     apr_size_t *sync_end,
+                     const char *watch_abspath,
+                     apr_interval_time_t timeout,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  const char *journal_abspath = svn_dirent_join(watch_abspath, JOURNAL_FILE,
+                                                scratch_pool);
+  const char *token = svn_uuid_generate(scratch_pool);
+  const char *expected = apr_pstrcat(scratch_pool, "\nS ", token, "\n",
+                                     SVN_VA_NULL);
+  apr_interval_time_t delay = 1000;
+  apr_time_t deadline;
+
+  SVN_ERR(svn_io_write_atomic(svn_dirent_join(watch_abspath, SYNC_FILE,
+                                              scratch_pool),
+                              token, strlen(token), NULL, scratch_pool));
+
+  deadline = apr_time_now() + timeout;
+  while (TRUE)
+    {
+      const char *found;
+
+      SVN_ERR(svn_stringbuf_from_file2(contents, journal_abspath,
+                                       result_pool));
+
+      found = strstr((*contents)->data, expected);
+      if (found)
+        {
+          *sync_end = found - (*contents)->data + strlen(expected);
+          return SVN_NO_ERROR;
+        }
+
+      if (apr_time_now() > deadline)
+        {
+          *contents = NULL;
+          return SVN_NO_ERROR;
+        }
+
+      apr_sleep(delay);
+      delay = MIN(2 * delay, apr_time_from_msec(50));
+    }
+}
+
+/* Parse the stored listings in CONTENTS, which must remain valid for the
+   lifetime of JOURNAL, into JOURNAL->CACHED.  Set *EPOCH and *OFFSET to
+   what they refer to.  Return FALSE if CONTENTS is malformed. */
+static svn_boolean_t
+parse_cache(const char **epoch,
+            apr_size_t *offset,
+            svn_wc__journal_t *journal,
+            const svn_stringbuf_t *contents)
+{
+  const char *pos = contents->data;
+  const char *end = contents->data + contents->len;
+  const char *line;
+  const char *relpath = NULL;
+  const char *body = NULL;
+  apr_size_t len;
+  apr_int64_t val;
+  char *sep;
+
+  if (!next_line(&line, &len, &pos, end) || len < 2 || line[0] != 'E')
+    return FALSE;
+
+  sep = memchr(line + 2, ' ', len - 2);
+  if (sep == NULL)
+    return FALSE;
+
+  *epoch = apr_pstrmemdup(journal->pool, line + 2, sep - (line + 2));
+  val = apr_strtoi64(sep + 1, NULL, 10);
+  if (val < 0)
+    return FALSE;
+  *offset = (apr_size_t)val;
+
+  while (TRUE)
+    {
+      const char *start = pos;
+      svn_boolean_t more = next_line(&line, &len, &pos, end);
+
+      if (!more || line[0] == '@')
+        {
+          /* Finish the previous listing. */
+          if (relpath)
+            svn_hash_sets(journal->cached, relpath,
+                          svn_string_ncreate(body, start - body,
+                                             journal->pool));
+          if (!more)
+            break;
+
+          relpath = apr_pstrmemdup(journal->pool, line + 2,
+                                   len > 2 ? len - 2 : 0);
+          body = pos;
+        }
+      else if (!relpath)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+svn_error_t *
+svn_wc__journal_create(svn_wc__journal_t **journal_p,
+                       const char *wcroot_abspath,
+                       const char *watch_abspath,
+                       const svn_stringbuf_t *contents,
+                       apr_size_t sync_end,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  svn_wc__journal_t *journal;
+  const char *cache_epoch = NULL;
+  apr_size_t cache_offset = 0;
+  svn_stringbuf_t *cache_contents;
+  const char *pos, *end, *line;
+  apr_size_t len;
+  svn_error_t *err;
+
+  *journal_p = NULL;
+
+  journal = apr_pcalloc(result_pool, sizeof(*journal));
+  journal->pool = result_pool;
+  journal->wcroot_abspath = apr_pstrdup(result_pool, wcroot_abspath);
+  journal->cache_abspath = svn_dirent_join(watch_abspath, CACHE_FILE,
+                                           result_pool);
+  journal->offset = sync_end;
+  journal->cached = apr_hash_make(result_pool);
+  journal->fresh = svn_stringbuf_create_empty(result_pool);
+  journal->fresh_dirs = apr_hash_make(result_pool);
+
+  pos = contents->data;
+  end = contents->data + sync_end;
+  if (!next_line(&line, &len, &pos, end) || len < 2 || line[0] != 'E')
+    return SVN_NO_ERROR;
+  journal->epoch = apr_pstrmemdup(result_pool, line + 2, len - 2);
+
+  /* Without stored listings, we simply read everything from disk. */
+  err = svn_stringbuf_from_file2(&cache_contents, journal->cache_abspath,
+                                 result_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      cache_contents = NULL;
+    }
+
+  /* Stored listings from another journal instance are useless.  So is
+     a malformed cache, which we simply replace. */
+  if (!cache_contents
+      || !parse_cache(&cache_epoch, &cache_offset, journal, cache_contents)
+      || strcmp(cache_epoch, journal->epoch) != 0
+      || cache_offset > sync_end
+      || cache_offset < (apr_size_t)(pos - contents->data))
+    {
+      apr_hash_clear(journal->cached);
+      journal->modified = TRUE;
+      *journal_p = journal;
+      return SVN_NO_ERROR;
+    }
+
+  /* Drop all listings of directories that changed since they were read. */
+  pos = contents->data + cache_offset;
+  while (next_line(&line, &len, &pos, end))
+    {
+      if (line[0] == 'O')
+        {
+          apr_hash_clear(journal->cached);
+          journal->modified = TRUE;
+        }
+      else if (line[0] == 'D' && len >= 2)
+        {
+          const char *relpath = apr_pstrmemdup(scratch_pool, line + 2,
+                                               len - 2);
+
+          if (svn_hash_gets(journal->cached, relpath))
+            {
+              svn_hash_sets(journal->cached, relpath, NULL);
+              journal->modified = TRUE;
+            }
+        }
+    }
+
+  *journal_p = journal;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__journal_open(svn_wc__journal_t **journal_p,
+                     svn_wc__db_t *db,
+                     const char *local_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  const char *wcroot_abspath;
+  const char *watch_abspath;
+  svn_stringbuf_t *contents;
+  svn_node_kind_t kind;
+  apr_size_t sync_end;
+  svn_error_t *err;
+
+  *journal_p = NULL;
+
+  SVN_ERR(svn_wc__db_get_wcroot(&wcroot_abspath, db, local_abspath,
+                                scratch_pool, scratch_pool));
+  watch_abspath = svn_wc__adm_child(wcroot_abspath, WATCH_DIR, scratch_pool);
+
+  /* Most working copies are not being watched. */
+  SVN_ERR(svn_io_check_path(watch_abspath, &kind, scratch_pool));
+  if (kind != svn_node_dir || !watcher_running(watch_abspath, scratch_pool))
+    return SVN_NO_ERROR;
+
+  /* The journal only saves work.  If we can't talk to the watcher, e.g.
+     because we may not write to this working copy, read everything from
+     disk. */
+  err = svn_wc__journal_sync(&contents, &sync_end, watch_abspath,
+                             SYNC_TIMEOUT, scratch_pool, scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  if (!contents)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(svn_wc__journal_create(journal_p, wcroot_abspath,
+                                                watch_abspath, contents,
+                                                sync_end, result_pool,
+                                                scratch_pool));
+}
+
+/* Return the relpath of DIR_ABSPATH within the wcroot of JOURNAL or NULL
+   if it is not inside that wcroot. */
+static const char *
+journal_relpath(svn_wc__journal_t *journal,
+                const char *dir_abspath)
+{
+  return svn_dirent_skip_ancestor(journal->wcroot_abspath, dir_abspath);
+}
+
+svn_error_t *
+svn_wc__journal_get_dirents(apr_hash_t **dirents,
+                            svn_wc__journal_t *journal,
+                            const char *dir_abspath,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  const char *relpath = journal_relpath(journal, dir_abspath);
+  const svn_string_t *listing;
+  const char *pos, *end, *line;
+  apr_size_t len;
+
+  *dirents = NULL;
+
+  listing = relpath ? svn_hash_gets(journal->cached, relpath) : NULL;
+  if (!listing)
+    return SVN_NO_ERROR;
+
+  *dirents = apr_hash_make(result_pool);
+  pos = listing->data;
+  end = listing->data + listing->len;
+  while (next_line(&line, &len, &pos, end))
+    {
+      svn_io_dirent2_t *dirent = svn_io_dirent2_create(result_pool);
+      const char *field;
+      char *field_end;
+
+      switch (len > 4 ? line[0] : 0)
+        {
+          case 'f': dirent->kind = svn_node_file; break;
+          case 'd': dirent->kind = svn_node_dir; break;
+          case 's': dirent->kind = svn_node_symlink; break;
+          case 'u': dirent->kind = svn_node_unknown; break;
+          default:
+            /* Corrupt listing.  Read the directory from disk. */
+            *dirents = NULL;
+            return SVN_NO_ERROR;
+        }
+      dirent->special = (line[1] == '1');
+
+      field = line + 3;
+      dirent->filesize = apr_strtoi64(field, &field_end, 10);
+      if (*field_end != ' ')
+        {
+          *dirents = NULL;
+          return SVN_NO_ERROR;
+        }
+
+      field = field_end + 1;
+      dirent->mtime = apr_strtoi64(field, &field_end, 10);
+      if (*field_end != ' ' || field_end + 1 >= line + len)
+        {
+          *dirents = NULL;
+          return SVN_NO_ERROR;
+        }
+
+      field = field_end + 1;
+      svn_hash_sets(*dirents,
+                    apr_pstrmemdup(result_pool, field, line + len - field),
+                    dirent);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__journal_put_dirents(svn_wc__journal_t *journal,
+                            const char *dir_abspath,
+                            apr_hash_t *dirents,
+                            apr_pool_t *scratch_pool)
+{
+  const char *relpath = journal_relpath(journal, dir_abspath);
+  svn_stringbuf_t *listing;
+  apr_hash_index_t *hi;
+
+  if (!relpath
+      || strchr(relpath, '\n')
+      || svn_hash_gets(journal->fresh_dirs, relpath))
+    return SVN_NO_ERROR;
+
+  listing = svn_stringbuf_createf(scratch_pool, "@ %s\n", relpath);
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+      char kind;
+
+      /* We can't store this name.  Don't remember this directory. */
+      if (strchr(name, '\n'))
+        return SVN_NO_ERROR;
+
+      switch (dirent->kind)
+        {
+          case svn_node_file: kind = 'f'; break;
+          case svn_node_dir: kind = 'd'; break;
+          case svn_node_symlink: kind = 's'; break;
+          default: kind = 'u'; break;
+        }
+
+      svn_stringbuf_appendcstr(listing,
+                               apr_psprintf(scratch_pool,
+                                            "%c%c %" SVN_FILESIZE_T_FMT
+                                            " %" APR_TIME_T_FMT " %s\n",
+                                            kind,
+                                            dirent->special ? '1' : '0',
+                                            dirent->filesize,
+                                            dirent->mtime,
+                                            name));
+    }
+
+  svn_stringbuf_appendstr(journal->fresh, listing);
+  svn_hash_sets(journal->fresh_dirs, apr_pstrdup(journal->pool, relpath),
+                "");
+  svn_hash_sets(journal->cached, relpath, NULL);
+  journal->modified = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__journal_close(svn_wc__journal_t *journal,
+                      apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *contents;
+  apr_hash_index_t *hi;
+
+  /* If we did not read any directory from disk, the listings stored
+     still cover everything we found in the cache. */
+  if (!journal->modified)
+    return SVN_NO_ERROR;
+
+  contents = svn_stringbuf_createf(scratch_pool, "E %s %" APR_SIZE_T_FMT "\n",
+                                   journal->epoch, journal->offset);
+  svn_stringbuf_appendstr(contents, journal->fresh);
+
+  for (hi = apr_hash_first(scratch_pool, journal->cached);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const svn_string_t *listing = apr_hash_this_val(hi);
+
+      svn_stringbuf_appendcstr(contents, "@ ");
+      svn_stringbuf_appendcstr(contents, apr_hash_this_key(hi));
+      svn_stringbuf_appendbyte(contents, '\n');
+      svn_stringbuf_appendbytes(contents, listing->data, listing->len);
+    }
+
+  return svn_error_trace(svn_io_write_atomic(journal->cache_abspath,
+                                             contents->data, contents->len,
+                                             NULL, scratch_pool));
+}
+
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+/* Events that change the listing of a watched directory. */
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB \
+                    | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO \
+                    | IN_DELETE_SELF | IN_MOVE_SELF \
+                    | IN_ONLYDIR | IN_DONT_FOLLOW)
+
+/* State of a running watcher. */
+typedef struct watcher_t
+{
+  const char *wcroot_abspath;
+  const char *watch_abspath;
+
+  /* Name of the administrative directories, which we don't watch. */
+  const char *adm_name;
+
+  /* The inotify instance and the watch for WATCH_ABSPATH within it. */
+  int fd;
+  int sync_wd;
+
+  /* Maps int watch descriptors to const char * relpaths.
+     Allocated in PATHS_POOL. */
+  apr_hash_t *paths;
+  apr_pool_t *paths_pool;
+
+  /* Directories already reported since the last "S" line.
+     Allocated in REPORTED_POOL. */
+  apr_hash_t *reported;
+  apr_pool_t *reported_pool;
+
+  /* The journal file, opened for appending, and its size. */
+  apr_file_t *journal;
+  apr_off_t journal_size;
+  apr_pool_t *journal_pool;
+} watcher_t;
+
+/* Replace the journal of W with a new instance whose first lines are the
+   "E" line and then FIRST_LINES.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+start_journal(watcher_t *w,
+              const char *first_lines,
+              apr_pool_t *scratch_pool)
+{
+  const char *journal_abspath = svn_dirent_join(w->watch_abspath,
+                                                JOURNAL_FILE, scratch_pool);
+  const char *contents = apr_psprintf(scratch_pool, "E %s\n%s",
+                                      svn_uuid_generate(scratch_pool),
+                                      first_lines);
+
+  if (w->journal)
+    SVN_ERR(svn_io_file_close(w->journal, scratch_pool));
+  svn_pool_clear(w->journal_pool);
+
+  SVN_ERR(svn_io_write_atomic(journal_abspath, contents, strlen(contents),
+                              NULL, scratch_pool));
+  SVN_ERR(svn_io_file_open(&w->journal, journal_abspath,
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT,
+                           w->journal_pool));
+  w->journal_size = strlen(contents);
+
+  svn_pool_clear(w->reported_pool);
+  w->reported = apr_hash_make(w->reported_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Append LINE to the journal of W. */
+static svn_error_t *
+append_line(watcher_t *w,
+            const char *line,
+            apr_pool_t *scratch_pool)
+{
+  apr_size_t len = strlen(line);
+
+  SVN_ERR(svn_io_file_write_full(w->journal, line, len, NULL, scratch_pool));
+  w->journal_size += len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Record in W that directory RELPATH changed. */
+static svn_error_t *
+mark_changed(watcher_t *w,
+             const char *relpath,
+             apr_pool_t *scratch_pool)
+{
+  /* Readers don't store listings for such paths. */
+  if (strchr(relpath, '\n') || svn_hash_gets(w->reported, relpath))
+    return SVN_NO_ERROR;
+
+  svn_hash_sets(w->reported, apr_pstrdup(w->reported_pool, relpath), "");
+  return svn_error_trace(append_line(w, apr_pstrcat(scratch_pool,
+                                                    "D ", relpath, "\n",
+                                                    SVN_VA_NULL),
+                                     scratch_pool));
+}
+
+/* Watch directory RELPATH in W and all its subdirectories except for
+   administrative areas.  If MARK is set, report all of them as changed
+   once we watch them.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+add_watches(watcher_t *w,
+            const char *relpath,
+            svn_boolean_t mark,
+            apr_pool_t *scratch_pool)
+{
+  const char *dir_abspath = svn_dirent_join(w->wcroot_abspath, relpath,
+                                            scratch_pool);
+  apr_pool_t *iterpool;
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  svn_error_t *err;
+  int *wd = apr_palloc(w->paths_pool, sizeof(*wd));
+
+  *wd = inotify_add_watch(w->fd, dir_abspath, WATCH_MASK);
+  if (*wd < 0)
+    {
+      /* The directory vanished already; its parent will report that. */
+      if (errno == ENOENT || errno == ENOTDIR)
+        return SVN_NO_ERROR;
+
+      return svn_error_wrap_apr(apr_get_os_error(), _("Can't watch '%s'"),
+                                svn_dirent_local_style(dir_abspath,
+                                                       scratch_pool));
+    }
+
+  apr_hash_set(w->paths, wd, sizeof(*wd),
+               apr_pstrdup(w->paths_pool, relpath));
+  if (mark)
+    SVN_ERR(mark_changed(w, relpath, scratch_pool));
+
+  err = svn_io_get_dirents3(&dirents, dir_abspath, TRUE,
+                            scratch_pool, scratch_pool);
+  if (err && (APR_STATUS_IS_ENOENT(err->apr_err)
+              || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+
+      if (dirent->kind != svn_node_dir || dirent->special
+          || strcmp(name, w->adm_name) == 0)
+        continue;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(add_watches(w, svn_relpath_join(relpath, name, iterpool),
+                          mark, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* (Re-)create the inotify instance of W and watch the whole working copy.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+watch_all(watcher_t *w,
+          apr_pool_t *scratch_pool)
+{
+  if (w->fd >= 0)
+    close(w->fd);
+
+  svn_pool_clear(w->paths_pool);
+  w->paths = apr_hash_make(w->paths_pool);
+
+  w->fd = inotify_init1(IN_CLOEXEC);
+  if (w->fd < 0)
+    return svn_error_wrap_apr(apr_get_os_error(),
+                              _("Can't watch the working copy"));
+
+  w->sync_wd = inotify_add_watch(w->fd, w->watch_abspath,
+                                 IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (w->sync_wd < 0)
+    return svn_error_wrap_apr(apr_get_os_error(), _("Can't watch '%s'"),
+                              svn_dirent_local_style(w->watch_abspath,
+                                                     scratch_pool));
+
+  return svn_error_trace(add_watches(w, "", FALSE, scratch_pool));
+}
+
+/* Acknowledge the sync request in W's SYNC_FILE. */
+static svn_error_t *
+acknowledge_sync(watcher_t *w,
+                 apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *token;
+  const char *line;
+  svn_error_t *err;
+
+  err = svn_stringbuf_from_file2(&token,
+                                 svn_dirent_join(w->watch_abspath, SYNC_FILE,
+                                                 scratch_pool),
+                                 scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  if (token->len == 0 || strchr(token->data, '\n'))
+    return SVN_NO_ERROR;
+
+  line = apr_pstrcat(scratch_pool, "S ", token->data, "\n", SVN_VA_NULL);
+
+  /* Everything before this point is in the journal, so this is a good
+     time to start over with a shorter one. */
+  if (w->journal_size > JOURNAL_MAX_SIZE)
+    return svn_error_trace(start_journal(w, line, scratch_pool));
+
+  SVN_ERR(append_line(w, line, scratch_pool));
+
+  /* Changes after the sync have to be reported again. */
+  svn_pool_clear(w->reported_pool);
+  w->reported = apr_hash_make(w->reported_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Record the LEN bytes of inotify events in BUF in the journal of W.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+handle_events(watcher_t *w,
+              const char *buf,
+              apr_size_t len,
+              apr_pool_t *scratch_pool)
+{
+  const char *pos = buf;
+
+  while (pos < buf + len)
+    {
+      const struct inotify_event *event = (const void *)pos;
+      const char *name = event->len ? event->name : NULL;
+      const char *relpath;
+
+      pos += sizeof(*event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW)
+        {
+          /* We lost track.  Start over and tell the readers. */
+          SVN_ERR(watch_all(w, scratch_pool));
+          return svn_error_trace(append_line(w, "O\n", scratch_pool));
+        }
+
+      if (event->wd == w->sync_wd)
+        {
+          if (name && strcmp(name, SYNC_FILE) == 0)
+            SVN_ERR(acknowledge_sync(w, scratch_pool));
+          continue;
+        }
+
+      if (event->mask & IN_IGNORED)
+        {
+          apr_hash_set(w->paths, &event->wd, sizeof(event->wd), NULL);
+          continue;
+        }
+
+      relpath = apr_hash_get(w->paths, &event->wd, sizeof(event->wd));
+      if (!relpath)
+        continue;
+
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+        {
+          if (relpath[0] == '\0')
+            return svn_error_createf(SVN_ERR_WC_PATH_NOT_FOUND, NULL,
+                                     _("'%s' has been removed"),
+                                     svn_dirent_local_style(
+                                         w->wcroot_abspath, scratch_pool));
+
+          SVN_ERR(mark_changed(w, relpath, scratch_pool));
+          continue;
+        }
+
+      if (name && strcmp(name, w->adm_name) == 0)
+        continue;
+
+      SVN_ERR(mark_changed(w, relpath, scratch_pool));
+
+      if (name && (event->mask & IN_ISDIR))
+        {
+          const char *child_relpath = svn_relpath_join(relpath, name,
+                                                       scratch_pool);
+
+          if (event->mask & (IN_MOVED_FROM | IN_MOVED_TO))
+            {
+              /* The relpaths of all watches below the moved directory
+                 are stale now.  Start over and tell the readers. */
+              SVN_ERR(watch_all(w, scratch_pool));
+              return svn_error_trace(append_line(w, "O\n", scratch_pool));
+            }
+
+          if (event->mask & IN_CREATE)
+            SVN_ERR(add_watches(w, child_relpath, TRUE, scratch_pool));
+          else if (event->mask & IN_DELETE)
+            SVN_ERR(mark_changed(w, child_relpath, scratch_pool));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* HAVE_SYS_INOTIFY_H */
+
+svn_error_t *
+svn_wc__journal_watch(svn_wc_context_t *wc_ctx,
+                      const char *local_abspath,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *scratch_pool)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+  watcher_t w = { 0 };
+  apr_pool_t *iterpool;
+  const char *wcroot_abspath;
+  char *buf;
+  apr_size_t buf_size = 64 * 1024;
+  svn_error_t *err;
+
+  SVN_ERR(svn_wc__db_get_wcroot(&wcroot_abspath, wc_ctx->db, local_abspath,
+                                scratch_pool, scratch_pool));
+
+  w.wcroot_abspath = wcroot_abspath;
+  w.watch_abspath = svn_wc__adm_child(wcroot_abspath, WATCH_DIR,
+                                      scratch_pool);
+  w.adm_name = svn_wc_get_adm_dir(scratch_pool);
+  w.fd = -1;
+  w.paths_pool = svn_pool_create(scratch_pool);
+  w.reported_pool = svn_pool_create(scratch_pool);
+  w.journal_pool = svn_pool_create(scratch_pool);
+  w.reported = apr_hash_make(w.reported_pool);
+
+  SVN_ERR(svn_io_make_dir_recursively(w.watch_abspath, scratch_pool));
+
+  /* Only one watcher per working copy.  Readers check this lock to see
+     whether the journal is being maintained. */
+  err = svn_io_file_lock2(svn_dirent_join(w.watch_abspath, LOCK_FILE,
+                                          scratch_pool),
+                          TRUE, TRUE, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      SVN_ERR(svn_io_file_create_empty(svn_dirent_join(w.watch_abspath,
+                                                       LOCK_FILE,
+                                                       scratch_pool),
+                                       scratch_pool));
+      err = svn_io_file_lock2(svn_dirent_join(w.watch_abspath, LOCK_FILE,
+                                              scratch_pool),
+                              TRUE, TRUE, scratch_pool);
+    }
+  if (err)
+    return svn_error_createf(SVN_ERR_WC_LOCKED, err,
+                             _("'%s' is already being watched"),
+                             svn_dirent_local_style(wcroot_abspath,
+                                                    scratch_pool));
+
+  /* A new journal instance invalidates all listings stored before. */
+  SVN_ERR(start_journal(&w, "", scratch_pool));
+  err = watch_all(&w, scratch_pool);
+
+  buf = apr_palloc(scratch_pool, buf_size);
+  iterpool = svn_pool_create(scratch_pool);
+  while (!err)
+    {
+      struct pollfd pfd;
+      ssize_t got;
+      int rc;
+
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        {
+          err = cancel_func(cancel_baton);
+          if (err)
+            break;
+        }
+
+      /* Wake up regularly to check for cancellation. */
+      pfd.fd = w.fd;
+      pfd.events = POLLIN;
+      rc = poll(&pfd, 1, 1000);
+      if (rc <= 0)
+        {
+          if (rc < 0 && errno != EINTR)
+            err = svn_error_wrap_apr(apr_get_os_error(),
+                                     _("Can't watch the working copy"));
+          continue;
+        }
+
+      got = read(w.fd, buf, buf_size);
+      if (got < 0)
+        {
+          if (errno != EINTR && errno != EAGAIN)
+            err = svn_error_wrap_apr(apr_get_os_error(),
+                                     _("Can't watch the working copy"));
+          continue;
+        }
+
+      err = handle_events(&w, buf, got, iterpool);
+    }
+
+  if (w.fd >= 0)
+    close(w.fd);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Watching working copies for changes is not "
+                            "supported on this platform"));
+#endif
+}
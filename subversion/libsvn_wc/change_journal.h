@@ -0,0 +1,122 @@
+/*
+ * change_journal.h :  reuse directory listings of unchanged directories
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#ifndef SVN_LIBSVN_WC_CHANGE_JOURNAL_H
+#define SVN_LIBSVN_WC_CHANGE_JOURNAL_H
+
+#include <apr_pools.h>
+#include <apr_hash.h>
+#include "svn_types.h"
+#include "svn_string.h"
+
+#include "wc_db.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/* While svn_wc__journal_watch() runs for a working copy, it records which
+   directories changed.  The status walker uses this information to reuse
+   the directory listings that it stored during earlier runs instead of
+   reading unchanged directories from disk again.  */
+typedef struct svn_wc__journal_t svn_wc__journal_t;
+
+/* Set *JOURNAL to the change journal of the working copy containing
+   LOCAL_ABSPATH in DB, allocated in RESULT_POOL.  Set *JOURNAL to NULL if
+   that working copy is not being watched, if the watcher does not respond
+   in time or if its journal can't be read.  Use SCRATCH_POOL for temporary
+   allocations.  */
+svn_error_t *
+svn_wc__journal_open(svn_wc__journal_t **journal,
+                     svn_wc__db_t *db,
+                     const char *local_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool);
+
+/* Ask the watcher whose journal is in WATCH_ABSPATH to acknowledge all
+   changes made so far and set *CONTENTS to its journal once it did so.
+   Set *SYNC_END to the length of the acknowledged part.  If the watcher
+   does not respond within TIMEOUT, set *CONTENTS to NULL.  Allocate
+   *CONTENTS in RESULT_POOL and use SCRATCH_POOL for temporary
+   allocations.
+
+   This is the first half of svn_wc__journal_open(), exposed for testing. */
+svn_error_t *
+svn_wc__journal_sync(svn_stringbuf_t **contents,
+                     apr_size_t *sync_end,
+                     const char *watch_abspath,
+                     apr_interval_time_t timeout,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool);
+
+/* Set *JOURNAL to the change journal of the working copy WCROOT_ABSPATH,
+   based on the journal CONTENTS in WATCH_ABSPATH that the watcher has
+   acknowledged up to SYNC_END, and the listings stored in WATCH_ABSPATH.
+   Set *JOURNAL to NULL if CONTENTS is malformed.  Allocate *JOURNAL in
+   RESULT_POOL and use SCRATCH_POOL for temporary allocations.
+
+   This is the second half of svn_wc__journal_open(), exposed for
+   testing. */
+svn_error_t *
+svn_wc__journal_create(svn_wc__journal_t **journal,
+                       const char *wcroot_abspath,
+                       const char *watch_abspath,
+                       const svn_stringbuf_t *contents,
+                       apr_size_t sync_end,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool);
+
+/* Set *DIRENTS to the listing of directory DIR_ABSPATH, as it would be
+   returned by svn_io_get_dirents3() with ONLY_CHECK_TYPE set to FALSE, if
+   it is known from JOURNAL and has not changed since.  Otherwise, set
+   *DIRENTS to NULL.  Allocate *DIRENTS in RESULT_POOL.  */
+svn_error_t *
+svn_wc__journal_get_dirents(apr_hash_t **dirents,
+                            svn_wc__journal_t *journal,
+                            const char *dir_abspath,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/* Remember DIRENTS, the current listing of directory DIR_ABSPATH as
+   returned by svn_io_get_dirents3() with ONLY_CHECK_TYPE set to FALSE,
+   in JOURNAL.  Use SCRATCH_POOL for temporary allocations.  */
+svn_error_t *
+svn_wc__journal_put_dirents(svn_wc__journal_t *journal,
+                            const char *dir_abspath,
+                            apr_hash_t *dirents,
+                            apr_pool_t *scratch_pool);
+
+/* Store all listings remembered in JOURNAL for use by future status runs.
+   Use SCRATCH_POOL for temporary allocations.  */
+svn_error_t *
+svn_wc__journal_close(svn_wc__journal_t *journal,
+                      apr_pool_t *scratch_pool);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_WC_CHANGE_JOURNAL_H */
@@ -29,6 +29,9 @@
 #include <apr_pools.h>
 #include <apr_file_io.h>
 #include <apr_hash.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
 
 #include "svn_pools.h"
 #include "svn_types.h"
@@ -46,6 +49,7 @@
 
 #include "wc.h"
 #include "props.h"
+#include "change_journal.h"
 
 #include "private/svn_sorts_private.h"
 #include "private/svn_wc_private.h"
@@ -75,6 +79,9 @@ typedef struct svn_wc__internal_status_t
 } svn_wc__internal_status_t;
 
 
+/* Reads directories ahead of the status walker.  See below. */
+typedef struct dir_prefetcher_t dir_prefetcher_t;
+
 /*** Baton used for walking the local status */
 struct walk_status_baton
 {
@@ -100,6 +107,14 @@ struct walk_status_baton
 
   /* Repository locks, if set. */
   apr_hash_t *repos_locks;
+
+  /* Directory listings known to be unchanged since an earlier status run,
+     or NULL. */
+  svn_wc__journal_t *journal;
+
+  /* Reads the directories we are going to visit in the background,
+     or NULL. */
+  dir_prefetcher_t *prefetcher;
 };
 
 /*** Editor batons ***/
@@ -1023,6 +1038,343 @@ send_unversioned_item(const struct walk_status_baton *wb,
   return SVN_NO_ERROR;
 }
 
+/*** Reading directories ahead ***/
+
+/* On network file systems and with cold caches, the latency of reading a
+   directory and stat()ing its entries dominates the status walk.  While
+   the walker processes one directory, worker threads read the listings
+   of the subdirectories that it will descend into next.  The results
+   are still reported in the walker's order. */
+
+#if APR_HAS_THREADS
+
+/* Maximum number of directories queued or read but not yet used by the
+   walker.  This limits the memory used for listings read ahead. */
+#define PREFETCH_MAX_DIRS 256
+
+/* A directory to read ahead. */
+typedef struct prefetch_dir_t
+{
+  const char *local_abspath;
+
+  /* Root pool containing this structure and the listing.  Only used by
+     the thread that currently owns this directory. */
+  apr_pool_t *pool;
+
+  /* What svn_io_get_dirents3() returned. */
+  apr_hash_t *dirents;
+  svn_error_t *err;
+
+  enum { prefetch_queued, prefetch_busy, prefetch_done } state;
+} prefetch_dir_t;
+
+struct dir_prefetcher_t
+{
+  /* Directories (prefetch_dir_t *) that have been queued but not picked
+     up yet.  The one to read next is the last one. */
+  apr_array_header_t *stack;
+
+  /* All directories that have been queued and not been handed to the
+     walker yet.  Maps const char * abspaths to prefetch_dir_t *. */
+  apr_hash_t *dirs;
+
+  /* Parameter to svn_io_get_dirents3(). */
+  svn_boolean_t only_check_type;
+
+  /* Start at most MAX_THREADS workers.  THREAD_COUNT of them are running
+     and listed in THREADS.  The threads get created in THREAD_POOL. */
+  int max_threads;
+  int thread_count;
+  apr_thread_t **threads;
+  apr_pool_t *thread_pool;
+
+  /* Serializes access to all of the above once workers are running. */
+  apr_thread_mutex_t *mutex;
+
+  /* Signaled whenever a directory has been queued or read. */
+  apr_thread_cond_t *changed;
+
+  /* If set, workers shall terminate. */
+  svn_boolean_t stop;
+
+  /* Allocates this structure, STACK and DIRS. */
+  apr_pool_t *pool;
+};
+
+/* Thread function for workers of the dir_prefetcher_t given as DATA.
+ * Read queued directories until the prefetcher gets stopped. */
+static void * APR_THREAD_FUNC
+prefetch_worker_thread(apr_thread_t *thread,
+                       void *data)
+{
+  dir_prefetcher_t *prefetcher = data;
+
+  apr_thread_mutex_lock(prefetcher->mutex);
+  while (!prefetcher->stop)
+    {
+      prefetch_dir_t *dir;
+
+      if (prefetcher->stack->nelts == 0)
+        {
+          apr_thread_cond_wait(prefetcher->changed, prefetcher->mutex);
+          continue;
+        }
+
+      /* DIR is ours until we mark it as "done". */
+      dir = *(prefetch_dir_t **)apr_array_pop(prefetcher->stack);
+      dir->state = prefetch_busy;
+      apr_thread_mutex_unlock(prefetcher->mutex);
+
+      dir->err = svn_io_get_dirents3(&dir->dirents, dir->local_abspath,
+                                     prefetcher->only_check_type,
+                                     dir->pool, dir->pool);
+
+      apr_thread_mutex_lock(prefetcher->mutex);
+      dir->state = prefetch_done;
+      apr_thread_cond_broadcast(prefetcher->changed);
+    }
+  apr_thread_mutex_unlock(prefetcher->mutex);
+
+  /* Don't call apr_thread_exit() here.  It would destroy the thread's
+   * pool, which is a sub-pool of PREFETCHER->THREAD_POOL. */
+  return NULL;
+}
+
+/* Start the worker threads for PREFETCHER.  If none can be started,
+ * don't try again and don't queue any directories. */
+static void
+start_prefetch_workers(dir_prefetcher_t *prefetcher)
+{
+  apr_status_t status = APR_SUCCESS;
+
+  /* The threads' pools will be used concurrently. */
+  prefetcher->thread_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+
+  /* Once the first thread runs, we must use the mutex. */
+  while (!status && prefetcher->thread_count < prefetcher->max_threads)
+    {
+      status = apr_thread_create(
+                        &prefetcher->threads[prefetcher->thread_count],
+                        NULL, prefetch_worker_thread, prefetcher,
+                        prefetcher->thread_pool);
+      if (!status)
+        ++prefetcher->thread_count;
+    }
+
+  if (prefetcher->thread_count == 0)
+    prefetcher->max_threads = 0;
+}
+
+/* Pool cleanup function for the dir_prefetcher_t given as DATA.  Stop
+ * all workers and release all listings that have not been used. */
+static apr_status_t
+cleanup_prefetcher(void *data)
+{
+  dir_prefetcher_t *prefetcher = data;
+  apr_hash_index_t *hi;
+  apr_status_t retval;
+  int i;
+
+  if (prefetcher->thread_count)
+    {
+      apr_thread_mutex_lock(prefetcher->mutex);
+      prefetcher->stop = TRUE;
+      apr_thread_cond_broadcast(prefetcher->changed);
+      apr_thread_mutex_unlock(prefetcher->mutex);
+
+      for (i = 0; i < prefetcher->thread_count; ++i)
+        apr_thread_join(&retval, prefetcher->threads[i]);
+
+      prefetcher->thread_count = 0;
+    }
+
+  if (prefetcher->thread_pool)
+    {
+      svn_pool_destroy(prefetcher->thread_pool);
+      prefetcher->thread_pool = NULL;
+    }
+
+  for (hi = apr_hash_first(NULL, prefetcher->dirs);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      prefetch_dir_t *dir = apr_hash_this_val(hi);
+
+      /* The key lives in DIR->POOL.  Remove the entry while it is valid. */
+      svn_hash_sets(prefetcher->dirs, dir->local_abspath, NULL);
+      svn_error_clear(dir->err);
+      svn_pool_destroy(dir->pool);
+    }
+  apr_array_clear(prefetcher->stack);
+
+  return APR_SUCCESS;
+}
+
+/* Return a new prefetcher that reads directories like svn_io_get_dirents3()
+ * with ONLY_CHECK_TYPE on up to MAX_THREADS threads.  It lives until POOL
+ * gets cleaned up. */
+static dir_prefetcher_t *
+create_prefetcher(svn_boolean_t only_check_type,
+                  int max_threads,
+                  apr_pool_t *pool)
+{
+  dir_prefetcher_t *prefetcher = apr_pcalloc(pool, sizeof(*prefetcher));
+
+  prefetcher->stack = apr_array_make(pool, PREFETCH_MAX_DIRS,
+                                     sizeof(prefetch_dir_t *));
+  prefetcher->dirs = apr_hash_make(pool);
+  prefetcher->only_check_type = only_check_type;
+  prefetcher->max_threads = max_threads;
+  prefetcher->threads = apr_pcalloc(pool,
+                                    max_threads * sizeof(apr_thread_t *));
+  prefetcher->pool = pool;
+
+  /* Create the synchronization objects before registering our cleanup.
+   * They will then get destroyed only after all workers have stopped.
+   * Without them, we simply don't read ahead. */
+  if (   apr_thread_mutex_create(&prefetcher->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                 pool)
+      || apr_thread_cond_create(&prefetcher->changed, pool))
+    prefetcher->max_threads = 0;
+
+  apr_pool_cleanup_register(pool, prefetcher, cleanup_prefetcher,
+                            apr_pool_cleanup_null);
+
+  return prefetcher;
+}
+
+/* Queue those of the SORTED_CHILDREN of LOCAL_ABSPATH in PREFETCHER that
+ * the status walker will descend into.  NODES and DIRENTS are the
+ * children's information as used by get_dir_status(). */
+static void
+prefetch_subdirs(dir_prefetcher_t *prefetcher,
+                 const char *local_abspath,
+                 const apr_array_header_t *sorted_children,
+                 apr_hash_t *nodes,
+                 apr_hash_t *dirents)
+{
+  int i;
+
+  if (prefetcher->max_threads == 0)
+    return;
+
+  if (prefetcher->thread_count == 0)
+    {
+      start_prefetch_workers(prefetcher);
+      if (prefetcher->thread_count == 0)
+        return;
+    }
+
+  apr_thread_mutex_lock(prefetcher->mutex);
+
+  /* The walker visits the children in order and the workers pick up the
+     last directory queued first.  So, queue them in reverse order. */
+  for (i = sorted_children->nelts - 1; i >= 0; --i)
+    {
+      const svn_sort__item_t *item = &APR_ARRAY_IDX(sorted_children, i,
+                                                    svn_sort__item_t);
+      const struct svn_wc__db_info_t *info = apr_hash_get(nodes, item->key,
+                                                          item->klen);
+      const svn_io_dirent2_t *dirent = apr_hash_get(dirents, item->key,
+                                                    item->klen);
+      prefetch_dir_t *dir;
+      apr_pool_t *dir_pool;
+
+      /* Only directories that one_child_status() descends into. */
+      if (!info
+          || !info->has_descendants
+          || info->status == svn_wc__db_status_not_present
+          || info->status == svn_wc__db_status_excluded
+          || info->status == svn_wc__db_status_server_excluded
+          || !dirent
+          || dirent->kind != svn_node_dir)
+        continue;
+
+      if (apr_hash_count(prefetcher->dirs) >= PREFETCH_MAX_DIRS)
+        break;
+
+      dir_pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      dir = apr_pcalloc(dir_pool, sizeof(*dir));
+      dir->pool = dir_pool;
+      dir->local_abspath = svn_dirent_join(local_abspath, item->key,
+                                           dir_pool);
+      dir->state = prefetch_queued;
+
+      APR_ARRAY_PUSH(prefetcher->stack, prefetch_dir_t *) = dir;
+      svn_hash_sets(prefetcher->dirs, dir->local_abspath, dir);
+    }
+
+  apr_thread_cond_broadcast(prefetcher->changed);
+  apr_thread_mutex_unlock(prefetcher->mutex);
+}
+
+/* Pool cleanup function destroying the pool given as DATA. */
+static apr_status_t
+destroy_prefetched_dir(void *data)
+{
+  svn_pool_destroy(data);
+  return APR_SUCCESS;
+}
+
+/* If PREFETCHER has queued LOCAL_ABSPATH, set *DIRENTS and *ERR to the
+ * result of reading it, waiting for a worker to finish if necessary, and
+ * return TRUE.  The listing remains valid until RESULT_POOL gets cleaned
+ * up.  Return FALSE if the caller has to read the directory itself. */
+static svn_boolean_t
+take_prefetched_dir(apr_hash_t **dirents,
+                    svn_error_t **err,
+                    dir_prefetcher_t *prefetcher,
+                    const char *local_abspath,
+                    apr_pool_t *result_pool)
+{
+  prefetch_dir_t *dir;
+
+  if (prefetcher->thread_count == 0)
+    return FALSE;
+
+  apr_thread_mutex_lock(prefetcher->mutex);
+
+  dir = svn_hash_gets(prefetcher->dirs, local_abspath);
+  if (!dir)
+    {
+      apr_thread_mutex_unlock(prefetcher->mutex);
+      return FALSE;
+    }
+
+  svn_hash_sets(prefetcher->dirs, local_abspath, NULL);
+
+  if (dir->state == prefetch_queued)
+    {
+      /* No worker got to it yet.  Reading it ourselves is faster than
+         waiting for the workers to get through all those before it. */
+      int i;
+      for (i = 0; i < prefetcher->stack->nelts; ++i)
+        if (APR_ARRAY_IDX(prefetcher->stack, i, prefetch_dir_t *) == dir)
+          {
+            svn_sort__array_delete(prefetcher->stack, i, 1);
+            break;
+          }
+
+      apr_thread_mutex_unlock(prefetcher->mutex);
+      svn_pool_destroy(dir->pool);
+      return FALSE;
+    }
+
+  while (dir->state != prefetch_done)
+    apr_thread_cond_wait(prefetcher->changed, prefetcher->mutex);
+  apr_thread_mutex_unlock(prefetcher->mutex);
+
+  *dirents = dir->dirents;
+  *err = dir->err;
+  apr_pool_cleanup_register(result_pool, dir->pool, destroy_prefetched_dir,
+                            apr_pool_cleanup_null);
+
+  return TRUE;
+}
+
+#endif /* APR_HAS_THREADS */
+
 static svn_error_t *
 get_dir_status(const struct walk_status_baton *wb,
                const char *local_abspath,
@@ -1247,18 +1599,43 @@ get_dir_status(const struct walk_status_baton *wb,
 
   if (wb->check_working_copy)
     {
-      err = svn_io_get_dirents3(&dirents, local_abspath,
-                                wb->ignore_text_mods /* only_check_type*/,
-                                scratch_pool, iterpool);
-      if (err
-          && (APR_STATUS_IS_ENOENT(err->apr_err)
-              || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+      dirents = NULL;
+
+      /* Skip reading directories that have not changed since the last
+         status run, if we know that. */
+      if (wb->journal && dirent && dirent->kind == svn_node_dir)
+        SVN_ERR(svn_wc__journal_get_dirents(&dirents, wb->journal,
+                                            local_abspath,
+                                            scratch_pool, iterpool));
+
+      if (!dirents)
         {
-          svn_error_clear(err);
-          dirents = apr_hash_make(scratch_pool);
+#if APR_HAS_THREADS
+          if (!wb->prefetcher
+              || !take_prefetched_dir(&dirents, &err, wb->prefetcher,
+                                      local_abspath, scratch_pool))
+#endif
+            err = svn_io_get_dirents3(&dirents, local_abspath,
+                                      wb->ignore_text_mods
+                                          /* only_check_type*/,
+                                      scratch_pool, iterpool);
+          if (err
+              && (APR_STATUS_IS_ENOENT(err->apr_err)
+                  || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+            {
+              svn_error_clear(err);
+              dirents = apr_hash_make(scratch_pool);
+            }
+          else
+            {
+              SVN_ERR(err);
+
+              if (wb->journal && !wb->ignore_text_mods)
+                SVN_ERR(svn_wc__journal_put_dirents(wb->journal,
+                                                    local_abspath, dirents,
+                                                    iterpool));
+            }
         }
-      else
-        SVN_ERR(err);
     }
   else
     dirents = apr_hash_make(scratch_pool);
@@ -1340,6 +1717,13 @@ get_dir_status(const struct walk_status_baton *wb,
   sorted_children = svn_sort__hash(all_children,
                                    svn_sort_compare_items_lexically,
                                    scratch_pool);
+
+#if APR_HAS_THREADS
+  /* Start reading the subdirectories we will descend into. */
+  if (wb->prefetcher && depth == svn_depth_infinity)
+    prefetch_subdirs(wb->prefetcher, local_abspath, sorted_children,
+                     nodes, dirents);
+#endif
   for (i = 0; i < sorted_children->nelts; i++)
     {
       const void *key;
@@ -2513,6 +2897,8 @@ svn_wc__get_status_editor(const svn_delta_editor_t **editor,
   eb->wb.check_working_copy = check_working_copy;
   eb->wb.repos_locks      = NULL;
   eb->wb.repos_root       = NULL;
+  eb->wb.journal          = NULL;
+  eb->wb.prefetcher       = NULL;
 
   SVN_ERR(svn_wc__db_externals_defined_below(&eb->wb.externals,
                                              wc_ctx->db, eb->target_abspath,
@@ -2644,6 +3030,8 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
   wb.check_working_copy = TRUE;
   wb.repos_root = NULL;
   wb.repos_locks = NULL;
+  wb.journal = NULL;
+  wb.prefetcher = NULL;
 
   /* Use the caller-provided ignore patterns if provided; the build-time
      configured defaults otherwise. */
@@ -2690,6 +3078,24 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
       && info->status != svn_wc__db_status_excluded
       && info->status != svn_wc__db_status_server_excluded)
     {
+      SVN_ERR(svn_wc__journal_open(&wb.journal, db, local_abspath,
+                                   scratch_pool, scratch_pool));
+
+#if APR_HAS_THREADS
+      /* Listings reused from the journal need no reading ahead.  The
+         walker itself is one of the configured threads. */
+      if (!wb.journal
+          && (depth == svn_depth_infinity || depth == svn_depth_unknown))
+        {
+          int threads = svn_wc__db_get_thread_count(
+                          db, SVN_CONFIG_OPTION_STATUS_THREADS);
+
+          if (threads > 1)
+            wb.prefetcher = create_prefetcher(ignore_text_mods, threads - 1,
+                                              scratch_pool);
+        }
+#endif
+
       SVN_ERR(get_dir_status(&wb,
                              local_abspath,
                              FALSE /* skip_root */,
@@ -2703,6 +3109,17 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
                              status_func, status_baton,
                              cancel_func, cancel_baton,
                              scratch_pool));
+
+      /* The stored listings just speed up future runs.  Not being able
+         to update them must not fail this one. */
+      if (wb.journal)
+        svn_error_clear(svn_wc__journal_close(wb.journal, scratch_pool));
+
+#if APR_HAS_THREADS
+      if (wb.prefetcher)
+        apr_pool_cleanup_run(scratch_pool, wb.prefetcher,
+                             cleanup_prefetcher);
+#endif
     }
   else
     {
@@ -60,6 +60,9 @@
             (status) != svn_wc__db_status_excluded &&       \
             (status) != svn_wc__db_status_not_present)
 
+/* Maximum number of BASE file nodes written to wc.db in one transaction. */
+#define BASE_BATCH_SIZE 100
+
 static svn_error_t *
 path_join_under_root(const char **result_path,
                      const char *base_path,
@@ -261,6 +264,12 @@ struct edit_baton
   /* After closing the root directory a copy of its edited value */
   svn_boolean_t edited;
 
+  /* BASE nodes of closed files that have not been written to the working
+     copy database yet, or NULL if not created yet.  BATCHED_NODES is the
+     number of these nodes. */
+  svn_wc__db_base_batch_t *base_batch;
+  int batched_nodes;
+
   apr_pool_t *pool;
 };
 
@@ -468,6 +477,40 @@ get_empty_tmp_file(const char **tmp_filename,
   return SVN_NO_ERROR;
 }
 
+/* Write the BASE nodes batched in EB to the working copy database,
+   together with their work items. */
+static svn_error_t *
+flush_base_batch(struct edit_baton *eb,
+                 apr_pool_t *scratch_pool)
+{
+  if (eb->batched_nodes == 0)
+    return SVN_NO_ERROR;
+
+  eb->batched_nodes = 0;
+  return svn_error_trace(svn_wc__db_base_batch_flush(eb->base_batch,
+                                                     scratch_pool));
+}
+
+/* An APR pool pre-cleanup handler.  This records the files that were
+   completely received before an edit got aborted.  It must run before
+   the batch, which lives in a subpool of the edit pool, gets destroyed. */
+static apr_status_t
+flush_edit_baton(void *edit_baton)
+{
+  struct edit_baton *eb = edit_baton;
+  svn_error_t *err;
+
+  err = flush_base_batch(eb, apr_pool_parent_get(eb->pool));
+
+  if (err)
+    {
+      apr_status_t apr_err = err->apr_err;
+      svn_error_clear(err);
+      return apr_err;
+    }
+  return APR_SUCCESS;
+}
+
 /* An APR pool cleanup handler.  This runs the working queue for an
    editor baton. */
 static apr_status_t
@@ -2427,6 +2470,10 @@ close_directory(void *dir_baton,
   svn_skel_t *all_work_items = NULL;
   svn_skel_t *conflict_skel = NULL;
 
+  /* Write the files in this directory (and those closed after their
+     directory) before anything else touches it. */
+  SVN_ERR(flush_base_batch(eb, scratch_pool));
+
   /* Skip if we're in a conflicted tree. */
   if (db->skip_this)
     {
@@ -4515,30 +4562,76 @@ close_file(void *file_baton,
         svn_hash_sets(eb->wcroot_iprops, fb->local_abspath, NULL);
     }
 
-  SVN_ERR(svn_wc__db_base_add_file(eb->db, fb->local_abspath,
-                                   eb->wcroot_abspath,
-                                   fb->new_repos_relpath,
-                                   eb->repos_root, eb->repos_uuid,
-                                   *eb->target_revision,
-                                   new_base_props,
-                                   fb->changed_rev,
-                                   fb->changed_date,
-                                   fb->changed_author,
-                                   new_checksum,
-                                   (dav_prop_changes->nelts > 0)
-                                     ? svn_prop_array_to_hash(
-                                                      dav_prop_changes,
-                                                      scratch_pool)
-                                     : NULL,
-                                   (fb->add_existed && fb->adding_file),
-                                   (! fb->shadowed) && new_base_props,
-                                   new_actual_props,
-                                   iprops,
-                                   keep_recorded_info,
-                                   (fb->shadowed && fb->obstruction_found),
-                                   conflict_skel,
-                                   all_work_items,
-                                   scratch_pool));
+  if (conflict_skel)
+    {
+      /* The conflict resolver below needs this node in the database.
+         Write the earlier files first, to keep the work items in order. */
+      SVN_ERR(flush_base_batch(eb, scratch_pool));
+
+      SVN_ERR(svn_wc__db_base_add_file(eb->db, fb->local_abspath,
+                                       eb->wcroot_abspath,
+                                       fb->new_repos_relpath,
+                                       eb->repos_root, eb->repos_uuid,
+                                       *eb->target_revision,
+                                       new_base_props,
+                                       fb->changed_rev,
+                                       fb->changed_date,
+                                       fb->changed_author,
+                                       new_checksum,
+                                       (dav_prop_changes->nelts > 0)
+                                         ? svn_prop_array_to_hash(
+                                                          dav_prop_changes,
+                                                          scratch_pool)
+                                         : NULL,
+                                       (fb->add_existed && fb->adding_file),
+                                       (! fb->shadowed) && new_base_props,
+                                       new_actual_props,
+                                       iprops,
+                                       keep_recorded_info,
+                                       (fb->shadowed
+                                        && fb->obstruction_found),
+                                       conflict_skel,
+                                       all_work_items,
+                                       scratch_pool));
+    }
+  else
+    {
+      /* Write this node together with its siblings, in a single
+         transaction, when closing the directory. */
+      if (!eb->base_batch)
+        SVN_ERR(svn_wc__db_base_batch_create(&eb->base_batch, eb->db,
+                                             eb->wcroot_abspath,
+                                             eb->pool, scratch_pool));
+
+      SVN_ERR(svn_wc__db_base_batch_add_file(
+                                       eb->base_batch, fb->local_abspath,
+                                       fb->new_repos_relpath,
+                                       eb->repos_root, eb->repos_uuid,
+                                       *eb->target_revision,
+                                       new_base_props,
+                                       fb->changed_rev,
+                                       fb->changed_date,
+                                       fb->changed_author,
+                                       new_checksum,
+                                       (dav_prop_changes->nelts > 0)
+                                         ? svn_prop_array_to_hash(
+                                                          dav_prop_changes,
+                                                          scratch_pool)
+                                         : NULL,
+                                       (fb->add_existed && fb->adding_file),
+                                       (! fb->shadowed) && new_base_props,
+                                       new_actual_props,
+                                       iprops,
+                                       keep_recorded_info,
+                                       (fb->shadowed
+                                        && fb->obstruction_found),
+                                       all_work_items,
+                                       scratch_pool));
+
+      /* Don't keep too many nodes of huge directories in memory. */
+      if (++eb->batched_nodes >= BASE_BATCH_SIZE)
+        SVN_ERR(flush_base_batch(eb, scratch_pool));
+    }
 
   if (conflict_skel && eb->conflict_func)
     SVN_ERR(svn_wc__conflict_invoke_resolver(eb->db, fb->local_abspath,
@@ -4692,6 +4785,9 @@ close_edit(void *edit_baton,
   struct edit_baton *eb = edit_baton;
   apr_pool_t *scratch_pool = eb->pool;
 
+  /* Write the files closed after their directories. */
+  SVN_ERR(flush_base_batch(eb, scratch_pool));
+
   /* The editor didn't even open the root; we have to take care of
      some cleanup stuffs. */
   if (! eb->root_opened
@@ -4936,6 +5032,7 @@ make_editor(svn_revnum_t *target_revision,
 
   apr_pool_cleanup_register(edit_pool, eb, cleanup_edit_baton,
                             apr_pool_cleanup_null);
+  apr_pool_pre_cleanup_register(edit_pool, eb, flush_edit_baton);
 
   /* Construct an editor. */
   tree_editor->set_target_revision = set_target_revision;
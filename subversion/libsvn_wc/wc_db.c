@@ -1843,6 +1843,251 @@ svn_wc__db_base_add_file(svn_wc__db_t *db,
 }
 
 
+/* A BASE node waiting in a svn_wc__db_base_batch_t. */
+typedef struct batched_node_t
+{
+  const char *local_abspath;
+  const char *local_relpath;
+  insert_base_baton_t ibb;
+} batched_node_t;
+
+struct svn_wc__db_base_batch_t
+{
+  svn_wc__db_wcroot_t *wcroot;
+
+  /* The batched_node_t * to write, in the order they were added. */
+  apr_array_header_t *nodes;
+
+  /* Repository id of REPOS_ROOT_URL, once known, or INVALID_REPOS_ID.
+     Nearly all nodes of an update share the same repository. */
+  apr_int64_t repos_id;
+  const char *repos_root_url;
+
+  /* Holds NODES and everything they reference.  Cleared by every flush. */
+  apr_pool_t *nodes_pool;
+};
+
+/* Return a deep copy of the array of svn_prop_inherited_item_t * IPROPS,
+   allocated in RESULT_POOL. */
+static apr_array_header_t *
+dup_iprops(const apr_array_header_t *iprops,
+           apr_pool_t *result_pool)
+{
+  apr_array_header_t *result = apr_array_make(result_pool, iprops->nelts,
+                                              sizeof(void *));
+  int i;
+
+  for (i = 0; i < iprops->nelts; ++i)
+    {
+      const svn_prop_inherited_item_t *item
+        = APR_ARRAY_IDX(iprops, i, svn_prop_inherited_item_t *);
+      svn_prop_inherited_item_t *copy = apr_palloc(result_pool,
+                                                   sizeof(*copy));
+
+      copy->path_or_url = apr_pstrdup(result_pool, item->path_or_url);
+      copy->prop_hash = svn_prop_hash_dup(item->prop_hash, result_pool);
+      APR_ARRAY_PUSH(result, svn_prop_inherited_item_t *) = copy;
+    }
+
+  return result;
+}
+
+svn_error_t *
+svn_wc__db_base_batch_create(svn_wc__db_base_batch_t **batch,
+                             svn_wc__db_t *db,
+                             const char *wri_abspath,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  svn_wc__db_base_batch_t *new_batch = apr_pcalloc(result_pool,
+                                                   sizeof(*new_batch));
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&new_batch->wcroot,
+                                                &local_relpath, db,
+                                                wri_abspath,
+                                                result_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(new_batch->wcroot);
+
+  new_batch->nodes_pool = svn_pool_create(result_pool);
+  new_batch->nodes = apr_array_make(new_batch->nodes_pool, 64,
+                                    sizeof(batched_node_t *));
+  new_batch->repos_id = INVALID_REPOS_ID;
+
+  *batch = new_batch;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_base_batch_add_file(svn_wc__db_base_batch_t *batch,
+                               const char *local_abspath,
+                               const char *repos_relpath,
+                               const char *repos_root_url,
+                               const char *repos_uuid,
+                               svn_revnum_t revision,
+                               const apr_hash_t *props,
+                               svn_revnum_t changed_rev,
+                               apr_time_t changed_date,
+                               const char *changed_author,
+                               const svn_checksum_t *checksum,
+                               apr_hash_t *dav_cache,
+                               svn_boolean_t delete_working,
+                               svn_boolean_t update_actual_props,
+                               apr_hash_t *new_actual_props,
+                               apr_array_header_t *new_iprops,
+                               svn_boolean_t keep_recorded_info,
+                               svn_boolean_t insert_base_deleted,
+                               const svn_skel_t *work_items,
+                               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *pool = batch->nodes_pool;
+  batched_node_t *node;
+  insert_base_baton_t *ibb;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(local_abspath));
+  SVN_ERR_ASSERT(repos_relpath != NULL);
+  SVN_ERR_ASSERT(svn_uri_is_canonical(repos_root_url, scratch_pool));
+  SVN_ERR_ASSERT(repos_uuid != NULL);
+  SVN_ERR_ASSERT(SVN_IS_VALID_REVNUM(revision));
+  SVN_ERR_ASSERT(props != NULL);
+  SVN_ERR_ASSERT(SVN_IS_VALID_REVNUM(changed_rev));
+  SVN_ERR_ASSERT(checksum != NULL);
+
+  node = apr_pcalloc(pool, sizeof(*node));
+  node->local_abspath = apr_pstrdup(pool, local_abspath);
+  node->local_relpath = svn_dirent_skip_ancestor(batch->wcroot->abspath,
+                                                 node->local_abspath);
+  SVN_ERR_ASSERT(node->local_relpath != NULL);
+
+  /* The caller's data is usually gone by the time we flush. */
+  ibb = &node->ibb;
+  blank_ibb(ibb);
+
+  ibb->repos_root_url = apr_pstrdup(pool, repos_root_url);
+  ibb->repos_uuid = apr_pstrdup(pool, repos_uuid);
+
+  ibb->status = svn_wc__db_status_normal;
+  ibb->kind = svn_node_file;
+  ibb->repos_relpath = apr_pstrdup(pool, repos_relpath);
+  ibb->revision = revision;
+
+  ibb->props = svn_prop_hash_dup(props, pool);
+  ibb->changed_rev = changed_rev;
+  ibb->changed_date = changed_date;
+  ibb->changed_author = apr_pstrdup(pool, changed_author);
+
+  ibb->checksum = svn_checksum_dup(checksum, pool);
+
+  if (dav_cache)
+    ibb->dav_cache = svn_prop_hash_dup(dav_cache, pool);
+  if (new_iprops)
+    ibb->iprops = dup_iprops(new_iprops, pool);
+
+  if (update_actual_props)
+    {
+      ibb->update_actual_props = TRUE;
+      if (new_actual_props)
+        ibb->new_actual_props = svn_prop_hash_dup(new_actual_props, pool);
+    }
+
+  ibb->keep_recorded_info = keep_recorded_info;
+  ibb->insert_base_deleted = insert_base_deleted;
+  ibb->delete_working = delete_working;
+
+  if (work_items)
+    ibb->work_items = svn_skel__dup(work_items, TRUE, pool);
+
+  APR_ARRAY_PUSH(batch->nodes, batched_node_t *) = node;
+
+  return SVN_NO_ERROR;
+}
+
+/* Write all nodes in BATCH to its working copy.  Helper for
+   svn_wc__db_base_batch_flush(), to be called within a transaction. */
+static svn_error_t *
+write_base_batch(svn_wc__db_base_batch_t *batch,
+                 apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < batch->nodes->nelts; ++i)
+    {
+      batched_node_t *node = APR_ARRAY_IDX(batch->nodes, i,
+                                           batched_node_t *);
+
+      svn_pool_clear(iterpool);
+
+      /* Look up the repository once instead of once per node. */
+      if (batch->repos_id == INVALID_REPOS_ID
+          || strcmp(batch->repos_root_url, node->ibb.repos_root_url) != 0)
+        {
+          SVN_ERR(create_repos_id(&batch->repos_id,
+                                  node->ibb.repos_root_url,
+                                  node->ibb.repos_uuid,
+                                  batch->wcroot->sdb, scratch_pool));
+          batch->repos_root_url = node->ibb.repos_root_url;
+        }
+      node->ibb.repos_id = batch->repos_id;
+
+      SVN_ERR(insert_base_node(&node->ibb, batch->wcroot,
+                               node->local_relpath, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Write all nodes in BATCH to its working copy in a single transaction.
+   Helper for svn_wc__db_base_batch_flush(). */
+static svn_error_t *
+flush_base_batch(svn_wc__db_base_batch_t *batch,
+                 apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot = batch->wcroot;
+  int i;
+
+  /* REPOS_ROOT_URL lived in the pool of an earlier batch. */
+  batch->repos_id = INVALID_REPOS_ID;
+
+  SVN_WC__DB_WITH_TXN(write_base_batch(batch, scratch_pool), wcroot);
+
+  /* If any of these used to be a directory we should remove children so
+   * pass depth infinity. */
+  for (i = 0; i < batch->nodes->nelts; ++i)
+    {
+      batched_node_t *node = APR_ARRAY_IDX(batch->nodes, i,
+                                           batched_node_t *);
+
+      SVN_ERR(flush_entries(wcroot, node->local_abspath,
+                            svn_depth_infinity, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_base_batch_flush(svn_wc__db_base_batch_t *batch,
+                            apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+
+  if (batch->nodes->nelts == 0)
+    return SVN_NO_ERROR;
+
+  err = flush_base_batch(batch, scratch_pool);
+
+  /* Don't write the same nodes again, even if we failed. */
+  svn_pool_clear(batch->nodes_pool);
+  batch->nodes = apr_array_make(batch->nodes_pool, 64,
+                                sizeof(batched_node_t *));
+
+  return svn_error_trace(err);
+}
+
+
 svn_error_t *
 svn_wc__db_base_add_symlink(svn_wc__db_t *db,
                             const char *local_abspath,
@@ -13592,7 +13837,125 @@ svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc__db_wq_fetch_following(apr_array_header_t **ids,
+                              apr_array_header_t **work_items,
+                              svn_wc__db_t *db,
+                              const char *wri_abspath,
+                              apr_uint64_t after_id,
+                              int max_items,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  *ids = apr_array_make(result_pool, max_items, sizeof(apr_uint64_t));
+  *work_items = apr_array_make(result_pool, max_items, sizeof(svn_skel_t *));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_WORK_ITEMS_AFTER));
+  SVN_ERR(svn_sqlite__bind_int64(stmt, 1, after_id));
+  SVN_ERR(svn_sqlite__bind_int(stmt, 2, max_items));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  while (have_row)
+    {
+      apr_size_t len;
+      const void *val;
+
+      APR_ARRAY_PUSH(*ids, apr_uint64_t) = svn_sqlite__column_int64(stmt, 0);
+
+      val = svn_sqlite__column_blob(stmt, 1, &len, result_pool);
+      APR_ARRAY_PUSH(*work_items, svn_skel_t *)
+        = svn_skel__parse(val, len, result_pool);
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* The body of svn_wc__db_wq_record_and_complete().
+ */
+static svn_error_t *
+wq_record_and_complete(svn_wc__db_wcroot_t *wcroot,
+                       const apr_array_header_t *completed_ids,
+                       apr_hash_t *record_map,
+                       apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  int i;
+
+  for (i = 0; i < completed_ids->nelts; i++)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                        STMT_DELETE_WORK_ITEM));
+      SVN_ERR(svn_sqlite__bind_int64(stmt, 1,
+                                     APR_ARRAY_IDX(completed_ids, i,
+                                                   apr_uint64_t)));
+      SVN_ERR(svn_sqlite__step_done(stmt));
+    }
+
+  if (record_map)
+    SVN_ERR(wq_record(wcroot, record_map, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_wq_record_and_complete(svn_wc__db_t *db,
+                                  const char *wri_abspath,
+                                  const apr_array_header_t *completed_ids,
+                                  apr_hash_t *record_map,
+                                  apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  SVN_WC__DB_WITH_TXN(
+    wq_record_and_complete(wcroot, completed_ids, record_map, scratch_pool),
+    wcroot);
+
+  return SVN_NO_ERROR;
+}
+
+
+
+int
+svn_wc__db_get_thread_count(svn_wc__db_t *db,
+                            const char *option)
+{
+  apr_int64_t count;
+  svn_error_t *err;
+
+  if (db->config == NULL)
+    return 1;
+
+  err = svn_config_get_int64(db->config, &count,
+                             SVN_CONFIG_SECTION_WORKING_COPY, option, 1);
+  if (err || count < 1)
+    {
+      svn_error_clear(err);
+      return 1;
+    }
 
+  return (int)MIN(count, SVN_WC__DB_MAX_THREADS);
+}
 
 /* ### temporary API. remove before release.  */
 svn_error_t *
@@ -530,6 +530,63 @@ svn_wc__db_base_add_file(svn_wc__db_t *db,
                          apr_pool_t *scratch_pool);
 
 
+/* A set of BASE nodes that are written to the working copy database in
+   a single transaction.  Writing many nodes this way is much cheaper
+   than writing them one at a time.  */
+typedef struct svn_wc__db_base_batch_t svn_wc__db_base_batch_t;
+
+/* Set *BATCH to a new, empty batch for the working copy containing
+   WRI_ABSPATH in DB, allocated in RESULT_POOL.
+
+   All temporary allocations will be made in SCRATCH_POOL.
+*/
+svn_error_t *
+svn_wc__db_base_batch_create(svn_wc__db_base_batch_t **batch,
+                             svn_wc__db_t *db,
+                             const char *wri_abspath,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
+/* Like svn_wc__db_base_add_file() without a conflict, but only add the
+   file to BATCH.  Nothing is written to the database until BATCH gets
+   flushed.  BATCH keeps a copy of all arguments, so the caller may free
+   them right away.
+
+   All temporary allocations will be made in SCRATCH_POOL.
+*/
+svn_error_t *
+svn_wc__db_base_batch_add_file(svn_wc__db_base_batch_t *batch,
+                               const char *local_abspath,
+                               const char *repos_relpath,
+                               const char *repos_root_url,
+                               const char *repos_uuid,
+                               svn_revnum_t revision,
+                               const apr_hash_t *props,
+                               svn_revnum_t changed_rev,
+                               apr_time_t changed_date,
+                               const char *changed_author,
+                               const svn_checksum_t *checksum,
+                               apr_hash_t *dav_cache,
+                               svn_boolean_t delete_working,
+                               svn_boolean_t update_actual_props,
+                               apr_hash_t *new_actual_props,
+                               apr_array_header_t *new_iprops,
+                               svn_boolean_t keep_recorded_info,
+                               svn_boolean_t insert_base_deleted,
+                               const svn_skel_t *work_items,
+                               apr_pool_t *scratch_pool);
+
+/* Write all nodes added to BATCH, together with their work items, in a
+   single transaction and empty BATCH.  BATCH is emptied even if this
+   fails.
+
+   All temporary allocations will be made in SCRATCH_POOL.
+*/
+svn_error_t *
+svn_wc__db_base_batch_flush(svn_wc__db_base_batch_t *batch,
+                            apr_pool_t *scratch_pool);
+
+
 /* Add or replace a symlink in the BASE tree.
 
    The symlink is located at LOCAL_ABSPATH on the local filesystem, and
@@ -945,6 +1002,22 @@ svn_wc__db_pristine_read(svn_stream_t **contents,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool);
 
+/* Set *CONTENTS to a readable stream that will yield the pristine text
+   identified by SHA1_CHECKSUM from the pristine store that is shared
+   between the working copies of DB (see the 'shared-pristine-store'
+   runtime configuration option).  Set *CONTENTS to NULL if there is no
+   shared store or if it can't provide that text.  Verify the text before
+   returning it and remove it from the store if it does not match
+   SHA1_CHECKSUM.
+
+   Allocate the stream in RESULT_POOL. */
+svn_error_t *
+svn_wc__db_pristine_read_shared(svn_stream_t **contents,
+                                svn_wc__db_t *db,
+                                const svn_checksum_t *sha1_checksum,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool);
+
 /* Baton for svn_wc__db_pristine_install */
 typedef struct svn_wc__db_install_data_t
                svn_wc__db_install_data_t;
@@ -1040,7 +1113,9 @@ svn_wc__db_pristine_remove(svn_wc__db_t *db,
                            apr_pool_t *scratch_pool);
 
 
-/* Remove all unreferenced pristines in the WC of WRI_ABSPATH in DB. */
+/* Remove all unreferenced pristines in the WC of WRI_ABSPATH in DB.
+   Also remove the texts that no working copy has used for some time from
+   the pristine store shared between the working copies of DB. */
 svn_error_t *
 svn_wc__db_pristine_cleanup(svn_wc__db_t *db,
                             const char *wri_abspath,
@@ -3023,6 +3098,34 @@ svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
                                     apr_pool_t *result_pool,
                                     apr_pool_t *scratch_pool);
 
+/* In the WCROOT associated with DB and WRI_ABSPATH, fetch up to MAX_ITEMS
+   work items that have been queued after the item AFTER_ID, in the order
+   they were queued.  Return their identifiers in *IDS (apr_uint64_t) and
+   the items themselves in *WORK_ITEMS (svn_skel_t *), both allocated in
+   RESULT_POOL.  This does not mark any item as completed.
+
+   SCRATCH_POOL will be used for all temporary allocations.  */
+svn_error_t *
+svn_wc__db_wq_fetch_following(apr_array_header_t **ids,
+                              apr_array_header_t **work_items,
+                              svn_wc__db_t *db,
+                              const char *wri_abspath,
+                              apr_uint64_t after_id,
+                              int max_items,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool);
+
+/* In a single transaction, mark all work items whose identifiers are in
+   COMPLETED_IDS (apr_uint64_t) as completed and, unless RECORD_MAP is
+   NULL, record the timestamps and sizes given in it, just like
+   svn_wc__db_wq_record_and_fetch_next() does.  */
+svn_error_t *
+svn_wc__db_wq_record_and_complete(svn_wc__db_t *db,
+                                  const char *wri_abspath,
+                                  const apr_array_header_t *completed_ids,
+                                  apr_hash_t *record_map,
+                                  apr_pool_t *scratch_pool);
+
 
 /* @} */
 
@@ -3122,6 +3225,17 @@ svn_wc__db_op_set_base_depth(svn_wc__db_t *db,
                              svn_depth_t depth,
                              apr_pool_t *scratch_pool);
 
+/* Upper limit for svn_wc__db_get_thread_count(). */
+#define SVN_WC__DB_MAX_THREADS 64
+
+/* Return the number of threads that the operation controlled by the
+   [working-copy] OPTION in DB's runtime configuration may use.  Return 1
+   if the option is not set or invalid, and cap the result at
+   SVN_WC__DB_MAX_THREADS.  */
+int
+svn_wc__db_get_thread_count(svn_wc__db_t *db,
+                            const char *option);
+
 /* ### temp function. return the FORMAT for the directory LOCAL_ABSPATH.  */
 svn_error_t *
 svn_wc__db_temp_get_format(int *format,
@@ -25,6 +25,8 @@
 
 #define SVN_WC__I_AM_WC_DB
 
+#include <apr_user.h>
+
 #include "svn_pools.h"
 #include "svn_io.h"
 #include "svn_dirent_uri.h"
@@ -40,8 +42,48 @@
 #define PRISTINE_STORAGE_RELPATH "pristine"
 #define PRISTINE_TEMPDIR_RELPATH "tmp"
 
+/* Texts in the shared pristine store that no working copy links to are
+   kept for this long after the last change of their link count. */
+#define SHARED_PRISTINE_GRACE_PERIOD apr_time_from_sec(24 * 60 * 60)
+
 
 
+/* Returns in PRISTINE_ABSPATH a new string allocated from RESULT_POOL,
+   holding the local absolute path to the file location that is dedicated
+   to hold CHECKSUM's pristine file in the pristine store directory
+   BASE_DIR_ABSPATH. The returned path does not necessarily currently exist.
+
+   Any other allocations are made in SCRATCH_POOL. */
+static svn_error_t *
+get_fname_in_store(const char **pristine_abspath,
+                   const char *base_dir_abspath,
+                   const svn_checksum_t *sha1_checksum,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  const char *hexdigest = svn_checksum_to_cstring(sha1_checksum, scratch_pool);
+  char subdir[3];
+
+  /* We should have a valid checksum and (thus) a valid digest. */
+  SVN_ERR_ASSERT(hexdigest != NULL);
+
+  /* Get the first two characters of the digest, for the subdir. */
+  subdir[0] = hexdigest[0];
+  subdir[1] = hexdigest[1];
+  subdir[2] = '\0';
+
+  hexdigest = apr_pstrcat(scratch_pool, hexdigest, PRISTINE_STORAGE_EXT,
+                          SVN_VA_NULL);
+
+  /* The file is located at BASE_DIR/XX/XXYYZZ...svn-base */
+  *pristine_abspath = svn_dirent_join_many(result_pool,
+                                           base_dir_abspath,
+                                           subdir,
+                                           hexdigest,
+                                           SVN_VA_NULL);
+  return SVN_NO_ERROR;
+}
+
 /* Returns in PRISTINE_ABSPATH a new string allocated from RESULT_POOL,
    holding the local absolute path to the file location that is dedicated
    to hold CHECKSUM's pristine file, relating to the pristine store
@@ -57,8 +99,6 @@ get_pristine_fname(const char **pristine_abspath,
                    apr_pool_t *scratch_pool)
 {
   const char *base_dir_abspath;
-  const char *hexdigest = svn_checksum_to_cstring(sha1_checksum, scratch_pool);
-  char subdir[3];
 
   /* ### code is in transition. make sure we have the proper data.  */
   SVN_ERR_ASSERT(pristine_abspath != NULL);
@@ -72,24 +112,33 @@ get_pristine_fname(const char **pristine_abspath,
                                           PRISTINE_STORAGE_RELPATH,
                                           SVN_VA_NULL);
 
-  /* We should have a valid checksum and (thus) a valid digest. */
-  SVN_ERR_ASSERT(hexdigest != NULL);
+  return svn_error_trace(get_fname_in_store(pristine_abspath,
+                                            base_dir_abspath, sha1_checksum,
+                                            result_pool, scratch_pool));
+}
 
-  /* Get the first two characters of the digest, for the subdir. */
-  subdir[0] = hexdigest[0];
-  subdir[1] = hexdigest[1];
-  subdir[2] = '\0';
+/* Like get_pristine_fname(), but for the pristine store at
+   SHARED_STORE_ABSPATH that is shared between working copies.  Set
+   *SHARED_ABSPATH to NULL if SHARED_STORE_ABSPATH is NULL. */
+static svn_error_t *
+get_shared_pristine_fname(const char **shared_abspath,
+                          const char *shared_store_abspath,
+                          const svn_checksum_t *sha1_checksum,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  if (!shared_store_abspath)
+    {
+      *shared_abspath = NULL;
+      return SVN_NO_ERROR;
+    }
 
-  hexdigest = apr_pstrcat(scratch_pool, hexdigest, PRISTINE_STORAGE_EXT,
-                          SVN_VA_NULL);
+  SVN_ERR_ASSERT(sha1_checksum->kind == svn_checksum_sha1);
 
-  /* The file is located at DIR/.svn/pristine/XX/XXYYZZ...svn-base */
-  *pristine_abspath = svn_dirent_join_many(result_pool,
-                                           base_dir_abspath,
-                                           subdir,
-                                           hexdigest,
-                                           SVN_VA_NULL);
-  return SVN_NO_ERROR;
+  return svn_error_trace(get_fname_in_store(shared_abspath,
+                                            shared_store_abspath,
+                                            sha1_checksum,
+                                            result_pool, scratch_pool));
 }
 
 
@@ -256,6 +305,107 @@ svn_wc__db_pristine_read(svn_stream_t **contents,
   return SVN_NO_ERROR;
 }
 
+/* Set *MATCHES to whether the text in FILE, which must be positioned at
+   its start, has SHA1_CHECKSUM.  Leave FILE positioned at its start.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+shared_text_matches(svn_boolean_t *matches,
+                    apr_file_t *file,
+                    const svn_checksum_t *sha1_checksum,
+                    apr_pool_t *scratch_pool)
+{
+  svn_checksum_t *actual;
+  svn_stream_t *stream;
+  apr_off_t offset = 0;
+
+  stream = svn_stream_checksummed2(svn_stream_from_aprfile2(file, TRUE,
+                                                            scratch_pool),
+                                   &actual, NULL, svn_checksum_sha1, TRUE,
+                                   scratch_pool);
+  SVN_ERR(svn_stream_close(stream));
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+
+  *matches = svn_checksum_match(actual, sha1_checksum);
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if FILE is owned by the current user.  Nobody else may then
+   modify a shared text that we linked to.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_boolean_t
+owned_by_current_user(apr_file_t *file,
+                      apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  apr_uid_t uid;
+  apr_gid_t gid;
+  apr_status_t status;
+
+  status = apr_file_info_get(&finfo, APR_FINFO_USER, file);
+  if ((status && status != APR_INCOMPLETE)
+      || !(finfo.valid & APR_FINFO_USER))
+    return FALSE;
+
+  if (apr_uid_current(&uid, &gid, scratch_pool))
+    return FALSE;
+
+  return apr_uid_compare(finfo.user, uid) == APR_SUCCESS;
+}
+
+svn_error_t *
+svn_wc__db_pristine_read_shared(svn_stream_t **contents,
+                                svn_wc__db_t *db,
+                                const svn_checksum_t *sha1_checksum,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool)
+{
+  const char *shared_abspath;
+  apr_file_t *file;
+  svn_boolean_t matches;
+  svn_error_t *err;
+
+  *contents = NULL;
+
+  if (sha1_checksum->kind != svn_checksum_sha1)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_shared_pristine_fname(&shared_abspath,
+                                    db->shared_pristine_abspath,
+                                    sha1_checksum,
+                                    scratch_pool, scratch_pool));
+  if (!shared_abspath)
+    return SVN_NO_ERROR;
+
+  /* Texts are added to the shared store atomically.  As with our own
+   * pristine store, the stream remains readable if the text gets removed.
+   * Not being able to read it, for whatever reason, just means that we
+   * have to get the text elsewhere. */
+  err = svn_io_file_open(&file, shared_abspath, APR_READ, APR_OS_DEFAULT,
+                         result_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  /* Anybody using the store may have written this file. */
+  err = shared_text_matches(&matches, file, sha1_checksum, scratch_pool);
+  if (err || !matches)
+    {
+      svn_error_clear(err);
+      svn_error_clear(svn_io_file_close(file, scratch_pool));
+
+      /* Drop a corrupt text, so that it gets fetched and shared again. */
+      if (!err)
+        svn_error_clear(svn_io_remove_file2(shared_abspath, TRUE,
+                                            scratch_pool));
+      return SVN_NO_ERROR;
+    }
+
+  *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
+  return SVN_NO_ERROR;
+}
+
 
 /* Return the absolute path to the temporary directory for pristine text
    files within WCROOT. */
@@ -269,10 +419,125 @@ pristine_get_tempdir(svn_wc__db_wcroot_t *wcroot,
                               PRISTINE_TEMPDIR_RELPATH, SVN_VA_NULL);
 }
 
+/* If the shared pristine store has the text of SIZE bytes with
+ * SHA1_CHECKSUM at SHARED_ABSPATH, create PRISTINE_ABSPATH as a hard link
+ * to it and set *LINKED to TRUE.  Otherwise, e.g. if the store is on a
+ * different file system, set *LINKED to FALSE.
+ *
+ * Only keep links to texts that the current user owns and that match
+ * SHA1_CHECKSUM.  Remove a corrupt text from the store, so that ours can
+ * take its place.
+ */
+static svn_error_t *
+link_from_shared_store(svn_boolean_t *linked,
+                       const char *shared_abspath,
+                       const char *pristine_abspath,
+                       const svn_checksum_t *sha1_checksum,
+                       svn_filesize_t size,
+                       apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  apr_file_t *file;
+  svn_boolean_t owned = FALSE;
+  svn_boolean_t matches = FALSE;
+  svn_error_t *err;
+
+  *linked = FALSE;
+
+  /* Don't trust a text that can't be complete. */
+  err = svn_io_stat(&finfo, shared_abspath, APR_FINFO_SIZE, scratch_pool);
+  if (err || finfo.size != size)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  err = svn_io__file_link(shared_abspath, pristine_abspath, scratch_pool);
+  if (err && APR_STATUS_IS_EEXIST(err->apr_err))
+    {
+      /* An orphan file; see pristine_install_txn(). */
+      svn_error_clear(err);
+      SVN_ERR(svn_io_remove_file2(pristine_abspath, TRUE, scratch_pool));
+      err = svn_io__file_link(shared_abspath, pristine_abspath, scratch_pool);
+    }
+
+  if (err)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  /* Check the file we linked to.  Unlike the name in the store, our link
+     can't be replaced by somebody else. */
+  err = svn_io_file_open(&file, pristine_abspath, APR_READ, APR_OS_DEFAULT,
+                         scratch_pool);
+  if (!err)
+    {
+      owned = owned_by_current_user(file, scratch_pool);
+      if (owned)
+        err = shared_text_matches(&matches, file, sha1_checksum,
+                                  scratch_pool);
+      err = svn_error_compose_create(err, svn_io_file_close(file,
+                                                            scratch_pool));
+    }
+
+  if (err || !owned || !matches)
+    {
+      if (!err && owned)
+        svn_error_clear(svn_io_remove_file2(shared_abspath, TRUE,
+                                            scratch_pool));
+      svn_error_clear(err);
+
+      return svn_error_trace(svn_io_remove_file2(pristine_abspath, TRUE,
+                                                 scratch_pool));
+    }
+
+  *linked = TRUE;
+  return SVN_NO_ERROR;
+}
+
+/* Make the pristine text at PRISTINE_ABSPATH available to other working
+ * copies as SHARED_ABSPATH in the shared pristine store.  Prefer a hard
+ * link, which lets the store see which texts are still used.
+ */
+static svn_error_t *
+publish_to_shared_store(const char *pristine_abspath,
+                        const char *shared_abspath,
+                        apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+
+  SVN_ERR(svn_io_make_dir_recursively(svn_dirent_dirname(shared_abspath,
+                                                         scratch_pool),
+                                      scratch_pool));
+
+  /* If the text is there already, another working copy published it
+     concurrently.  Its contents are the same. */
+  err = svn_io__file_link(pristine_abspath, shared_abspath, scratch_pool);
+  if (!err || APR_STATUS_IS_EEXIST(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  svn_error_clear(err);
+
+  /* Copy it instead.  This writes a temporary file first and then moves
+     it into place, so that readers never see a partial text. */
+  SVN_ERR(svn_io_copy_file(pristine_abspath, shared_abspath, FALSE,
+                           scratch_pool));
+  SVN_ERR(svn_io_set_file_read_only(shared_abspath, FALSE, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Install the pristine text described by BATON into the pristine store of
  * SDB.  If it is already stored then just delete the new file
  * BATON->tempfile_abspath.
  *
+ * If SHARED_ABSPATH is not NULL, it is the location of this text in the
+ * shared pristine store.  Link the pristine text to it, or publish it
+ * there if it isn't present yet.
+ *
  * This function expects to be executed inside a SQLite txn that has already
  * acquired a 'RESERVED' lock.
  *
@@ -288,6 +553,8 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
                      const svn_checksum_t *sha1_checksum,
                      /* The pristine text's MD-5 checksum. */
                      const svn_checksum_t *md5_checksum,
+                     /* Its location in the shared pristine store, or NULL. */
+                     const char *shared_abspath,
                      apr_pool_t *scratch_pool)
 {
   svn_sqlite__stmt_t *stmt;
@@ -333,11 +600,31 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
    * an orphan file and it doesn't matter if we overwrite it.) */
   {
     apr_finfo_t finfo;
+    svn_boolean_t linked = FALSE;
+
     SVN_ERR(svn_stream__install_get_info(&finfo, install_stream, APR_FINFO_SIZE,
                                          scratch_pool));
-    SVN_ERR(svn_io_set_file_read_write(pristine_abspath, TRUE, scratch_pool));
-    SVN_ERR(svn_stream__install_stream(install_stream, pristine_abspath,
-                                        TRUE, scratch_pool));
+
+    /* Share the disk space with the other working copies if we can. */
+    if (shared_abspath)
+      {
+        SVN_ERR(svn_io_make_dir_recursively(
+                          svn_dirent_dirname(pristine_abspath, scratch_pool),
+                          scratch_pool));
+        SVN_ERR(link_from_shared_store(&linked, shared_abspath,
+                                       pristine_abspath, sha1_checksum,
+                                       finfo.size, scratch_pool));
+      }
+
+    if (linked)
+      SVN_ERR(svn_stream__install_delete(install_stream, scratch_pool));
+    else
+      {
+        SVN_ERR(svn_io_set_file_read_write(pristine_abspath, TRUE,
+                                           scratch_pool));
+        SVN_ERR(svn_stream__install_stream(install_stream, pristine_abspath,
+                                           TRUE, scratch_pool));
+      }
 
     SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
                                       STMT_INSERT_PRISTINE));
@@ -346,7 +633,19 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
     SVN_ERR(svn_sqlite__bind_int64(stmt, 3, finfo.size));
     SVN_ERR(svn_sqlite__insert(NULL, stmt));
 
-    SVN_ERR(svn_io_set_file_read_only(pristine_abspath, FALSE, scratch_pool));
+    /* A shared text is read-only already and may belong to another user. */
+    if (!linked)
+      {
+        SVN_ERR(svn_io_set_file_read_only(pristine_abspath, FALSE,
+                                          scratch_pool));
+
+        /* The shared store is just a cache: failing to add to it doesn't
+           affect this working copy. */
+        if (shared_abspath)
+          svn_error_clear(publish_to_shared_store(pristine_abspath,
+                                                  shared_abspath,
+                                                  scratch_pool));
+      }
   }
 
   return SVN_NO_ERROR;
@@ -356,6 +655,9 @@ struct svn_wc__db_install_data_t
 {
   svn_wc__db_wcroot_t *wcroot;
   svn_stream_t *inner_stream;
+
+  /* The pristine store shared between working copies, or NULL. */
+  const char *shared_store_abspath;
 };
 
 svn_error_t *
@@ -382,6 +684,7 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
   *install_data = apr_pcalloc(result_pool, sizeof(**install_data));
   (*install_data)->wcroot = wcroot;
+  (*install_data)->shared_store_abspath = db->shared_pristine_abspath;
 
   SVN_ERR(svn_stream__create_for_install(stream,
                                          temp_dir_abspath,
@@ -407,6 +710,7 @@ svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
 {
   svn_wc__db_wcroot_t *wcroot = install_data->wcroot;
   const char *pristine_abspath;
+  const char *shared_abspath;
 
   SVN_ERR_ASSERT(sha1_checksum != NULL);
   SVN_ERR_ASSERT(sha1_checksum->kind == svn_checksum_sha1);
@@ -416,13 +720,17 @@ svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
   SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
                              sha1_checksum,
                              scratch_pool, scratch_pool));
+  SVN_ERR(get_shared_pristine_fname(&shared_abspath,
+                                    install_data->shared_store_abspath,
+                                    sha1_checksum,
+                                    scratch_pool, scratch_pool));
 
   /* Ensure the SQL txn has at least a 'RESERVED' lock before we start looking
    * at the disk, to ensure no concurrent pristine install/delete txn. */
   SVN_SQLITE__WITH_IMMEDIATE_TXN(
     pristine_install_txn(wcroot->sdb,
                          install_data->inner_stream, pristine_abspath,
-                         sha1_checksum, md5_checksum,
+                         sha1_checksum, md5_checksum, shared_abspath,
                          scratch_pool),
     wcroot->sdb);
 
@@ -893,6 +1201,84 @@ pristine_cleanup_wcroot(svn_wc__db_wcroot_t *wcroot,
       svn_error_compose_create(err, svn_sqlite__reset(stmt)));
 }
 
+/* Remove the texts in the shared pristine store at SHARED_STORE_ABSPATH
+ * that no working copy has linked to for SHARED_PRISTINE_GRACE_PERIOD.
+ *
+ * The link count of a shared text is its reference count.  Removing a
+ * text concurrently with a working copy linking to it is safe: if the
+ * link gets created first, the text survives in that working copy;
+ * otherwise linking fails and the working copy stores its own copy.
+ *
+ * Texts that were copied into the store, because it is on a different
+ * file system than the working copy, are removed once they have been
+ * in the store for SHARED_PRISTINE_GRACE_PERIOD.
+ */
+static svn_error_t *
+pristine_cleanup_shared_store(const char *shared_store_abspath,
+                              apr_pool_t *scratch_pool)
+{
+  apr_time_t expiry = apr_time_now() - SHARED_PRISTINE_GRACE_PERIOD;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *file_pool = svn_pool_create(scratch_pool);
+  apr_hash_t *subdirs;
+  apr_hash_index_t *hi;
+  svn_error_t *err;
+
+  err = svn_io_get_dirents3(&subdirs, shared_store_abspath, TRUE,
+                            scratch_pool, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  for (hi = apr_hash_first(scratch_pool, subdirs); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+      const char *subdir_abspath;
+      apr_hash_t *files;
+      apr_hash_index_t *hi2;
+
+      if (dirent->kind != svn_node_dir || strlen(name) != 2)
+        continue;
+
+      svn_pool_clear(iterpool);
+
+      subdir_abspath = svn_dirent_join(shared_store_abspath, name, iterpool);
+      err = svn_io_get_dirents3(&files, subdir_abspath, TRUE,
+                                iterpool, iterpool);
+      if (err)
+        {
+          /* Removed concurrently or not ours to clean up. */
+          svn_error_clear(err);
+          continue;
+        }
+
+      for (hi2 = apr_hash_first(iterpool, files); hi2; hi2 = apr_hash_next(hi2))
+        {
+          const char *file_abspath;
+          apr_finfo_t finfo;
+
+          svn_pool_clear(file_pool);
+
+          file_abspath = svn_dirent_join(subdir_abspath,
+                                         apr_hash_this_key(hi2), file_pool);
+          err = svn_io_stat(&finfo, file_abspath,
+                            APR_FINFO_NLINK | APR_FINFO_CTIME, file_pool);
+          if (!err && finfo.nlink == 1 && finfo.ctime < expiry)
+            err = svn_io_remove_file2(file_abspath, TRUE, file_pool);
+
+          svn_error_clear(err);
+        }
+    }
+
+  svn_pool_destroy(file_pool);
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_wc__db_pristine_cleanup(svn_wc__db_t *db,
                             const char *wri_abspath,
@@ -909,6 +1295,10 @@ svn_wc__db_pristine_cleanup(svn_wc__db_t *db,
 
   SVN_ERR(pristine_cleanup_wcroot(wcroot, scratch_pool));
 
+  if (db->shared_pristine_abspath)
+    SVN_ERR(pristine_cleanup_shared_store(db->shared_pristine_abspath,
+                                          scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
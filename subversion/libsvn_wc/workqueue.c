@@ -22,14 +22,19 @@
  */
 
 #include <apr_pools.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_proc.h>
 
 #include "svn_private_config.h"
 #include "svn_types.h"
+#include "svn_config.h"
 #include "svn_pools.h"
 #include "svn_dirent_uri.h"
 #include "svn_subst.h"
 #include "svn_hash.h"
 #include "svn_io.h"
+#include "svn_sorts.h"
 
 #include "wc.h"
 #include "wc_db.h"
@@ -38,6 +43,7 @@
 #include "conflicts.h"
 #include "translate.h"
 
+#include "private/svn_atomic.h"
 #include "private/svn_io_private.h"
 #include "private/svn_skel.h"
 
@@ -61,6 +67,11 @@
 #define OP_TMP_SET_TEXT_CONFLICT_MARKERS "tmp-set-text-conflict-markers"
 #define OP_TMP_SET_PROPERTY_CONFLICT_MARKER "tmp-set-property-conflict-marker"
 
+#if APR_HAS_THREADS
+/* Maximum number of OP_FILE_INSTALL items to install in one go. */
+#define INSTALL_BATCH_SIZE 64
+#endif
+
 /* For work queue debugging. Generates output about its operation.  */
 /* #define SVN_DEBUG_WORK_QUEUE */
 
@@ -444,60 +455,94 @@ svn_wc__wq_build_postupgrade(svn_skel_t **work_item,
 
 /* OP_FILE_INSTALL */
 
-/* Process the OP_FILE_INSTALL work item WORK_ITEM.
- * See svn_wc__wq_build_file_install() which generates this work item.
- * Implements (struct work_item_dispatch).func. */
+/* Everything needed to install a single file.  Only the preparation reads
+ * from the wc.db; the installation itself touches the file system only and
+ * may therefore run on any thread. */
+typedef struct install_job_t
+{
+  /* The work item and its id in the queue. */
+  apr_uint64_t id;
+  const svn_skel_t *work_item;
+
+  /* Install from SOURCE_ABSPATH to LOCAL_ABSPATH.  If SOURCE_IS_PRISTINE
+   * is not set, SOURCE_ABSPATH is a file provided by the work item. */
+  const char *local_abspath;
+  const char *source_abspath;
+  svn_boolean_t source_is_pristine;
+
+  /* Where to put the temporary file before moving it into place. */
+  const char *temp_dir_abspath;
+
+  /* Translation to apply. */
+  svn_boolean_t special;
+  svn_boolean_t translate;
+  const char *eol;
+  apr_hash_t *keywords;
+
+  /* Flags and timestamp to set on the installed file.  Don't touch the
+   * timestamp if SET_TIME is 0. */
+  svn_boolean_t executable;
+  svn_boolean_t read_only;
+  apr_time_t set_time;
+
+  /* If set, fill in FILEINFO and set HAVE_FILEINFO after installation. */
+  svn_boolean_t record_fileinfo;
+  svn_boolean_t have_fileinfo;
+  svn_io_dirent2_t fileinfo;
+
+  /* The result of the installation.  DONE is set once it has been run. */
+  svn_boolean_t done;
+  svn_error_t *err;
+} install_job_t;
+
+/* Fill in all input fields of JOB for the OP_FILE_INSTALL work item
+ * WORK_ITEM, reading the node's details from DB.  Allocate the results in
+ * RESULT_POOL and temporaries in SCRATCH_POOL. */
 static svn_error_t *
-run_file_install(work_item_baton_t *wqb,
-                 svn_wc__db_t *db,
-                 const svn_skel_t *work_item,
-                 const char *wri_abspath,
-                 svn_cancel_func_t cancel_func,
-                 void *cancel_baton,
-                 apr_pool_t *scratch_pool)
+prepare_file_install(install_job_t *job,
+                     svn_wc__db_t *db,
+                     const svn_skel_t *work_item,
+                     const char *wri_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
 {
   const svn_skel_t *arg1 = work_item->children->next;
   const svn_skel_t *arg4 = arg1->next->next->next;
   const char *local_relpath;
-  const char *local_abspath;
   svn_boolean_t use_commit_times;
-  svn_boolean_t record_fileinfo;
-  svn_boolean_t special;
-  svn_stream_t *src_stream;
   svn_subst_eol_style_t style;
-  const char *eol;
-  apr_hash_t *keywords;
-  const char *temp_dir_abspath;
-  svn_stream_t *dst_stream;
   apr_int64_t val;
   const char *wcroot_abspath;
-  const char *source_abspath;
   const svn_checksum_t *checksum;
   apr_hash_t *props;
   apr_time_t changed_date;
 
+  job->work_item = work_item;
+
   local_relpath = apr_pstrmemdup(scratch_pool, arg1->data, arg1->len);
-  SVN_ERR(svn_wc__db_from_relpath(&local_abspath, db, wri_abspath,
-                                  local_relpath, scratch_pool, scratch_pool));
+  SVN_ERR(svn_wc__db_from_relpath(&job->local_abspath, db, wri_abspath,
+                                  local_relpath, result_pool, scratch_pool));
 
   SVN_ERR(svn_skel__parse_int(&val, arg1->next, scratch_pool));
   use_commit_times = (val != 0);
   SVN_ERR(svn_skel__parse_int(&val, arg1->next->next, scratch_pool));
-  record_fileinfo = (val != 0);
+  job->record_fileinfo = (val != 0);
 
   SVN_ERR(svn_wc__db_read_node_install_info(&wcroot_abspath,
                                             &checksum, &props,
                                             &changed_date,
-                                            db, local_abspath, wri_abspath,
+                                            db, job->local_abspath,
+                                            wri_abspath,
                                             scratch_pool, scratch_pool));
 
   if (arg4 != NULL)
     {
       /* Use the provided path for the source.  */
       local_relpath = apr_pstrmemdup(scratch_pool, arg4->data, arg4->len);
-      SVN_ERR(svn_wc__db_from_relpath(&source_abspath, db, wri_abspath,
+      SVN_ERR(svn_wc__db_from_relpath(&job->source_abspath, db, wri_abspath,
                                       local_relpath,
-                                      scratch_pool, scratch_pool));
+                                      result_pool, scratch_pool));
+      job->source_is_pristine = FALSE;
     }
   else if (! checksum)
     {
@@ -512,31 +557,86 @@ run_file_install(work_item_baton_t *wqb,
                                _("Can't install '%s' from pristine store, "
                                  "because no checksum is recorded for this "
                                  "file"),
-                               svn_dirent_local_style(local_abspath,
+                               svn_dirent_local_style(job->local_abspath,
                                                       scratch_pool));
     }
   else
     {
-      SVN_ERR(svn_wc__db_pristine_get_future_path(&source_abspath,
+      SVN_ERR(svn_wc__db_pristine_get_future_path(&job->source_abspath,
                                                   wcroot_abspath,
                                                   checksum,
-                                                  scratch_pool, scratch_pool));
+                                                  result_pool, scratch_pool));
+      job->source_is_pristine = TRUE;
     }
 
-  SVN_ERR(svn_stream_open_readonly(&src_stream, source_abspath,
-                                   scratch_pool, scratch_pool));
-
   /* Fetch all the translation bits.  */
-  SVN_ERR(svn_wc__get_translate_info(&style, &eol,
-                                     &keywords,
-                                     &special, db, local_abspath,
+  SVN_ERR(svn_wc__get_translate_info(&style, &job->eol,
+                                     &job->keywords,
+                                     &job->special, db, job->local_abspath,
                                      props, FALSE,
-                                     scratch_pool, scratch_pool));
-  if (special)
+                                     result_pool, scratch_pool));
+
+  /* No need to set exec or read-only flags on special files.  */
+  if (job->special)
+    return SVN_NO_ERROR;
+
+  job->translate = svn_subst_translation_required(style, job->eol,
+                                                  job->keywords,
+                                                  FALSE /* special */,
+                                                  TRUE /* force_eol_check */);
+
+  /* Where is the Right Place to put a temp file in this working copy?  */
+  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&job->temp_dir_abspath,
+                                         db, wcroot_abspath,
+                                         result_pool, scratch_pool));
+
+#ifndef WIN32
+  job->executable = props && svn_hash_gets(props, SVN_PROP_EXECUTABLE);
+#endif
+
+  /* Note that this explicitly checks the pristine properties, to make sure
+     that when the lock is locally set (=modification) it is not read only */
+  if (props && svn_hash_gets(props, SVN_PROP_NEEDS_LOCK))
+    {
+      svn_wc__db_status_t status;
+      svn_wc__db_lock_t *lock;
+      SVN_ERR(svn_wc__db_read_info(&status, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, &lock, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL,
+                                   db, job->local_abspath,
+                                   scratch_pool, scratch_pool));
+
+      job->read_only = (!lock && status != svn_wc__db_status_added);
+    }
+
+  if (use_commit_times)
+    job->set_time = changed_date;
+
+  return SVN_NO_ERROR;
+}
+
+/* Install the file described by JOB, which has been filled in by
+ * prepare_file_install().  This does not access the wc.db and may
+ * therefore run on any thread.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+perform_file_install(install_job_t *job,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool)
+{
+  svn_stream_t *src_stream;
+  svn_stream_t *dst_stream;
+
+  SVN_ERR(svn_stream_open_readonly(&src_stream, job->source_abspath,
+                                   scratch_pool, scratch_pool));
+
+  if (job->special)
     {
       /* When this stream is closed, the resulting special file will
          atomically be created/moved into place at LOCAL_ABSPATH.  */
-      SVN_ERR(svn_subst_create_specialfile(&dst_stream, local_abspath,
+      SVN_ERR(svn_subst_create_specialfile(&dst_stream, job->local_abspath,
                                            scratch_pool, scratch_pool));
 
       /* Copy the "repository normal" form of the special file into the
@@ -545,33 +645,24 @@ run_file_install(work_item_baton_t *wqb,
                                cancel_func, cancel_baton,
                                scratch_pool));
 
-      /* No need to set exec or read-only flags on special files.  */
-
       /* ### Shouldn't this record a timestamp and size, etc.? */
       return SVN_NO_ERROR;
     }
 
-  if (svn_subst_translation_required(style, eol, keywords,
-                                     FALSE /* special */,
-                                     TRUE /* force_eol_check */))
+  if (job->translate)
     {
       /* Wrap it in a translating (expanding) stream.  */
-      src_stream = svn_subst_stream_translated(src_stream, eol,
+      src_stream = svn_subst_stream_translated(src_stream, job->eol,
                                                TRUE /* repair */,
-                                               keywords,
+                                               job->keywords,
                                                TRUE /* expand */,
                                                scratch_pool);
     }
 
-  /* Where is the Right Place to put a temp file in this working copy?  */
-  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&temp_dir_abspath,
-                                         db, wcroot_abspath,
-                                         scratch_pool, scratch_pool));
-
   /* Translate to a temporary file. We don't want the user seeing a partial
      file, nor let them muck with it while we translate. We may also need to
      get its TRANSLATED_SIZE before the user can monkey it.  */
-  SVN_ERR(svn_stream__create_for_install(&dst_stream, temp_dir_abspath,
+  SVN_ERR(svn_stream__create_for_install(&dst_stream, job->temp_dir_abspath,
                                          scratch_pool, scratch_pool));
 
   /* Copy from the source to the dest, translating as we go. This will also
@@ -584,49 +675,341 @@ run_file_install(work_item_baton_t *wqb,
   /* With a single db we might want to install files in a missing directory.
      Simply trying this scenario on error won't do any harm and at least
      one user reported this problem on IRC. */
-  SVN_ERR(svn_stream__install_stream(dst_stream, local_abspath,
+  SVN_ERR(svn_stream__install_stream(dst_stream, job->local_abspath,
                                      TRUE /* make_parents*/, scratch_pool));
 
   /* Tweak the on-disk file according to its properties.  */
-#ifndef WIN32
-  if (props && svn_hash_gets(props, SVN_PROP_EXECUTABLE))
-    SVN_ERR(svn_io_set_file_executable(local_abspath, TRUE, FALSE,
+  if (job->executable)
+    SVN_ERR(svn_io_set_file_executable(job->local_abspath, TRUE, FALSE,
                                        scratch_pool));
-#endif
 
-  /* Note that this explicitly checks the pristine properties, to make sure
-     that when the lock is locally set (=modification) it is not read only */
-  if (props && svn_hash_gets(props, SVN_PROP_NEEDS_LOCK))
+  if (job->read_only)
+    SVN_ERR(svn_io_set_file_read_only(job->local_abspath, FALSE,
+                                      scratch_pool));
+
+  if (job->set_time)
+    SVN_ERR(svn_io_set_file_affected_time(job->set_time,
+                                          job->local_abspath,
+                                          scratch_pool));
+
+  /* ### this should happen before we rename the file into place.  */
+  if (job->record_fileinfo)
     {
-      svn_wc__db_status_t status;
-      svn_wc__db_lock_t *lock;
-      SVN_ERR(svn_wc__db_read_info(&status, NULL, NULL, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, &lock, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, NULL, NULL, NULL, NULL,
-                                   db, local_abspath,
-                                   scratch_pool, scratch_pool));
+      const svn_io_dirent2_t *dirent;
 
-      if (!lock && status != svn_wc__db_status_added)
-        SVN_ERR(svn_io_set_file_read_only(local_abspath, FALSE, scratch_pool));
+      SVN_ERR(svn_io_stat_dirent2(&dirent, job->local_abspath, FALSE, FALSE,
+                                  scratch_pool, scratch_pool));
+      if (dirent->kind == svn_node_file)
+        {
+          job->fileinfo = *dirent;
+          job->have_fileinfo = TRUE;
+        }
     }
 
-  if (use_commit_times)
+  return SVN_NO_ERROR;
+}
+
+/* Remember the file info collected by the installation JOB in WQB, to be
+ * written to the wc.db when the work item gets marked as completed. */
+static void
+record_installed_fileinfo(work_item_baton_t *wqb,
+                          const install_job_t *job);
+
+/* Threads helping with file installations.  Only used with thread support. */
+typedef struct install_workers_t install_workers_t;
+
+#if APR_HAS_THREADS
+
+/* Jobs shared between all threads installing a batch of files. */
+typedef struct install_queue_t
+{
+  /* The jobs and their number.  Each job is accessed by only one thread
+   * until the batch has been completed. */
+  install_job_t *jobs;
+  int count;
+
+  /* Index of the next job to hand out.  May exceed COUNT. */
+  volatile svn_atomic_t next_job;
+} install_queue_t;
+
+/* Per worker thread data. */
+typedef struct install_worker_t
+{
+  install_workers_t *workers;
+
+  /* Root pool for all temporaries of this worker. */
+  apr_pool_t *pool;
+
+  apr_thread_t *thread;
+} install_worker_t;
+
+/* Threads helping with all file installation batches of a single work
+ * queue run.  They get started once and then wait for batches to be
+ * handed to them by run_install_jobs(). */
+struct install_workers_t
+{
+  /* Serializes access to the members below. */
+  apr_thread_mutex_t *mutex;
+
+  /* Signaled when a new batch is available or the workers shall exit. */
+  apr_thread_cond_t *work_available;
+
+  /* Signaled when the last busy worker is done with the current batch. */
+  apr_thread_cond_t *batch_done;
+
+  /* The batch being installed.  NULL between batches. */
+  install_queue_t *queue;
+
+  /* Incremented for each new batch, so that every worker joins each
+   * batch at most once. */
+  apr_uint64_t batch;
+
+  /* Number of workers running jobs from QUEUE. */
+  int busy;
+
+  /* Set when the workers shall exit. */
+  svn_boolean_t shutdown;
+
+  /* The threads and their number. */
+  install_worker_t *threads;
+  int count;
+};
+
+/* Run jobs from QUEUE until there are none left.  Jobs run by the
+ * thread that processes the work queue get CANCEL_FUNC and CANCEL_BATON,
+ * all other threads pass NULL.  If CANCEL_FUNC requests cancellation
+ * between jobs, stop handing out further jobs and return its error.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+run_queued_installs(install_queue_t *queue,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_error_t *err = SVN_NO_ERROR;
+
+  while (TRUE)
     {
-      if (changed_date)
-        SVN_ERR(svn_io_set_file_affected_time(changed_date,
-                                              local_abspath,
-                                              scratch_pool));
+      install_job_t *job;
+      int i;
+
+      if (cancel_func)
+        {
+          err = cancel_func(cancel_baton);
+          if (err)
+            {
+              svn_atomic_set(&queue->next_job, queue->count);
+              break;
+            }
+        }
+
+      i = (int)svn_atomic_inc(&queue->next_job);
+      if (i >= queue->count)
+        break;
+
+      svn_pool_clear(iterpool);
+      job = &queue->jobs[i];
+      job->err = perform_file_install(job, cancel_func, cancel_baton,
+                                      iterpool);
+      job->done = TRUE;
     }
 
-  /* ### this should happen before we rename the file into place.  */
-  if (record_fileinfo)
+  svn_pool_destroy(iterpool);
+  return err;
+}
+
+/* Thread function running jobs from each batch that the install_workers_t
+ * of the install_worker_t given as DATA hands out, until told to exit. */
+static void * APR_THREAD_FUNC
+install_worker_thread(apr_thread_t *thread,
+                      void *data)
+{
+  install_worker_t *worker = data;
+  install_workers_t *workers = worker->workers;
+  apr_uint64_t last_batch = 0;
+
+  apr_thread_mutex_lock(workers->mutex);
+  while (TRUE)
     {
-      SVN_ERR(get_and_record_fileinfo(wqb, local_abspath,
-                                      FALSE /* ignore_enoent */,
-                                      scratch_pool));
+      install_queue_t *queue;
+
+      while (!workers->shutdown && workers->batch == last_batch)
+        apr_thread_cond_wait(workers->work_available, workers->mutex);
+
+      if (workers->shutdown)
+        break;
+
+      /* The batch may have been completed without us already. */
+      last_batch = workers->batch;
+      queue = workers->queue;
+      if (queue == NULL)
+        continue;
+
+      ++workers->busy;
+      apr_thread_mutex_unlock(workers->mutex);
+
+      /* Without a cancel function, this can't fail. */
+      svn_error_clear(run_queued_installs(queue, NULL, NULL, worker->pool));
+      svn_pool_clear(worker->pool);
+
+      apr_thread_mutex_lock(workers->mutex);
+      if (--workers->busy == 0)
+        apr_thread_cond_signal(workers->batch_done);
+    }
+  apr_thread_mutex_unlock(workers->mutex);
+
+  /* Don't call apr_thread_exit() here.  It would destroy the thread's
+   * pool, which is a sub-pool of one owned by the work queue runner. */
+  return NULL;
+}
+
+/* Start up to COUNT threads that will help installing files and return
+ * them in *WORKERS_P.  If we fail to start some threads, the current one
+ * will simply do more of the work itself.  Allocate *WORKERS_P in
+ * RESULT_POOL.  Call stop_install_workers() before clearing that pool. */
+static svn_error_t *
+start_install_workers(install_workers_t **workers_p,
+                      int count,
+                      apr_pool_t *result_pool)
+{
+  install_workers_t *workers = apr_pcalloc(result_pool, sizeof(*workers));
+  apr_status_t status;
+
+  status = apr_thread_mutex_create(&workers->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                   result_pool);
+  if (!status)
+    status = apr_thread_cond_create(&workers->work_available, result_pool);
+  if (!status)
+    status = apr_thread_cond_create(&workers->batch_done, result_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create install threads"));
+
+  workers->threads = apr_pcalloc(result_pool,
+                                 count * sizeof(*workers->threads));
+  for (workers->count = 0; workers->count < count; ++workers->count)
+    {
+      install_worker_t *worker = &workers->threads[workers->count];
+
+      worker->workers = workers;
+      worker->pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+      if (apr_thread_create(&worker->thread, NULL, install_worker_thread,
+                            worker, result_pool))
+        {
+          svn_pool_destroy(worker->pool);
+          break;
+        }
     }
 
+  *workers_p = workers;
+  return SVN_NO_ERROR;
+}
+
+/* Make all threads in WORKERS exit and wait for them to do so. */
+static void
+stop_install_workers(install_workers_t *workers)
+{
+  int i;
+
+  apr_thread_mutex_lock(workers->mutex);
+  workers->shutdown = TRUE;
+  apr_thread_cond_broadcast(workers->work_available);
+  apr_thread_mutex_unlock(workers->mutex);
+
+  for (i = 0; i < workers->count; ++i)
+    {
+      apr_status_t retval;
+      apr_thread_join(&retval, workers->threads[i].thread);
+      svn_pool_destroy(workers->threads[i].pool);
+    }
+}
+
+/* Run all COUNT jobs in JOBS in the current thread and, if not NULL,
+ * the threads of WORKERS.  Only the current thread uses CANCEL_FUNC and
+ * CANCEL_BATON.  If it requests cancellation, return its error once all
+ * jobs already started have finished; the others won't be DONE.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_install_jobs(install_job_t *jobs,
+                 int count,
+                 install_workers_t *workers,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  install_queue_t *queue = apr_pcalloc(scratch_pool, sizeof(*queue));
+  svn_error_t *err;
+
+  queue->jobs = jobs;
+  queue->count = count;
+
+  if (workers && workers->count)
+    {
+      apr_thread_mutex_lock(workers->mutex);
+      workers->queue = queue;
+      ++workers->batch;
+      apr_thread_cond_broadcast(workers->work_available);
+      apr_thread_mutex_unlock(workers->mutex);
+    }
+
+  err = run_queued_installs(queue, cancel_func, cancel_baton, scratch_pool);
+
+  /* No job will be handed out anymore.  Wait for those still running. */
+  if (workers && workers->count)
+    {
+      apr_thread_mutex_lock(workers->mutex);
+      while (workers->busy)
+        apr_thread_cond_wait(workers->batch_done, workers->mutex);
+      workers->queue = NULL;
+      apr_thread_mutex_unlock(workers->mutex);
+    }
+
+  return err;
+}
+
+/* Add the paths that JOB writes or reads a private copy of to CLAIMED.
+ * Return FALSE and don't modify CLAIMED if any of them is in there already,
+ * i.e. if JOB can't be run in parallel with the jobs already claimed. */
+static svn_boolean_t
+claim_install_paths(apr_hash_t *claimed,
+                    const install_job_t *job)
+{
+  if (svn_hash_gets(claimed, job->local_abspath))
+    return FALSE;
+  if (!job->source_is_pristine && svn_hash_gets(claimed, job->source_abspath))
+    return FALSE;
+
+  svn_hash_sets(claimed, job->local_abspath, job);
+  if (!job->source_is_pristine)
+    svn_hash_sets(claimed, job->source_abspath, job);
+
+  return TRUE;
+}
+
+#endif /* APR_HAS_THREADS */
+
+/* Process the OP_FILE_INSTALL work item WORK_ITEM.
+ * See svn_wc__wq_build_file_install() which generates this work item.
+ * Implements (struct work_item_dispatch).func. */
+static svn_error_t *
+run_file_install(work_item_baton_t *wqb,
+                 svn_wc__db_t *db,
+                 const svn_skel_t *work_item,
+                 const char *wri_abspath,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  install_job_t job = { 0 };
+
+  SVN_ERR(prepare_file_install(&job, db, work_item, wri_abspath,
+                               scratch_pool, scratch_pool));
+  SVN_ERR(perform_file_install(&job, cancel_func, cancel_baton,
+                               scratch_pool));
+  record_installed_fileinfo(wqb, &job);
+
   return SVN_NO_ERROR;
 }
 
@@ -1417,6 +1800,150 @@ struct work_item_baton_t
 };
 
 
+/* Return ERR, the failure of work item WORK_ITEM with identifier ID in the
+   work queue of WRI_ABSPATH, wrapped in a SVN_ERR_WC_BAD_ADM_LOG error. */
+static svn_error_t *
+wrap_work_item_error(svn_error_t *err,
+                     const char *wri_abspath,
+                     apr_uint64_t id,
+                     const svn_skel_t *work_item,
+                     apr_pool_t *scratch_pool)
+{
+  const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
+
+  return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
+                           _("Failed to run the WC DB work queue "
+                             "associated with '%s', work item %d %s"),
+                           svn_dirent_local_style(wri_abspath,
+                                                  scratch_pool),
+                           (int)id, skel);
+}
+
+#if APR_HAS_THREADS
+/* Run the OP_FILE_INSTALL work item FIRST_ITEM with identifier FIRST_ID
+   and as many of the following items in the work queue of WRI_ABSPATH as
+   can be installed independently, with the help of WORKERS.
+
+   Only this thread accesses DB: all work items are prepared here before
+   the files get installed in parallel, and afterwards all successfully
+   installed items are marked as completed and their file info recorded
+   in a single transaction.  If any item failed, return the error of the
+   first one.  Items following the last one of the batch, as well as those
+   not started before cancellation, are left in the queue.
+
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_file_install_batch(svn_wc__db_t *db,
+                       const char *wri_abspath,
+                       apr_uint64_t first_id,
+                       const svn_skel_t *first_item,
+                       install_workers_t *workers,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_hash_t *claimed = apr_hash_make(scratch_pool);
+  apr_hash_t *record_map = NULL;
+  apr_array_header_t *ids;
+  apr_array_header_t *work_items;
+  apr_array_header_t *completed_ids;
+  install_job_t *jobs;
+  svn_error_t *err = SVN_NO_ERROR;
+  svn_error_t *cancel_err = SVN_NO_ERROR;
+  int count;
+  int i;
+
+  SVN_ERR(svn_wc__db_wq_fetch_following(&ids, &work_items, db, wri_abspath,
+                                        first_id, INSTALL_BATCH_SIZE - 1,
+                                        scratch_pool, scratch_pool));
+
+  jobs = apr_pcalloc(scratch_pool, (ids->nelts + 1) * sizeof(*jobs));
+  jobs[0].id = first_id;
+  err = prepare_file_install(&jobs[0], db, first_item, wri_abspath,
+                             scratch_pool, iterpool);
+  if (err)
+    return svn_error_trace(wrap_work_item_error(err, wri_abspath, first_id,
+                                                first_item, scratch_pool));
+  claim_install_paths(claimed, &jobs[0]);
+
+  /* Extend the batch for as long as the items are independent file
+     installations.  Items we can't prepare are left for the serial code,
+     which will report their failure in due order. */
+  for (count = 1; count <= ids->nelts; ++count)
+    {
+      install_job_t *job = &jobs[count];
+      const svn_skel_t *work_item = APR_ARRAY_IDX(work_items, count - 1,
+                                                  const svn_skel_t *);
+
+      if (! svn_skel__matches_atom(work_item->children, OP_FILE_INSTALL))
+        break;
+
+      svn_pool_clear(iterpool);
+      job->id = APR_ARRAY_IDX(ids, count - 1, apr_uint64_t);
+      err = prepare_file_install(job, db, work_item, wri_abspath,
+                                 scratch_pool, iterpool);
+      if (err)
+        {
+          svn_error_clear(err);
+          err = SVN_NO_ERROR;
+          break;
+        }
+
+      if (! claim_install_paths(claimed, job))
+        break;
+    }
+  svn_pool_destroy(iterpool);
+
+  if (count == 1)
+    {
+      jobs[0].err = perform_file_install(&jobs[0], cancel_func, cancel_baton,
+                                         scratch_pool);
+      jobs[0].done = TRUE;
+    }
+  else
+    cancel_err = run_install_jobs(jobs, count, workers,
+                                  cancel_func, cancel_baton, scratch_pool);
+
+  /* Collect the results. */
+  completed_ids = apr_array_make(scratch_pool, count, sizeof(apr_uint64_t));
+  for (i = 0; i < count; ++i)
+    {
+      install_job_t *job = &jobs[i];
+
+      if (job->err)
+        {
+          if (err)
+            svn_error_clear(job->err);
+          else
+            err = wrap_work_item_error(job->err, wri_abspath, job->id,
+                                       job->work_item, scratch_pool);
+        }
+      else if (job->done)
+        {
+          APR_ARRAY_PUSH(completed_ids, apr_uint64_t) = job->id;
+
+          if (job->have_fileinfo)
+            {
+              if (! record_map)
+                record_map = apr_hash_make(scratch_pool);
+
+              svn_hash_sets(record_map, job->local_abspath, &job->fileinfo);
+            }
+        }
+    }
+
+  if (completed_ids->nelts)
+    err = svn_error_compose_create(
+            err,
+            svn_wc__db_wq_record_and_complete(db, wri_abspath, completed_ids,
+                                              record_map, scratch_pool));
+
+  return svn_error_trace(svn_error_compose_create(err, cancel_err));
+}
+#endif /* APR_HAS_THREADS */
+
+
 static svn_error_t *
 dispatch_work_item(work_item_baton_t *wqb,
                    svn_wc__db_t *db,
@@ -1473,9 +2000,13 @@ dispatch_work_item(work_item_baton_t *wqb,
 }
 
 
-svn_error_t *
-svn_wc__wq_run(svn_wc__db_t *db,
+/* The body of svn_wc__wq_run().  If WORKERS is not NULL, install files
+   in batches with the help of those threads.  WORKERS is always NULL
+   without thread support. */
+static svn_error_t *
+run_work_queue(svn_wc__db_t *db,
                const char *wri_abspath,
+               install_workers_t *workers,
                svn_cancel_func_t cancel_func,
                void *cancel_baton,
                apr_pool_t *scratch_pool)
@@ -1542,19 +2073,28 @@ svn_wc__wq_run(svn_wc__db_t *db,
       if (work_item == NULL)
         break;
 
+#if APR_HAS_THREADS
+      /* Install this file together with the ones queued after it. */
+      if (workers
+          && svn_skel__matches_atom(work_item->children, OP_FILE_INSTALL))
+        {
+          SVN_ERR(run_file_install_batch(db, wri_abspath, id, work_item,
+                                         workers,
+                                         cancel_func, cancel_baton,
+                                         iterpool));
+
+          /* The batch has already been marked as completed. */
+          last_id = 0;
+          continue;
+        }
+#endif
+
       err = dispatch_work_item(&wib, db, wri_abspath, work_item,
                                cancel_func, cancel_baton, iterpool);
       if (err)
-        {
-          const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
-
-          return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
-                                   _("Failed to run the WC DB work queue "
-                                     "associated with '%s', work item %d %s"),
-                                   svn_dirent_local_style(wri_abspath,
-                                                          scratch_pool),
-                                   (int)id, skel);
-        }
+        return svn_error_trace(wrap_work_item_error(err, wri_abspath, id,
+                                                    work_item,
+                                                    scratch_pool));
 
       /* The work item finished without error. Mark it completed
          in the next loop.  */
@@ -1565,6 +2105,36 @@ svn_wc__wq_run(svn_wc__db_t *db,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc__wq_run(svn_wc__db_t *db,
+               const char *wri_abspath,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *scratch_pool)
+{
+  install_workers_t *workers = NULL;
+  svn_error_t *err;
+
+#if APR_HAS_THREADS
+  /* Start the threads once and let them help with every batch. */
+  int install_threads
+    = svn_wc__db_get_thread_count(db, SVN_CONFIG_OPTION_INSTALL_THREADS);
+  if (install_threads > 1)
+    SVN_ERR(start_install_workers(&workers, install_threads - 1,
+                                  scratch_pool));
+#endif
+
+  err = run_work_queue(db, wri_abspath, workers, cancel_func, cancel_baton,
+                       scratch_pool);
+
+#if APR_HAS_THREADS
+  if (workers)
+    stop_install_workers(workers);
+#endif
+
+  return svn_error_trace(err);
+}
+
 
 svn_skel_t *
 svn_wc__wq_merge(svn_skel_t *work_item1,
@@ -1614,6 +2184,23 @@ svn_wc__wq_merge(svn_skel_t *work_item1,
 }
 
 
+static void
+record_installed_fileinfo(work_item_baton_t *wqb,
+                          const install_job_t *job)
+{
+  if (! job->have_fileinfo)
+    return;
+
+  wqb->used = TRUE;
+
+  if (! wqb->record_map)
+    wqb->record_map = apr_hash_make(wqb->result_pool);
+
+  svn_hash_sets(wqb->record_map,
+                apr_pstrdup(wqb->result_pool, job->local_abspath),
+                svn_io_dirent2_dup(&job->fileinfo, wqb->result_pool));
+}
+
 static svn_error_t *
 get_and_record_fileinfo(work_item_baton_t *wqb,
                         const char *local_abspath,
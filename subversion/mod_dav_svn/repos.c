@@ -1730,6 +1730,7 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
      necessary ones in this file. */
   int i;
   const apr_array_header_t *encoding_prefs;
+  svn_boolean_t compress = dav_svn__get_compression_level(r) > 0;
   encoding_prefs = do_header_line(r->pool,
                                   apr_table_get(r->headers_in,
                                                 "Accept-Encoding"));
@@ -1747,7 +1748,19 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
     {
       struct accept_rec rec = APR_ARRAY_IDX(encoding_prefs, i,
                                             struct accept_rec);
-      if (strcmp(rec.name, "svndiff1") == 0)
+      /* The compressing formats are only worth offering if we are
+         configured to compress at all. */
+      if (!compress
+          && (   strcmp(rec.name, "svndiff2") == 0
+              || strcmp(rec.name, "svndiff1") == 0))
+        continue;
+
+      if (strcmp(rec.name, "svndiff2") == 0)
+        {
+          *svndiff_version = 2;
+          break;
+        }
+      else if (strcmp(rec.name, "svndiff1") == 0)
         {
           *svndiff_version = 1;
           break;
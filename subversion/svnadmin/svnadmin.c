@@ -214,7 +214,8 @@ enum svnadmin__cmdline_options_t
     svnadmin__pre_1_6_compatible,
     svnadmin__compatible_version,
     svnadmin__check_normalization,
-    svnadmin__metadata_only
+    svnadmin__metadata_only,
+    svnadmin__jobs
   };
 
 /* Option codes and descriptions.
@@ -333,6 +334,10 @@ static const apr_getopt_option_t options_table[] =
         "                             checking against external corruption in\n"
         "                             Subversion 1.9+ format repositories.\n")},
 
+    {"jobs",          svnadmin__jobs, 1,
+     N_("number of revisions to process in parallel\n"
+        "                             (default: 1)")},
+
     {NULL}
   };
 
@@ -542,7 +547,8 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
    ("usage: svnadmin verify REPOS_PATH\n\n"
     "Verify the data stored in the repository.\n"),
    {'t', 'r', 'q', svnadmin__keep_going, 'M',
-    svnadmin__check_normalization, svnadmin__metadata_only} },
+    svnadmin__check_normalization, svnadmin__metadata_only,
+    svnadmin__jobs} },
 
   { NULL, NULL, {0}, NULL, {0} }
 };
@@ -578,6 +584,7 @@ struct svnadmin_opt_state
   enum svn_repos_load_uuid uuid_action;             /* --ignore-uuid,
                                                        --force-uuid */
   apr_uint64_t memory_cache_size;                   /* --memory-cache-size M */
+  int jobs;                                         /* --jobs */
   const char *parent_dir;                           /* --parent-dir */
   svn_stringbuf_t *filedata;                        /* --file */
 
@@ -1840,10 +1847,11 @@ subcommand_verify(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 
   notify_baton.result_pool = pool;
 
-  verify_err = svn_repos_verify_fs3(repos, lower, upper,
+  verify_err = svn_repos_verify_fs4(repos, lower, upper,
                                     opt_state->keep_going,
                                     opt_state->check_normalization,
                                     opt_state->metadata_only,
+                                    opt_state->jobs,
                                     !opt_state->quiet
                                     ? repos_notify_handler : NULL,
                                     &notify_baton, check_cancel,
@@ -2444,6 +2452,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
   opt_state.memory_cache_size = svn_cache_config_get()->cache_size;
+  opt_state.jobs = 1;
 
   /* Parse options. */
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
@@ -2586,6 +2595,14 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       case svnadmin__metadata_only:
         opt_state.metadata_only = TRUE;
         break;
+      case svnadmin__jobs:
+        {
+          apr_int64_t jobs;
+
+          SVN_ERR(svn_cstring_strtoi64(&jobs, opt_arg, 1, 256, 10));
+          opt_state.jobs = (int)jobs;
+        }
+        break;
       case svnadmin__fs_type:
         SVN_ERR(svn_utf_cstring_to_utf8(&opt_state.fs_type, opt_arg, pool));
         break;
@@ -2773,7 +2790,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_t settings = *svn_cache_config_get();
 
     settings.cache_size = opt_state.memory_cache_size;
-    settings.single_threaded = TRUE;
+    /* Parallel verification and, depending on the repository
+     * configuration, packing require thread-safe caches. */
+    settings.single_threaded = opt_state.jobs <= 1
+                            && subcommand->cmd_func != subcommand_pack;
 
     svn_cache_config_set(&settings);
   }
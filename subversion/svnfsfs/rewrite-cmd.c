@@ -0,0 +1,145 @@
+/* rewrite-cmd.c -- implements the rewrite sub-command.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_dirent_uri.h"
+#include "svn_fs.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_repos.h"
+#include "svn_sorts.h"
+
+#include "svn_private_config.h"
+#include "svnfsfs.h"
+
+/* Number of revisions to copy through a single temporary dump file.
+ * Limits the temporary disk space needed while keeping the per-chunk
+ * overhead small.
+ */
+#define REVISIONS_PER_CHUNK 100
+
+/* Implements svn_repos_notify_func_t.  Print the number of each revision
+ * that has been written to the new repository.
+ */
+static void
+print_progress(void *baton,
+               const svn_repos_notify_t *notify,
+               apr_pool_t *scratch_pool)
+{
+  if (notify->action == svn_repos_notify_load_txn_committed)
+    {
+      printf(_("Rewrote revision %ld.\n"), notify->new_revision);
+      fflush(stdout);
+    }
+}
+
+/* Copy all revisions of the FSFS repository at PATH into a new repository
+ * at NEW_PATH.  The data gets re-deltified according to the default
+ * settings of the new repository, which bounds the length of all delta
+ * chains.  If QUIET is not set, report progress on stdout.  Use POOL for
+ * allocations.
+ */
+static svn_error_t *
+rewrite(const char *path,
+        const char *new_path,
+        svn_boolean_t quiet,
+        apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_repos_t *repos;
+  svn_repos_t *new_repos;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  svn_revnum_t youngest;
+  svn_revnum_t start;
+  const char *uuid;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Check repository type and open it. */
+  SVN_ERR(open_fs(&fs, path, pool));
+  SVN_ERR(svn_repos_open3(&repos, path, NULL, pool, pool));
+  fs = svn_repos_fs(repos);
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+  SVN_ERR(svn_fs_get_uuid(fs, &uuid, pool));
+
+  /* The target must be a new FSFS repository in the latest format,
+   * which comes with skip-delta friendly [deltification] defaults. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FS_TYPE, SVN_FS_TYPE_FSFS);
+  SVN_ERR(svn_repos_create(&new_repos, new_path, NULL, NULL, NULL,
+                           fs_config, pool));
+  SVN_ERR(svn_fs_set_uuid(svn_repos_fs(new_repos), uuid, pool));
+
+  /* Dump / load the history in chunks.  The first chunk includes r0
+   * and is a full dump.  All others are incremental. */
+  for (start = 0; start <= youngest; start += REVISIONS_PER_CHUNK)
+    {
+      svn_revnum_t end = MIN(start + REVISIONS_PER_CHUNK - 1, youngest);
+      svn_stream_t *stream;
+      const char *dump_path;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_stream_open_unique(&stream, &dump_path, new_path,
+                                     svn_io_file_del_on_pool_cleanup,
+                                     iterpool, iterpool));
+      SVN_ERR(svn_repos_dump_fs3(repos, stream, start, end, start > 0,
+                                 FALSE, NULL, NULL, check_cancel, NULL,
+                                 iterpool));
+      SVN_ERR(svn_stream_close(stream));
+
+      SVN_ERR(svn_stream_open_readonly(&stream, dump_path,
+                                       iterpool, iterpool));
+      SVN_ERR(svn_repos_load_fs5(new_repos, stream,
+                                 SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
+                                 svn_repos_load_uuid_ignore, NULL,
+                                 FALSE, FALSE, FALSE, FALSE,
+                                 quiet ? NULL : print_progress, NULL,
+                                 check_cancel, NULL, iterpool));
+      SVN_ERR(svn_stream_close(stream));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* This implements `svn_opt_subcommand_t'. */
+svn_error_t *
+subcommand__rewrite(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  svnfsfs__opt_state *opt_state = baton;
+  apr_array_header_t *args;
+  const char *new_path;
+
+  SVN_ERR(svn_opt_parse_all_args(&args, os, pool));
+  if (args->nelts != 1)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Exactly one target repository path "
+                              "required"));
+
+  new_path = svn_dirent_internal_style(APR_ARRAY_IDX(args, 0, const char *),
+                                       pool);
+  SVN_ERR(rewrite(opt_state->repository_path, new_path, opt_state->quiet,
+                  pool));
+
+  return SVN_NO_ERROR;
+}
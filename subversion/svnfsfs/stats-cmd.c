@@ -125,6 +125,65 @@ print_histogram(svn_fs_fs__histogram_t *histogram,
            (int)(histogram->lines[i].count * 100 / histogram->total.count));
 }
 
+/* Print the non-zero section of the delta chain length HISTOGRAM to
+ * console.  Use POOL for allocations.
+ */
+static void
+print_chain_histogram(svn_fs_fs__histogram_t *histogram,
+                      apr_pool_t *pool)
+{
+  int first = 0;
+  int last = 63;
+  int i;
+
+  /* identify non-zero range */
+  while (last > 0 && histogram->lines[last].count == 0)
+    --last;
+
+  while (first <= last && histogram->lines[first].count == 0)
+    ++first;
+
+  /* display histogram lines */
+  for (i = last; i >= first; --i)
+    printf(_("  %4s .. < %-4s %12s (%2d%%) representations\n"),
+           print_two_power(i-1, pool), print_two_power(i, pool),
+           svn__ui64toa_sep(histogram->lines[i].count, ',', pool),
+           (int)(histogram->lines[i].count * 100 / histogram->total.count));
+}
+
+/* Print the delta chain statistics in STATS.  Use POOL for allocations.
+ */
+static void
+print_chain_stats(svn_fs_fs__stats_t *stats,
+                  apr_pool_t *pool)
+{
+  int i;
+  apr_uint64_t average = stats->chain_length_histogram.total.count
+                       ? stats->chain_length_histogram.total.sum
+                         / stats->chain_length_histogram.total.count
+                       : 0;
+
+  printf(_("%20s representations\n"
+           "%20s average delta chain length\n"),
+         svn__ui64toa_sep(stats->chain_length_histogram.total.count, ',',
+                          pool),
+         svn__ui64toa_sep(average, ',', pool));
+
+  printf("\nLongest delta chains:\n");
+  for (i = 0; i < stats->longest_chains->nelts; ++i)
+    {
+      svn_fs_fs__chain_info_t *info
+        = APR_ARRAY_IDX(stats->longest_chains, i, svn_fs_fs__chain_info_t *);
+      printf(_("%12s r%-8ld item %s\n"),
+             svn__ui64toa_sep(info->length, ',', pool),
+             info->revision,
+             svn__ui64toa_sep(info->item_index, ',', pool));
+    }
+
+  printf("\nHistogram of delta chain lengths:\n");
+  print_chain_histogram(&stats->chain_length_histogram, pool);
+}
+
 /* COMPARISON_FUNC for svn_sort__hash.
  * Sort extension_info_t values by total count in descending order.
  */
@@ -413,6 +472,9 @@ print_stats(svn_fs_fs__stats_t *stats,
   printf("\nFile property representation statistics:\n");
   print_rep_stats(&stats->file_prop_rep_stats, pool);
 
+  printf("\nDelta chain statistics:\n");
+  print_chain_stats(stats, pool);
+
   printf("\nLargest representations:\n");
   print_largest_reps(stats->largest_changes, pool);
   printf("\nExtensions by number of representations:\n");
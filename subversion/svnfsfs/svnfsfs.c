@@ -192,9 +192,20 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
     "number is automatically extracted from input stream.  No ordering is required.\n"),
    {'M'} },
 
+  {"rewrite", subcommand__rewrite, {0}, N_
+   ("usage: svnfsfs rewrite REPOS_PATH NEW_REPOS_PATH\n\n"
+    "Copy all revisions of the repository at REPOS_PATH into a new repository\n"
+    "at NEW_REPOS_PATH, which must not exist yet.  All data gets re-deltified\n"
+    "with the default settings of the latest FSFS format, which bounds the\n"
+    "delta chain lengths reported by 'svnfsfs stats'.  Revision numbers,\n"
+    "revision properties and the repository UUID are preserved.  Hook scripts,\n"
+    "configuration files and locks are not copied.  Make sure that nobody\n"
+    "commits to REPOS_PATH while this command is running.\n"),
+   {'q', 'M'} },
+
   {"stats", subcommand__stats, {0}, N_
    ("usage: svnfsfs stats REPOS_PATH\n\n"
-    "Write object size statistics to console.\n"),
+    "Write object size and delta chain statistics to console.\n"),
    {'M'} },
 
   { NULL, NULL, {0}, NULL, {0} }
@@ -33,9 +33,16 @@
 #include <apr_lib.h>
 #include <apr_strings.h>
 
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#endif
+
 #include "svn_compat.h"
 #include "svn_private_config.h"  /* For SVN_PATH_LOCAL_SEPARATOR */
 #include "svn_hash.h"
+#include "svn_io.h"
 #include "svn_types.h"
 #include "svn_string.h"
 #include "svn_pools.h"
@@ -55,6 +62,7 @@
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_ra_svn_private.h"
 #include "private/svn_fspath.h"
+#include "private/svn_fs_private.h"
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>   /* For getpid() */
@@ -62,6 +70,7 @@
 
 #include "server.h"
 #include "logger.h"
+#include "stats.h"
 
 typedef struct commit_callback_baton_t {
   apr_pool_t *pool;
@@ -81,6 +90,11 @@ typedef struct report_driver_baton_t {
   svn_boolean_t only_empty_entries;
   /* for diff() logging */
   svn_revnum_t *from_rev;
+  /* set if the client reported switched paths */
+  svn_boolean_t has_links;
+  /* revision root used by report_file_storage(), opened on demand */
+  svn_fs_root_t *target_root;
+  apr_pool_t *pool;
 } report_driver_baton_t;
 
 typedef struct log_baton_t {
@@ -568,6 +582,9 @@ static svn_error_t *send_mechs(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
     SVN_ERR(svn_ra_svn__write_word(conn, pool, "EXTERNAL"));
   if (b->repository->pwdb && b->repository->auth_access >= required)
     SVN_ERR(svn_ra_svn__write_word(conn, pool, "CRAM-MD5"));
+  if (b->ticket_secret && b->repository->pwdb
+      && b->repository->auth_access >= required)
+    SVN_ERR(svn_ra_svn__write_word(conn, pool, "TICKET"));
   return SVN_NO_ERROR;
 }
 
@@ -643,6 +660,7 @@ static svn_error_t *auth(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
         return svn_ra_svn__write_tuple(conn, pool, "w(c)", "failure",
                                        "Requested username does not match");
       b->client_info->user = b->client_info->tunnel_user;
+      b->client_info->password_auth = FALSE;
       SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w()", "success"));
       *success = TRUE;
       return SVN_NO_ERROR;
@@ -662,6 +680,28 @@ static svn_error_t *auth(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
       SVN_ERR(svn_ra_svn_cram_server(conn, pool, b->repository->pwdb,
                                      &user, success));
       b->client_info->user = apr_pstrdup(b->pool, user);
+      b->client_info->password_auth = *success;
+      return SVN_NO_ERROR;
+    }
+
+  /* Session tickets are only issued after password authentication and
+   * become invalid as soon as the user's password changes. */
+  if (b->repository->auth_access >= required
+      && b->repository->pwdb && b->ticket_secret
+      && strcmp(mech, "TICKET") == 0)
+    {
+      SVN_ERR(svn_ra_svn__session_ticket_server(conn, pool,
+                                                mecharg ? mecharg : "",
+                                                b->ticket_secret,
+                                                b->repository->realm,
+                                                b->repository->pwdb,
+                                                apr_time_now(),
+                                                &user, success));
+      if (*success)
+        {
+          b->client_info->user = apr_pstrdup(b->pool, user);
+          b->client_info->password_auth = FALSE;
+        }
       return SVN_NO_ERROR;
     }
 
@@ -897,6 +937,7 @@ static svn_error_t *link_path(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
     b->err = svn_repos_link_path3(b->report_baton, path, fs_path, rev,
                                   depth, start_empty, lock_token, pool);
   b->entry_counter++;
+  b->has_links = TRUE;
   return SVN_NO_ERROR;
 }
 
@@ -931,6 +972,42 @@ static const svn_ra_svn_cmd_entry_t report_commands[] = {
   { NULL }
 };
 
+/* Implements svn_ra_svn__file_storage_func_t for accept_report().
+ * BATON is the report_driver_baton_t. */
+static svn_error_t *
+report_file_storage(apr_file_t **file,
+                    apr_off_t *offset,
+                    svn_filesize_t *length,
+                    int *svndiff_version,
+                    void *baton,
+                    const char *path,
+                    svn_revnum_t revision,
+                    apr_pool_t *pool)
+{
+  report_driver_baton_t *b = baton;
+
+  /* Edit paths only map directly onto repository paths below our anchor
+   * as long as no part of the working copy has been switched. */
+  if (b->has_links)
+    {
+      *file = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  if (   b->target_root == NULL
+      || svn_fs_revision_root_revision(b->target_root) != revision)
+    SVN_ERR(svn_fs_revision_root(&b->target_root, b->sb->repository->fs,
+                                 revision, b->pool));
+
+  return svn_error_trace(
+           svn_fs__get_file_storage(file, offset, length, svndiff_version,
+                                    b->target_root,
+                                    svn_fspath__join(
+                                      b->sb->repository->fs_path->data,
+                                      path, pool),
+                                    pool, pool));
+}
+
 /* Accept a report from the client, drive the network editor with the
  * result, and then write an empty command response.  If there is a
  * non-protocol failure, accept_report will abort the edit and return
@@ -963,9 +1040,18 @@ static svn_error_t *accept_report(svn_boolean_t *only_empty_entry,
   ab.server = b;
   ab.conn = conn;
 
+  rb.sb = b;
+  rb.has_links = FALSE;
+  rb.target_root = NULL;
+  rb.pool = pool;
+
   /* Make an svn_repos report baton.  Tell it to drive the network editor
-   * when the report is complete. */
-  svn_ra_svn_get_editor(&editor, &edit_baton, conn, pool, NULL, NULL);
+   * when the report is complete.  When updating, file contents that are
+   * new to the client may be sent straight from the repository files. */
+  svn_ra_svn__get_editor(&editor, &edit_baton, conn, pool, NULL, NULL,
+                         text_deltas && !tgt_path ? report_file_storage
+                                                  : NULL,
+                         &rb);
   SVN_CMD_ERR(svn_repos_begin_report3(&report_baton, rev,
                                       b->repository->repos,
                                       b->repository->fs_path->data, target,
@@ -976,7 +1062,6 @@ static svn_error_t *accept_report(svn_boolean_t *only_empty_entry,
                                       &ab, svn_ra_svn_zero_copy_limit(conn),
                                       pool));
 
-  rb.sb = b;
   rb.repos_url = svn_path_uri_decode(b->repository->repos_url, pool);
   rb.report_baton = report_baton;
   rb.err = NULL;
@@ -2628,15 +2713,9 @@ static svn_error_t *file_rev_handler(void *baton, const char *path,
       svn_stream_set_write(stream, svndiff_handler);
       svn_stream_set_close(stream, svndiff_close_handler);
 
-      /* If the connection does not support SVNDIFF1 or if we don't want to use
-       * compression, use the non-compressing "version 0" implementation */
-      if (   svn_ra_svn_compression_level(frb->conn) > 0
-          && svn_ra_svn_has_capability(frb->conn, SVN_RA_SVN_CAP_SVNDIFF1))
-        svn_txdelta_to_svndiff3(d_handler, d_baton, stream, 1,
-                                svn_ra_svn_compression_level(frb->conn), pool);
-      else
-        svn_txdelta_to_svndiff3(d_handler, d_baton, stream, 0,
-                                svn_ra_svn_compression_level(frb->conn), pool);
+      svn_txdelta_to_svndiff3(d_handler, d_baton, stream,
+                              svn_ra_svn__svndiff_version(frb->conn),
+                              svn_ra_svn_compression_level(frb->conn), pool);
     }
   else
     SVN_ERR(svn_ra_svn__write_cstring(frb->conn, pool, ""));
@@ -2697,6 +2776,158 @@ static svn_error_t *get_file_revs(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
+/* Send the file entry for FULL_PATH in ROOT to the client, i.e. PATH,
+   REV, the file's properties and checksum, followed by its contents as
+   svndiff against the empty stream.  Use the connection and pool in FRB
+   and the authz info in AB.
+
+   If reading the contents fails, the svndiff data remains unterminated.
+   The client will detect that when it receives the final "done". */
+static svn_error_t *send_file(file_revs_baton_t *frb,
+                              authz_baton_t *ab,
+                              svn_fs_root_t *root,
+                              const char *path,
+                              const char *full_path,
+                              svn_revnum_t rev)
+{
+  apr_pool_t *pool = frb->pool;
+  svn_checksum_t *checksum;
+  apr_hash_t *props;
+  svn_stream_t *contents, *stream;
+  svn_txdelta_window_handler_t d_handler;
+  void *d_baton;
+
+  SVN_ERR(svn_fs_file_checksum(&checksum, svn_checksum_md5, root,
+                               full_path, TRUE, pool));
+  SVN_ERR(get_props(&props, NULL, ab, root, full_path, pool));
+  SVN_ERR(svn_fs_file_contents(&contents, root, full_path, pool));
+
+  SVN_ERR(svn_ra_svn__write_tuple(frb->conn, pool, "cr(!", path, rev));
+  SVN_ERR(svn_ra_svn__write_proplist(frb->conn, pool, props));
+  SVN_ERR(svn_ra_svn__write_tuple(frb->conn, pool, "!)c",
+                                  svn_checksum_to_cstring_display(checksum,
+                                                                  pool)));
+
+  /* The contents are a self-contained delta such that the svndiff
+     compression applies.  Closing the delta writes the terminator. */
+  stream = svn_stream_create(frb, pool);
+  svn_stream_set_write(stream, svndiff_handler);
+  svn_stream_set_close(stream, svndiff_close_handler);
+  svn_txdelta_to_svndiff3(&d_handler, &d_baton, stream,
+                          svn_ra_svn__svndiff_version(frb->conn),
+                          svn_ra_svn_compression_level(frb->conn), pool);
+
+  return svn_error_trace(svn_txdelta_send_stream(contents, d_handler,
+                                                 d_baton, NULL, pool));
+}
+
+static svn_error_t *get_files(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
+                              apr_array_header_t *params, void *baton)
+{
+  server_baton_t *b = baton;
+  apr_array_header_t *path_revs;
+  apr_array_header_t *paths, *full_paths, *revs;
+  svn_revnum_t youngest = SVN_INVALID_REVNUM;
+  svn_fs_root_t *root = NULL;
+  apr_pool_t *iterpool;
+  svn_error_t *err = SVN_NO_ERROR, *write_err;
+  file_revs_baton_t frb;
+  authz_baton_t ab;
+  int i;
+
+  ab.server = b;
+  ab.conn = conn;
+
+  SVN_ERR(svn_ra_svn__parse_tuple(params, pool, "l", &path_revs));
+
+  /* We can only send a single auth reply per request.  So, check the
+     blanket access here and the individual paths below. */
+  SVN_ERR(must_have_access(conn, pool, b, svn_authz_read, NULL, FALSE));
+
+  /* Parse and check all requests before sending any file. */
+  paths = apr_array_make(pool, path_revs->nelts, sizeof(const char *));
+  full_paths = apr_array_make(pool, path_revs->nelts, sizeof(const char *));
+  revs = apr_array_make(pool, path_revs->nelts, sizeof(svn_revnum_t));
+  iterpool = svn_pool_create(pool);
+
+  for (i = 0; i < path_revs->nelts; ++i)
+    {
+      const char *path, *full_path;
+      svn_revnum_t rev;
+      svn_ra_svn_item_t *item = &APR_ARRAY_IDX(path_revs, i,
+                                               svn_ra_svn_item_t);
+
+      svn_pool_clear(iterpool);
+
+      if (item->kind != SVN_RA_SVN_LIST)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                "File requests should be list of lists");
+
+      SVN_ERR(svn_ra_svn__parse_tuple(item->u.list, pool, "c(?r)", &path,
+                                      &rev));
+
+      full_path = svn_fspath__join(b->repository->fs_path->data,
+                                   svn_relpath_canonicalize(path, iterpool),
+                                   pool);
+      if (! lookup_access(iterpool, b, svn_authz_read, full_path, FALSE))
+        return svn_error_create(SVN_ERR_RA_SVN_CMD_ERR,
+                                error_create_and_log(SVN_ERR_RA_NOT_AUTHORIZED,
+                                                     NULL, NULL, b),
+                                NULL);
+
+      if (!SVN_IS_VALID_REVNUM(rev))
+        {
+          if (!SVN_IS_VALID_REVNUM(youngest))
+            SVN_CMD_ERR(svn_fs_youngest_rev(&youngest, b->repository->fs,
+                                            pool));
+          rev = youngest;
+        }
+
+      APR_ARRAY_PUSH(paths, const char *) = path;
+      APR_ARRAY_PUSH(full_paths, const char *) = full_path;
+      APR_ARRAY_PUSH(revs, svn_revnum_t) = rev;
+    }
+
+  SVN_ERR(log_command(b, conn, pool, "%s",
+                      svn_log__get_files(full_paths, pool)));
+
+  /* Send the files in the order they were requested.  Requests tend to
+     be sorted by revision, so we reuse the revision root if possible. */
+  frb.conn = conn;
+  for (i = 0; i < paths->nelts && !err; ++i)
+    {
+      svn_revnum_t rev = APR_ARRAY_IDX(revs, i, svn_revnum_t);
+
+      svn_pool_clear(iterpool);
+      frb.pool = iterpool;
+
+      if (!root || svn_fs_revision_root_revision(root) != rev)
+        {
+          if (root)
+            svn_fs_close_root(root);
+
+          err = svn_fs_revision_root(&root, b->repository->fs, rev, pool);
+          if (err)
+            break;
+        }
+
+      err = send_file(&frb, &ab, root, APR_ARRAY_IDX(paths, i, const char *),
+                      APR_ARRAY_IDX(full_paths, i, const char *), rev);
+    }
+  svn_pool_destroy(iterpool);
+
+  write_err = svn_ra_svn__write_word(conn, pool, "done");
+  if (write_err)
+    {
+      svn_error_clear(err);
+      return write_err;
+    }
+  SVN_CMD_ERR(err);
+  SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *lock(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                          apr_array_header_t *params, void *baton)
 {
@@ -3233,6 +3464,410 @@ static svn_error_t *replay(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_THREADS
+
+/* Number of revisions per worker that may be replayed ahead of the one
+ * currently being sent to the client. */
+#define REPLAY_REVS_PER_JOB 2
+
+/* Amount of replay data per revision to keep in memory before spilling
+ * the remainder to a temporary file. */
+#define REPLAY_SPILL_MEMORY (4 * 1024 * 1024)
+
+/* A single revision replayed by a worker thread. */
+typedef struct replay_result_t
+{
+  /* Set once the worker is done with this revision. */
+  svn_boolean_t done;
+
+  /* Error that shall be reported to the client as command failure after
+   * sending the contents of BUFFER. */
+  svn_error_t *err;
+
+  /* Error that prevented the worker from recording what shall be sent.
+   * The sequential code would have failed to write to the connection,
+   * so this terminates the connection. */
+  svn_error_t *fatal_err;
+
+  /* If set, the editor drive failed and the client needs to see an
+   * abort-edit after the contents of BUFFER. */
+  svn_boolean_t abort_edit;
+
+  /* Everything the worker would have sent for this revision.  NULL if
+   * the worker did not get that far. */
+  svn_spillbuf_t *buffer;
+
+  /* Root pool containing BUFFER.  NULL if not in use. */
+  apr_pool_t *pool;
+} replay_result_t;
+
+/* State shared between the worker threads and the sending thread. */
+typedef struct replay_queue_t
+{
+  /* Serializes access to all members that are not read-only. */
+  apr_thread_mutex_t *mutex;
+
+  /* Broadcast whenever a result became available, a result has been
+   * sent or the workers shall stop. */
+  apr_thread_cond_t *changed;
+
+  /* Next revision to hand out to a worker. */
+  svn_revnum_t next_rev;
+
+  /* Oldest revision that has not been sent, yet. */
+  svn_revnum_t next_to_send;
+
+  /* If set, workers won't start replaying further revisions. */
+  svn_boolean_t stop;
+
+  /* Ring buffer of WINDOW_SIZE results, indexed by revision. */
+  replay_result_t *results;
+  int window_size;
+
+  /* Replay parameters.  These are read-only. */
+  svn_ra_svn_conn_t *conn;
+  const char *fs_path;
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+  svn_revnum_t low_water_mark;
+  svn_boolean_t send_deltas;
+} replay_queue_t;
+
+/* Per worker thread data. */
+typedef struct replay_worker_t
+{
+  /* Work queue shared with all other workers. */
+  replay_queue_t *queue;
+
+  /* The worker's private file system instance. */
+  svn_fs_t *fs;
+
+  /* Pool to use for FS and all temporaries. */
+  apr_pool_t *pool;
+
+  /* The thread executing this worker. */
+  apr_thread_t *thread;
+} replay_worker_t;
+
+/* Return the result slot for REV in QUEUE. */
+static replay_result_t *
+get_replay_result(replay_queue_t *queue,
+                  svn_revnum_t rev)
+{
+  return &queue->results[(rev - queue->start_rev) % queue->window_size];
+}
+
+/* Release all resources held by RESULT and mark it as unused. */
+static void
+reset_replay_result(replay_result_t *result)
+{
+  if (result->pool)
+    svn_pool_destroy(result->pool);
+
+  svn_error_clear(result->err);
+  svn_error_clear(result->fatal_err);
+
+  result->done = FALSE;
+  result->err = SVN_NO_ERROR;
+  result->fatal_err = SVN_NO_ERROR;
+  result->abort_edit = FALSE;
+  result->buffer = NULL;
+  result->pool = NULL;
+}
+
+/* Write into RESULT everything that replay_range() sends for revision
+ * REV, using the file system of WORKER.  Record command failures in
+ * RESULT and return errors that the sequential code would have treated
+ * as connection failures.  Path-based authz is not supported here.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+prefetch_one_revision(replay_result_t *result,
+                      replay_worker_t *worker,
+                      svn_revnum_t rev,
+                      apr_pool_t *scratch_pool)
+{
+  replay_queue_t *queue = worker->queue;
+  svn_ra_svn_conn_t *conn;
+  const svn_delta_editor_t *editor;
+  void *edit_baton;
+  svn_fs_root_t *root;
+  apr_hash_t *props;
+  svn_error_t *err;
+
+  result->pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  result->buffer = svn_spillbuf__create(SVN__STREAM_CHUNK_SIZE,
+                                        REPLAY_SPILL_MEMORY, result->pool);
+  conn = svn_ra_svn__create_spill_conn(queue->conn, result->buffer,
+                                       result->pool);
+
+  /* Like replay_range(), report a failure to read the revprops as a
+   * command failure before anything got sent for REV. */
+  result->err = svn_fs_revision_proplist(&props, worker->fs, rev,
+                                         scratch_pool);
+  if (result->err)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "w(!", "revprops"));
+  SVN_ERR(svn_ra_svn__write_proplist(conn, scratch_pool, props));
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "!)"));
+
+  svn_ra_svn_get_editor(&editor, &edit_baton, conn, scratch_pool, NULL, NULL);
+
+  err = svn_fs_revision_root(&root, worker->fs, rev, scratch_pool);
+  if (! err)
+    err = svn_repos_replay2(root, queue->fs_path, queue->low_water_mark,
+                            queue->send_deltas, editor, edit_baton,
+                            NULL, NULL, scratch_pool);
+
+  /* Aborting the edit requires a response from the client, so leave
+   * that to the sending thread. */
+  if (err)
+    {
+      result->err = err;
+      result->abort_edit = TRUE;
+    }
+  else
+    {
+      SVN_ERR(svn_ra_svn__write_cmd_finish_replay(conn, scratch_pool));
+    }
+
+  return svn_error_trace(svn_ra_svn__flush(conn, scratch_pool));
+}
+
+/* Thread function replaying revisions from the replay_queue_t of the
+ * replay_worker_t given as DATA until all revisions have been handed out
+ * or we are asked to stop.
+ */
+static void * APR_THREAD_FUNC
+replay_worker_thread(apr_thread_t *thread,
+                     void *data)
+{
+  replay_worker_t *worker = data;
+  replay_queue_t *queue = worker->queue;
+  apr_pool_t *iterpool = svn_pool_create(worker->pool);
+
+  while (TRUE)
+    {
+      svn_revnum_t rev;
+      replay_result_t *result;
+      svn_error_t *err;
+
+      /* Get the next revision to replay.  Don't get too far ahead of the
+       * sending thread. */
+      apr_thread_mutex_lock(queue->mutex);
+      while (   !queue->stop
+             && queue->next_rev <= queue->end_rev
+             && queue->next_rev
+                  >= queue->next_to_send + queue->window_size)
+        apr_thread_cond_wait(queue->changed, queue->mutex);
+
+      if (queue->stop || queue->next_rev > queue->end_rev)
+        {
+          apr_thread_mutex_unlock(queue->mutex);
+          break;
+        }
+
+      rev = queue->next_rev++;
+      apr_thread_mutex_unlock(queue->mutex);
+
+      /* The result slot for REV is ours until we mark it as "done". */
+      svn_pool_clear(iterpool);
+      result = get_replay_result(queue, rev);
+      err = prefetch_one_revision(result, worker, rev, iterpool);
+
+      apr_thread_mutex_lock(queue->mutex);
+      result->fatal_err = err;
+      result->done = TRUE;
+      apr_thread_cond_broadcast(queue->changed);
+      apr_thread_mutex_unlock(queue->mutex);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Don't call apr_thread_exit() here.  It would destroy the thread's
+   * pool, which is a sub-pool of one owned by the sending thread. */
+  return NULL;
+}
+
+/* Tell all workers in QUEUE to stop and wait for the COUNT threads in
+ * WORKERS to terminate.  Release all resources held by QUEUE and WORKERS.
+ */
+static void
+stop_replay_workers(replay_queue_t *queue,
+                    replay_worker_t *workers,
+                    int count)
+{
+  int i;
+  apr_status_t retval;
+
+  apr_thread_mutex_lock(queue->mutex);
+  queue->stop = TRUE;
+  apr_thread_cond_broadcast(queue->changed);
+  apr_thread_mutex_unlock(queue->mutex);
+
+  for (i = 0; i < count; ++i)
+    apr_thread_join(&retval, workers[i].thread);
+
+  for (i = 0; i < count; ++i)
+    svn_pool_destroy(workers[i].pool);
+
+  for (i = 0; i < queue->window_size; ++i)
+    reset_replay_result(&queue->results[i]);
+}
+
+/* Send the replay of revisions START_REV to END_REV of the repository in
+ * B over CONN, exactly as the sequential loop in replay_range() would.
+ * The revisions get replayed ahead of time by JOBS worker threads, each
+ * with its own FS instance, and are sent in revision order.  Return
+ * command failures wrapped in SVN_ERR_RA_SVN_CMD_ERR.  Use SCRATCH_POOL
+ * for temporary allocations.
+ */
+static svn_error_t *
+replay_revisions_in_parallel(svn_ra_svn_conn_t *conn,
+                             server_baton_t *b,
+                             svn_revnum_t start_rev,
+                             svn_revnum_t end_rev,
+                             svn_revnum_t low_water_mark,
+                             svn_boolean_t send_deltas,
+                             int jobs,
+                             apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs = b->repository->fs;
+  const char *fs_path = svn_fs_path(fs, scratch_pool);
+  apr_hash_t *fs_config = svn_fs_config(fs, scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  replay_queue_t *queue = apr_pcalloc(scratch_pool, sizeof(*queue));
+  replay_worker_t *workers;
+  svn_error_t *err = SVN_NO_ERROR;
+  svn_error_t *cmd_err = SVN_NO_ERROR;
+  apr_status_t status;
+  svn_revnum_t rev;
+  int started = 0;
+  int i;
+
+  /* Don't start more threads than there are revisions to replay. */
+  if (jobs > end_rev - start_rev + 1)
+    jobs = (int)(end_rev - start_rev + 1);
+
+  queue->next_rev = start_rev;
+  queue->next_to_send = start_rev;
+  queue->window_size = jobs * REPLAY_REVS_PER_JOB;
+  queue->results = apr_pcalloc(scratch_pool,
+                               queue->window_size * sizeof(*queue->results));
+  queue->conn = conn;
+  queue->fs_path = b->repository->fs_path->data;
+  queue->start_rev = start_rev;
+  queue->end_rev = end_rev;
+  queue->low_water_mark = low_water_mark;
+  queue->send_deltas = send_deltas;
+
+  status = apr_thread_mutex_create(&queue->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                   scratch_pool);
+  if (!status)
+    status = apr_thread_cond_create(&queue->changed, scratch_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create replay queue"));
+
+  /* Open a separate FS instance for each worker.  They may share their
+   * caches but nothing else. */
+  workers = apr_pcalloc(scratch_pool, jobs * sizeof(*workers));
+  for (i = 0; i < jobs; ++i)
+    {
+      workers[i].queue = queue;
+      workers[i].pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+      err = svn_fs_open2(&workers[i].fs, fs_path, fs_config,
+                         workers[i].pool, iterpool);
+      if (err)
+        break;
+    }
+
+  /* Start the workers. */
+  for (started = 0; !err && started < jobs; ++started)
+    {
+      status = apr_thread_create(&workers[started].thread, NULL,
+                                 replay_worker_thread, &workers[started],
+                                 scratch_pool);
+      if (status)
+        err = svn_error_wrap_apr(status, _("Can't create thread"));
+    }
+
+  if (err)
+    {
+      if (started)
+        --started;
+
+      stop_replay_workers(queue, workers, started);
+      for (i = started; i < jobs; ++i)
+        if (workers[i].pool)
+          svn_pool_destroy(workers[i].pool);
+
+      return svn_error_trace(err);
+    }
+
+  /* Send results in revision order as they become available. */
+  for (rev = start_rev; rev <= end_rev; ++rev)
+    {
+      replay_result_t *result = get_replay_result(queue, rev);
+      svn_pool_clear(iterpool);
+
+      apr_thread_mutex_lock(queue->mutex);
+      while (!result->done)
+        apr_thread_cond_wait(queue->changed, queue->mutex);
+      apr_thread_mutex_unlock(queue->mutex);
+
+      /* Like replay_one_revision(), log the replay only if we got past
+       * sending the revision properties. */
+      err = result->fatal_err;
+      result->fatal_err = SVN_NO_ERROR;
+      cmd_err = result->err;
+      result->err = SVN_NO_ERROR;
+      if (!err && (!cmd_err || result->abort_edit))
+        err = log_command(b, conn, iterpool,
+                          svn_log__replay(b->repository->fs_path->data, rev,
+                                          iterpool));
+
+      if (!err && result->buffer)
+        err = svn_ra_svn__write_spillbuf(conn, result->buffer, iterpool);
+
+      if (!err && cmd_err && result->abort_edit)
+        {
+          svn_error_t *abort_err
+            = svn_ra_svn__write_cmd_abort_edit(conn, iterpool);
+          if (!abort_err)
+            abort_err = svn_ra_svn__read_cmd_response(conn, iterpool, "");
+          svn_error_clear(abort_err);
+        }
+
+      /* Make the slot available for the next revision. */
+      apr_thread_mutex_lock(queue->mutex);
+      reset_replay_result(result);
+      queue->next_to_send = rev + 1;
+      apr_thread_cond_broadcast(queue->changed);
+      apr_thread_mutex_unlock(queue->mutex);
+
+      if (err || cmd_err)
+        break;
+    }
+
+  stop_replay_workers(queue, workers, jobs);
+  svn_pool_destroy(iterpool);
+
+  if (err)
+    {
+      svn_error_clear(cmd_err);
+      return svn_error_trace(err);
+    }
+
+  SVN_CMD_ERR(cmd_err);
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* APR_HAS_THREADS */
+
 static svn_error_t *replay_range(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                                  apr_array_header_t *params, void *baton)
 {
@@ -3251,6 +3886,20 @@ static svn_error_t *replay_range(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 
   SVN_ERR(trivial_auth_request(conn, pool, b));
 
+#if APR_HAS_THREADS
+  /* Worker threads must not evaluate path-based authz rules because
+   * those are not thread-safe. */
+  if (b->replay_jobs > 1 && end_rev > start_rev && !b->repository->authzdb)
+    {
+      SVN_ERR(replay_revisions_in_parallel(conn, b, start_rev, end_rev,
+                                           low_water_mark, send_deltas,
+                                           b->replay_jobs, pool));
+      SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
   iterpool = svn_pool_create(pool);
   for (rev = start_rev; rev <= end_rev; rev++)
     {
@@ -3369,6 +4018,48 @@ get_inherited_props(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Issue a session ticket that lets the client skip the password exchange
+ * in its next connections to this realm.  Tickets are stateless, i.e. we
+ * only sign the user name, realm, password and expiry time and check that
+ * signature when the ticket is presented. */
+static svn_error_t *
+get_session_ticket(svn_ra_svn_conn_t *conn,
+                   apr_pool_t *pool,
+                   apr_array_header_t *params,
+                   void *baton)
+{
+  server_baton_t *b = baton;
+  const char *password = NULL;
+  const char *ticket;
+
+  SVN_ERR(log_command(b, conn, pool, "get-session-ticket"));
+  SVN_ERR(trivial_auth_request(conn, pool, b));
+
+  /* Don't let tickets extend themselves nor other mechanisms turn into
+   * password-free access. */
+  if (b->ticket_secret && b->repository->pwdb
+      && b->client_info->password_auth)
+    svn_config_get(b->repository->pwdb, &password,
+                   SVN_CONFIG_SECTION_USERS, b->client_info->user, NULL);
+  if (!password)
+    SVN_CMD_ERR(svn_error_create(SVN_ERR_RA_NOT_AUTHORIZED, NULL,
+                                 "Session tickets require password "
+                                 "authentication"));
+
+  ticket = svn_ra_svn__session_ticket_create(b->ticket_secret,
+                                             b->client_info->user,
+                                             b->repository->realm,
+                                             password,
+                                             apr_time_now()
+                                               + b->ticket_lifetime,
+                                             pool);
+  SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, "ccn",
+                                         b->client_info->user, ticket,
+                                         (apr_uint64_t)apr_time_sec(
+                                                       b->ticket_lifetime)));
+  return SVN_NO_ERROR;
+}
+
 static const svn_ra_svn_cmd_entry_t main_commands[] = {
   { "reparent",        reparent },
   { "get-latest-rev",  get_latest_rev },
@@ -3379,6 +4070,7 @@ static const svn_ra_svn_cmd_entry_t main_commands[] = {
   { "rev-prop",        rev_prop },
   { "commit",          commit },
   { "get-file",        get_file },
+  { "get-files",       get_files },
   { "get-dir",         get_dir },
   { "update",          update },
   { "switch",          switch_cmd },
@@ -3401,6 +4093,7 @@ static const svn_ra_svn_cmd_entry_t main_commands[] = {
   { "replay-range",    replay_range },
   { "get-deleted-rev", get_deleted_rev },
   { "get-iprops",      get_inherited_props },
+  { "get-session-ticket", get_session_ticket },
   { NULL }
 };
 
@@ -3456,13 +4149,272 @@ repos_path_valid(const char *path)
   return TRUE;
 }
 
+/* An svn_repos_t instance that can be handed from one connection to the
+ * next through a repos_cache_t. */
+typedef struct cached_repos_t
+{
+  /* The repository instance, allocated in POOL. */
+  svn_repos_t *repos;
+
+  /* Root directory of REPOS; key in the cache's hash. */
+  const char *repos_root;
+
+  /* Cache that this instance will be returned to. */
+  repos_cache_t *cache;
+
+  /* When this instance had been opened. */
+  apr_time_t created;
+
+  /* Identifies the on-disk repository that REPOS has been opened for.
+   * See get_repos_signature(). */
+  const char *signature;
+
+  /* Root pool with its own allocator, owning this structure. */
+  apr_pool_t *pool;
+} cached_repos_t;
+
+struct repos_cache_t
+{
+  /* Maps repository root directories to arrays of idle cached_repos_t *,
+   * most recently used ones last. */
+  apr_hash_t *idle;
+
+  /* Limits per repository. */
+  int max_idle;
+  apr_interval_time_t max_age;
+
+  /* Serializes all access to IDLE. */
+  svn_mutex__t *mutex;
+
+  /* For the hash and its keys and arrays. */
+  apr_pool_t *pool;
+};
+
+svn_error_t *
+repos_cache_create(repos_cache_t **cache,
+                   int max_idle,
+                   apr_interval_time_t max_age,
+                   apr_pool_t *pool)
+{
+  repos_cache_t *result = apr_pcalloc(pool, sizeof(*result));
+
+  result->idle = apr_hash_make(pool);
+  result->max_idle = max_idle;
+  result->max_age = max_age;
+  result->pool = pool;
+  SVN_ERR(svn_mutex__init(&result->mutex, TRUE, pool));
+
+  *cache = result;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_warning_callback_t for idle repository instances. */
+static void
+ignore_fs_warning(void *baton, svn_error_t *err)
+{
+}
+
+/* Set *SIGNATURE to a string that identifies the repository at
+ * REPOS_ROOT on disk, i.e. changes when the repository gets replaced,
+ * upgraded or gets a new UUID.  Allocate it in RESULT_POOL and use
+ * SCRATCH_POOL for temporaries. */
+static svn_error_t *
+get_repos_signature(const char **signature,
+                    const char *repos_root,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  static const char *files[] = { "format", "db/format", "db/uuid", NULL };
+  svn_stringbuf_t *result = svn_stringbuf_create_empty(result_pool);
+  int i;
+
+  for (i = 0; files[i]; ++i)
+    {
+      apr_finfo_t finfo;
+      svn_error_t *err;
+
+      err = svn_io_stat(&finfo, svn_dirent_join(repos_root, files[i],
+                                                scratch_pool),
+                        APR_FINFO_IDENT | APR_FINFO_MTIME | APR_FINFO_SIZE,
+                        scratch_pool);
+
+      /* Not all back ends have all of these files. */
+      if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+        {
+          svn_error_clear(err);
+          svn_stringbuf_appendcstr(result, "-;");
+          continue;
+        }
+      SVN_ERR(err);
+
+      svn_stringbuf_appendcstr(result,
+                               apr_psprintf(scratch_pool,
+                                            "%" APR_UINT64_T_FMT
+                                            ":%" APR_UINT64_T_FMT
+                                            ":%" APR_TIME_T_FMT
+                                            ":%" APR_OFF_T_FMT ";",
+                                            (apr_uint64_t)finfo.device,
+                                            (apr_uint64_t)finfo.inode,
+                                            finfo.mtime, finfo.size));
+    }
+
+  *signature = result->data;
+  return SVN_NO_ERROR;
+}
+
+/* Set *INSTANCE to the most recently released, not yet expired instance
+ * of the repository at REPOS_ROOT in CACHE, or to NULL if there is none.
+ * Instances expire MAX_AGE after they have been opened.  Expired
+ * instances get destroyed.  The caller must hold CACHE->MUTEX. */
+static svn_error_t *
+pop_idle_repos(cached_repos_t **instance,
+               repos_cache_t *cache,
+               const char *repos_root)
+{
+  apr_array_header_t *idle = svn_hash_gets(cache->idle, repos_root);
+  apr_time_t now = apr_time_now();
+
+  *instance = NULL;
+  while (idle && idle->nelts && !*instance)
+    {
+      cached_repos_t *candidate
+        = *(cached_repos_t **)apr_array_pop(idle);
+
+      if (now - candidate->created < cache->max_age)
+        *instance = candidate;
+      else
+        svn_pool_destroy(candidate->pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Add INSTANCE to the idle instances of its repository.  Set *KEPT to
+ * FALSE if there are already enough of them.  The caller must hold
+ * INSTANCE->CACHE->MUTEX. */
+static svn_error_t *
+push_idle_repos(svn_boolean_t *kept,
+                cached_repos_t *instance)
+{
+  repos_cache_t *cache = instance->cache;
+  apr_array_header_t *idle = svn_hash_gets(cache->idle,
+                                           instance->repos_root);
+
+  if (idle == NULL)
+    {
+      idle = apr_array_make(cache->pool, cache->max_idle,
+                            sizeof(cached_repos_t *));
+      svn_hash_sets(cache->idle,
+                    apr_pstrdup(cache->pool, instance->repos_root), idle);
+    }
+
+  *kept = idle->nelts < cache->max_idle;
+  if (*kept)
+    APR_ARRAY_PUSH(idle, cached_repos_t *) = instance;
+
+  return SVN_NO_ERROR;
+}
+
+/* Pool cleanup handler returning the cached_repos_t DATA to its cache
+ * once the connection that used it ends.  Clear all connection-specific
+ * state first. */
+static apr_status_t
+release_repos(void *data)
+{
+  cached_repos_t *instance = data;
+  svn_fs_t *fs = svn_repos_fs(instance->repos);
+  svn_boolean_t kept = FALSE;
+  svn_error_t *err;
+
+  err = svn_fs_set_access(fs, NULL);
+  svn_fs_set_warning_func(fs, ignore_fs_warning, NULL);
+  if (!err)
+    err = svn_repos_remember_client_capabilities(instance->repos, NULL);
+
+  if (!err)
+    SVN_MUTEX__WITH_LOCK(instance->cache->mutex,
+                         push_idle_repos(&kept, instance));
+
+  if (err || !kept)
+    {
+      svn_error_clear(err);
+      svn_pool_destroy(instance->pool);
+    }
+
+  return APR_SUCCESS;
+}
+
+/* Set *REPOS to an instance of the repository at REPOS_ROOT, opened with
+ * FS_CONFIG.  If CACHE is not NULL, reuse an idle instance from it and
+ * return that to CACHE once RESULT_POOL gets cleaned up.  Only reuse
+ * instances of the same on-disk repository.  Otherwise, allocate the
+ * repository in RESULT_POOL.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+acquire_repos(svn_repos_t **repos,
+              repos_cache_t *cache,
+              const char *repos_root,
+              apr_hash_t *fs_config,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  cached_repos_t *instance;
+  const char *signature;
+
+  if (cache == NULL)
+    return svn_error_trace(svn_repos_open3(repos, repos_root, fs_config,
+                                           result_pool, scratch_pool));
+
+  /* Drop idle instances of a repository that has since been replaced. */
+  SVN_ERR(get_repos_signature(&signature, repos_root, scratch_pool,
+                              scratch_pool));
+  while (TRUE)
+    {
+      SVN_MUTEX__WITH_LOCK(cache->mutex,
+                           pop_idle_repos(&instance, cache, repos_root));
+      if (instance == NULL || strcmp(instance->signature, signature) == 0)
+        break;
+
+      svn_pool_destroy(instance->pool);
+    }
+
+  if (instance == NULL)
+    {
+      apr_pool_t *pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      svn_error_t *err;
+
+      instance = apr_pcalloc(pool, sizeof(*instance));
+      instance->repos_root = apr_pstrdup(pool, repos_root);
+      instance->cache = cache;
+      instance->created = apr_time_now();
+      instance->signature = apr_pstrdup(pool, signature);
+      instance->pool = pool;
+
+      err = svn_repos_open3(&instance->repos, repos_root, fs_config, pool,
+                            scratch_pool);
+      if (err)
+        {
+          svn_pool_destroy(pool);
+          return svn_error_trace(err);
+        }
+    }
+
+  apr_pool_cleanup_register(result_pool, instance, release_repos,
+                            apr_pool_cleanup_null);
+  *repos = instance->repos;
+
+  return SVN_NO_ERROR;
+}
+
 /* Look for the repository given by URL, using ROOT as the virtual
  * repository root.  If we find one, fill in the repos, fs, repos_url,
  * and fs_path fields of REPOSITORY.  VHOST and READ_ONLY flags are the
  * same as in the server baton.
  *
  * CONFIG_POOL and AUTHZ_POOL shall be used to load any object of the
- * respective type.
+ * respective type.  REPOS_CACHE, if not NULL, provides the repository
+ * instance.
  *
  * Use SCRATCH_POOL for temporary allocations.
  *
@@ -3477,10 +4429,11 @@ find_repos(const char *url,
            svn_repos__config_pool_t *config_pool,
            svn_repos__authz_pool_t *authz_pool,
            apr_hash_t *fs_config,
+           repos_cache_t *repos_cache,
            apr_pool_t *result_pool,
            apr_pool_t *scratch_pool)
 {
-  const char *path, *full_path, *fs_path, *hooks_env;
+  const char *path, *full_path, *fs_path, *hooks_env, *compression;
   svn_stringbuf_t *url_buf;
 
   /* Skip past the scheme and authority part. */
@@ -3515,8 +4468,9 @@ find_repos(const char *url,
                              "No repository found in '%s'", url);
 
   /* Open the repository and fill in b with the resulting information. */
-  SVN_ERR(svn_repos_open3(&repository->repos, repository->repos_root,
-                          fs_config, result_pool, scratch_pool));
+  SVN_ERR(acquire_repos(&repository->repos, repos_cache,
+                        repository->repos_root, fs_config,
+                        result_pool, scratch_pool));
   SVN_ERR(svn_repos_remember_client_capabilities(repository->repos,
                                                  repository->capabilities));
   repository->fs = svn_repos_fs(repository->repos);
@@ -3594,6 +4548,14 @@ find_repos(const char *url,
 
   repository->hooks_env = apr_pstrdup(result_pool, hooks_env);
 
+  /* Override the server's network compression method, if configured. */
+  svn_config_get(cfg, &compression, SVN_CONFIG_SECTION_GENERAL,
+                 SVN_CONFIG_OPTION_NETWORK_COMPRESSION, NULL);
+  if (compression)
+    SVN_ERR(svn_ra_svn__parse_compression(&repository->compression,
+                                          &repository->compression_level,
+                                          compression));
+
   return SVN_NO_ERROR;
 }
 
@@ -3787,10 +4749,18 @@ construct_server_baton(server_baton_t **baton,
   b->repository->authzdb = NULL;
   b->repository->realm = NULL;
   b->repository->use_sasl = FALSE;
+  b->repository->compression = params->compression;
+  b->repository->compression_level = params->compression_level;
 
   b->read_only = params->read_only;
   b->pool = conn_pool;
   b->vhost = params->vhost;
+  b->replay_jobs = params->replay_jobs;
+  if (params->session_ticket_lifetime > 0)
+    {
+      b->ticket_secret = params->session_ticket_secret;
+      b->ticket_lifetime = params->session_ticket_lifetime;
+    }
 
   b->logger = params->logger;
   b->client_info = get_client_info(conn, params, conn_pool);
@@ -3799,10 +4769,11 @@ construct_server_baton(server_baton_t **baton,
    * send an empty mechlist. */
   if (params->compression_level > 0)
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwww)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_SVNDIFF1,
+                                           SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED,
                                            SVN_RA_SVN_CAP_ABSENT_ENTRIES,
                                            SVN_RA_SVN_CAP_COMMIT_REVPROPS,
                                            SVN_RA_SVN_CAP_DEPTH,
@@ -3811,11 +4782,12 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_PARTIAL_REPLAY,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
-                                           SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE
+                                           SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
+                                           SVN_RA_SVN_CAP_GET_FILES
                                            ));
   else
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwww)",
+                                           "nn()(wwwwwwwwwww)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_ABSENT_ENTRIES,
@@ -3826,7 +4798,8 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_PARTIAL_REPLAY,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
-                                           SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE
+                                           SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
+                                           SVN_RA_SVN_CAP_GET_FILES
                                            ));
 
   /* Read client response, which we assume to be in version 2 format:
@@ -3882,6 +4855,7 @@ construct_server_baton(server_baton_t **baton,
                                        b->read_only, params->cfg,
                                        b->repository, params->config_pool,
                                        params->authz_pool, params->fs_config,
+                                       params->repos_cache,
                                        conn_pool, scratch_pool),
                             b);
   if (!err)
@@ -3913,6 +4887,10 @@ construct_server_baton(server_baton_t **baton,
   SVN_ERR(svn_fs_get_uuid(b->repository->fs, &b->repository->uuid,
                           conn_pool));
 
+  /* From now on, compress data as configured for this repository. */
+  svn_ra_svn__set_compression(conn, b->repository->compression,
+                              b->repository->compression_level);
+
   /* We can't claim mergeinfo capability until we know whether the
      repository supports mergeinfo (i.e., is not a 1.4 repository),
      but we don't get the repository url from the client until after
@@ -4017,6 +4995,19 @@ serve_interruptable(svn_boolean_t *terminate_p,
                                   connection->params->zero_copy_limit,
                                   connection->params->error_check_interval,
                                   connection->pool);
+      svn_ra_svn__set_compression(connection->conn,
+                                  connection->params->compression,
+                                  connection->params->compression_level);
+
+      /* Let the statistics collector see every command. */
+      if (connection->params->stats)
+        {
+          svn_ra_svn__set_command_observer(connection->conn,
+                                           stats__command_observer,
+                                           connection->params->stats);
+          stats__connection_opened(connection->params->stats,
+                                   connection->pool);
+        }
 
       /* Construct server baton and open the repository for the first time. */
       err = construct_server_baton(&connection->baton, connection->conn,
@@ -4076,6 +5067,13 @@ svn_error_t *serve(svn_ra_svn_conn_t *conn,
 {
   server_baton_t *baton = NULL;
 
+  if (params->stats)
+    {
+      svn_ra_svn__set_command_observer(conn, stats__command_observer,
+                                       params->stats);
+      stats__connection_opened(params->stats, pool);
+    }
+
   SVN_ERR(construct_server_baton(&baton, conn, params, pool));
   return svn_ra_svn__handle_commands2(conn, pool, main_commands, baton, FALSE);
 }
@@ -38,6 +38,7 @@ extern "C" {
 
 #include "private/svn_atomic.h"
 #include "private/svn_mutex.h"
+#include "private/svn_ra_svn_private.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
 
@@ -71,6 +72,9 @@ typedef struct repository_t {
   enum access_type auth_access; /* access granted to authenticated users */
   enum access_type anon_access; /* access granted to annonymous users */
 
+  svn_ra_svn__compression_t compression; /* network compression method */
+  int compression_level;   /* zlib level used with COMPRESSION */
+
 } repository_t;
 
 typedef struct client_info_t {
@@ -79,8 +83,12 @@ typedef struct client_info_t {
   const char *authz_user;  /* Username for authz ('user' + 'username_case') */
   svn_boolean_t tunnel;    /* Tunneled through login agent */
   const char *tunnel_user; /* Allow EXTERNAL to authenticate as this */
+  svn_boolean_t password_auth; /* 'user' authenticated with a password */
 } client_info_t;
 
+/* Opaque cache of open repositories, shared by all connections. */
+typedef struct repos_cache_t repos_cache_t;
+
 typedef struct server_baton_t {
   repository_t *repository; /* repository-specific data to use */
   client_info_t *client_info; /* client-specific data to use */
@@ -88,6 +96,9 @@ typedef struct server_baton_t {
                               May be NULL even if log_file is not. */
   svn_boolean_t read_only; /* Disallow write access (global flag) */
   svn_boolean_t vhost;     /* Use virtual-host-based path to repo. */
+  int replay_jobs;         /* Worker threads per replay-range command */
+  const char *ticket_secret; /* Key for session tickets; NULL = disabled */
+  apr_interval_time_t ticket_lifetime; /* Validity of new session tickets */
   apr_pool_t *pool;
 } server_baton_t;
 
@@ -138,6 +149,11 @@ typedef struct serve_params_t {
   /* Size of the in-memory cache (used by FSFS only). */
   apr_uint64_t memory_cache_size;
 
+  /* Data compression method to reduce network traffic.  Repositories
+     may override this in their svnserve.conf.
+     Defaults to svn_ra_svn__compression_lz4. */
+  svn_ra_svn__compression_t compression;
+
   /* Data compression level to reduce for network traffic. If this
      is 0, no compression should be applied and the protocol may
      fall back to svndiff "version 0" bypassing zlib entirely.
@@ -154,6 +170,25 @@ typedef struct serve_params_t {
 
   /* Use virtual-host-based path to repo. */
   svn_boolean_t vhost;
+
+  /* Number of worker threads used to replay revisions ahead of the one
+     being sent in a replay-range command.  Values below 2 disable that. */
+  int replay_jobs;
+
+  /* Statistics collector for all connections; possibly NULL. */
+  struct stats_t *stats;
+
+  /* How long session tickets issued to password-authenticated clients
+     shall remain valid.  0 disables session tickets. */
+  apr_interval_time_t session_ticket_lifetime;
+
+  /* Server-private key used to sign and verify session tickets.
+     Only valid if session_ticket_lifetime is not 0. */
+  const char *session_ticket_secret;
+
+  /* Idle repository instances that connections may reuse instead of
+     opening the repository again; possibly NULL. */
+  repos_cache_t *repos_cache;
 } serve_params_t;
 
 /* This structure contains all data that describes a client / server
@@ -216,6 +251,17 @@ serve_interruptable(svn_boolean_t *terminate_p,
                     svn_boolean_t (* is_busy)(connection_t *),
                     apr_pool_t *pool);
 
+/* Create a cache in POOL that keeps up to MAX_IDLE unused svn_repos_t
+ * instances per repository.  Instances are handed out again only until
+ * MAX_AGE after they have been opened and only while the repository on
+ * disk has not been replaced.  It may be used by multiple threads
+ * concurrently.  Return it in *CACHE. */
+svn_error_t *
+repos_cache_create(repos_cache_t **cache,
+                   int max_idle,
+                   apr_interval_time_t max_age,
+                   apr_pool_t *pool);
+
 /* Initialize the Cyrus SASL library. POOL is used for allocations. */
 svn_error_t *cyrus_init(apr_pool_t *pool);
 
@@ -0,0 +1,568 @@
+/*
+ * stats.c : Implementation of the svnserve statistics collector
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#define APR_WANT_STRFUNC
+#include <apr_want.h>
+#include <apr_shm.h>
+#include <apr_strings.h>
+#include <apr_thread_mutex.h>
+
+#include <errno.h>
+
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+#include "svn_time.h"
+
+#include "private/svn_cache.h"
+
+#include "svn_private_config.h"
+#include "logger.h"
+#include "stats.h"
+
+/* Counters shared between processes need a lock that works across
+ * process boundaries.  A child process dying while holding it must not
+ * block all others forever, i.e. the lock must be robust.  Like shared
+ * membuffer caches, we use robust process-shared pthread mutexes for
+ * that.  Without them, every process only collects its own data.
+ */
+#if APR_HAS_PROC_PTHREAD_SERIALIZE && defined(EOWNERDEAD)
+#  define USE_ROBUST_PROCESS_LOCK 1
+#  include <pthread.h>
+#else
+#  define USE_ROBUST_PROCESS_LOCK 0
+#endif
+
+/* The protocol has less than 50 commands.  Anything beyond this limit
+ * will not be recorded.
+ */
+#define MAX_COMMANDS 64
+
+/* Command names are short words.  Longer ones get truncated.
+ */
+#define MAX_CMDNAME_LEN 32
+
+/* Upper bounds of the command latency histogram buckets in microseconds.
+ * The implicit last bucket is unbounded.
+ */
+static const apr_interval_time_t bucket_limits[] =
+  {
+    1000, 5000, 10000, 50000, 100000, 500000,
+    1000000, 5000000, 10000000, 60000000
+  };
+
+#define BUCKET_COUNT (sizeof(bucket_limits) / sizeof(bucket_limits[0]))
+
+/* Counters for a single protocol command.
+ */
+typedef struct command_stats_t
+{
+  /* NUL-terminated command name.  Empty for unused entries. */
+  char name[MAX_CMDNAME_LEN];
+
+  /* Number of executions, including failed ones. */
+  apr_uint64_t count;
+
+  /* Number of executions that returned an error. */
+  apr_uint64_t failures;
+
+  /* Number of executions that took at most BUCKET_LIMITS[i] but more
+   * than BUCKET_LIMITS[i-1]. */
+  apr_uint64_t buckets[BUCKET_COUNT];
+
+  /* Total execution time in microseconds. */
+  apr_uint64_t duration;
+} command_stats_t;
+
+/* All counters.  This structure may live in shared memory.
+ */
+typedef struct shared_stats_t
+{
+  /* When the collector was created. */
+  apr_time_t start_time;
+
+  /* When the statistics file has been written the last time. */
+  apr_time_t last_write;
+
+  /* Number of connections accepted so far. */
+  apr_uint64_t connections;
+
+  /* Number of connections currently being served. */
+  apr_uint64_t active_connections;
+
+  /* Network traffic caused by commands. */
+  apr_uint64_t bytes_received;
+  apr_uint64_t bytes_sent;
+
+  /* Per-command counters.  The first COMMAND_COUNT entries are in use. */
+  int command_count;
+  command_stats_t commands[MAX_COMMANDS];
+
+#if USE_ROBUST_PROCESS_LOCK
+  /* Serializes access to all of the above among threads and processes. */
+  pthread_mutex_t mutex;
+#endif
+} shared_stats_t;
+
+struct stats_t
+{
+  /* The actual counters.  See lock_stats(). */
+  shared_stats_t *shared;
+
+#if !USE_ROBUST_PROCESS_LOCK && APR_HAS_THREADS
+  /* Serializes access to SHARED among the threads of this process. */
+  apr_thread_mutex_t *mutex;
+#endif
+
+  /* Where to write the statistics to and how often. */
+  const char *filename;
+  apr_interval_time_t interval;
+
+  /* Report write errors here; may be NULL. */
+  logger_t *logger;
+
+#if APR_HAS_THREADS
+  /* Worker thread pool to report on; may be NULL. */
+  apr_thread_pool_t *threads;
+#endif
+};
+
+svn_error_t *
+stats__create(stats_t **stats,
+              const char *filename,
+              apr_interval_time_t interval,
+              logger_t *logger,
+              apr_pool_t *pool)
+{
+  stats_t *result = apr_pcalloc(pool, sizeof(*result));
+
+#if USE_ROBUST_PROCESS_LOCK
+  apr_status_t status;
+  apr_shm_t *shm;
+  pthread_mutexattr_t attr;
+  int pstatus;
+
+  /* Anonymous shared memory gets inherited by forked child processes.
+   * Without it, we can still collect data from all threads.  Either way,
+   * the memory is zero-initialized. */
+  status = apr_shm_create(&shm, sizeof(*result->shared), NULL, pool);
+  if (status == APR_SUCCESS)
+    result->shared = apr_shm_baseaddr_get(shm);
+  else if (APR_STATUS_IS_ENOTIMPL(status))
+    result->shared = apr_pcalloc(pool, sizeof(*result->shared));
+  else
+    return svn_error_wrap_apr(status,
+                              _("Can't create shared memory for statistics"));
+
+  pstatus = pthread_mutexattr_init(&attr);
+  if (pstatus == 0)
+    {
+      pstatus = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+      if (pstatus == 0)
+        pstatus = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+      if (pstatus == 0)
+        pstatus = pthread_mutex_init(&result->shared->mutex, &attr);
+
+      pthread_mutexattr_destroy(&attr);
+    }
+
+  if (pstatus)
+    return svn_error_wrap_apr(pstatus, _("Can't create statistics mutex"));
+#else
+  result->shared = apr_pcalloc(pool, sizeof(*result->shared));
+
+#if APR_HAS_THREADS
+  {
+    apr_status_t status = apr_thread_mutex_create(&result->mutex,
+                                                  APR_THREAD_MUTEX_DEFAULT,
+                                                  pool);
+    if (status)
+      return svn_error_wrap_apr(status,
+                                _("Can't create statistics mutex"));
+  }
+#endif
+#endif
+
+  result->shared->start_time = apr_time_now();
+  result->filename = apr_pstrdup(pool, filename);
+  result->interval = interval;
+  result->logger = logger;
+
+  *stats = result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Acquire the lock protecting STATS->SHARED.  Return FALSE if that failed,
+ * in which case the counters must not be touched.
+ */
+static svn_boolean_t
+lock_stats(stats_t *stats)
+{
+#if USE_ROBUST_PROCESS_LOCK
+  int status = pthread_mutex_lock(&stats->shared->mutex);
+
+  /* The previous owner died while holding the lock.  At worst, it left
+   * a few counters of a single command out of sync, which is not worth
+   * losing all statistics over. */
+  if (status == EOWNERDEAD)
+    status = pthread_mutex_consistent(&stats->shared->mutex);
+
+  return status == 0;
+#elif APR_HAS_THREADS
+  return apr_thread_mutex_lock(stats->mutex) == APR_SUCCESS;
+#else
+  return TRUE;
+#endif
+}
+
+/* Release the lock acquired by lock_stats(STATS).
+ */
+static void
+unlock_stats(stats_t *stats)
+{
+#if USE_ROBUST_PROCESS_LOCK
+  pthread_mutex_unlock(&stats->shared->mutex);
+#elif APR_HAS_THREADS
+  apr_thread_mutex_unlock(stats->mutex);
+#endif
+}
+
+#if APR_HAS_THREADS
+void
+stats__set_thread_pool(stats_t *stats,
+                       apr_thread_pool_t *threads)
+{
+  stats->threads = threads;
+}
+#endif
+
+/* Implements apr_pool_cleanup_t for the stats_t given as DATA.
+ */
+static apr_status_t
+connection_closed(void *data)
+{
+  stats_t *stats = data;
+
+  if (lock_stats(stats))
+    {
+      --stats->shared->active_connections;
+      unlock_stats(stats);
+    }
+
+  return APR_SUCCESS;
+}
+
+void
+stats__connection_opened(stats_t *stats,
+                         apr_pool_t *connection_pool)
+{
+  if (stats == NULL)
+    return;
+
+  if (lock_stats(stats))
+    {
+      ++stats->shared->connections;
+      ++stats->shared->active_connections;
+      unlock_stats(stats);
+
+      apr_pool_cleanup_register(connection_pool, stats, connection_closed,
+                                apr_pool_cleanup_null);
+    }
+}
+
+/* Return the entry for command CMDNAME in SHARED, creating it as
+ * necessary.  Return NULL if the command table is full.  The caller
+ * must hold the lock.
+ */
+static command_stats_t *
+get_command_stats(shared_stats_t *shared,
+                  const char *cmdname)
+{
+  int i;
+  command_stats_t *command;
+
+  for (i = 0; i < shared->command_count; ++i)
+    if (strncmp(shared->commands[i].name, cmdname, MAX_CMDNAME_LEN - 1) == 0)
+      return &shared->commands[i];
+
+  if (shared->command_count == MAX_COMMANDS)
+    return NULL;
+
+  command = &shared->commands[shared->command_count++];
+  apr_cpystrn(command->name, cmdname, sizeof(command->name));
+
+  return command;
+}
+
+/* Append the Prometheus metric NAME of TYPE with the description HELP
+ * and the unlabeled VALUE to BUFFER.
+ */
+static void
+append_metric(svn_stringbuf_t *buffer,
+              const char *name,
+              const char *type,
+              const char *help,
+              apr_uint64_t value,
+              apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_appendcstr(buffer,
+                           apr_psprintf(scratch_pool,
+                                        "# HELP %s %s\n"
+                                        "# TYPE %s %s\n"
+                                        "%s %" APR_UINT64_T_FMT "\n",
+                                        name, help, name, type,
+                                        name, value));
+}
+
+/* Append the per-command metrics for all commands in STATS to BUFFER.
+ */
+static void
+append_command_metrics(svn_stringbuf_t *buffer,
+                       const shared_stats_t *stats,
+                       apr_pool_t *scratch_pool)
+{
+  int i;
+  apr_size_t k;
+
+  svn_stringbuf_appendcstr(buffer,
+    "# HELP svnserve_commands_total Number of executed commands.\n"
+    "# TYPE svnserve_commands_total counter\n");
+  for (i = 0; i < stats->command_count; ++i)
+    svn_stringbuf_appendcstr(buffer,
+      apr_psprintf(scratch_pool,
+                   "svnserve_commands_total{command=\"%s\"} %"
+                   APR_UINT64_T_FMT "\n",
+                   stats->commands[i].name, stats->commands[i].count));
+
+  svn_stringbuf_appendcstr(buffer,
+    "# HELP svnserve_command_failures_total Number of failed commands.\n"
+    "# TYPE svnserve_command_failures_total counter\n");
+  for (i = 0; i < stats->command_count; ++i)
+    svn_stringbuf_appendcstr(buffer,
+      apr_psprintf(scratch_pool,
+                   "svnserve_command_failures_total{command=\"%s\"} %"
+                   APR_UINT64_T_FMT "\n",
+                   stats->commands[i].name, stats->commands[i].failures));
+
+  svn_stringbuf_appendcstr(buffer,
+    "# HELP svnserve_command_duration_seconds Command execution time.\n"
+    "# TYPE svnserve_command_duration_seconds histogram\n");
+  for (i = 0; i < stats->command_count; ++i)
+    {
+      const command_stats_t *command = &stats->commands[i];
+      apr_uint64_t cumulative = 0;
+
+      for (k = 0; k < BUCKET_COUNT; ++k)
+        {
+          cumulative += command->buckets[k];
+          svn_stringbuf_appendcstr(buffer,
+            apr_psprintf(scratch_pool,
+                         "svnserve_command_duration_seconds_bucket"
+                         "{command=\"%s\",le=\"%g\"} %" APR_UINT64_T_FMT
+                         "\n",
+                         command->name,
+                         (double)bucket_limits[k] / APR_USEC_PER_SEC,
+                         cumulative));
+        }
+
+      svn_stringbuf_appendcstr(buffer,
+        apr_psprintf(scratch_pool,
+                     "svnserve_command_duration_seconds_bucket"
+                     "{command=\"%s\",le=\"+Inf\"} %" APR_UINT64_T_FMT "\n"
+                     "svnserve_command_duration_seconds_sum"
+                     "{command=\"%s\"} %.6f\n"
+                     "svnserve_command_duration_seconds_count"
+                     "{command=\"%s\"} %" APR_UINT64_T_FMT "\n",
+                     command->name, command->count,
+                     command->name,
+                     (double)command->duration / APR_USEC_PER_SEC,
+                     command->name, command->count));
+    }
+}
+
+/* Write a snapshot of the counters in SNAPSHOT plus information on the
+ * worker threads and the global membuffer cache to the file managed by
+ * STATS.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+write_stats(stats_t *stats,
+            const shared_stats_t *snapshot,
+            apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buffer = svn_stringbuf_create_ensure(0x4000,
+                                                        scratch_pool);
+
+  append_metric(buffer, "svnserve_uptime_seconds", "gauge",
+                "Time since the server has been started.",
+                apr_time_sec(apr_time_now() - snapshot->start_time),
+                scratch_pool);
+  append_metric(buffer, "svnserve_connections_total", "counter",
+                "Number of accepted client connections.",
+                snapshot->connections, scratch_pool);
+  append_metric(buffer, "svnserve_active_connections", "gauge",
+                "Number of client connections being served.",
+                snapshot->active_connections, scratch_pool);
+  append_metric(buffer, "svnserve_received_bytes_total", "counter",
+                "Network data received while executing commands.",
+                snapshot->bytes_received, scratch_pool);
+  append_metric(buffer, "svnserve_sent_bytes_total", "counter",
+                "Network data sent while executing commands.",
+                snapshot->bytes_sent, scratch_pool);
+
+  append_command_metrics(buffer, snapshot, scratch_pool);
+
+#if APR_HAS_THREADS
+  if (stats->threads)
+    {
+      append_metric(buffer, "svnserve_threads", "gauge",
+                    "Number of worker threads.",
+                    apr_thread_pool_threads_count(stats->threads),
+                    scratch_pool);
+      append_metric(buffer, "svnserve_busy_threads", "gauge",
+                    "Number of worker threads serving a connection.",
+                    apr_thread_pool_busy_count(stats->threads),
+                    scratch_pool);
+      append_metric(buffer, "svnserve_queued_connections", "gauge",
+                    "Number of connections waiting for a worker thread.",
+                    apr_thread_pool_tasks_count(stats->threads),
+                    scratch_pool);
+    }
+#endif
+
+  /* In fork mode, this is the cache of the process writing the file,
+   * unless all processes share the same cache. */
+  if (svn_cache__get_global_membuffer_cache())
+    {
+      svn_cache__info_t *info
+        = svn_cache__membuffer_get_global_info(scratch_pool);
+
+      append_metric(buffer, "svnserve_cache_gets_total", "counter",
+                    "Number of cache lookups.",
+                    info->gets, scratch_pool);
+      append_metric(buffer, "svnserve_cache_hits_total", "counter",
+                    "Number of successful cache lookups.",
+                    info->hits, scratch_pool);
+      append_metric(buffer, "svnserve_cache_sets_total", "counter",
+                    "Number of items added to the cache.",
+                    info->sets, scratch_pool);
+      append_metric(buffer, "svnserve_cache_used_bytes", "gauge",
+                    "Size of the data in the cache.",
+                    info->used_size, scratch_pool);
+      append_metric(buffer, "svnserve_cache_size_bytes", "gauge",
+                    "Total size of the cache.",
+                    info->total_size, scratch_pool);
+      append_metric(buffer, "svnserve_cache_entries", "gauge",
+                    "Number of items in the cache.",
+                    info->used_entries, scratch_pool);
+    }
+
+  return svn_error_trace(svn_io_write_atomic(stats->filename,
+                                             buffer->data, buffer->len,
+                                             NULL, scratch_pool));
+}
+
+void
+stats__command_observer(void *baton,
+                        const char *cmdname,
+                        apr_interval_time_t duration,
+                        svn_boolean_t failed,
+                        apr_uint64_t bytes_received,
+                        apr_uint64_t bytes_sent)
+{
+  stats_t *stats = baton;
+  command_stats_t *command;
+  apr_size_t k;
+
+  if (!lock_stats(stats))
+    return;
+
+  stats->shared->bytes_received += bytes_received;
+  stats->shared->bytes_sent += bytes_sent;
+
+  command = get_command_stats(stats->shared, cmdname);
+  if (command)
+    {
+      ++command->count;
+      if (failed)
+        ++command->failures;
+
+      command->duration += duration;
+      for (k = 0; k < BUCKET_COUNT; ++k)
+        if (duration <= bucket_limits[k])
+          {
+            ++command->buckets[k];
+            break;
+          }
+    }
+
+  unlock_stats(stats);
+}
+
+apr_interval_time_t
+stats__get_interval(stats_t *stats)
+{
+  return stats->interval;
+}
+
+void
+stats__write_file(stats_t *stats,
+                  svn_boolean_t force,
+                  apr_pool_t *scratch_pool)
+{
+  shared_stats_t *snapshot;
+  apr_pool_t *pool;
+  apr_time_t now = apr_time_now();
+  svn_error_t *err;
+
+  if (stats == NULL)
+    return;
+
+  if (!lock_stats(stats))
+    return;
+
+  if (!force && now - stats->shared->last_write < stats->interval)
+    {
+      unlock_stats(stats);
+      return;
+    }
+
+  /* Take a snapshot to write while not holding the lock. */
+  pool = svn_pool_create(scratch_pool);
+  snapshot = apr_pmemdup(pool, stats->shared, sizeof(*snapshot));
+  stats->shared->last_write = now;
+
+  unlock_stats(stats);
+
+  err = write_stats(stats, snapshot, pool);
+  if (err)
+    {
+      logger__log_error(stats->logger, err, NULL, NULL);
+      svn_error_clear(err);
+    }
+
+  svn_pool_destroy(pool);
+}
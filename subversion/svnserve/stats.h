@@ -0,0 +1,104 @@
+/*
+ * stats.h : Declarations for the svnserve statistics collector
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#if APR_HAS_THREADS
+#    include <apr_thread_pool.h>
+#endif
+
+#include "server.h"
+
+
+
+/* Opaque svnserve statistics collector.  Its counters are shared among
+ * all threads of this process and, where robust process-shared mutexes
+ * are available, all processes forked after its creation.
+ */
+typedef struct stats_t stats_t;
+
+/* In POOL, create a statistics collector that writes its data to
+ * FILENAME in the Prometheus text exposition format and return it in
+ * *STATS.  The file will be refreshed by stats__write_file at most once
+ * every INTERVAL.  Errors during these updates will be reported to
+ * LOGGER, which may be NULL.
+ */
+svn_error_t *
+stats__create(stats_t **stats,
+              const char *filename,
+              apr_interval_time_t interval,
+              struct logger_t *logger,
+              apr_pool_t *pool);
+
+#if APR_HAS_THREADS
+/* Make STATS report the state of the worker thread pool THREADS as well.
+ */
+void
+stats__set_thread_pool(stats_t *stats,
+                       apr_thread_pool_t *threads);
+#endif
+
+/* Count a new client connection in STATS.  It will be considered active
+ * until CONNECTION_POOL gets cleared or destroyed.  STATS may be NULL.
+ */
+void
+stats__connection_opened(stats_t *stats,
+                         apr_pool_t *connection_pool);
+
+/* Implements svn_ra_svn__command_observer_t for the stats_t given as
+ * BATON.
+ */
+void
+stats__command_observer(void *baton,
+                        const char *cmdname,
+                        apr_interval_time_t duration,
+                        svn_boolean_t failed,
+                        apr_uint64_t bytes_received,
+                        apr_uint64_t bytes_sent);
+
+/* Return the refresh interval of the statistics file of STATS.
+ */
+apr_interval_time_t
+stats__get_interval(stats_t *stats);
+
+/* Write the current statistics to the file of STATS.  Unless FORCE is
+ * set, do so only if the last update is at least the refresh interval
+ * ago.  The server should call this regularly, e.g. from its main loop,
+ * even while it is idle.  STATS may be NULL.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+void
+stats__write_file(stats_t *stats,
+                  svn_boolean_t force,
+                  apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* STATS_H */
@@ -49,17 +49,21 @@
 #include "svn_version.h"
 #include "svn_io.h"
 #include "svn_hash.h"
+#include "svn_ctype.h"
 
 #include "svn_private_config.h"
 
 #include "private/svn_dep_compat.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_atomic.h"
+#include "private/svn_cache.h"
 #include "private/svn_mutex.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_ra_svn_private.h"
 
 #if APR_HAS_THREADS
 #    include <apr_thread_pool.h>
+#    include <apr_poll.h>
 #endif
 
 #include "winservice.h"
@@ -69,6 +73,7 @@
 #endif
 
 #include "server.h"
+#include "stats.h"
 #include "logger.h"
 
 /* The strategy for handling incoming connections.  Some of these may be
@@ -76,6 +81,8 @@
 enum connection_handling_mode {
   connection_mode_fork,   /* Create a process per connection */
   connection_mode_thread, /* Create a thread per connection */
+  connection_mode_event,  /* Park idle connections in a poll set and
+                             serve commands from a worker thread pool */
   connection_mode_single  /* One connection at a time in this process */
 };
 
@@ -145,6 +152,28 @@ enum run_mode {
  */
 #define THREADPOOL_THREAD_IDLE_LIMIT 1000000
 
+/* Default and maximum number of worker threads per replay-range command
+ * that replay revisions ahead of the one being sent to the client.
+ * Parallel replay is opt-in.
+ */
+#define REPLAY_JOBS_DEFAULT 1
+#define REPLAY_JOBS_MAX 64
+
+/* Maximum number of unused instances per repository that multi-threaded
+ * servers keep open for later connections, and the maximum number of
+ * seconds after opening that such an instance may be reused.
+ */
+#define REPOS_CACHE_MAX_IDLE 4
+#define REPOS_CACHE_MAX_AGE 60
+
+/* Expected number of concurrently idle connections in event-driven mode.
+ *
+ * This is only a hint to the OS (e.g. for epoll).  More connections
+ * will be accepted but each wakeup will report at most this many ready
+ * sockets.
+ */
+#define POLLSET_SIZE_HINT 1024
+
 /* Number of client to server connections that may concurrently in the
  * TCP 3-way handshake state, i.e. are in the process of being created.
  *
@@ -210,6 +239,12 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MIN_THREADS     271
 #define SVNSERVE_OPT_MAX_THREADS     272
 #define SVNSERVE_OPT_BLOCK_READ      273
+#define SVNSERVE_OPT_EVENT_DRIVEN    274
+#define SVNSERVE_OPT_CACHE_SHARED    275
+#define SVNSERVE_OPT_STATS_FILE      276
+#define SVNSERVE_OPT_STATS_INTERVAL  277
+#define SVNSERVE_OPT_REPLAY_JOBS     278
+#define SVNSERVE_OPT_SESSION_TICKETS 279
 
 static const apr_getopt_option_t svnserve__options[] =
   {
@@ -259,11 +294,15 @@ static const apr_getopt_option_t svnserve__options[] =
         "                             "
         "Use inetd mode or tunnel mode if you need this.]")},
     {"compression",      'c', 1,
-     N_("compression level to use for network transmissions\n"
+     N_("compression method to use for network\n"
+        "                             "
+        "transmissions [none, lz4 (default), zlib or\n"
+        "                             "
+        "zlib-N with N = 1 .. 9].  A plain zlib level\n"
         "                             "
-        "[0 .. no compression, 5 .. default, \n"
+        "0 .. 9 is accepted as well; any non-zero level\n"
         "                             "
-        " 9 .. maximum compression]")},
+        "prefers lz4 where clients support it.")},
     {"memory-cache-size", 'M', 1,
      N_("size of the extra in-memory cache in MB used to\n"
         "                             "
@@ -312,6 +351,16 @@ static const apr_getopt_option_t svnserve__options[] =
         "Default is no.\n"
         "                             "
         "[used for FSFS repositories in 1.9 format only]")},
+#if APR_HAS_FORK
+    {"cache-shared", SVNSERVE_OPT_CACHE_SHARED, 1,
+     N_("share the in-memory cache between all server\n"
+        "                             "
+        "processes instead of giving each its own copy.\n"
+        "                             "
+        "Default is no.\n"
+        "                             "
+        "[used only in the default fork mode]")},
+#endif
 #ifdef CONNECTION_HAVE_THREAD_OPTION
     /* ### Making the assumption here that WIN32 never has fork and so
      * ### this option never exists when --service exists. */
@@ -324,7 +373,7 @@ static const apr_getopt_option_t svnserve__options[] =
         "                             "
         "Default is 1.\n"
         "                             "
-        "[used only with --threads]")},
+        "[used only with --threads or --event-driven]")},
 #if (APR_SIZEOF_VOIDP <= 4)
     {"max-threads",      SVNSERVE_OPT_MAX_THREADS, 1,
      N_("Maximum number of server threads, even if there\n"
@@ -333,7 +382,7 @@ static const apr_getopt_option_t svnserve__options[] =
         "                             "
         "Default is 64.\n"
         "                             "
-        "[used only with --threads]")},
+        "[used only with --threads or --event-driven]")},
 #else
     {"max-threads",      SVNSERVE_OPT_MAX_THREADS, 1,
      N_("Maximum number of server threads, even if there\n"
@@ -342,8 +391,30 @@ static const apr_getopt_option_t svnserve__options[] =
         "                             "
         "Default is 256.\n"
         "                             "
-        "[used only with --threads]")},
+        "[used only with --threads or --event-driven]")},
 #endif
+#endif
+#if APR_HAS_THREADS
+    {"event-driven",     SVNSERVE_OPT_EVENT_DRIVEN, 0,
+     N_("wait for commands from idle connections in a\n"
+        "                             "
+        "poll set and execute them using a fixed pool of\n"
+        "                             "
+        "max-threads worker threads.  Slow or idle clients\n"
+        "                             "
+        "don't occupy a thread.\n"
+        "                             "
+        "[mode: daemon]")},
+    {"replay-jobs",      SVNSERVE_OPT_REPLAY_JOBS, 1,
+     N_("number of threads replaying revisions ahead of\n"
+        "                             "
+        "the one being sent to svnsync (1-64).  1 disables\n"
+        "                             "
+        "this.  Not used for repositories with path-based\n"
+        "                             "
+        "authz.\n"
+        "                             "
+        "Default is 1.")},
 #endif
     {"foreground",        SVNSERVE_OPT_FOREGROUND, 0,
      N_("run in foreground (useful for debugging)\n"
@@ -355,6 +426,32 @@ static const apr_getopt_option_t svnserve__options[] =
         "process (useful for debugging)")},
     {"log-file",         SVNSERVE_OPT_LOG_FILE, 1,
      N_("svnserve log file")},
+    {"stats-file",       SVNSERVE_OPT_STATS_FILE, 1,
+     N_("periodically write command, connection and cache\n"
+        "                             "
+        "statistics to file ARG in the Prometheus text\n"
+        "                             "
+        "format")},
+    {"stats-interval",   SVNSERVE_OPT_STATS_INTERVAL, 1,
+     N_("update the statistics file every ARG seconds,\n"
+        "                             "
+        "even while idle.\n"
+        "                             "
+        "Default is 10.")},
+    {"session-ticket-lifetime", SVNSERVE_OPT_SESSION_TICKETS, 1,
+     N_("let clients that authenticated with a password\n"
+        "                             "
+        "skip that for ARG seconds in later connections.\n"
+        "                             "
+        "Tickets are valid only for this server process.\n"
+        "                             "
+        "Each ticket is sent to the client in clear text\n"
+        "                             "
+        "once, like all svn:// data.  Anybody who sees it\n"
+        "                             "
+        "can use it as that user until it expires.\n"
+        "                             "
+        "Default is 0 (disabled).")},
     {"pid-file",         SVNSERVE_OPT_PID_FILE, 1,
 #ifdef WIN32
      N_("write server process ID to file ARG\n"
@@ -515,10 +612,15 @@ accept_connection(connection_t **connection,
             connection_pool) == APR_CHILD_DONE)
             ;
         }
+
+      /* With statistics enabled, SOCK times out regularly such that we
+       * can update the file even while no clients connect. */
+      stats__write_file(params->stats, FALSE, connection_pool);
     }
   while (APR_STATUS_IS_EINTR(status)
     || APR_STATUS_IS_ECONNABORTED(status)
-    || APR_STATUS_IS_ECONNRESET(status));
+    || APR_STATUS_IS_ECONNRESET(status)
+    || (params->stats && APR_STATUS_IS_TIMEUP(status)));
 
   return status
        ? svn_error_wrap_apr(status, _("Can't accept client connection"))
@@ -615,6 +717,203 @@ static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
   return NULL;
 }
 
+/* In event-driven mode, all sockets that we wait for are in this set:
+   The listening socket (with NULL client data) and all idle connections
+   (with their connection_t as client data).  Connections get removed from
+   the set while they are being processed. */
+static apr_pollset_t *pollset;
+
+/* Load determination callback for serve_interruptable in event-driven
+   mode:  Always return after the current command such that idle
+   connections never block a worker thread. */
+static svn_boolean_t
+is_event_driven(connection_t *connection)
+{
+  return TRUE;
+}
+
+/* Add CONNECTION to POLLSET, i.e. wait for the next command to come in.
+   The caller must not access CONNECTION afterwards because the main
+   thread may pick it up immediately. */
+static apr_status_t
+park_connection(connection_t *connection)
+{
+  apr_pollfd_t descriptor = { 0 };
+
+  descriptor.p = connection->pool;
+  descriptor.desc_type = APR_POLL_SOCKET;
+  descriptor.desc.s = connection->usock;
+  descriptor.reqevents = APR_POLLIN;
+  descriptor.client_data = connection;
+
+  return apr_pollset_add(pollset, &descriptor);
+}
+
+/* Execute the next command on the connection given by DATA.  If further
+   commands have already been received, re-schedule the connection in
+   THREADS.  Otherwise, park it in POLLSET. */
+static void * APR_THREAD_FUNC serve_event_thread(apr_thread_t *tid,
+                                                 void *data)
+{
+  svn_boolean_t done;
+  svn_boolean_t has_command = FALSE;
+  connection_t *connection = data;
+  svn_error_t *err;
+  apr_status_t status;
+
+  apr_pool_t *pool = svn_root_pools__acquire_pool(connection_pools);
+
+  /* Process the command (or the initial handshake) and flush the
+     response to the client. */
+  err = serve_interruptable(&done, connection, is_event_driven, pool);
+  if (!err && !done)
+    err = svn_ra_svn__has_complete_command(&has_command, &done,
+                                           connection->conn, pool);
+
+  if (err)
+    {
+      logger__log_error(connection->params->logger, err, NULL,
+                        get_client_info(connection->conn, connection->params,
+                                        pool));
+      svn_error_clear(err);
+      done = TRUE;
+    }
+  svn_root_pools__release_pool(pool, connection_pools);
+
+  /* Close, re-schedule or park the connection. */
+  if (done)
+    close_connection(connection);
+  else if (has_command)
+    apr_thread_pool_push(threads, serve_event_thread, connection, 0, NULL);
+  else
+    {
+      status = park_connection(connection);
+      if (status)
+        {
+          err = svn_error_wrap_apr(status, _("Can't poll connection"));
+          logger__log_error(connection->params->logger, err, NULL, NULL);
+          svn_error_clear(err);
+          close_connection(connection);
+        }
+    }
+
+  return NULL;
+}
+
+/* Main loop of the event-driven mode:  Accept new connections on SOCK
+ * using PARAMS and wait for commands to come in on idle connections.
+ * Hand those over to the worker THREADS once the complete command has
+ * been received.  Use POOL for allocations.
+ *
+ * Only returns in case of fatal errors.
+ */
+static svn_error_t *
+serve_events(apr_socket_t *sock,
+             serve_params_t *params,
+             apr_pool_t *pool)
+{
+  apr_status_t status;
+  apr_pollfd_t descriptor = { 0 };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_interval_time_t timeout = params->stats
+                              ? stats__get_interval(params->stats)
+                              : -1;
+
+  /* Worker threads will add connections while we are polling.  Platforms
+     that can't support that (e.g. without epoll or kqueue) will fail. */
+  status = apr_pollset_create(&pollset, POLLSET_SIZE_HINT, pool,
+                              APR_POLLSET_THREADSAFE);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create poll set"));
+
+  descriptor.p = pool;
+  descriptor.desc_type = APR_POLL_SOCKET;
+  descriptor.desc.s = sock;
+  descriptor.reqevents = APR_POLLIN;
+  descriptor.client_data = NULL;
+
+  status = apr_pollset_add(pollset, &descriptor);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't poll connection"));
+
+  while (1)
+    {
+      const apr_pollfd_t *descriptors;
+      apr_int32_t count, i;
+
+      svn_pool_clear(iterpool);
+
+      status = apr_pollset_poll(pollset, timeout, &count, &descriptors);
+      stats__write_file(params->stats, FALSE, iterpool);
+      if (APR_STATUS_IS_EINTR(status) || APR_STATUS_IS_TIMEUP(status))
+        continue;
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't poll connections"));
+
+      for (i = 0; i < count; ++i)
+        {
+          connection_t *connection = descriptors[i].client_data;
+          svn_boolean_t has_command = TRUE;
+          svn_boolean_t terminated = FALSE;
+
+          if (connection == NULL)
+            {
+              /* New connections start with a handshake, i.e. there
+                 is nothing to wait for. */
+              SVN_ERR(accept_connection(&connection, sock, params,
+                                        connection_mode_event, pool));
+            }
+          else
+            {
+              svn_error_t *err;
+
+              /* Don't report this connection again while it is being
+                 checked and processed. */
+              status = apr_pollset_remove(pollset, &descriptors[i]);
+              if (status)
+                return svn_error_wrap_apr(status,
+                                          _("Can't poll connection"));
+
+              /* Only wake a worker once the full command is here.
+                 Otherwise, a slow client would block it. */
+              err = svn_ra_svn__has_complete_command(&has_command,
+                                                     &terminated,
+                                                     connection->conn,
+                                                     iterpool);
+              if (err)
+                {
+                  logger__log_error(params->logger, err, NULL,
+                                    get_client_info(connection->conn,
+                                                    params, iterpool));
+                  svn_error_clear(err);
+                  terminated = TRUE;
+                }
+            }
+
+          if (terminated)
+            {
+              close_connection(connection);
+            }
+          else if (has_command)
+            {
+              status = apr_thread_pool_push(threads, serve_event_thread,
+                                            connection, 0, NULL);
+              if (status)
+                return svn_error_wrap_apr(status, _("Can't push task"));
+            }
+          else
+            {
+              status = park_connection(connection);
+              if (status)
+                return svn_error_wrap_apr(status,
+                                          _("Can't poll connection"));
+            }
+        }
+    }
+
+  /* NOTREACHED */
+}
+
 #endif
 
 /* Write the PID of the current process as a decimal number, followed by a
@@ -637,6 +936,33 @@ static svn_error_t *write_pid_file(const char *filename, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Set *SECRET to a new random key for signing session tickets, allocated
+ * in POOL. */
+static svn_error_t *
+create_ticket_secret(const char **secret, apr_pool_t *pool)
+{
+#if APR_HAS_RANDOM
+  unsigned char key[32];
+  char *hex = apr_palloc(pool, 2 * sizeof(key) + 1);
+  apr_status_t status;
+  apr_size_t i;
+
+  status = apr_generate_random_bytes(key, sizeof(key));
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create session ticket key"));
+
+  for (i = 0; i < sizeof(key); i++)
+    apr_snprintf(hex + 2 * i, 3, "%02x", key[i]);
+
+  *secret = hex;
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Session tickets require a random number "
+                            "generator"));
+#endif
+}
+
 /* Version compatibility check */
 static svn_error_t *
 check_lib_versions(void)
@@ -683,6 +1009,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   svn_boolean_t cache_txdeltas = TRUE;
   svn_boolean_t cache_revprops = FALSE;
   svn_boolean_t use_block_read = FALSE;
+  svn_boolean_t cache_shared = FALSE;
   apr_uint16_t port = SVN_RA_SVN_PORT;
   const char *host = NULL;
   int family = APR_INET;
@@ -697,6 +1024,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   const char *config_filename = NULL;
   const char *pid_filename = NULL;
   const char *log_filename = NULL;
+  const char *stats_filename = NULL;
+  apr_int64_t stats_interval = 10;
+  apr_int64_t ticket_lifetime = 0;
   svn_node_kind_t kind;
   apr_size_t min_thread_count = THREADPOOL_MIN_SIZE;
   apr_size_t max_thread_count = THREADPOOL_MAX_SIZE;
@@ -718,12 +1048,18 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   params.read_only = FALSE;
   params.base = NULL;
   params.cfg = NULL;
+  params.compression = svn_ra_svn__compression_lz4;
   params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
   params.logger = NULL;
   params.config_pool = NULL;
   params.authz_pool = NULL;
   params.fs_config = NULL;
   params.vhost = FALSE;
+  params.stats = NULL;
+  params.session_ticket_lifetime = 0;
+  params.session_ticket_secret = NULL;
+  params.repos_cache = NULL;
+  params.replay_jobs = REPLAY_JOBS_DEFAULT;
   params.username_case = CASE_ASIS;
   params.memory_cache_size = (apr_uint64_t)-1;
   params.zero_copy_limit = 0;
@@ -846,12 +1182,31 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           handling_opt_count++;
           break;
 
+#if APR_HAS_THREADS
+        case SVNSERVE_OPT_EVENT_DRIVEN:
+          handling_mode = connection_mode_event;
+          handling_opt_count++;
+          break;
+#endif
+
         case 'c':
-          params.compression_level = atoi(arg);
-          if (params.compression_level < SVN_DELTA_COMPRESSION_LEVEL_NONE)
-            params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
-          if (params.compression_level > SVN_DELTA_COMPRESSION_LEVEL_MAX)
-            params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_MAX;
+          if (svn_ctype_isdigit(*arg))
+            {
+              params.compression_level = atoi(arg);
+              if (params.compression_level < SVN_DELTA_COMPRESSION_LEVEL_NONE)
+                params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
+              if (params.compression_level > SVN_DELTA_COMPRESSION_LEVEL_MAX)
+                params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_MAX;
+              params.compression
+                = params.compression_level > 0 ? svn_ra_svn__compression_lz4
+                                               : svn_ra_svn__compression_none;
+            }
+          else
+            {
+              SVN_ERR(svn_ra_svn__parse_compression(&params.compression,
+                                                    &params.compression_level,
+                                                    arg));
+            }
           break;
 
         case 'M':
@@ -874,6 +1229,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           use_block_read = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_CACHE_SHARED:
+          cache_shared = svn_tristate__from_word(arg) == svn_tristate_true;
+          break;
+
         case SVNSERVE_OPT_CLIENT_SPEED:
           {
             apr_size_t bandwidth = (apr_size_t)apr_strtoi64(arg, NULL, 0);
@@ -899,6 +1258,19 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           max_thread_count = (apr_size_t)apr_strtoi64(arg, NULL, 0);
           break;
 
+        case SVNSERVE_OPT_REPLAY_JOBS:
+          {
+            apr_uint64_t val;
+
+            err = svn_cstring_strtoui64(&val, arg, 1, REPLAY_JOBS_MAX, 10);
+            if (err)
+              return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, err,
+                                       _("Invalid number of replay jobs "
+                                         "'%s'"), arg);
+            params.replay_jobs = (int)val;
+          }
+          break;
+
 #ifdef WIN32
         case SVNSERVE_OPT_SERVICE:
           if (run_mode != run_mode_service)
@@ -932,6 +1304,25 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           SVN_ERR(svn_dirent_get_absolute(&log_filename, log_filename, pool));
           break;
 
+        case SVNSERVE_OPT_STATS_FILE:
+          SVN_ERR(svn_utf_cstring_to_utf8(&stats_filename, arg, pool));
+          stats_filename = svn_dirent_internal_style(stats_filename, pool);
+          SVN_ERR(svn_dirent_get_absolute(&stats_filename, stats_filename,
+                                          pool));
+          break;
+
+        case SVNSERVE_OPT_STATS_INTERVAL:
+          stats_interval = apr_strtoi64(arg, NULL, 0);
+          if (stats_interval < 1)
+            stats_interval = 1;
+          break;
+
+        case SVNSERVE_OPT_SESSION_TICKETS:
+          ticket_lifetime = apr_strtoi64(arg, NULL, 0);
+          if (ticket_lifetime < 0)
+            ticket_lifetime = 0;
+          break;
+
         }
     }
 
@@ -966,7 +1357,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   if (handling_opt_count > 1)
     {
       svn_error_clear(svn_cmdline_fputs(
-                      _("You may only specify one of -T or --single-thread\n"),
+                      _("You may only specify one of -T, --event-driven "
+                        "or --single-thread\n"),
                       stderr, pool));
       usage(argv[0], pool);
       *exit_code = EXIT_FAILURE;
@@ -974,7 +1366,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     }
 
   /* construct object pools */
-  is_multi_threaded = handling_mode == connection_mode_thread;
+  is_multi_threaded = handling_mode == connection_mode_thread
+                   || handling_mode == connection_mode_event;
   params.fs_config = apr_hash_make(pool);
   svn_hash_sets(params.fs_config, SVN_FS_CONFIG_FSFS_CACHE_DELTAS,
                 cache_txdeltas ? "1" :"0");
@@ -1042,6 +1435,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
                                      params.zero_copy_limit,
                                      params.error_check_interval,
                                      connection_pool);
+      svn_ra_svn__set_compression(conn, params.compression,
+                                  params.compression_level);
       err = serve(conn, &params, connection_pool);
       svn_pool_destroy(connection_pool);
 
@@ -1216,7 +1611,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       settings.cache_size = params.memory_cache_size;
 
     settings.single_threaded = TRUE;
-    if (handling_mode == connection_mode_thread)
+    if (is_multi_threaded || params.replay_jobs > 1)
       {
 #if APR_HAS_THREADS
         settings.single_threaded = FALSE;
@@ -1231,12 +1626,45 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       }
 
     svn_cache_config_set(&settings);
+
+    /* Let all forked children use the same cache.  It must be created
+     * before the first fork. */
+    if (cache_shared && handling_mode == connection_mode_fork)
+      SVN_ERR(svn_cache__share_global_membuffer_cache());
   }
 
+  /* All forked children must accept each other's session tickets. */
+  if (ticket_lifetime > 0)
+    {
+      SVN_ERR(create_ticket_secret(&params.session_ticket_secret, pool));
+      params.session_ticket_lifetime = apr_time_from_sec(ticket_lifetime);
+    }
+
+  /* Connections served by the same process may share repository
+   * instances instead of opening the repository every time. */
+  if (is_multi_threaded)
+    SVN_ERR(repos_cache_create(&params.repos_cache, REPOS_CACHE_MAX_IDLE,
+                               apr_time_from_sec(REPOS_CACHE_MAX_AGE),
+                               pool));
+
+  /* The statistics must be shared with all forked children as well. */
+  if (stats_filename)
+    {
+      SVN_ERR(stats__create(&params.stats, stats_filename,
+                            apr_time_from_sec(stats_interval),
+                            params.logger, pool));
+
+      /* Wake up the accept loop regularly to update the statistics. */
+      status = apr_socket_timeout_set(sock,
+                                      apr_time_from_sec(stats_interval));
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't set socket timeout"));
+    }
+
 #if APR_HAS_THREADS
   SVN_ERR(svn_root_pools__create(&connection_pools));
 
-  if (handling_mode == connection_mode_thread)
+  if (is_multi_threaded)
     {
       /* create the thread pool with a valid range of threads */
       if (max_thread_count < 1)
@@ -1259,11 +1687,19 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 
       /* don't queue requests unless we reached the worker thread limit */
       apr_thread_pool_threshold_set(threads, 0);
+
+      if (params.stats)
+        stats__set_thread_pool(params.stats, threads);
     }
   else
     {
       threads = NULL;
     }
+
+  /* In event-driven mode, the main thread only polls the sockets. */
+  if (   handling_mode == connection_mode_event
+      && run_mode != run_mode_listen_once)
+    return svn_error_trace(serve_events(sock, &params, pool));
 #endif
 
   while (1)
@@ -1275,6 +1711,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
         {
           err = serve_socket(connection, connection->pool);
           close_connection(connection);
+          stats__write_file(params.stats, TRUE, pool);
           return err;
         }
 
@@ -1318,6 +1755,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 #endif
           break;
 
+        case connection_mode_event:
+          /* Handled by serve_events(). */
+          SVN_ERR_MALFUNCTION_NO_RETURN();
+
         case connection_mode_single:
           /* Serve one connection at a time. */
           /* serve_socket() logs any error it returns, so ignore it. */
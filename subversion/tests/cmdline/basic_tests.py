@@ -25,7 +25,7 @@
 ######################################################################
 
 # General modules
-import shutil, stat, re, os, logging
+import shutil, stat, re, os, logging, time
 
 logger = logging.getLogger()
 
@@ -3114,6 +3114,56 @@ def plaintext_password_storage_disabled(sbox):
       f.close()
 
 
+def svnserve_stats_file(sbox):
+  "svnserve writes a statistics file"
+
+  sbox.build(create_wc=False, empty=True)
+  stats_file = os.path.abspath(sbox.get_tempname('stats'))
+
+  # The server exits after its first connection, so we can't probe it.
+  server, url = svntest.main.start_svnserve(sbox.repo_dir,
+                                            ['-X',
+                                             '--stats-file', stats_file,
+                                             '--stats-interval', '1'],
+                                            wait_for_listener=False)
+
+  def read_metric(name):
+    "Return the value of metric NAME in the stats file or None."
+    try:
+      for line in open(stats_file).readlines():
+        if line.startswith(name + ' '):
+          return int(line.split()[1])
+    except IOError:
+      pass
+    return None
+
+  try:
+    # The file gets refreshed while the server is waiting for clients.
+    deadline = time.time() + 30
+    while (read_metric('svnserve_uptime_seconds') or 0) < 2:
+      if time.time() > deadline:
+        raise svntest.Failure("statistics file not refreshed while idle")
+      time.sleep(0.1)
+
+    if read_metric('svnserve_connections_total') != 0:
+      raise svntest.Failure("unexpected connection count")
+
+    svntest.actions.run_and_verify_svn(None, [], 'info', url + '/')
+
+    # Serving that single connection was all the server had to do.
+    if server.wait() != 0:
+      raise svntest.Failure("svnserve failed")
+  finally:
+    svntest.main.stop_svnserve(server)
+
+  # The final update covers the connection.
+  if read_metric('svnserve_connections_total') != 1:
+    raise svntest.Failure("connection not counted")
+  if not re.search(r'^svnserve_commands_total\{command="[a-z-]+"\} [1-9]',
+                   open(stats_file).read(), re.MULTILINE):
+    raise svntest.Failure("commands not counted")
+
+
 ########################################################################
 # Run the tests
 
@@ -3184,6 +3234,7 @@ test_list = [ None,
               peg_rev_on_non_existent_wc_path,
               mkdir_parents_target_exists_on_disk,
               plaintext_password_storage_disabled,
+              svnserve_stats_file,
              ]
 
 if __name__ == '__main__':
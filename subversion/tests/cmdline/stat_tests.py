@@ -27,6 +27,7 @@
 # General modules
 import os
 import re
+import subprocess
 import time
 import datetime
 import logging
@@ -2303,6 +2304,49 @@ def status_missing_conflicts(sbox):
 
 
 
+def status_watched_wc(sbox):
+  "status of a working copy watched by svnwcwatch"
+
+  if not os.path.exists(svntest.main.svnwcwatch_binary):
+    raise svntest.Skip('svnwcwatch has not been built')
+
+  sbox.build()
+  wc_dir = sbox.wc_dir
+  cache = os.path.join(wc_dir, svntest.main.get_admin_name(),
+                       'watch', 'cache')
+
+  watcher = subprocess.Popen([svntest.main.svnwcwatch_binary, wc_dir],
+                             stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+  try:
+    # Status stores the listings once the watcher is up.
+    expected_status = svntest.actions.get_virginal_state(wc_dir, 1)
+    for i in range(100):
+      if watcher.poll() is not None:
+        err = watcher.stderr.read()
+        if 'not supported' in err:
+          raise svntest.Skip('svnwcwatch is not supported on this platform')
+        raise svntest.Failure('svnwcwatch failed: %s' % err)
+      svntest.actions.run_and_verify_status(wc_dir, expected_status)
+      if os.path.exists(cache):
+        break
+      time.sleep(0.1)
+    else:
+      raise svntest.Failure('status did not use the watcher')
+
+    # The listings get reused.
+    svntest.actions.run_and_verify_status(wc_dir, expected_status)
+
+    # But not for a directory that changed since.
+    svntest.main.file_append(sbox.ospath('A/mu'), 'appended mu text')
+    svntest.main.file_append(sbox.ospath('A/B/E/alpha'), 'appended alpha text')
+    expected_status.tweak('A/mu', 'A/B/E/alpha', status='M ')
+    svntest.actions.run_and_verify_status(wc_dir, expected_status)
+    svntest.actions.run_and_verify_status(wc_dir, expected_status)
+  finally:
+    if watcher.poll() is None:
+      watcher.kill()
+      watcher.wait()
+
 ########################################################################
 # Run the tests
 
@@ -2354,6 +2398,7 @@ test_list = [ None,
               status_move_missing_direct,
               status_move_missing_direct_base,
               status_missing_conflicts,
+              status_watched_wc,
              ]
 
 if __name__ == '__main__':
@@ -2954,6 +2954,80 @@ def load_no_svndate_r0(sbox):
                                          'proplist', '--revprop', '-r0',
                                          sbox.repo_dir)
 
+def verify_parallel(sbox):
+  "svnadmin verify --jobs"
+
+  sbox.build(create_wc = False)
+
+  # Add a few more revisions such that the workers have something to do.
+  for i in range(8):
+    svntest.actions.run_and_verify_svn(None, [],
+                                       'mkdir', '-m', 'log_msg',
+                                       sbox.repo_url + '/dir%d' % i)
+
+  exit_code, expected_output, errput = svntest.main.run_svnadmin("verify",
+                                                                 sbox.repo_dir)
+  if errput:
+    raise SVNUnexpectedStderr(errput)
+
+  # Parallel verification must report the same results in the same order.
+  for jobs in ['2', '4', '16']:
+    exit_code, output, errput = svntest.main.run_svnadmin("verify",
+                                                          "--jobs", jobs,
+                                                          sbox.repo_dir)
+    if errput:
+      raise SVNUnexpectedStderr(errput)
+
+    svntest.verify.compare_and_display_lines(
+      "Unexpected output of 'svnadmin verify --jobs %s'." % jobs,
+      'STDOUT', expected_output, output)
+
+
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+def fsfs_rewrite(sbox):
+  "svnfsfs rewrite into a new repository"
+
+  sbox.build()
+
+  # Give iota a long history, i.e. a long delta chain.
+  for i in range(20):
+    sbox.simple_append('iota', 'line %d\n' % i)
+    sbox.simple_commit(message='r%d' % (i + 2))
+
+  new_repo_dir = sbox.get_tempname()
+  exit_code, output, errput = svntest.main.run_svnfsfs('rewrite',
+                                                       sbox.repo_dir,
+                                                       new_repo_dir)
+  if errput:
+    raise SVNUnexpectedStderr(errput)
+  svntest.verify.verify_outputs("Unexpected output of 'svnfsfs rewrite'.",
+                                output, None,
+                                ['Rewrote revision %d.\n' % i
+                                 for i in range(1, 22)], None)
+
+  # The new repository has the same contents, revprops and UUID.
+  exit_code, expected_dump, errput = svntest.main.run_svnadmin(
+                                       'dump', '--quiet', sbox.repo_dir)
+  if errput:
+    raise SVNUnexpectedStderr(errput)
+  exit_code, actual_dump, errput = svntest.main.run_svnadmin(
+                                     'dump', '--quiet', new_repo_dir)
+  if errput:
+    raise SVNUnexpectedStderr(errput)
+  svntest.verify.compare_and_display_lines(
+    "Dump of the rewritten repository differs.", 'DUMP',
+    expected_dump, actual_dump)
+
+  svntest.actions.run_and_verify_svnadmin(None, [], 'verify', '--quiet',
+                                          new_repo_dir)
+
+  # The target must not exist yet.
+  exit_code, output, errput = svntest.main.run_svnfsfs('rewrite',
+                                                       sbox.repo_dir,
+                                                       new_repo_dir)
+  if not errput:
+    raise svntest.Failure("'svnfsfs rewrite' overwrote a repository")
+
 ########################################################################
 # Run the tests
 
@@ -3009,6 +3083,8 @@ test_list = [ None,
               upgrade,
               load_txdelta,
               load_no_svndate_r0,
+              verify_parallel,
+              fsfs_rewrite,
              ]
 
 if __name__ == '__main__':
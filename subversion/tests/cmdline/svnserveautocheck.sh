@@ -31,6 +31,8 @@
 # distribution; it's easiest to just run it as "make svnserveautocheck".
 # Like "make check", you can specify further options like
 # "make svnserveautocheck FS_TYPE=bdb TESTS=subversion/tests/cmdline/basic.py".
+# Set THREADED or EVENT_DRIVEN to run svnserve with --threads or
+# --event-driven, respectively.
 
 PYTHON=${PYTHON:-python}
 
@@ -103,6 +105,8 @@ done
 
 if [ "$THREADED" != "" ]; then
   SVNSERVE_ARGS="-T"
+elif [ "$EVENT_DRIVEN" != "" ]; then
+  SVNSERVE_ARGS="--event-driven"
 fi
 
 if [ ${CACHE_REVPROPS:+set} ]; then
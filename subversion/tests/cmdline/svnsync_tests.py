@@ -573,6 +573,39 @@ PROPS-END
   verify_mirror(dest_sbox, dump_out)
 
 
+#----------------------------------------------------------------------
+
+@SkipUnless(svntest.main.is_posix_os)
+def replay_jobs(sbox):
+  "sync from svnserve replaying on several threads"
+
+  svnsync_tests_dir = os.path.join(os.path.dirname(sys.argv[0]),
+                                   'svnsync_tests_data')
+  dumpfile_contents = open(os.path.join(svnsync_tests_dir,
+                                        'svnsync-trunk-A-changes.dump'),
+                           'rb').readlines()
+
+  sbox.build(create_wc=False, empty=True)
+  svntest.actions.run_and_verify_load(sbox.repo_dir, dumpfile_contents)
+
+  dest_sbox = sbox.clone_dependent()
+  dest_sbox.build(create_wc=False, empty=True)
+  svntest.actions.enable_revprop_changes(dest_sbox.repo_dir)
+
+  # Use a server of our own.
+  server, repo_url = svntest.main.start_svnserve(sbox.repo_dir,
+                                                 ['-d', '--foreground', '-T',
+                                                  '--replay-jobs', '4'])
+  try:
+    # The whole history gets replayed in a single replay-range command.
+    run_init(dest_sbox.repo_url, repo_url)
+    run_sync(dest_sbox.repo_url, repo_url)
+  finally:
+    svntest.main.stop_svnserve(server)
+
+  verify_mirror(dest_sbox, dumpfile_contents)
+
+
 ########################################################################
 # Run the tests
 
@@ -609,6 +642,7 @@ test_list = [ None,
               delete_revprops,
               fd_leak_sync_from_serf_to_local, # calls setrlimit
               mergeinfo_contains_r0,
+              replay_jobs,
              ]
 
 if __name__ == '__main__':
@@ -28,6 +28,7 @@ import os
 import shutil
 import re
 import stat
+import socket
 import subprocess
 import time
 import threading
@@ -164,6 +165,7 @@ svnversion_binary = P('svnversion/svnversion')
 svndumpfilter_binary = P('svndumpfilter/svndumpfilter')
 svnmucc_binary = P('svnmucc/svnmucc')
 svnfsfs_binary = P('svnfsfs/svnfsfs')
+svnserve_binary = P('svnserve/svnserve')
 entriesdump_binary = P('tests/cmdline/entries-dump')
 lock_helper_binary = P('tests/cmdline/lock-helper')
 atomic_ra_revprop_change_binary = P('tests/cmdline/atomic-ra-revprop-change')
@@ -179,6 +181,9 @@ svnauthz_binary = os.path.abspath('../../../tools/server-side/svnauthz' + _exe)
 svnauthz_validate_binary = os.path.abspath(
     '../../../tools/server-side/svnauthz-validate' + _exe
 )
+svnwcwatch_binary = os.path.abspath(
+    '../../../tools/client-side/svnwcwatch/svnwcwatch' + _exe
+)
 
 # Location to the pristine repository, will be calculated from test_area_url
 # when we know what the user specified for --url.
@@ -1217,6 +1222,46 @@ def write_restrictive_svnserve_conf_with_groups(repo_dir,
     fp.write("password-db = passwd\n")
   fp.close()
 
+def start_svnserve(repo_dir, options, wait_for_listener=True):
+  """Start an svnserve that serves REPO_DIR on a free port of the local
+  host, passing the list of additional command line OPTIONS.  If
+  WAIT_FOR_LISTENER is true, don't return before the server accepts
+  connections.  Don't set it for servers that exit after their first
+  connection.  Return the server process and the svn:// URL of its root.
+  Shut the server down with stop_svnserve()."""
+
+  # Let the OS pick a free port for the server.
+  s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+  s.bind(('127.0.0.1', 0))
+  port = s.getsockname()[1]
+  s.close()
+
+  server = subprocess.Popen([svnserve_binary,
+                             '--listen-host', '127.0.0.1',
+                             '--listen-port', str(port),
+                             '-r', os.path.abspath(repo_dir)] + options)
+
+  if wait_for_listener:
+    deadline = time.time() + 30
+    while True:
+      try:
+        socket.create_connection(('127.0.0.1', port)).close()
+        break
+      except socket.error:
+        if time.time() > deadline or server.poll() is not None:
+          stop_svnserve(server)
+          raise Failure("svnserve did not start")
+        time.sleep(0.1)
+
+  return server, 'svn://127.0.0.1:%d' % port
+
+def stop_svnserve(server):
+  "Terminate the SERVER process started by start_svnserve(), if running."
+
+  if server.poll() is None:
+    server.kill()
+    server.wait()
+
 # Warning: because mod_dav_svn uses one shared authz file for all
 # repositories, you *cannot* use write_authz_file in any test that
 # might be run in parallel.
@@ -2146,6 +2191,7 @@ def execute_tests(test_list, serial_only = False, test_name = None,
   global svnmucc_binary
   global svnauthz_binary
   global svnauthz_validate_binary
+  global svnwcwatch_binary
   global options
 
   if test_name:
@@ -2270,6 +2316,7 @@ def execute_tests(test_list, serial_only = False, test_name = None,
     svnauthz_binary = os.path.join(options.tools_bin, 'svnauthz' + _exe)
     svnauthz_validate_binary = os.path.join(options.tools_bin,
                                             'svnauthz-validate' + _exe)
+    svnwcwatch_binary = os.path.join(options.tools_bin, 'svnwcwatch' + _exe)
 
   ######################################################################
 
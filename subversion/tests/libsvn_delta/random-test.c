@@ -280,9 +280,11 @@ copy_tempfile(apr_file_t *fp, apr_pool_t *pool)
 
 
 
-/* (Note: *LAST_SEED is an output parameter.) */
+/* Encode the deltas as svndiff version SVNDIFF_VERSION.
+   (Note: *LAST_SEED is an output parameter.) */
 static svn_error_t *
 do_random_test(apr_pool_t *pool,
+               int svndiff_version,
                apr_uint32_t *last_seed)
 {
   apr_uint32_t seed, maxlen;
@@ -330,8 +332,8 @@ do_random_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, 1, i % 10,
-                              delta_pool);
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream,
+                              svndiff_version, i % 10, delta_pool);
 
       /* Make stage 1: create the text delta.  */
       svn_txdelta2(&txdelta_stream,
@@ -363,7 +365,18 @@ static svn_error_t *
 random_test(apr_pool_t *pool)
 {
   apr_uint32_t seed;
-  svn_error_t *err = do_random_test(pool, &seed);
+  svn_error_t *err = do_random_test(pool, 1, &seed);
+  if (err)
+    fprintf(stderr, "SEED: %lu\n", (unsigned long)seed);
+  return err;
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+random_test_svndiff2(apr_pool_t *pool)
+{
+  apr_uint32_t seed;
+  svn_error_t *err = do_random_test(pool, 2, &seed);
   if (err)
     fprintf(stderr, "SEED: %lu\n", (unsigned long)seed);
   return err;
@@ -371,9 +384,11 @@ random_test(apr_pool_t *pool)
 
 
 
-/* (Note: *LAST_SEED is an output parameter.) */
+/* Encode the deltas as svndiff version SVNDIFF_VERSION.
+   (Note: *LAST_SEED is an output parameter.) */
 static svn_error_t *
 do_random_combine_test(apr_pool_t *pool,
+                       int svndiff_version,
                        apr_uint32_t *last_seed)
 {
   apr_uint32_t seed, maxlen;
@@ -426,8 +441,8 @@ do_random_combine_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, 1, i % 10,
-                              delta_pool);
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream,
+                              svndiff_version, i % 10, delta_pool);
 
       /* Make stage 1: create the text deltas.  */
 
@@ -508,7 +523,18 @@ static svn_error_t *
 random_combine_test(apr_pool_t *pool)
 {
   apr_uint32_t seed;
-  svn_error_t *err = do_random_combine_test(pool, &seed);
+  svn_error_t *err = do_random_combine_test(pool, 1, &seed);
+  if (err)
+    fprintf(stderr, "SEED: %lu\n", (unsigned long)seed);
+  return err;
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+random_combine_test_svndiff2(apr_pool_t *pool)
+{
+  apr_uint32_t seed;
+  svn_error_t *err = do_random_combine_test(pool, 2, &seed);
   if (err)
     fprintf(stderr, "SEED: %lu\n", (unsigned long)seed);
   return err;
@@ -533,6 +559,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random delta test"),
     SVN_TEST_PASS2(random_combine_test,
                    "random combine delta test"),
+    SVN_TEST_PASS2(random_test_svndiff2,
+                   "random delta test with svndiff2"),
+    SVN_TEST_PASS2(random_combine_test_svndiff2,
+                   "random combine delta test with svndiff2"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
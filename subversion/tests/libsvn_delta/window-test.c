@@ -28,7 +28,10 @@
 #include "svn_types.h"
 #include "svn_error.h"
 #include "svn_delta.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_subr_private.h"
 
 static svn_error_t *
@@ -97,7 +100,248 @@ stream_window_test(apr_pool_t *pool)
 }
 
 
+
+/* Return the svndiff data of the delta between SOURCE and TARGET,
+   encoded as SVNDIFF_VERSION and computed using THREAD_COUNT threads.
+   If USE_RUN is set, use svn_txdelta__run, otherwise push the TARGET
+   data into svn_txdelta__target_push_svndiff in odd-sized chunks. */
+static svn_error_t *
+pipelined_svndiff(svn_stringbuf_t **result,
+                  const svn_string_t *source,
+                  const svn_string_t *target,
+                  int svndiff_version,
+                  int thread_count,
+                  svn_boolean_t use_run,
+                  apr_pool_t *pool)
+{
+  svn_stream_t *output;
+
+  *result = svn_stringbuf_create_empty(pool);
+  output = svn_stream_from_stringbuf(*result, pool);
+
+  if (use_run)
+    {
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      svn_checksum_t *checksum;
+      svn_checksum_t *expected;
+
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, output,
+                              svndiff_version,
+                              SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+      SVN_ERR(svn_txdelta__run(svn_stream_from_string(source, pool),
+                               svn_stream_from_string(target, pool),
+                               handler, handler_baton,
+                               svn_checksum_md5, &checksum,
+                               NULL, NULL, thread_count, pool, pool));
+
+      SVN_ERR(svn_checksum(&expected, svn_checksum_md5,
+                           target->data, target->len, pool));
+      SVN_TEST_ASSERT(svn_checksum_match(expected, checksum));
+    }
+  else
+    {
+      svn_stream_t *stream;
+      apr_size_t pos = 0;
+
+      stream = svn_txdelta__target_push_svndiff(
+                   svn_stream_from_string(source, pool), output,
+                   svndiff_version, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                   thread_count, pool);
+
+      while (pos < target->len)
+        {
+          apr_size_t len = MIN(target->len - pos, 33333);
+          SVN_ERR(svn_stream_write(stream, target->data + pos, &len));
+          pos += len;
+        }
+
+      SVN_ERR(svn_stream_close(stream));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+pipelined_delta_test(apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_stringbuf_t *source = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *target = svn_stringbuf_create_empty(pool);
+  apr_uint32_t seed = 0x4d595df4;
+  apr_size_t sizes[] = { 0, 1000, 102400, 1234567 };
+  int i, version;
+
+  /* Semi-compressible source data with scattered changes in the target.
+     The target is a bit longer such that some windows have no source. */
+  while (source->len < 1100000)
+    {
+      seed = seed * 1103515245 + 12345;
+      svn_stringbuf_appendcstr(source, (seed >> 16) & 1 ? "foo\n" : "bar\n");
+      svn_stringbuf_appendbyte(source, (char)(seed >> 24));
+    }
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+      apr_size_t k;
+      svn_string_t source_str;
+      svn_string_t target_str;
+
+      svn_stringbuf_setempty(target);
+      for (k = 0; k < sizes[i]; ++k)
+        svn_stringbuf_appendbyte(target, k % 997 == 0
+                                          ? 'X'
+                                          : source->data[k % source->len]);
+
+      source_str.data = source->data;
+      source_str.len = source->len;
+      target_str.data = target->data;
+      target_str.len = target->len;
+
+      for (version = 0; version <= 2; ++version)
+        {
+          svn_stringbuf_t *expected, *actual;
+          svn_boolean_t use_run;
+
+          svn_pool_clear(iterpool);
+          for (use_run = FALSE; use_run <= TRUE; ++use_run)
+            {
+              SVN_ERR(pipelined_svndiff(&expected, &source_str, &target_str,
+                                        version, 1, use_run, iterpool));
+              SVN_ERR(pipelined_svndiff(&actual, &source_str, &target_str,
+                                        version, 4, use_run, iterpool));
+
+              SVN_TEST_ASSERT(svn_stringbuf_compare(expected, actual));
+            }
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 
+/* Window handler that appends a copy of every window it receives to the
+   apr_array_header_t of svn_txdelta_window_t * in BATON. */
+static svn_error_t *
+collect_window(svn_txdelta_window_t *window, void *baton)
+{
+  apr_array_header_t *windows = baton;
+
+  if (window)
+    APR_ARRAY_PUSH(windows, svn_txdelta_window_t *)
+      = svn_txdelta_window_dup(window, windows->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the window with a single "new data" op inserting DATA. */
+static svn_txdelta_window_t *
+make_new_data_window(const svn_string_t *data,
+                     apr_pool_t *pool)
+{
+  svn_txdelta_window_t *window = apr_pcalloc(pool, sizeof(*window));
+  svn_txdelta_op_t *op = apr_pcalloc(pool, sizeof(*op));
+
+  window->tview_len = data->len;
+  window->new_data = data;
+  if (data->len)
+    {
+      op->action_code = svn_txdelta_new;
+      op->offset = 0;
+      op->length = data->len;
+      window->num_ops = 1;
+      window->ops = op;
+    }
+
+  return window;
+}
+
+static svn_error_t *
+svndiff2_roundtrip_test(apr_pool_t *pool)
+{
+  svn_stringbuf_t *incompressible = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *compressible = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *svndiff = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *packed = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *unpacked = svn_stringbuf_create_empty(pool);
+  apr_array_header_t *received
+    = apr_array_make(pool, 4, sizeof(svn_txdelta_window_t *));
+  svn_txdelta_window_t *windows[3];
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *stream;
+  apr_uint32_t seed = 0x1b873593;
+  int i;
+
+  while (incompressible->len < 10000)
+    {
+      seed = seed * 1103515245 + 12345;
+      svn_stringbuf_appendbyte(incompressible, (char)(seed >> 24));
+      svn_stringbuf_appendcstr(compressible, "svndiff2 ");
+    }
+
+  /* An empty window, one whose data LZ4 cannot shrink and one it can. */
+  windows[0] = make_new_data_window(svn_string_create_empty(pool), pool);
+  windows[1] = make_new_data_window(
+                 svn_string_create_from_buf(incompressible, pool), pool);
+  windows[2] = make_new_data_window(
+                 svn_string_create_from_buf(compressible, pool), pool);
+
+  /* Encode them as svndiff2 and parse the result back. */
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(svndiff, pool),
+                          2, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  for (i = 0; i < 3; ++i)
+    SVN_ERR(handler(windows[i], handler_baton));
+  SVN_ERR(handler(NULL, handler_baton));
+
+  SVN_TEST_ASSERT(svndiff->len > 4 && svndiff->data[3] == 2);
+
+  stream = svn_txdelta_parse_svndiff(collect_window, received, TRUE, pool);
+  SVN_ERR(svn_stream_write(stream, svndiff->data, &svndiff->len));
+  SVN_ERR(svn_stream_close(stream));
+
+  SVN_TEST_ASSERT(received->nelts == 3);
+  for (i = 0; i < 3; ++i)
+    {
+      svn_txdelta_window_t *expected = windows[i];
+      svn_txdelta_window_t *actual
+        = APR_ARRAY_IDX(received, i, svn_txdelta_window_t *);
+
+      SVN_TEST_ASSERT(actual->tview_len == expected->tview_len);
+      SVN_TEST_ASSERT(actual->num_ops == expected->num_ops);
+      SVN_TEST_ASSERT(svn_string_compare(actual->new_data,
+                                         expected->new_data));
+    }
+
+  /* The raw codec must round-trip empty and incompressible data, too,
+     and store the latter without growing it by more than the header. */
+  SVN_ERR(svn__compress_lz4(svn_stringbuf_create_empty(pool), packed));
+  SVN_ERR(svn__decompress_lz4(packed, unpacked, 0));
+  SVN_TEST_ASSERT(unpacked->len == 0);
+
+  SVN_ERR(svn__compress_lz4(incompressible, packed));
+  SVN_TEST_ASSERT(packed->len <= incompressible->len
+                                 + SVN__MAX_ENCODED_UINT_LEN);
+  SVN_ERR(svn__decompress_lz4(packed, unpacked, incompressible->len));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(unpacked, incompressible));
+
+  SVN_ERR(svn__compress_lz4(compressible, packed));
+  SVN_TEST_ASSERT(packed->len < compressible->len);
+  SVN_ERR(svn__decompress_lz4(packed, unpacked, compressible->len));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(unpacked, compressible));
+
+  /* The size limit is enforced. */
+  SVN_TEST_ASSERT_ERROR(svn__decompress_lz4(packed, unpacked,
+                                            compressible->len - 1),
+                        SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA);
+
+  return SVN_NO_ERROR;
+}
+
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -107,6 +351,10 @@ static struct svn_test_descriptor_t test_funcs[] =
     SVN_TEST_NULL,
     SVN_TEST_PASS2(stream_window_test,
                    "txdelta stream and windows test"),
+    SVN_TEST_PASS2(pipelined_delta_test,
+                   "multi-threaded delta computation"),
+    SVN_TEST_PASS2(svndiff2_roundtrip_test,
+                   "svndiff2 round-trip of special windows"),
     SVN_TEST_NULL
   };
 
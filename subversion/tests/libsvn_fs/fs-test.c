@@ -6498,6 +6498,85 @@ test_zero_copy_processsing(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_file_storage(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *root;
+  svn_revnum_t rev;
+  const struct svn_test__tree_entry_t *node;
+  apr_file_t *file;
+  apr_off_t offset;
+  svn_filesize_t length;
+  int svndiff_version;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Start with a new repo and the greek tree in rev 1. */
+  SVN_ERR(svn_test__create_fs(&fs, "test-repo-file-storage", opts, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+
+  /* Txn contents are never available. */
+  SVN_ERR(svn_fs__get_file_storage(&file, &offset, &length,
+                                   &svndiff_version, txn_root, "iota",
+                                   pool, pool));
+  SVN_TEST_ASSERT(file == NULL);
+
+  SVN_ERR(test_commit_txn(&rev, txn, NULL, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+
+  /* Whatever the backend reports must reproduce the contents. */
+  for (node = svn_test__greek_tree_nodes; node->path; node++)
+    if (node->contents)
+      {
+        svn_stringbuf_t *data;
+        apr_size_t len;
+
+        svn_pool_clear(iterpool);
+
+        SVN_ERR(svn_fs__get_file_storage(&file, &offset, &length,
+                                         &svndiff_version, root, node->path,
+                                         iterpool, iterpool));
+        if (file == NULL)
+          continue;
+
+        len = (apr_size_t)length;
+        data = svn_stringbuf_create_ensure(len, iterpool);
+        SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, iterpool));
+        SVN_ERR(svn_io_file_read_full2(file, data->data, len, NULL, NULL,
+                                       iterpool));
+        data->len = len;
+        data->data[len] = '\0';
+
+        if (svndiff_version >= 0)
+          {
+            svn_txdelta_window_handler_t handler;
+            void *baton;
+            svn_stream_t *svndiff;
+            svn_stringbuf_t *contents = svn_stringbuf_create_empty(iterpool);
+
+            svn_txdelta_apply(svn_stream_empty(iterpool),
+                              svn_stream_from_stringbuf(contents, iterpool),
+                              NULL, NULL, iterpool, &handler, &baton);
+            svndiff = svn_txdelta_parse_svndiff(handler, baton, TRUE,
+                                                iterpool);
+            SVN_ERR(svn_stream_write(svndiff, data->data, &len));
+            SVN_ERR(svn_stream_close(svndiff));
+            data = contents;
+          }
+
+        SVN_TEST_STRING_ASSERT(data->data, node->contents);
+      }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_dir_optimal_order(const svn_test_opts_t *opts,
                        apr_pool_t *pool)
@@ -7120,6 +7199,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test setting and getting internal txn props"),
     SVN_TEST_OPTS_PASS(check_txn_related,
                        "test svn_fs_check_related for transactions"),
+    SVN_TEST_OPTS_PASS(test_file_storage,
+                       "test svn_fs__get_file_storage"),
     SVN_TEST_NULL
   };
 
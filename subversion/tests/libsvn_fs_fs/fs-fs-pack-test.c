@@ -29,12 +29,14 @@
 #include "../../libsvn_fs_fs/fs.h"
 #include "../../libsvn_fs_fs/fs_fs.h"
 #include "../../libsvn_fs_fs/low_level.h"
+#include "../../libsvn_fs_fs/rep-cache.h"
 #include "../../libsvn_fs_fs/util.h"
 
 #include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
+#include "private/svn_fspath.h"
 #include "private/svn_string_private.h"
 
 #include "../svn_test_fs.h"
@@ -101,17 +103,17 @@ pack_notify(void *baton,
 
 #define R1_LOG_MSG "Let's serf"
 
-/* Create a packed filesystem in DIR.  Set the shard size to
+/* Create a non-packed filesystem in DIR.  Set the shard size to
    SHARD_SIZE and create NUM_REVS number of revisions (in addition to
    r0).  Use POOL for allocations.  After this function successfully
    completes, the filesystem's youngest revision number will be the
    same as NUM_REVS.  */
 static svn_error_t *
-create_packed_filesystem(const char *dir,
-                         const svn_test_opts_t *opts,
-                         svn_revnum_t num_revs,
-                         int shard_size,
-                         apr_pool_t *pool)
+create_non_packed_filesystem(const char *dir,
+                             const svn_test_opts_t *opts,
+                             svn_revnum_t num_revs,
+                             int shard_size,
+                             apr_pool_t *pool)
 {
   svn_fs_t *fs;
   svn_fs_txn_t *txn;
@@ -119,7 +121,6 @@ create_packed_filesystem(const char *dir,
   const char *conflict;
   svn_revnum_t after_rev;
   apr_pool_t *subpool = svn_pool_create(pool);
-  struct pack_notify_baton pnb;
   apr_pool_t *iterpool;
   apr_hash_t *fs_config;
 
@@ -166,6 +167,43 @@ create_packed_filesystem(const char *dir,
   svn_pool_destroy(iterpool);
   svn_pool_destroy(subpool);
 
+  return SVN_NO_ERROR;
+}
+
+/* Append TEXT to the fsfs.conf file of the repository at DIR.
+   Use POOL for allocations.  */
+static svn_error_t *
+append_to_fsfs_conf(const char *dir,
+                    const char *text,
+                    apr_pool_t *pool)
+{
+  const char *conf_path = svn_dirent_join(dir, PATH_CONFIG, pool);
+  svn_stringbuf_t *conf;
+
+  SVN_ERR(svn_stringbuf_from_file2(&conf, conf_path, pool));
+  svn_stringbuf_appendcstr(conf, text);
+  SVN_ERR(svn_io_write_atomic(conf_path, conf->data, conf->len, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Create a packed filesystem in DIR.  Set the shard size to
+   SHARD_SIZE and create NUM_REVS number of revisions (in addition to
+   r0).  Use POOL for allocations.  After this function successfully
+   completes, the filesystem's youngest revision number will be the
+   same as NUM_REVS.  */
+static svn_error_t *
+create_packed_filesystem(const char *dir,
+                         const svn_test_opts_t *opts,
+                         svn_revnum_t num_revs,
+                         int shard_size,
+                         apr_pool_t *pool)
+{
+  struct pack_notify_baton pnb;
+
+  SVN_ERR(create_non_packed_filesystem(dir, opts, num_revs, shard_size,
+                                       pool));
+
   /* Now pack the FS */
   pnb.expected_shard = 0;
   pnb.expected_action = svn_fs_pack_notify_start;
@@ -1647,7 +1685,595 @@ delta_chain_with_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-pack-concurrently"
+#define SHARD_SIZE 3
+#define MAX_REV 40
+static svn_error_t *
+pack_concurrently(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  struct pack_notify_baton pnb;
+  svn_revnum_t i;
+
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                       pool));
+
+  /* Pack using several threads and a small memory budget per shard. */
+  SVN_ERR(append_to_fsfs_conf(REPO_NAME,
+                              "\n[" CONFIG_SECTION_PACK "]\n"
+                              CONFIG_OPTION_CONCURRENCY " = 4\n"
+                              CONFIG_OPTION_MAX_MEM " = 1\n",
+                              pool));
+
+  /* Shards must still be reported in order. */
+  pnb.expected_shard = 0;
+  pnb.expected_action = svn_fs_pack_notify_start;
+  SVN_ERR(svn_fs_pack(REPO_NAME, pack_notify, &pnb, NULL, NULL, pool));
+  SVN_TEST_ASSERT(pnb.expected_shard == (MAX_REV + 1) / SHARD_SIZE);
+
+  /* The result must be consistent and complete. */
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
+                        pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+
+  for (i = 1; i < (MAX_REV + 1); i++)
+    {
+      svn_fs_root_t *rev_root;
+      svn_stringbuf_t *contents;
+
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, pool));
+      SVN_ERR(svn_test__get_file_contents(rev_root, "iota", &contents, pool));
+
+      if (i == 1)
+        SVN_TEST_STRING_ASSERT(contents->data, "This is the file 'iota'.\n");
+      else
+        SVN_TEST_STRING_ASSERT(contents->data, get_rev_contents(i, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-read-mapped-packed-fs"
+#define SHARD_SIZE 5
+#define MAX_REV 23
+static svn_error_t *
+read_mapped_packed_fs(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_revnum_t i;
+  apr_hash_t *fs_config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(append_to_fsfs_conf(REPO_NAME,
+                              "\n[" CONFIG_SECTION_IO "]\n"
+                              CONFIG_OPTION_MMAP_PACK_FILES " = true\n",
+                              pool));
+
+  /* Use a new cache namespace to make sure we actually read from disk. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  /* Read every revision twice such that we also re-use mappings. */
+  for (i = 1; i < 2 * (MAX_REV + 1); i++)
+    {
+      svn_revnum_t rev = i % (MAX_REV + 1);
+      svn_fs_root_t *rev_root;
+      svn_stringbuf_t *contents;
+
+      if (rev == 0)
+        continue;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, rev, iterpool));
+      SVN_ERR(svn_test__get_file_contents(rev_root, "iota", &contents,
+                                          iterpool));
+
+      if (rev == 1)
+        SVN_TEST_STRING_ASSERT(contents->data, "This is the file 'iota'.\n");
+      else
+        SVN_TEST_STRING_ASSERT(contents->data,
+                               get_rev_contents(rev, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Verification reads mapped and non-mapped data. */
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, MAX_REV, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-rep-cache-batching"
+
+/* Walker function for svn_fs_fs__walk_rep_reference() counting the
+   entries in the int given as BATON. */
+static svn_error_t *
+count_rep_cache_entry(representation_t *rep,
+                      void *baton,
+                      svn_fs_t *fs,
+                      apr_pool_t *scratch_pool)
+{
+  int *count = baton;
+  ++*count;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+rep_cache_batching(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_t *other_fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  int count;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  const char *hello_str = multiply_string("Hello, ", pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(append_to_fsfs_conf(REPO_NAME,
+                              "\n[" CONFIG_SECTION_REP_SHARING "]\n"
+                              CONFIG_OPTION_REP_CACHE_BATCH_SIZE " = 100\n",
+                              pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, subpool, subpool));
+
+  /* Revision 1: add a file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, subpool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, subpool));
+  SVN_ERR(svn_fs_make_file(root, "foo", subpool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", hello_str, subpool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, subpool));
+
+  /* Revision 2: add a copy of it that must share the pending entry. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, subpool));
+  SVN_ERR(svn_fs_make_file(root, "bar", subpool));
+  SVN_ERR(svn_test__set_file_contents(root, "bar", hello_str, subpool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, subpool));
+
+  SVN_ERR(count_representations(&count, fs, rev, subpool));
+  SVN_TEST_ASSERT(count == 1);
+
+  /* Nothing has been written to the database yet. */
+  SVN_ERR(svn_fs_open2(&other_fs, REPO_NAME, NULL, pool, pool));
+  count = 0;
+  SVN_ERR(svn_fs_fs__walk_rep_reference(other_fs, 0, rev,
+                                        count_rep_cache_entry, &count,
+                                        NULL, NULL, pool));
+  SVN_TEST_ASSERT(count == 0);
+
+  /* Closing the filesystem writes the pending entries. */
+  svn_pool_destroy(subpool);
+
+  count = 0;
+  SVN_ERR(svn_fs_fs__walk_rep_reference(other_fs, 0, rev,
+                                        count_rep_cache_entry, &count,
+                                        NULL, NULL, pool));
+  SVN_TEST_ASSERT(count > 0);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-rep-cache-filter"
+
+/* Look up COUNT SHA1 checksums that are not in the rep-cache of FS and
+   verify that none of them gets found.  A few thousand lookups will make
+   FS build its rep-cache filter.  Use POOL for temporary allocations. */
+static svn_error_t *
+lookup_missing_reps(svn_fs_t *fs,
+                    int count,
+                    apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < count; ++i)
+    {
+      svn_checksum_t *checksum;
+      representation_t *rep;
+      const char *text;
+
+      svn_pool_clear(iterpool);
+      text = apr_psprintf(iterpool, "missing %d", i);
+      SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, text, strlen(text),
+                           iterpool));
+      SVN_ERR(svn_fs_fs__get_rep_reference(&rep, fs, checksum, iterpool));
+      SVN_TEST_ASSERT(rep == NULL);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Verify that the rep-cache of FS has an entry for the fulltext CONTENTS.
+   Use POOL for temporary allocations. */
+static svn_error_t *
+assert_rep_cached(svn_fs_t *fs,
+                  const char *contents,
+                  apr_pool_t *pool)
+{
+  svn_checksum_t *checksum;
+  representation_t *rep;
+
+  SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, contents,
+                       strlen(contents), pool));
+  SVN_ERR(svn_fs_fs__get_rep_reference(&rep, fs, checksum, pool));
+  if (rep == NULL)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "rep-cache entry for '%s' reported missing",
+                             contents);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+rep_cache_filter(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  enum { FILE_COUNT = 20 };
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  int i;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(append_to_fsfs_conf(REPO_NAME,
+                              "\n[" CONFIG_SECTION_REP_SHARING "]\n"
+                              CONFIG_OPTION_REP_CACHE_FILTER " = true\n",
+                              pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  ffd = fs->fsap_data;
+  SVN_TEST_ASSERT(ffd->rep_cache_filter_enabled);
+
+  /* Revisions 1 .. FILE_COUNT: add files with distinct contents. */
+  rev = 0;
+  for (i = 0; i < FILE_COUNT; ++i)
+    {
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = apr_psprintf(iterpool, "f%d", i);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      SVN_ERR(svn_fs_make_file(root, path, iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, path,
+                                          get_rev_contents(i, iterpool),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  /* Make sure the entries are in the database and not just pending. */
+  SVN_ERR(svn_fs_fs__flush_rep_references(fs, pool));
+
+  /* Unknown reps are reported as such, with or without a filter. */
+  SVN_ERR(lookup_missing_reps(fs, 2000, pool));
+
+  /* A rep that really is cached must never be reported missing. */
+  for (i = 0; i < FILE_COUNT; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(assert_rep_cached(fs, get_rev_contents(i, iterpool),
+                                iterpool));
+    }
+
+  /* Nor may entries that were added after the filter had been built. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "new", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "new", "new contents\n", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_ERR(svn_fs_fs__flush_rep_references(fs, pool));
+
+  SVN_ERR(lookup_missing_reps(fs, 2000, pool));
+  SVN_ERR(assert_rep_cached(fs, "new contents\n", pool));
+  for (i = 0; i < FILE_COUNT; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(assert_rep_cached(fs, get_rev_contents(i, iterpool),
+                                iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+
 
+/* ------------------------------------------------------------------------ */
+
+/* Set *DIGEST_PATH to the lock digest file of PATH in FS. */
+static svn_error_t *
+lock_digest_path(const char **digest_path,
+                 svn_fs_t *fs,
+                 const char *path,
+                 apr_pool_t *pool)
+{
+  svn_checksum_t *checksum;
+  const char *digest;
+
+  SVN_ERR(svn_checksum(&checksum, svn_checksum_md5, path, strlen(path),
+                       pool));
+  digest = svn_checksum_to_cstring_display(checksum, pool);
+  *digest_path = svn_dirent_join_many(pool, fs->path, PATH_LOCKS_DIR,
+                                      apr_pstrmemdup(pool, digest, 3),
+                                      digest, SVN_VA_NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Append the paths in the NULL-terminated LIST to PATHS. */
+static void
+append_paths(apr_array_header_t *paths,
+             const char **list)
+{
+  for (; *list; ++list)
+    APR_ARRAY_PUSH(paths, const char *) = *list;
+}
+
+/* Implements svn_fs_lock_callback_t.  Fail on any per-path error and
+   count the paths reported in the int BATON. */
+static svn_error_t *
+count_locks_cb(void *baton,
+               const char *path,
+               const svn_lock_t *lock,
+               svn_error_t *fs_err,
+               apr_pool_t *pool)
+{
+  int *count = baton;
+
+  SVN_ERR(svn_error_dup(fs_err));
+  ++*count;
+
+  return SVN_NO_ERROR;
+}
+
+/* Lock the PATHS in revision REV of FS in a single batch or, if UNLOCK
+   is set, break their locks in a single batch. */
+static svn_error_t *
+lock_batch(svn_fs_t *fs,
+           svn_revnum_t rev,
+           const apr_array_header_t *paths,
+           svn_boolean_t unlock,
+           apr_pool_t *pool)
+{
+  apr_hash_t *targets = apr_hash_make(pool);
+  svn_fs_lock_target_t *target = svn_fs_lock_target_create(NULL, rev, pool);
+  int count = 0;
+  int i;
+
+  for (i = 0; i < paths->nelts; ++i)
+    svn_hash_sets(targets, APR_ARRAY_IDX(paths, i, const char *),
+                  unlock ? (const void *)"" : (const void *)target);
+
+  if (unlock)
+    SVN_ERR(svn_fs_unlock_many(fs, targets, TRUE, count_locks_cb, &count,
+                               pool, pool));
+  else
+    SVN_ERR(svn_fs_lock_many(fs, targets, "comment", FALSE, 0, FALSE,
+                             count_locks_cb, &count, pool, pool));
+
+  SVN_TEST_ASSERT(count == paths->nelts);
+  return SVN_NO_ERROR;
+}
+
+/* Verify that the lock index digest file of each directory in the
+   NULL-terminated DIRS in FS lists exactly the digest file names of
+   those LOCKED paths that are below it.  If there are none, the digest
+   file must not exist.  Also verify that all LOCKED paths are locked. */
+static svn_error_t *
+check_lock_index(svn_fs_t *fs,
+                 const char **dirs,
+                 const apr_array_header_t *locked,
+                 apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < locked->nelts; ++i)
+    {
+      svn_lock_t *lock;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_get_lock(&lock, fs,
+                              APR_ARRAY_IDX(locked, i, const char *),
+                              iterpool));
+      SVN_TEST_ASSERT(lock);
+    }
+
+  for (; *dirs; ++dirs)
+    {
+      apr_hash_t *expected;
+      apr_hash_t *hash;
+      apr_array_header_t *children;
+      const char *digest_path;
+      svn_string_t *value;
+      svn_node_kind_t kind;
+      svn_stream_t *stream;
+
+      svn_pool_clear(iterpool);
+      expected = apr_hash_make(iterpool);
+      hash = apr_hash_make(iterpool);
+
+      for (i = 0; i < locked->nelts; ++i)
+        {
+          const char *path = APR_ARRAY_IDX(locked, i, const char *);
+          const char *relpath = svn_fspath__skip_ancestor(*dirs, path);
+
+          if (relpath && *relpath)
+            {
+              SVN_ERR(lock_digest_path(&digest_path, fs, path, iterpool));
+              svn_hash_sets(expected, svn_dirent_basename(digest_path, NULL),
+                            path);
+            }
+        }
+
+      SVN_ERR(lock_digest_path(&digest_path, fs, *dirs, iterpool));
+      SVN_ERR(svn_io_check_path(digest_path, &kind, iterpool));
+      if (apr_hash_count(expected) == 0)
+        {
+          SVN_TEST_ASSERT(kind == svn_node_none);
+          continue;
+        }
+      SVN_TEST_ASSERT(kind == svn_node_file);
+
+      SVN_ERR(svn_stream_open_readonly(&stream, digest_path,
+                                       iterpool, iterpool));
+      SVN_ERR(svn_hash_read2(hash, stream, SVN_HASH_TERMINATOR, iterpool));
+      SVN_ERR(svn_stream_close(stream));
+
+      value = svn_hash_gets(hash, "children");
+      SVN_TEST_ASSERT(value);
+      children = svn_cstring_split(value->data, "\n", FALSE, iterpool);
+      SVN_TEST_ASSERT(children->nelts == apr_hash_count(expected));
+      for (i = 0; i < children->nelts; ++i)
+        SVN_TEST_ASSERT(svn_hash_gets(expected,
+                                      APR_ARRAY_IDX(children, i,
+                                                    const char *)));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#define REPO_NAME "test-repo-lock-many-digests"
+static svn_error_t *
+lock_many_digests(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  static const char *dirs[] = { "/", "/A", "/A/B", "/A/B/E", "/A/C",
+                                "/A/D", "/A/D/G", "/A/D/H", "/shared",
+                                NULL };
+  static const char *first[] = { "/A/B/E/alpha", "/A/B/E/beta",
+                                 "/A/D/H/omega", NULL };
+  static const char *second[] = { "/iota", "/A/mu", "/A/B/lambda",
+                                  "/A/D/G/pi", "/A/D/G/rho", NULL };
+  const char *shared[3] = { NULL, NULL, NULL };
+  apr_hash_t *digest_dirs = apr_hash_make(pool);
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_fs_access_t *access;
+  svn_revnum_t rev;
+  apr_array_header_t *paths;
+  apr_array_header_t *locked;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  /* Find two paths whose digest files share a digest directory, so that
+     the second one of them gets written to a directory known to exist. */
+  for (i = 0; !shared[0]; ++i)
+    {
+      const char *path = apr_psprintf(pool, "/shared/file-%d", i);
+      const char *digest_path;
+      const char *digest_dir;
+      const char *other;
+
+      SVN_ERR(lock_digest_path(&digest_path, fs, path, pool));
+      digest_dir = svn_dirent_dirname(digest_path, pool);
+      other = svn_hash_gets(digest_dirs, digest_dir);
+      if (other)
+        {
+          shared[0] = other;
+          shared[1] = path;
+        }
+      else
+        svn_hash_sets(digest_dirs, digest_dir, path);
+    }
+
+  /* Revision 1: the greek tree plus those two files. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(root, pool));
+  SVN_ERR(svn_fs_make_dir(root, "/shared", pool));
+  SVN_ERR(svn_fs_make_file(root, shared[0], pool));
+  SVN_ERR(svn_fs_make_file(root, shared[1], pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(svn_fs_create_access(&access, "bubba", pool));
+  SVN_ERR(svn_fs_set_access(fs, access));
+
+  /* Lock everything in one batch.  Every parent index must list all of
+     the locked paths below it. */
+  locked = apr_array_make(pool, 16, sizeof(const char *));
+  append_paths(locked, first);
+  append_paths(locked, second);
+  append_paths(locked, shared);
+  SVN_ERR(lock_batch(fs, rev, locked, FALSE, pool));
+  SVN_ERR(check_lock_index(fs, dirs, locked, pool));
+
+  /* Unlock some of them in one batch.  Indexes that become empty go
+     away, the others must shrink. */
+  paths = apr_array_make(pool, 16, sizeof(const char *));
+  append_paths(paths, first);
+  APR_ARRAY_PUSH(paths, const char *) = shared[0];
+  SVN_ERR(lock_batch(fs, rev, paths, TRUE, pool));
+
+  locked = apr_array_make(pool, 16, sizeof(const char *));
+  append_paths(locked, second);
+  APR_ARRAY_PUSH(locked, const char *) = shared[1];
+  SVN_ERR(check_lock_index(fs, dirs, locked, pool));
+
+  /* Unlock the rest.  No index may remain. */
+  SVN_ERR(lock_batch(fs, rev, locked, TRUE, pool));
+  apr_array_clear(locked);
+  SVN_ERR(check_lock_index(fs, dirs, locked, pool));
+
+  /* The digest directories known to exist are remembered per batch
+     only.  A new batch must re-create them when they are gone. */
+  SVN_ERR(svn_io_remove_dir2(svn_dirent_join(fs->path, PATH_LOCKS_DIR, pool),
+                             FALSE, NULL, NULL, pool));
+  append_paths(locked, shared);
+  APR_ARRAY_PUSH(locked, const char *) = "/A/mu";
+  SVN_ERR(lock_batch(fs, rev, locked, FALSE, pool));
+  SVN_ERR(check_lock_index(fs, dirs, locked, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -1695,6 +2321,16 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "rep-sharing effectiveness"),
     SVN_TEST_OPTS_PASS(delta_chain_with_plain,
                        "delta chains starting with PLAIN, issue #4577"),
+    SVN_TEST_OPTS_PASS(pack_concurrently,
+                       "pack several shards concurrently"),
+    SVN_TEST_OPTS_PASS(read_mapped_packed_fs,
+                       "read from memory-mapped FSFS pack files"),
+    SVN_TEST_OPTS_PASS(rep_cache_batching,
+                       "batched rep-cache writes"),
+    SVN_TEST_OPTS_PASS(rep_cache_filter,
+                       "rep-cache filter"),
+    SVN_TEST_OPTS_PASS(lock_many_digests,
+                       "lock index updates of batched (un)locks"),
     SVN_TEST_NULL
   };
 
@@ -263,6 +263,90 @@ get_repo_stats(const svn_test_opts_t *opts,
 
 /* ------------------------------------------------------------------------ */
 
+#define REPO_NAME "test-repo-get-chain-stats-test"
+
+static svn_error_t *
+get_chain_stats(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_revnum_t rev;
+  int i;
+  svn_fs_fs__stats_t *stats;
+  const svn_fs_fs__histogram_t *histogram;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  /* Create a filesystem and modify the same file over and over. */
+  SVN_ERR(create_greek_repo(&repos, &rev, opts, REPO_NAME, pool, pool));
+  fs = svn_repos_fs(repos);
+
+  for (i = 0; i < 20; ++i)
+    {
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *txn_root;
+      const char *contents;
+
+      svn_pool_clear(iterpool);
+      contents = apr_psprintf(iterpool,
+                              "This is the file 'iota'.\n"
+                              "It has been modified %d times.\n", i + 1);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota", contents,
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Gather statistics info on that repo. */
+  SVN_ERR(svn_fs_fs__get_stats(&stats, fs, NULL, NULL, NULL, NULL,
+                               pool, pool));
+
+  /* Every used rep has a chain length of at least 1. */
+  histogram = &stats->chain_length_histogram;
+  SVN_TEST_ASSERT(histogram->total.count
+                  == stats->total_rep_stats.total.count);
+  SVN_TEST_ASSERT(histogram->lines[0].count == 0);
+  SVN_TEST_ASSERT(histogram->total.sum >= histogram->total.count);
+
+  /* The 'iota' reps got deltified against their predecessors, but the
+   * chains cannot be longer than the history of that file. */
+  SVN_TEST_ASSERT(stats->longest_chains->nelts > 0);
+  SVN_TEST_ASSERT(stats->longest_chains->nelts <= 16);
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(stats->longest_chains, 0,
+                                svn_fs_fs__chain_info_t *)->length > 1);
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(stats->longest_chains, 0,
+                                svn_fs_fs__chain_info_t *)->length <= 21);
+
+  /* The list is sorted by length. */
+  for (i = 1; i < stats->longest_chains->nelts; ++i)
+    {
+      svn_fs_fs__chain_info_t *prev
+        = APR_ARRAY_IDX(stats->longest_chains, i - 1,
+                        svn_fs_fs__chain_info_t *);
+      svn_fs_fs__chain_info_t *info
+        = APR_ARRAY_IDX(stats->longest_chains, i, svn_fs_fs__chain_info_t *);
+
+      SVN_TEST_ASSERT(prev->length >= info->length);
+      SVN_TEST_ASSERT(info->length >= 1);
+      SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(info->revision));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
 #define REPO_NAME "test-repo-dump-index-test"
 
 typedef struct dump_baton_t
@@ -399,14 +483,14 @@ load_index(const svn_test_opts_t *opts,
   APR_ARRAY_PUSH(alt_entries, svn_fs_fs__p2l_entry_t *) = &entry;
 
   SVN_ERR(svn_fs_fs__load_index(svn_repos_fs(repos), rev, alt_entries, pool));
-  SVN_TEST_ASSERT_ERROR(svn_repos_verify_fs3(repos, rev, rev,
-                                             FALSE, FALSE, FALSE,
+  SVN_TEST_ASSERT_ERROR(svn_repos_verify_fs4(repos, rev, rev,
+                                             FALSE, FALSE, FALSE, 1,
                                              NULL, NULL, NULL, NULL, pool),
                         SVN_ERR_REPOS_CORRUPTED);
 
   /* Restore the original index. */
   SVN_ERR(svn_fs_fs__load_index(svn_repos_fs(repos), rev, entries, pool));
-  SVN_ERR(svn_repos_verify_fs3(repos, rev, rev, FALSE, FALSE, FALSE,
+  SVN_ERR(svn_repos_verify_fs4(repos, rev, rev, FALSE, FALSE, FALSE, 1,
                                NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
@@ -424,6 +508,8 @@ static struct svn_test_descriptor_t test_funcs[] =
     SVN_TEST_NULL,
     SVN_TEST_OPTS_PASS(get_repo_stats,
                        "get statistics on a FSFS filesystem"),
+    SVN_TEST_OPTS_PASS(get_chain_stats,
+                       "get delta chain statistics on a FSFS filesystem"),
     SVN_TEST_OPTS_PASS(dump_index,
                        "dump the P2L index"),
     SVN_TEST_OPTS_PASS(load_index,
@@ -26,6 +26,8 @@
 #include <apr_general.h>
 #include <apr_pools.h>
 #include <apr_file_io.h>
+#include <apr_network_io.h>
+#include <apr_thread_proc.h>
 #include <assert.h>
 
 #include "svn_error.h"
@@ -34,8 +36,13 @@
 #include "svn_time.h"
 #include "svn_pools.h"
 #include "svn_cmdline.h"
+#include "svn_config.h"
 #include "svn_dirent_uri.h"
 #include "svn_hash.h"
+#include "svn_props.h"
+#include "svn_ra_svn.h"
+
+#include "private/svn_ra_svn_private.h"
 
 #include "../svn_test.h"
 #include "../svn_test_fs.h"
@@ -601,6 +608,116 @@ lock_test(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Baton for get_files_cb. */
+struct get_files_baton_t
+{
+  /* Maps paths to their contents (svn_stringbuf_t *). */
+  apr_hash_t *contents;
+
+  /* Maps paths to their props (apr_hash_t *). */
+  apr_hash_t *props;
+
+  apr_pool_t *pool;
+};
+
+/* Implements svn_ra_file_receiver_t. */
+static svn_error_t *
+get_files_cb(void *baton,
+             const char *path,
+             svn_revnum_t revision,
+             apr_hash_t *props,
+             svn_stream_t **stream,
+             apr_pool_t *pool)
+{
+  struct get_files_baton_t *b = baton;
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(b->pool);
+
+  path = apr_pstrdup(b->pool, path);
+  SVN_TEST_ASSERT(!svn_hash_gets(b->contents, path));
+
+  svn_hash_sets(b->contents, path, contents);
+  svn_hash_sets(b->props, path, svn_prop_hash_dup(props, b->pool));
+  *stream = svn_stream_from_stringbuf(contents, pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Test svn_ra_get_files(). */
+static svn_error_t *
+get_files_test(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_ra_session_t *session;
+  const svn_delta_editor_t *editor;
+  void *edit_baton, *root_baton, *A_baton, *B_baton, *file_baton;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  apr_hash_t *path_revs = apr_hash_make(pool);
+  svn_revnum_t head = SVN_INVALID_REVNUM;
+  svn_revnum_t rev1 = 1;
+  struct get_files_baton_t baton;
+  svn_stringbuf_t *contents;
+  apr_hash_t *props;
+
+  SVN_ERR(make_and_open_repos(&session, "test-repo-get-files", opts, pool));
+  SVN_ERR(commit_tree(session, pool));
+
+  /* r2: Give A/B/f some contents and a property. */
+  SVN_ERR(svn_ra_get_commit_editor3(session, &editor, &edit_baton,
+                                    apr_hash_make(pool),
+                                    NULL, NULL, NULL, TRUE, pool));
+  SVN_ERR(editor->open_root(edit_baton, 1, pool, &root_baton));
+  SVN_ERR(editor->open_directory("A", root_baton, 1, pool, &A_baton));
+  SVN_ERR(editor->open_directory("A/B", A_baton, 1, pool, &B_baton));
+  SVN_ERR(editor->open_file("A/B/f", B_baton, 1, pool, &file_baton));
+  SVN_ERR(editor->change_file_prop(file_baton, "p",
+                                   svn_string_create("v", pool), pool));
+  SVN_ERR(editor->apply_textdelta(file_baton, NULL, pool,
+                                  &handler, &handler_baton));
+  SVN_ERR(svn_txdelta_send_string(svn_string_create("This is f.\n", pool),
+                                  handler, handler_baton, pool));
+  SVN_ERR(editor->close_file(file_baton, NULL, pool));
+  SVN_ERR(editor->close_directory(B_baton, pool));
+  SVN_ERR(editor->close_directory(A_baton, pool));
+  SVN_ERR(editor->close_directory(root_baton, pool));
+  SVN_ERR(editor->close_edit(edit_baton, pool));
+
+  baton.contents = apr_hash_make(pool);
+  baton.props = apr_hash_make(pool);
+  baton.pool = pool;
+
+  svn_hash_sets(path_revs, "A/B/f", &head);
+  svn_hash_sets(path_revs, "A/B/g", &rev1);
+  svn_hash_sets(path_revs, "A/BB/f", &rev1);
+
+  SVN_ERR(svn_ra_get_files(session, path_revs, get_files_cb, &baton, pool));
+  SVN_TEST_ASSERT(apr_hash_count(baton.contents) == 3);
+
+  contents = svn_hash_gets(baton.contents, "A/B/f");
+  SVN_TEST_STRING_ASSERT(contents->data, "This is f.\n");
+  props = svn_hash_gets(baton.props, "A/B/f");
+  SVN_TEST_ASSERT(svn_hash_gets(props, "p"));
+  SVN_TEST_STRING_ASSERT(((svn_string_t *)svn_hash_gets(props, "p"))->data,
+                         "v");
+
+  contents = svn_hash_gets(baton.contents, "A/B/g");
+  SVN_TEST_ASSERT(contents->len == 0);
+  props = svn_hash_gets(baton.props, "A/B/g");
+  SVN_TEST_ASSERT(!svn_hash_gets(props, "p"));
+
+  contents = svn_hash_gets(baton.contents, "A/BB/f");
+  SVN_TEST_ASSERT(contents->len == 0);
+
+  /* Missing files must be reported as errors. */
+  apr_hash_clear(baton.contents);
+  apr_hash_clear(baton.props);
+  svn_hash_sets(path_revs, "A/B/z", &head);
+  SVN_TEST_ASSERT_ANY_ERROR(svn_ra_get_files(session, path_revs,
+                                             get_files_cb, &baton, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Test svn_ra_get_dir2(). */
 static svn_error_t *
 get_dir_test(const svn_test_opts_t *opts,
@@ -1518,6 +1635,715 @@ ra_list_has_props(const svn_test_opts_t *opts,
 }
 
 
+/* Store CONTENTS as the contents of file PATH in a new revision of the
+ * FSFS repository at REPOS_DIRENT.  Set property X=Y on it if HAS_PROP
+ * is set.  Write the fsfs.conf for this commit first such that the new
+ * representations get written with the given svndiff COMPRESSION and
+ * property deltification disabled.  Use POOL for allocations.
+ */
+static svn_error_t *
+commit_stored_file(const char *repos_dirent,
+                   const char *compression,
+                   const char *path,
+                   const char *contents,
+                   svn_boolean_t has_prop,
+                   apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest;
+  svn_node_kind_t kind;
+  const char *conflict;
+  const char *config;
+
+  config = apr_psprintf(pool,
+                        "[deltification]\n"
+                        "enable-props-deltification = false\n"
+                        "compression = %s\n",
+                        compression);
+
+  SVN_ERR(svn_io_write_atomic(svn_dirent_join_many(pool, repos_dirent,
+                                                   "db", "fsfs.conf",
+                                                   SVN_VA_NULL),
+                              config, strlen(config), NULL, pool));
+
+  SVN_ERR(svn_repos_open3(&repos, repos_dirent, NULL, pool, pool));
+  fs = svn_repos_fs(repos);
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+
+  SVN_ERR(svn_fs_check_path(&kind, txn_root, path, pool));
+  if (kind == svn_node_none)
+    SVN_ERR(svn_fs_make_file(txn_root, path, pool));
+
+  SVN_ERR(svn_test__set_file_contents(txn_root, path, contents, pool));
+  if (has_prop)
+    SVN_ERR(svn_fs_change_node_prop(txn_root, path, "x",
+                                    svn_string_create("y", pool), pool));
+
+  SVN_ERR(svn_repos_fs_commit_txn(&conflict, repos, &youngest, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(youngest));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_delta_editor_t.open_root for update_stored_contents_test.
+ * The edit baton is a hash mapping paths to their received contents. */
+static svn_error_t *
+collect_open_root(void *edit_baton,
+                  svn_revnum_t base_revision,
+                  apr_pool_t *dir_pool,
+                  void **root_baton)
+{
+  *root_baton = edit_baton;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_delta_editor_t.add_file for update_stored_contents_test. */
+static svn_error_t *
+collect_add_file(const char *path,
+                 void *parent_baton,
+                 const char *copyfrom_path,
+                 svn_revnum_t copyfrom_revision,
+                 apr_pool_t *file_pool,
+                 void **file_baton)
+{
+  apr_hash_t *files = parent_baton;
+  apr_pool_t *result_pool = apr_hash_pool_get(files);
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(result_pool);
+
+  svn_hash_sets(files, apr_pstrdup(result_pool, path), contents);
+  *file_baton = contents;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_delta_editor_t.apply_textdelta for
+ * update_stored_contents_test.  Expands the delta against the empty
+ * source into the file's contents buffer. */
+static svn_error_t *
+collect_apply_textdelta(void *file_baton,
+                        const char *base_checksum,
+                        apr_pool_t *pool,
+                        svn_txdelta_window_handler_t *handler,
+                        void **handler_baton)
+{
+  svn_stringbuf_t *contents = file_baton;
+
+  svn_txdelta_apply(svn_stream_empty(pool),
+                    svn_stream_from_stringbuf(contents, pool),
+                    NULL, NULL, pool, handler, handler_baton);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+update_stored_contents_test(const svn_test_opts_t *opts,
+                            apr_pool_t *pool)
+{
+  tunnel_baton_t b = { TUNNEL_MAGIC };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  const char repos_name[] = "test-repo-update-stored-contents";
+  const char *compressions[] = { "none", "zlib", "lz4", NULL };
+  const char *repos_dirent;
+  const char *url;
+  svn_ra_callbacks2_t *cbtable;
+  svn_delta_editor_t *editor;
+  apr_hash_t *expected = apr_hash_make(pool);
+  apr_hash_index_t *hi;
+  svn_stringbuf_t *text = svn_stringbuf_create_empty(pool);
+  int i;
+
+  if (strcmp(opts->fs_type, SVN_FS_TYPE_FSFS) != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  SVN_ERR(svn_test__create_repos2(NULL, NULL, &repos_dirent, repos_name,
+                                  opts, pool, iterpool));
+  svn_pool_clear(iterpool);
+
+  /* Something larger than a single svndiff window. */
+  for (i = 0; i < 20000; ++i)
+    svn_stringbuf_appendcstr(text, apr_psprintf(iterpool, "line %d\n", i));
+
+  /* Self-deltas in svndiff0, 1 and 2 for files added in one revision
+   * each, plus a PLAIN property representation.  The latter also becomes
+   * the PLAIN data representation of a file with the same contents via
+   * rep-sharing.  Finally, a true delta against an earlier revision. */
+  svn_hash_sets(expected, "svndiff0", text->data);
+  SVN_ERR(commit_stored_file(repos_dirent, "none", "svndiff0", text->data,
+                             TRUE, iterpool));
+  svn_pool_clear(iterpool);
+  svn_hash_sets(expected, "svndiff1", apr_pstrcat(pool, "1", text->data,
+                                                  SVN_VA_NULL));
+  SVN_ERR(commit_stored_file(repos_dirent, "zlib", "svndiff1",
+                             svn_hash_gets(expected, "svndiff1"),
+                             FALSE, iterpool));
+  svn_pool_clear(iterpool);
+  svn_hash_sets(expected, "svndiff2", apr_pstrcat(pool, "2", text->data,
+                                                  SVN_VA_NULL));
+  SVN_ERR(commit_stored_file(repos_dirent, "lz4", "svndiff2",
+                             svn_hash_gets(expected, "svndiff2"),
+                             FALSE, iterpool));
+  svn_pool_clear(iterpool);
+  svn_hash_sets(expected, "plain", "K 1\nx\nV 1\ny\nEND\n");
+  SVN_ERR(commit_stored_file(repos_dirent, "none", "plain",
+                             svn_hash_gets(expected, "plain"),
+                             FALSE, iterpool));
+  svn_pool_clear(iterpool);
+  svn_hash_sets(expected, "svndiff0", apr_pstrcat(pool, text->data, "end\n",
+                                                  SVN_VA_NULL));
+  SVN_ERR(commit_stored_file(repos_dirent, "none", "svndiff0",
+                             svn_hash_gets(expected, "svndiff0"),
+                             FALSE, iterpool));
+  svn_pool_clear(iterpool);
+
+  url = apr_pstrcat(pool, "svn+test://localhost/", repos_name, SVN_VA_NULL);
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  cbtable->check_tunnel_func = check_tunnel;
+  cbtable->open_tunnel_func = open_tunnel;
+  cbtable->tunnel_baton = &b;
+  SVN_ERR(svn_cmdline_create_auth_baton2(&cbtable->auth_baton,
+                                         TRUE  /* non_interactive */,
+                                         "jrandom", "rayjandom",
+                                         NULL,
+                                         TRUE  /* no_auth_cache */,
+                                         FALSE /* trust_server_cert */,
+                                         FALSE, FALSE, FALSE, FALSE,
+                                         NULL, NULL, NULL, pool));
+
+  editor = svn_delta_default_editor(pool);
+  editor->open_root = collect_open_root;
+  editor->add_file = collect_add_file;
+  editor->apply_textdelta = collect_apply_textdelta;
+
+  /* Each network compression selects a different subset of the stored
+   * representations to be sent as they are. */
+  for (i = 0; compressions[i]; ++i)
+    {
+      svn_ra_session_t *session;
+      const svn_ra_reporter3_t *reporter;
+      void *report_baton;
+      apr_hash_t *files;
+      const char *config;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+      files = apr_hash_make(iterpool);
+
+      config = apr_psprintf(iterpool,
+                            "[general]\n"
+                            "anon-access = read\n"
+                            "compression = %s\n",
+                            compressions[i]);
+      SVN_ERR(svn_io_write_atomic(svn_dirent_join_many(iterpool, repos_dirent,
+                                                       "conf", "svnserve.conf",
+                                                       SVN_VA_NULL),
+                                  config, strlen(config), NULL, iterpool));
+
+      err = svn_ra_open4(&session, NULL, url, NULL, cbtable, NULL, NULL,
+                         iterpool);
+      if (err && err->apr_err == SVN_ERR_TEST_FAILED)
+        {
+          svn_handle_error2(err, stderr, FALSE, "svn_tests: ");
+          svn_error_clear(err);
+          return SVN_NO_ERROR;
+        }
+      SVN_ERR(err);
+
+      SVN_ERR(svn_ra_do_update3(session, &reporter, &report_baton,
+                                SVN_INVALID_REVNUM, "", svn_depth_infinity,
+                                FALSE, FALSE, editor, files,
+                                iterpool, iterpool));
+      SVN_ERR(reporter->set_path(report_baton, "", 0, svn_depth_infinity,
+                                 TRUE, NULL, iterpool));
+      SVN_ERR(reporter->finish_report(report_baton, iterpool));
+
+      SVN_TEST_ASSERT(apr_hash_count(files) == apr_hash_count(expected));
+      for (hi = apr_hash_first(iterpool, expected); hi; hi = apr_hash_next(hi))
+        {
+          svn_stringbuf_t *contents = svn_hash_gets(files,
+                                                    apr_hash_this_key(hi));
+
+          SVN_TEST_ASSERT(contents);
+          SVN_TEST_STRING_ASSERT(contents->data, apr_hash_this_val(hi));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  SVN_TEST_ASSERT(b.open_count == 0);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+parse_compression_test(apr_pool_t *pool)
+{
+  svn_ra_svn__compression_t method;
+  int level;
+
+  SVN_ERR(svn_ra_svn__parse_compression(&method, &level, "none"));
+  SVN_TEST_ASSERT(method == svn_ra_svn__compression_none);
+  SVN_TEST_ASSERT(level == SVN_DELTA_COMPRESSION_LEVEL_NONE);
+
+  SVN_ERR(svn_ra_svn__parse_compression(&method, &level, "lz4"));
+  SVN_TEST_ASSERT(method == svn_ra_svn__compression_lz4);
+
+  SVN_ERR(svn_ra_svn__parse_compression(&method, &level, "zlib"));
+  SVN_TEST_ASSERT(method == svn_ra_svn__compression_zlib);
+  SVN_TEST_ASSERT(level == SVN_DELTA_COMPRESSION_LEVEL_DEFAULT);
+
+  SVN_ERR(svn_ra_svn__parse_compression(&method, &level, "zlib-1"));
+  SVN_TEST_ASSERT(method == svn_ra_svn__compression_zlib);
+  SVN_TEST_ASSERT(level == 1);
+
+  SVN_ERR(svn_ra_svn__parse_compression(&method, &level, "zlib-9"));
+  SVN_TEST_ASSERT(method == svn_ra_svn__compression_zlib);
+  SVN_TEST_ASSERT(level == SVN_DELTA_COMPRESSION_LEVEL_MAX);
+
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__parse_compression(&method, &level,
+                                                      "zlib-0"),
+                        SVN_ERR_BAD_CONFIG_VALUE);
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__parse_compression(&method, &level,
+                                                      "zlib-10"),
+                        SVN_ERR_BAD_CONFIG_VALUE);
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__parse_compression(&method, &level,
+                                                      "zlib-x"),
+                        SVN_ERR_BAD_CONFIG_VALUE);
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__parse_compression(&method, &level,
+                                                      "zlib-"),
+                        SVN_ERR_BAD_CONFIG_VALUE);
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__parse_compression(&method, &level,
+                                                      "gzip"),
+                        SVN_ERR_BAD_CONFIG_VALUE);
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__parse_compression(&method, &level, ""),
+                        SVN_ERR_BAD_CONFIG_VALUE);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *CLIENT and *SERVER to the two ends of a new TCP connection over
+ * the loopback interface, allocated in POOL. */
+static svn_error_t *
+create_loopback(apr_socket_t **client,
+                apr_socket_t **server,
+                apr_pool_t *pool)
+{
+  apr_socket_t *listener;
+  apr_sockaddr_t *sa;
+  apr_status_t status;
+
+  status = apr_sockaddr_info_get(&sa, "127.0.0.1", APR_INET, 0, 0, pool);
+  if (!status)
+    status = apr_socket_create(&listener, sa->family, SOCK_STREAM,
+                               APR_PROTO_TCP, pool);
+  if (!status)
+    status = apr_socket_bind(listener, sa);
+  if (!status)
+    status = apr_socket_listen(listener, 1);
+  if (!status)
+    status = apr_socket_addr_get(&sa, APR_LOCAL, listener);
+  if (!status)
+    status = apr_socket_create(client, sa->family, SOCK_STREAM,
+                               APR_PROTO_TCP, pool);
+  if (!status)
+    status = apr_socket_connect(*client, sa);
+  if (!status)
+    status = apr_socket_accept(server, listener, pool);
+  if (status)
+    return svn_error_wrap_apr(status, "Can't create loopback connection");
+
+  apr_socket_close(listener);
+  return SVN_NO_ERROR;
+}
+
+/* Send the NUL-terminated DATA over SOCK. */
+static svn_error_t *
+send_raw(apr_socket_t *sock,
+         const char *data)
+{
+  apr_size_t len = strlen(data);
+  apr_status_t status = apr_socket_send(sock, data, &len);
+
+  if (status)
+    return svn_error_wrap_apr(status, "Can't send test data");
+  SVN_TEST_ASSERT(len == strlen(data));
+
+  return SVN_NO_ERROR;
+}
+
+/* Call svn_ra_svn__has_complete_command on CONN until it reports a
+ * command or termination, giving the data sent on the other end of the
+ * connection about a second to arrive.  Set *HAS_COMMAND and *TERMINATED
+ * accordingly. */
+static svn_error_t *
+wait_for_command(svn_boolean_t *has_command,
+                 svn_boolean_t *terminated,
+                 svn_ra_svn_conn_t *conn,
+                 apr_pool_t *pool)
+{
+  int i;
+
+  for (i = 0; i < 100; ++i)
+    {
+      SVN_ERR(svn_ra_svn__has_complete_command(has_command, terminated,
+                                               conn, pool));
+      if (*has_command || *terminated)
+        break;
+
+      apr_sleep(apr_time_from_msec(10));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+has_complete_command_test(apr_pool_t *pool)
+{
+  apr_socket_t *client;
+  apr_socket_t *server;
+  svn_ra_svn_conn_t *conn;
+  svn_boolean_t has_command;
+  svn_boolean_t terminated;
+  const char *cmd;
+  svn_string_t *str;
+  apr_uint64_t number;
+  svn_stringbuf_t *long_str;
+
+  SVN_ERR(create_loopback(&client, &server, pool));
+
+  conn = svn_ra_svn_create_conn4(server, NULL, NULL,
+                                 SVN_DELTA_COMPRESSION_LEVEL_NONE, 0, 0,
+                                 pool);
+
+  /* Nothing received yet. */
+  SVN_ERR(svn_ra_svn__has_complete_command(&has_command, &terminated,
+                                           conn, pool));
+  SVN_TEST_ASSERT(!has_command && !terminated);
+
+  /* Parentheses within strings must not close the command. */
+  SVN_ERR(send_raw(client, "( cmd ( 3:)() 12 "));
+  SVN_ERR(wait_for_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(!has_command && !terminated);
+
+  /* A string that has only partly arrived. */
+  SVN_ERR(send_raw(client, ") ( 10:(((("));
+  SVN_ERR(wait_for_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(!has_command && !terminated);
+
+  SVN_ERR(send_raw(client, "(((((( ) ) "));
+  SVN_ERR(wait_for_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(has_command && !terminated);
+
+  SVN_ERR(svn_ra_svn__read_tuple(conn, pool, "w(sn)(s)", &cmd, &str,
+                                 &number, &str));
+  SVN_TEST_STRING_ASSERT(cmd, "cmd");
+  SVN_TEST_ASSERT(number == 12);
+  SVN_TEST_STRING_ASSERT(str->data, "((((((((((");
+
+  /* Nothing left to process. */
+  SVN_ERR(svn_ra_svn__has_complete_command(&has_command, &terminated,
+                                           conn, pool));
+  SVN_TEST_ASSERT(!has_command && !terminated);
+
+  /* Large numbers are not string lengths. */
+  SVN_ERR(send_raw(client, "( num ( 98765432109876 "));
+  SVN_ERR(wait_for_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(!has_command && !terminated);
+
+  SVN_ERR(send_raw(client, ") ) "));
+  SVN_ERR(wait_for_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(has_command && !terminated);
+
+  SVN_ERR(svn_ra_svn__read_tuple(conn, pool, "w(n)", &cmd, &number));
+  SVN_TEST_STRING_ASSERT(cmd, "num");
+  SVN_TEST_ASSERT(number == APR_UINT64_C(98765432109876));
+
+  /* Strings that can never fit into the read buffer must not make us
+   * wait for them.  The parser reads them as they arrive. */
+  long_str = svn_stringbuf_create_ensure(65536, pool);
+  while (long_str->len < 65536)
+    svn_stringbuf_appendcstr(long_str, "0123456789abcdef");
+
+  SVN_ERR(send_raw(client, "( str ( 65536:0123"));
+  SVN_ERR(wait_for_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(has_command && !terminated);
+
+  SVN_ERR(send_raw(client, long_str->data + 4));
+  SVN_ERR(send_raw(client, " ) ) "));
+  SVN_ERR(svn_ra_svn__read_tuple(conn, pool, "w(s)", &cmd, &str));
+  SVN_TEST_STRING_ASSERT(cmd, "str");
+  SVN_TEST_ASSERT(str->len == long_str->len);
+  SVN_TEST_ASSERT(memcmp(str->data, long_str->data, str->len) == 0);
+
+  /* Incomplete commands don't count once the client is gone. */
+  SVN_ERR(send_raw(client, "( cmd "));
+  apr_socket_close(client);
+  SVN_ERR(wait_for_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(!has_command && terminated);
+
+  apr_socket_close(server);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+bulk_write_test(apr_pool_t *pool)
+{
+  /* Mix small items that go through the write buffer with ones that
+   * exceed half its size and get written around it, growing it along
+   * the way. */
+  const apr_size_t sizes[] = { 10, 8000, 5, 20000, 3000, 3000, 3000,
+                               300000, 0, 1000000, 7 };
+  const int count = sizeof(sizes) / sizeof(sizes[0]);
+  svn_stringbuf_t *wire = svn_stringbuf_create_empty(pool);
+  svn_ra_svn_conn_t *writer;
+  svn_ra_svn_conn_t *reader;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i, pass;
+
+  writer = svn_ra_svn_create_conn4(NULL, svn_stream_empty(pool),
+                                   svn_stream_from_stringbuf(wire, pool),
+                                   SVN_DELTA_COMPRESSION_LEVEL_NONE, 0, 0,
+                                   pool);
+  reader = svn_ra_svn_create_conn4(NULL,
+                                   svn_stream_from_stringbuf(wire, pool),
+                                   svn_stream_empty(pool),
+                                   SVN_DELTA_COMPRESSION_LEVEL_NONE, 0, 0,
+                                   pool);
+
+  /* Repeat the sequence such that later passes use the grown buffer. */
+  for (pass = 0; pass < 3; ++pass)
+    for (i = 0; i < count; ++i)
+      {
+        svn_stringbuf_t *data;
+        svn_string_t str;
+
+        svn_pool_clear(iterpool);
+        data = svn_stringbuf_create_ensure(sizes[i], iterpool);
+        memset(data->data, 'a' + (pass * count + i) % 26, sizes[i]);
+        data->len = sizes[i];
+        data->data[data->len] = '\0';
+
+        str.data = data->data;
+        str.len = data->len;
+        SVN_ERR(svn_ra_svn__write_tuple(writer, iterpool, "(ns)",
+                                        (apr_uint64_t)(pass * count + i),
+                                        &str));
+      }
+
+  SVN_ERR(svn_ra_svn__flush(writer, pool));
+
+  for (pass = 0; pass < 3; ++pass)
+    for (i = 0; i < count; ++i)
+      {
+        apr_uint64_t number;
+        svn_string_t *str;
+        apr_size_t k;
+
+        svn_pool_clear(iterpool);
+        SVN_ERR(svn_ra_svn__read_tuple(reader, iterpool, "ns", &number,
+                                       &str));
+
+        SVN_TEST_ASSERT(number == (apr_uint64_t)(pass * count + i));
+        SVN_TEST_ASSERT(str->len == sizes[i]);
+        for (k = 0; k < str->len; ++k)
+          SVN_TEST_ASSERT(str->data[k] == 'a' + (pass * count + i) % 26);
+      }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+
+#if APR_HAS_THREADS
+/* Baton for ticket_server_thread(). */
+typedef struct ticket_server_baton_t
+{
+  /* Server end of the connection. */
+  svn_ra_svn_conn_t *conn;
+
+  /* Server configuration. */
+  const char *secret;
+  const char *realm;
+  svn_config_t *pwdb;
+  apr_time_t now;
+
+  /* Outcome of the authentication. */
+  const char *user;
+  svn_boolean_t success;
+  svn_error_t *err;
+
+  /* For all allocations of the thread. */
+  apr_pool_t *pool;
+} ticket_server_baton_t;
+
+/* Thread function reading a TICKET auth response from the connection in
+ * the ticket_server_baton_t DATA and authenticating the client. */
+static void * APR_THREAD_FUNC
+ticket_server_thread(apr_thread_t *thread,
+                     void *data)
+{
+  ticket_server_baton_t *b = data;
+  const char *mech;
+  const char *mecharg;
+
+  b->err = svn_ra_svn__read_tuple(b->conn, b->pool, "w(?c)",
+                                  &mech, &mecharg);
+  if (!b->err && strcmp(mech, "TICKET") != 0)
+    b->err = svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                              "Unexpected auth mechanism");
+  if (!b->err)
+    b->err = svn_ra_svn__session_ticket_server(b->conn, b->pool,
+                                               mecharg ? mecharg : "",
+                                               b->secret, b->realm,
+                                               b->pwdb, b->now,
+                                               &b->user, &b->success);
+  if (!b->err)
+    b->err = svn_ra_svn__flush(b->conn, b->pool);
+
+  return NULL;
+}
+
+/* Present TICKET for USER on CLIENT_CONN to a server thread that uses
+ * SERVER_CONN, SECRET, REALM and PWDB at time NOW.  Set *ACCEPTED to
+ * whether the client authenticated; both ends must agree on that. */
+static svn_error_t *
+try_ticket(svn_boolean_t *accepted,
+           svn_ra_svn_conn_t *client_conn,
+           svn_ra_svn_conn_t *server_conn,
+           const char *user,
+           const char *ticket,
+           const char *secret,
+           const char *realm,
+           svn_config_t *pwdb,
+           apr_time_t now,
+           apr_pool_t *pool)
+{
+  ticket_server_baton_t baton = { 0 };
+  apr_thread_t *thread;
+  apr_status_t status;
+  apr_status_t retval;
+  const char *message;
+  svn_error_t *err;
+
+  baton.conn = server_conn;
+  baton.secret = secret;
+  baton.realm = realm;
+  baton.pwdb = pwdb;
+  baton.now = now;
+  baton.pool = svn_pool_create(pool);
+
+  status = apr_thread_create(&thread, NULL, ticket_server_thread, &baton,
+                             pool);
+  if (status)
+    return svn_error_wrap_apr(status, "Can't create thread");
+
+  err = svn_ra_svn__session_ticket_client(client_conn, pool, user, ticket,
+                                          &message);
+  apr_thread_join(&retval, thread);
+  SVN_ERR(svn_error_compose_create(baton.err, err));
+
+  SVN_TEST_ASSERT(baton.success == (message == NULL));
+  if (baton.success)
+    SVN_TEST_STRING_ASSERT(baton.user, user);
+
+  *accepted = baton.success;
+  svn_pool_destroy(baton.pool);
+
+  return SVN_NO_ERROR;
+}
+#endif
+
+static svn_error_t *
+session_ticket_test(apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  const char *secret = "0123456789abcdef";
+  const char *realm = "test-realm";
+  apr_time_t now = apr_time_now();
+  apr_socket_t *client;
+  apr_socket_t *server;
+  svn_ra_svn_conn_t *client_conn;
+  svn_ra_svn_conn_t *server_conn;
+  svn_config_t *pwdb;
+  const char *ticket;
+  svn_boolean_t accepted;
+
+  SVN_ERR(create_loopback(&client, &server, pool));
+  client_conn = svn_ra_svn_create_conn4(client, NULL, NULL,
+                                        SVN_DELTA_COMPRESSION_LEVEL_NONE,
+                                        0, 0, pool);
+  server_conn = svn_ra_svn_create_conn4(server, NULL, NULL,
+                                        SVN_DELTA_COMPRESSION_LEVEL_NONE,
+                                        0, 0, pool);
+
+  SVN_ERR(svn_config_create2(&pwdb, FALSE, FALSE, pool));
+  svn_config_set(pwdb, SVN_CONFIG_SECTION_USERS, "jrandom", "rayjandom");
+  svn_config_set(pwdb, SVN_CONFIG_SECTION_USERS, "jconstant", "rayjandom");
+
+  /* Issue a ticket.  It may be used any number of times. */
+  ticket = svn_ra_svn__session_ticket_create(secret, "jrandom", realm,
+                                             "rayjandom",
+                                             now + apr_time_from_sec(60),
+                                             pool);
+  SVN_ERR(try_ticket(&accepted, client_conn, server_conn, "jrandom", ticket,
+                     secret, realm, pwdb, now, pool));
+  SVN_TEST_ASSERT(accepted);
+  SVN_ERR(try_ticket(&accepted, client_conn, server_conn, "jrandom", ticket,
+                     secret, realm, pwdb, now, pool));
+  SVN_TEST_ASSERT(accepted);
+
+  /* It expires. */
+  SVN_ERR(try_ticket(&accepted, client_conn, server_conn, "jrandom", ticket,
+                     secret, realm, pwdb, now + apr_time_from_sec(60),
+                     pool));
+  SVN_TEST_ASSERT(!accepted);
+
+  /* It is only valid for the user, server and realm it was issued for. */
+  SVN_ERR(try_ticket(&accepted, client_conn, server_conn, "jconstant",
+                     ticket, secret, realm, pwdb, now, pool));
+  SVN_TEST_ASSERT(!accepted);
+  SVN_ERR(try_ticket(&accepted, client_conn, server_conn, "jrandom", ticket,
+                     "fedcba9876543210", realm, pwdb, now, pool));
+  SVN_TEST_ASSERT(!accepted);
+  SVN_ERR(try_ticket(&accepted, client_conn, server_conn, "jrandom", ticket,
+                     secret, "other-realm", pwdb, now, pool));
+  SVN_TEST_ASSERT(!accepted);
+
+  /* Extending its lifetime invalidates it. */
+  SVN_ERR(try_ticket(&accepted, client_conn, server_conn, "jrandom",
+                     apr_pstrcat(pool, "f", ticket, SVN_VA_NULL),
+                     secret, realm, pwdb, now, pool));
+  SVN_TEST_ASSERT(!accepted);
+
+  /* So does changing the user's password. */
+  svn_config_set(pwdb, SVN_CONFIG_SECTION_USERS, "jrandom", "changed");
+  SVN_ERR(try_ticket(&accepted, client_conn, server_conn, "jrandom", ticket,
+                     secret, realm, pwdb, now, pool));
+  SVN_TEST_ASSERT(!accepted);
+
+  /* Rejections leave the connection in a usable state. */
+  svn_config_set(pwdb, SVN_CONFIG_SECTION_USERS, "jrandom", "rayjandom");
+  SVN_ERR(try_ticket(&accepted, client_conn, server_conn, "jrandom", ticket,
+                     secret, realm, pwdb, now, pool));
+  SVN_TEST_ASSERT(accepted);
+
+  apr_socket_close(client);
+  apr_socket_close(server);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "Session ticket tests require threads");
+#endif
+}
+
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -1547,6 +2373,18 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "check how ra layers handle errors from callbacks"),
     SVN_TEST_OPTS_PASS(ra_list_has_props,
                        "check list has_props performance"),
+    SVN_TEST_OPTS_PASS(get_files_test,
+                       "test svn_ra_get_files"),
+    SVN_TEST_OPTS_PASS(update_stored_contents_test,
+                       "update with stored representations over ra_svn"),
+    SVN_TEST_PASS2(parse_compression_test,
+                   "parse ra_svn compression settings"),
+    SVN_TEST_PASS2(has_complete_command_test,
+                   "detect complete ra_svn commands"),
+    SVN_TEST_PASS2(bulk_write_test,
+                   "write bulk data to ra_svn connections"),
+    SVN_TEST_PASS2(session_ticket_test,
+                   "issue, accept and reject ra_svn session tickets"),
     SVN_TEST_NULL
   };
 
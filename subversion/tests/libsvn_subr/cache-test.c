@@ -26,8 +26,15 @@
 #include <apr_general.h>
 #include <apr_lib.h>
 #include <apr_time.h>
+#include <apr_thread_proc.h>
+
+#if APR_HAS_FORK
+#include <unistd.h>  /* for _exit */
+#endif
 
 #include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
 
 #include "private/svn_cache.h"
 #include "svn_private_config.h"
@@ -440,7 +447,475 @@ test_membuffer_cache_clearing(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
-
+static svn_error_t *
+test_disk_cache_tiered(apr_pool_t *pool)
+{
+  const char *cache_dir;
+  svn_disk_cache_t *disk_cache;
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache, *first, *second;
+  svn_revnum_t forty = 40, *answer;
+  svn_boolean_t found;
+
+  SVN_ERR(svn_dirent_get_absolute(&cache_dir, "cache-test-disk", pool));
+  SVN_ERR(svn_io_remove_dir2(cache_dir, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_io_make_dir_recursively(cache_dir, pool));
+  svn_test_add_dir_cleanup(cache_dir);
+
+  SVN_ERR(svn_cache__open_disk_cache(&disk_cache,
+                                     svn_dirent_join(cache_dir, "fscache",
+                                                     pool),
+                                     1024 * 1024, pool));
+
+  /* The disk cache alone. */
+  SVN_ERR(svn_cache__create_disk_cache(&cache, disk_cache,
+                                       serialize_revnum,
+                                       deserialize_revnum,
+                                       APR_HASH_KEY_STRING,
+                                       "basic", pool));
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+  /* Fill a two-level cache. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&first, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, pool, pool));
+  SVN_ERR(svn_cache__create_disk_cache(&second, disk_cache,
+                                       serialize_revnum,
+                                       deserialize_revnum,
+                                       APR_HASH_KEY_STRING,
+                                       "tiered", pool));
+  SVN_ERR(svn_cache__create_tiered_cache(&cache, first, second, pool));
+  SVN_ERR(svn_cache__set(cache, "forty", &forty, pool));
+
+  /* A fresh first level, e.g. after a restart, must get the data from
+   * the persistent second level and be populated by that. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&first, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, pool, pool));
+  SVN_ERR(svn_cache__has_key(&found, first, "forty", pool));
+  SVN_TEST_ASSERT(!found);
+
+  SVN_ERR(svn_cache__create_tiered_cache(&cache, first, second, pool));
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "forty", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 40);
+
+  SVN_ERR(svn_cache__has_key(&found, first, "forty", pool));
+  SVN_TEST_ASSERT(found);
+
+  /* Entries of different prefixes don't mix. */
+  SVN_ERR(svn_cache__get((void **)&answer, &found, second, "twenty", pool));
+  SVN_TEST_ASSERT(!found);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_shared(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_error_t *err;
+#if APR_HAS_FORK
+  apr_proc_t proc;
+  apr_status_t status;
+  int exitcode;
+  apr_exit_why_e exitwhy;
+  svn_revnum_t forty = 40, *answer;
+  svn_boolean_t found;
+#endif
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer, 10*1024, 1, 0,
+                                                 pool);
+  if (err && APR_STATUS_IS_ENOTIMPL(err->apr_err))
+    {
+      svn_error_clear(err);
+      return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                              "anonymous shared memory not supported");
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            pool, pool));
+
+  /* Within a single process, it behaves like any other membuffer cache. */
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+#if APR_HAS_FORK
+  /* Data added by a child process must be visible to its parent. */
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      err = svn_cache__set(cache, "forty", &forty, pool);
+      exitcode = err ? 1 : 0;
+      svn_error_clear(err);
+
+      /* Don't run any cleanups that might tear down the shared cache. */
+      _exit(exitcode);
+    }
+  else if (status != APR_INPARENT)
+    return svn_error_wrap_apr(status, "Can't fork");
+
+  status = apr_proc_wait(&proc, &exitcode, &exitwhy, APR_WAIT);
+  if (status != APR_CHILD_DONE)
+    return svn_error_wrap_apr(status, "Can't wait for child process");
+  SVN_TEST_ASSERT(APR_PROC_CHECK_EXIT(exitwhy) && exitcode == 0);
+
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "forty", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 40);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Number of words in a block_t. */
+#define BLOCK_WORDS 64
+
+/* Number of distinct blocks that we put into the cache. */
+#define BLOCK_COUNT 32
+
+/* Number of threads reading concurrently with the writer. */
+#define READER_COUNT 4
+
+/* How often each reader thread reads all blocks. */
+#define READER_ROUNDS 200
+
+/* How often the writer replaces all blocks. */
+#define WRITER_ROUNDS 50
+
+/* A cache item that is large enough to span several cache lines.  All
+ * words of a block are the same, so a read of a partially overwritten
+ * block is easy to detect. */
+typedef struct block_t
+{
+  apr_uint32_t words[BLOCK_WORDS];
+} block_t;
+
+/* Implements svn_cache__serialize_func_t */
+static svn_error_t *
+serialize_block(void **data,
+                apr_size_t *data_len,
+                void *in,
+                apr_pool_t *pool)
+{
+  *data_len = sizeof(block_t);
+  *data = apr_pmemdup(pool, in, *data_len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t */
+static svn_error_t *
+deserialize_block(void **out,
+                  void *data,
+                  apr_size_t data_len,
+                  apr_pool_t *pool)
+{
+  if (data_len != sizeof(block_t))
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "Bad size for block in cache");
+
+  *out = apr_pmemdup(pool, data, data_len);
+  return SVN_NO_ERROR;
+}
+
+/* Store version GENERATION of the block with number INDEX in CACHE.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+set_block(svn_cache__t *cache,
+          int index,
+          apr_uint32_t generation,
+          apr_pool_t *scratch_pool)
+{
+  block_t block;
+  int i;
+
+  for (i = 0; i < BLOCK_WORDS; ++i)
+    block.words[i] = ((apr_uint32_t)index << 16) | generation;
+
+  return svn_error_trace(svn_cache__set(cache,
+                                        apr_itoa(scratch_pool, index),
+                                        &block, scratch_pool));
+}
+
+/* Read all blocks from CACHE and verify that each block found has been
+ * written completely by a single set_block() call for the respective
+ * key.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+check_blocks(svn_cache__t *cache,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int index;
+
+  for (index = 0; index < BLOCK_COUNT; ++index)
+    {
+      block_t *block;
+      svn_boolean_t found;
+      int i;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_cache__get((void **)&block, &found, cache,
+                             apr_itoa(iterpool, index), iterpool));
+      if (!found)
+        continue;
+
+      if (block->words[0] >> 16 != (apr_uint32_t)index)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "Got the wrong data for block %d", index);
+
+      for (i = 1; i < BLOCK_WORDS; ++i)
+        if (block->words[i] != block->words[0])
+          return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                   "Got inconsistent data for block %d",
+                                   index);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+/* Baton for block_reader_thread(). */
+typedef struct block_reader_baton_t
+{
+  /* Read the blocks from this cache ... */
+  svn_membuffer_t *membuffer;
+
+  /* ... allocating in this thread-private pool ... */
+  apr_pool_t *pool;
+
+  /* ... and return the result here. */
+  svn_error_t *err;
+} block_reader_baton_t;
+
+/* Thread function repeatedly calling check_blocks() for the membuffer
+ * in the block_reader_baton_t DATA through a front-end of its own. */
+static void *
+APR_THREAD_FUNC block_reader_thread(apr_thread_t *thread, void *data)
+{
+  block_reader_baton_t *b = data;
+  svn_cache__t *cache;
+  svn_error_t *err;
+  int i;
+
+  err = svn_cache__create_membuffer_cache(&cache,
+                                          b->membuffer,
+                                          serialize_block,
+                                          deserialize_block,
+                                          APR_HASH_KEY_STRING,
+                                          "block:",
+                                          SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                          FALSE,
+                                          b->pool, b->pool);
+  for (i = 0; !err && i < READER_ROUNDS; ++i)
+    err = check_blocks(cache, b->pool);
+
+  b->err = err;
+  return NULL;
+}
+#endif
+
+static svn_error_t *
+test_membuffer_cache_lock_free_reads(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  svn_cache__info_t info;
+  apr_uint64_t lock_free_gets;
+  int i;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 64*1024, 1, 1,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_block,
+                                            deserialize_block,
+                                            APR_HASH_KEY_STRING,
+                                            "block:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            pool, pool));
+
+  for (i = 0; i < BLOCK_COUNT; ++i)
+    SVN_ERR(set_block(cache, i, 0, pool));
+
+  /* Without concurrent writers, either all reads are lock-free or, if not
+   * supported on this platform, none.  None of them needs to be retried. */
+  SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+  lock_free_gets = info.lock_free_gets;
+
+  SVN_ERR(check_blocks(cache, pool));
+
+  SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(   info.lock_free_gets == lock_free_gets
+                  || info.lock_free_gets == lock_free_gets + BLOCK_COUNT);
+  SVN_TEST_ASSERT(info.lock_free_retries == 0);
+
+#if APR_HAS_THREADS
+  {
+    block_reader_baton_t batons[READER_COUNT];
+    apr_thread_t *threads[READER_COUNT];
+    apr_pool_t *iterpool = svn_pool_create(pool);
+    svn_error_t *err = SVN_NO_ERROR;
+    apr_uint32_t generation;
+    int started;
+
+    for (started = 0; started < READER_COUNT; ++started)
+      {
+        apr_status_t status;
+
+        batons[started].membuffer = membuffer;
+        batons[started].err = SVN_NO_ERROR;
+        batons[started].pool
+          = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+        status = apr_thread_create(&threads[started], NULL,
+                                   block_reader_thread, &batons[started],
+                                   pool);
+        if (status)
+          {
+            svn_pool_destroy(batons[started].pool);
+            err = svn_error_wrap_apr(status, "Can't create thread");
+            break;
+          }
+      }
+
+    /* Keep replacing the blocks while the readers are active. */
+    for (generation = 1; !err && generation <= WRITER_ROUNDS; ++generation)
+      for (i = 0; !err && i < BLOCK_COUNT; ++i)
+        {
+          svn_pool_clear(iterpool);
+          err = set_block(cache, i, generation, iterpool);
+        }
+
+    for (i = 0; i < started; ++i)
+      {
+        apr_status_t retval;
+
+        apr_thread_join(&retval, threads[i]);
+        err = svn_error_compose_create(err, batons[i].err);
+        svn_pool_destroy(batons[i].pool);
+      }
+
+    svn_pool_destroy(iterpool);
+    SVN_ERR(err);
+  }
+#endif
+
+  /* Whatever survived the updates is still consistent. */
+  SVN_ERR(check_blocks(cache, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_FORK
+/* Implements svn_cache__partial_getter_func_t.  Terminate the process
+ * while it holds the lock for the cache segment containing DATA. */
+static svn_error_t *
+exit_partial_getter_func(void **out,
+                         const void *data,
+                         apr_size_t data_len,
+                         void *baton,
+                         apr_pool_t *result_pool)
+{
+  _exit(0);
+}
+#endif
+
+static svn_error_t *
+test_membuffer_cache_shared_owner_dead(apr_pool_t *pool)
+{
+#if APR_HAS_FORK
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_error_t *err;
+  apr_proc_t proc;
+  apr_status_t status;
+  int exitcode;
+  apr_exit_why_e exitwhy;
+  svn_revnum_t twenty = 20, forty = 40, *answer;
+  svn_boolean_t found;
+  void *value;
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer, 10*1024, 1, 0,
+                                                 pool);
+  if (err && APR_STATUS_IS_ENOTIMPL(err->apr_err))
+    {
+      svn_error_clear(err);
+      return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                              "shared caches not supported");
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            pool, pool));
+  SVN_ERR(svn_cache__set(cache, "twenty", &twenty, pool));
+
+  /* Let a child process die while it holds the segment lock. */
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      err = svn_cache__get_partial(&value, &found, cache, "twenty",
+                                   exit_partial_getter_func, NULL, pool);
+
+      /* Not reached unless the getter did not get called. */
+      svn_error_clear(err);
+      _exit(1);
+    }
+  else if (status != APR_INPARENT)
+    return svn_error_wrap_apr(status, "Can't fork");
+
+  status = apr_proc_wait(&proc, &exitcode, &exitwhy, APR_WAIT);
+  if (status != APR_CHILD_DONE)
+    return svn_error_wrap_apr(status, "Can't wait for child process");
+  SVN_TEST_ASSERT(APR_PROC_CHECK_EXIT(exitwhy) && exitcode == 0);
+
+  /* The next lock holder must neither block nor trust the segment
+   * contents that the dead process might have left half-modified. */
+  SVN_ERR(svn_cache__set(cache, "forty", &forty, pool));
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "twenty", pool));
+  SVN_TEST_ASSERT(!found);
+
+  /* The cache is fully operational again. */
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "forty", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 40);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "fork not supported");
+#endif
+}
+
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -460,6 +935,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test for error handling in membuffer svn_cache"),
     SVN_TEST_PASS2(test_membuffer_cache_clearing,
                    "test clearing a membuffer svn_cache"),
+    SVN_TEST_PASS2(test_disk_cache_tiered,
+                   "test a membuffer cache backed by a disk cache"),
+    SVN_TEST_PASS2(test_membuffer_cache_shared,
+                   "test shared membuffer cache across processes"),
+    SVN_TEST_PASS2(test_membuffer_cache_lock_free_reads,
+                   "test lock-free reads from a membuffer cache"),
+    SVN_TEST_PASS2(test_membuffer_cache_shared_owner_dead,
+                   "test shared cache recovery from dead lock owners"),
     SVN_TEST_NULL
   };
 
@@ -28,6 +28,7 @@
 #include "svn_error.h"
 #include "svn_io.h"
 #include "private/svn_pseudo_md5.h"
+#include "private/svn_adler32.h"
 
 #include "../svn_test.h"
 
@@ -307,6 +308,40 @@ test_serialization(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Verify that our Adler-32 shortcuts for short buffers match zlib's
+ * implementation for all lengths, alignments and a range of start values.
+ */
+static svn_error_t *
+test_adler32(apr_pool_t *pool)
+{
+  unsigned char data[256];
+  /* Both 16 bit halves of each start value must be less than 65521. */
+  apr_uint32_t seeds[] = { 1, 0xfff0fff0, 0x12345678 };
+  apr_size_t i, offset, len;
+
+  for (i = 0; i < sizeof(data); ++i)
+    data[i] = (unsigned char)(i * 167 + 13);
+
+  for (i = 0; i < sizeof(seeds) / sizeof(seeds[0]); ++i)
+    for (offset = 0; offset < 16; ++offset)
+      for (len = 0; len + offset <= sizeof(data); ++len)
+        {
+          apr_uint32_t expected
+            = (apr_uint32_t)adler32(seeds[i], data + offset, (uInt)len);
+          apr_uint32_t actual
+            = svn__adler32(seeds[i], (const char *)data + offset, len);
+
+          if (expected != actual)
+            return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                     "adler32 mismatch for length %d at "
+                                     "offset %d: expected %08x, got %08x",
+                                     (int)len, (int)offset,
+                                     (unsigned)expected, (unsigned)actual);
+        }
+
+  return SVN_NO_ERROR;
+}
+
 /* An array of all test functions */
 
 static int max_threads = 1;
@@ -328,6 +363,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "zero checksum cross-type matching"),
     SVN_TEST_PASS2(test_serialization,
                    "checksum (de-)serialization"),
+    SVN_TEST_PASS2(test_adler32,
+                   "adler32 compatibility with zlib"),
     SVN_TEST_NULL
   };
 
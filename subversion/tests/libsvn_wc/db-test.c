@@ -1402,6 +1402,98 @@ test_work_queue(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_batched_base_nodes(apr_pool_t *pool)
+{
+  const char *local_abspath;
+  svn_checksum_t *checksum;
+  svn_wc__db_t *db;
+  svn_wc__db_base_batch_t *batch;
+  apr_pool_t *node_pool = svn_pool_create(pool);
+  apr_hash_t *props;
+  const apr_array_header_t *children;
+  svn_skel_t *work_item;
+  apr_uint64_t id;
+
+  SVN_ERR(create_open(&db, &local_abspath, "test_batched_base_nodes", pool));
+
+  props = apr_hash_make(pool);
+  set_prop(props, "p1", "v1", pool);
+
+  children = svn_cstring_split("N-a N-b", " ", FALSE, pool);
+
+  SVN_ERR(svn_checksum_parse_hex(&checksum, svn_checksum_sha1, SHA1_1, pool));
+
+  SVN_ERR(svn_wc__db_base_add_directory(
+            db, svn_dirent_join(local_abspath, "N", pool),
+            local_abspath,
+            "N", ROOT_ONE, UUID_ONE, 3,
+            props,
+            1, TIME_1a, AUTHOR_1,
+            children, svn_depth_infinity,
+            NULL, FALSE, NULL, NULL, NULL, NULL,
+            pool));
+
+  SVN_ERR(svn_wc__db_base_batch_create(&batch, db, local_abspath,
+                                       pool, pool));
+
+  /* Replace both incomplete nodes with file nodes.  The batch has to
+     keep its own copy of the arguments. */
+  props = apr_hash_make(node_pool);
+  set_prop(props, "for-file", "N/N-a", node_pool);
+  SVN_ERR(svn_wc__db_base_batch_add_file(
+            batch, svn_dirent_join(local_abspath, "N/N-a", node_pool),
+            apr_pstrdup(node_pool, "N/N-a"), ROOT_ONE, UUID_ONE, 3,
+            props,
+            1, TIME_1a, AUTHOR_1,
+            checksum,
+            NULL, FALSE, FALSE, NULL, NULL, FALSE, FALSE,
+            NULL,
+            node_pool));
+
+  work_item = svn_skel__make_empty_list(node_pool);
+  svn_skel__prepend_int(1, work_item, node_pool);
+  props = apr_hash_make(node_pool);
+  set_prop(props, "for-file", "N/N-b", node_pool);
+  SVN_ERR(svn_wc__db_base_batch_add_file(
+            batch, svn_dirent_join(local_abspath, "N/N-b", node_pool),
+            apr_pstrdup(node_pool, "N/N-b"), ROOT_ONE, UUID_ONE, 3,
+            props,
+            1, TIME_1a, AUTHOR_1,
+            checksum,
+            NULL, FALSE, FALSE, NULL, NULL, FALSE, FALSE,
+            work_item,
+            node_pool));
+
+  svn_pool_destroy(node_pool);
+
+  /* Nothing has been written yet. */
+  SVN_ERR(validate_node(db, local_abspath, "N/N-a",
+                        svn_node_unknown, svn_wc__db_status_incomplete,
+                        pool));
+  SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db, local_abspath, 0,
+                                   pool, pool));
+  SVN_TEST_ASSERT(work_item == NULL);
+
+  SVN_ERR(svn_wc__db_base_batch_flush(batch, pool));
+
+  SVN_ERR(validate_node(db, local_abspath, "N/N-a",
+                        svn_node_file, svn_wc__db_status_normal,
+                        pool));
+  SVN_ERR(validate_node(db, local_abspath, "N/N-b",
+                        svn_node_file, svn_wc__db_status_normal,
+                        pool));
+
+  SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db, local_abspath, 0,
+                                   pool, pool));
+  SVN_TEST_ASSERT(work_item && detect_work_item(work_item) == 1);
+
+  /* A flushed batch is empty. */
+  SVN_ERR(svn_wc__db_base_batch_flush(batch, pool));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_externals_store(apr_pool_t *pool)
 {
@@ -1548,6 +1640,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "relocating a node"),
     SVN_TEST_PASS2(test_work_queue,
                    "work queue processing"),
+    SVN_TEST_PASS2(test_batched_base_nodes,
+                   "insert BASE nodes in one transaction"),
     SVN_TEST_PASS2(test_externals_store,
                    "externals store"),
     SVN_TEST_NULL
@@ -34,6 +34,7 @@
 #define SVN_DEPRECATED
 #include "svn_io.h"
 
+#include "svn_config.h"
 #include "svn_dirent_uri.h"
 #include "svn_pools.h"
 #include "svn_repos.h"
@@ -306,6 +307,294 @@ reject_mismatching_text(const svn_test_opts_t *opts,
 #endif
 }
 
+/* Test that pristine texts get shared between working copies through the
+   configured shared pristine store. */
+static svn_error_t *
+pristine_shared_store(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  svn_wc__db_t *db;
+  const char *wc_abspath;
+  const char *store_abspath;
+  svn_config_t *config;
+
+  svn_wc__db_install_data_t *install_data;
+  svn_stream_t *pristine_stream;
+  svn_stream_t *shared_stream;
+  apr_size_t sz;
+
+  const char data[] = "Shared blah";
+  svn_checksum_t *data_sha1, *data_md5;
+
+  SVN_ERR(create_repos_and_wc(&wc_abspath, &db,
+                              "pristine_shared_store", opts, pool));
+
+  store_abspath = apr_pstrcat(pool, wc_abspath, "-shared-pristines",
+                              SVN_VA_NULL);
+  SVN_ERR(svn_io_remove_dir2(store_abspath, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(store_abspath);
+
+  /* Open the working copy again, now using the shared store. */
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE, store_abspath);
+  SVN_ERR(svn_wc__db_open(&db, config, FALSE, TRUE, pool, pool));
+
+  SVN_ERR(svn_wc__db_pristine_prepare_install(&pristine_stream,
+                                              &install_data,
+                                              &data_sha1, &data_md5,
+                                              db, wc_abspath,
+                                              pool, pool));
+
+  sz = strlen(data);
+  SVN_ERR(svn_stream_write(pristine_stream, data, &sz));
+  SVN_ERR(svn_stream_close(pristine_stream));
+
+  /* Nobody has shared this text yet. */
+  SVN_ERR(svn_wc__db_pristine_read_shared(&shared_stream, db, data_sha1,
+                                          pool, pool));
+  SVN_TEST_ASSERT(shared_stream == NULL);
+
+  /* Installing it in one working copy makes it available to all. */
+  SVN_ERR(svn_wc__db_pristine_install(install_data,
+                                      data_sha1, data_md5, pool));
+
+  SVN_ERR(svn_wc__db_pristine_read_shared(&shared_stream, db, data_sha1,
+                                          pool, pool));
+  SVN_TEST_ASSERT(shared_stream != NULL);
+  {
+    svn_stream_t *data_stream = svn_stream_from_string(
+                                  svn_string_create(data, pool), pool);
+    svn_boolean_t same;
+
+    SVN_ERR(svn_stream_contents_same2(&same, shared_stream, data_stream,
+                                      pool));
+    SVN_TEST_ASSERT(same);
+  }
+
+  /* A recently used text survives the cleanup, even after this working
+     copy has dropped its unreferenced copy. */
+  SVN_ERR(svn_wc__db_pristine_cleanup(db, wc_abspath, pool));
+  SVN_ERR(svn_wc__db_pristine_read_shared(&shared_stream, db, data_sha1,
+                                          pool, pool));
+  SVN_TEST_ASSERT(shared_stream != NULL);
+  SVN_ERR(svn_stream_close(shared_stream));
+
+  return svn_error_trace(svn_wc__db_close(db));
+}
+
+
+/* Create a working copy for TEST_NAME that uses the shared pristine store
+   at STORE_ABSPATH.  Set *WC_ABSPATH to its path and *DB to its DB. */
+static svn_error_t *
+create_wc_with_shared_store(const char **wc_abspath,
+                            svn_wc__db_t **db,
+                            const char *test_name,
+                            const char *store_abspath,
+                            const svn_test_opts_t *opts,
+                            apr_pool_t *pool)
+{
+  svn_config_t *config;
+
+  SVN_ERR(create_repos_and_wc(wc_abspath, db, test_name, opts, pool));
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE, store_abspath);
+  SVN_ERR(svn_wc__db_open(db, config, FALSE, TRUE, pool, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Install DATA as a pristine text in the working copy WC_ABSPATH of DB.
+   Set *SHA1 to its checksum and *PRISTINE_ABSPATH to its location. */
+static svn_error_t *
+install_text(svn_checksum_t **sha1,
+             const char **pristine_abspath,
+             svn_wc__db_t *db,
+             const char *wc_abspath,
+             const char *data,
+             apr_pool_t *pool)
+{
+  svn_wc__db_install_data_t *install_data;
+  svn_stream_t *stream;
+  svn_checksum_t *md5;
+  apr_size_t sz = strlen(data);
+
+  SVN_ERR(svn_wc__db_pristine_prepare_install(&stream, &install_data,
+                                              sha1, &md5, db, wc_abspath,
+                                              pool, pool));
+  SVN_ERR(svn_stream_write(stream, data, &sz));
+  SVN_ERR(svn_stream_close(stream));
+  SVN_ERR(svn_wc__db_pristine_install(install_data, *sha1, md5, pool));
+
+  return svn_error_trace(svn_wc__db_pristine_get_future_path(
+                           pristine_abspath, wc_abspath, *sha1,
+                           pool, pool));
+}
+
+/* Return where the shared pristine store STORE_ABSPATH keeps the text
+   that a working copy keeps at PRISTINE_ABSPATH.  Both use the same
+   layout. */
+static const char *
+shared_text_path(const char *store_abspath,
+                 const char *pristine_abspath,
+                 apr_pool_t *pool)
+{
+  const char *subdir = svn_dirent_basename(svn_dirent_dirname(
+                                             pristine_abspath, pool),
+                                           pool);
+
+  return svn_dirent_join_many(pool, store_abspath, subdir,
+                              svn_dirent_basename(pristine_abspath, pool),
+                              SVN_VA_NULL);
+}
+
+/* Verify that STREAM, which may not be NULL, yields DATA. */
+static svn_error_t *
+check_text(svn_stream_t *stream,
+           const char *data,
+           apr_pool_t *pool)
+{
+  svn_boolean_t same;
+
+  SVN_TEST_ASSERT(stream != NULL);
+  SVN_ERR(svn_stream_contents_same2(&same, stream,
+                                    svn_stream_from_string(
+                                      svn_string_create(data, pool), pool),
+                                    pool));
+  SVN_TEST_ASSERT(same);
+
+  return SVN_NO_ERROR;
+}
+
+/* Test that a second working copy links to a text that the first one put
+   into the shared pristine store. */
+static svn_error_t *
+pristine_shared_store_link(const svn_test_opts_t *opts,
+                           apr_pool_t *pool)
+{
+  const char data[] = "Linked blah";
+  const char *store_abspath;
+  const char *wc1_abspath, *wc2_abspath;
+  svn_wc__db_t *db1, *db2;
+  const char *pristine1_abspath, *pristine2_abspath;
+  const char *shared_abspath;
+  svn_checksum_t *sha1;
+  svn_stream_t *stream;
+  apr_finfo_t shared_finfo, pristine_finfo;
+
+  SVN_ERR(svn_dirent_get_absolute(&store_abspath,
+                                  "pristine_shared_store_link-pristines",
+                                  pool));
+  SVN_ERR(svn_io_remove_dir2(store_abspath, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(store_abspath);
+
+  SVN_ERR(create_wc_with_shared_store(&wc1_abspath, &db1,
+                                      "pristine_shared_store_link-1",
+                                      store_abspath, opts, pool));
+  SVN_ERR(create_wc_with_shared_store(&wc2_abspath, &db2,
+                                      "pristine_shared_store_link-2",
+                                      store_abspath, opts, pool));
+
+  /* The first working copy publishes the text. */
+  SVN_ERR(install_text(&sha1, &pristine1_abspath, db1, wc1_abspath, data,
+                       pool));
+  SVN_ERR(svn_wc__db_pristine_read_shared(&stream, db1, sha1, pool, pool));
+  SVN_ERR(check_text(stream, data, pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  shared_abspath = shared_text_path(store_abspath, pristine1_abspath, pool);
+  SVN_ERR(svn_io_stat(&shared_finfo, shared_abspath, APR_FINFO_NLINK, pool));
+  if (shared_finfo.nlink == 1)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "No hard links in the test directory");
+
+  /* The second one links to it instead of storing another copy. */
+  SVN_ERR(install_text(&sha1, &pristine2_abspath, db2, wc2_abspath, data,
+                       pool));
+  SVN_ERR(svn_io_stat(&shared_finfo, shared_abspath,
+                      APR_FINFO_NLINK | APR_FINFO_IDENT, pool));
+  SVN_ERR(svn_io_stat(&pristine_finfo, pristine2_abspath, APR_FINFO_IDENT,
+                      pool));
+  SVN_TEST_ASSERT(shared_finfo.nlink == 3);
+  SVN_TEST_ASSERT(shared_finfo.inode == pristine_finfo.inode);
+  SVN_TEST_ASSERT(shared_finfo.device == pristine_finfo.device);
+
+  SVN_ERR(svn_wc__db_pristine_read(&stream, NULL, db2, wc2_abspath, sha1,
+                                   pool, pool));
+  SVN_ERR(check_text(stream, data, pool));
+
+  SVN_ERR(svn_wc__db_close(db1));
+  return svn_error_trace(svn_wc__db_close(db2));
+}
+
+/* Test that corrupt texts in the shared pristine store are neither read
+   nor linked to. */
+static svn_error_t *
+pristine_shared_store_corrupt(const svn_test_opts_t *opts,
+                              apr_pool_t *pool)
+{
+  const char data[] = "Correct blah";
+  const char corrupt[] = "Corrupt blah";
+  const char *store_abspath;
+  const char *wc1_abspath, *wc2_abspath;
+  svn_wc__db_t *db1, *db2;
+  const char *pristine1_abspath, *pristine2_abspath;
+  const char *shared_abspath;
+  svn_checksum_t *sha1;
+  svn_stream_t *stream;
+  svn_node_kind_t kind;
+
+  SVN_ERR(svn_dirent_get_absolute(&store_abspath,
+                                  "pristine_shared_store_corrupt-pristines",
+                                  pool));
+  SVN_ERR(svn_io_remove_dir2(store_abspath, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(store_abspath);
+
+  SVN_ERR(create_wc_with_shared_store(&wc1_abspath, &db1,
+                                      "pristine_shared_store_corrupt-1",
+                                      store_abspath, opts, pool));
+  SVN_ERR(create_wc_with_shared_store(&wc2_abspath, &db2,
+                                      "pristine_shared_store_corrupt-2",
+                                      store_abspath, opts, pool));
+
+  SVN_ERR(install_text(&sha1, &pristine1_abspath, db1, wc1_abspath, data,
+                       pool));
+  shared_abspath = shared_text_path(store_abspath, pristine1_abspath, pool);
+
+  /* Replace the shared text by one of the same size. */
+  SVN_ERR(svn_io_remove_file2(shared_abspath, FALSE, pool));
+  SVN_ERR(svn_io_write_atomic(shared_abspath, corrupt, strlen(corrupt),
+                              NULL, pool));
+
+  /* It doesn't get read, but dropped. */
+  SVN_ERR(svn_wc__db_pristine_read_shared(&stream, db2, sha1, pool, pool));
+  SVN_TEST_ASSERT(stream == NULL);
+  SVN_ERR(svn_io_check_path(shared_abspath, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  /* Installing the text doesn't link to a corrupt copy, but replaces it
+     with the correct one. */
+  SVN_ERR(svn_io_write_atomic(shared_abspath, corrupt, strlen(corrupt),
+                              NULL, pool));
+  SVN_ERR(install_text(&sha1, &pristine2_abspath, db2, wc2_abspath, data,
+                       pool));
+  SVN_ERR(svn_wc__db_pristine_read(&stream, NULL, db2, wc2_abspath, sha1,
+                                   pool, pool));
+  SVN_ERR(check_text(stream, data, pool));
+  SVN_ERR(svn_wc__db_pristine_read_shared(&stream, db1, sha1, pool, pool));
+  SVN_ERR(check_text(stream, data, pool));
+
+  /* The first working copy still has its own correct text. */
+  SVN_ERR(svn_wc__db_pristine_read(&stream, NULL, db1, wc1_abspath, sha1,
+                                   pool, pool));
+  SVN_ERR(check_text(stream, data, pool));
+
+  SVN_ERR(svn_wc__db_close(db1));
+  return svn_error_trace(svn_wc__db_close(db2));
+}
+
 
 static int max_threads = -1;
 
@@ -318,6 +607,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pristine_delete_while_open"),
     SVN_TEST_OPTS_PASS(reject_mismatching_text,
                        "reject_mismatching_text"),
+    SVN_TEST_OPTS_PASS(pristine_shared_store,
+                       "pristine_shared_store"),
+    SVN_TEST_OPTS_PASS(pristine_shared_store_link,
+                       "pristine_shared_store_link"),
+    SVN_TEST_OPTS_PASS(pristine_shared_store_corrupt,
+                       "pristine_shared_store_corrupt"),
     SVN_TEST_NULL
   };
 
@@ -21,13 +21,17 @@
  * ====================================================================
  */
 
+#include <string.h>
+
 #include <apr_pools.h>
 #include <apr_general.h>
 #include <apr_md5.h>
+#include <apr_thread_proc.h>
 
 #define SVN_DEPRECATED
 
 #include "svn_types.h"
+#include "svn_config.h"
 #include "svn_io.h"
 #include "svn_dirent_uri.h"
 #include "svn_pools.h"
@@ -35,14 +39,19 @@
 #include "svn_wc.h"
 #include "svn_client.h"
 #include "svn_hash.h"
+#include "svn_delta.h"
+#include "svn_props.h"
 
 #include "utils.h"
 
 #include "private/svn_wc_private.h"
 #include "private/svn_sqlite.h"
+#include "private/svn_skel.h"
 #include "private/svn_dep_compat.h"
 #include "../../libsvn_wc/wc.h"
 #include "../../libsvn_wc/wc_db.h"
+#include "../../libsvn_wc/workqueue.h"
+#include "../../libsvn_wc/change_journal.h"
 #define SVN_WC__I_AM_WC_DB
 #include "../../libsvn_wc/wc_db_private.h"
 
@@ -434,6 +443,539 @@ test_legacy_commit2(const svn_test_opts_t *opts, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_install_batch_failure(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  svn_test__sandbox_t b;
+  const char *paths[] = { "iota", "A/mu", "A/B/lambda", "A/D/gamma", NULL };
+  svn_config_t *config;
+  svn_wc_context_t *wc_ctx;
+  svn_wc__db_t *db;
+  const char *wcroot_abspath;
+  const svn_checksum_t *checksum;
+  const char *pristine_abspath;
+  apr_uint64_t id;
+  svn_skel_t *work_item;
+  apr_array_header_t *ids;
+  apr_array_header_t *work_items;
+  svn_node_kind_t kind;
+  int i;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "install_batch_failure", opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+
+  /* Use a context that installs files on multiple threads. */
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_INSTALL_THREADS, "4");
+  SVN_ERR(svn_wc_context_create(&wc_ctx, config, pool, pool));
+  db = wc_ctx->db;
+
+  /* Queue the installation of a few files, the second of which fails
+     because its pristine text is missing. */
+  SVN_ERR(svn_wc__db_read_node_install_info(&wcroot_abspath, &checksum,
+                                            NULL, NULL, db,
+                                            sbox_wc_path(&b, "A/mu"),
+                                            b.wc_abspath, pool, pool));
+  SVN_ERR(svn_wc__db_pristine_get_future_path(&pristine_abspath,
+                                              wcroot_abspath, checksum,
+                                              pool, pool));
+  SVN_ERR(svn_io_remove_file2(pristine_abspath, FALSE, pool));
+
+  for (i = 0; paths[i]; ++i)
+    {
+      const char *local_abspath = sbox_wc_path(&b, paths[i]);
+
+      SVN_ERR(svn_io_remove_file2(local_abspath, FALSE, pool));
+      SVN_ERR(svn_wc__wq_build_file_install(&work_item, db, local_abspath,
+                                            NULL, FALSE, TRUE, pool, pool));
+      SVN_ERR(svn_wc__db_wq_add(db, b.wc_abspath, work_item, pool));
+    }
+
+  SVN_TEST_ASSERT_ANY_ERROR(svn_wc__wq_run(db, b.wc_abspath, NULL, NULL,
+                                           pool));
+
+  /* All other files of the batch have been installed and their items
+     completed.  Only the failed one is left in the queue. */
+  for (i = 0; paths[i]; ++i)
+    {
+      SVN_ERR(svn_io_check_path(sbox_wc_path(&b, paths[i]), &kind, pool));
+      SVN_TEST_ASSERT(kind == (i == 1 ? svn_node_none : svn_node_file));
+    }
+
+  SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db, b.wc_abspath, 0,
+                                   pool, pool));
+  SVN_TEST_ASSERT(work_item != NULL);
+  SVN_TEST_ASSERT(svn_skel__matches_atom(work_item->children->next,
+                                         "A/mu"));
+
+  SVN_ERR(svn_wc__db_wq_fetch_following(&ids, &work_items, db,
+                                        b.wc_abspath, id, 10, pool, pool));
+  SVN_TEST_ASSERT(ids->nelts == 0);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "Parallel installation requires threads");
+#endif
+}
+
+/* Create an empty directory NAME in the current directory, to be removed
+   at the end of the test run, and set *DIR_ABSPATH to its path. */
+static svn_error_t *
+make_test_dir(const char **dir_abspath,
+              const char *name,
+              apr_pool_t *pool)
+{
+  SVN_ERR(svn_dirent_get_absolute(dir_abspath, name, pool));
+  SVN_ERR(svn_io_remove_dir2(*dir_abspath, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_io_make_dir_recursively(*dir_abspath, pool));
+  svn_test_add_dir_cleanup(*dir_abspath);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *JOURNAL to the change journal of WCROOT_ABSPATH whose journal
+   file consists of ACKED, which the watcher acknowledged, followed by
+   UNACKED, and whose listings are stored in WATCH_ABSPATH. */
+static svn_error_t *
+journal_from(svn_wc__journal_t **journal,
+             const char *wcroot_abspath,
+             const char *watch_abspath,
+             const char *acked,
+             const char *unacked,
+             apr_pool_t *pool)
+{
+  svn_stringbuf_t *contents = svn_stringbuf_createf(pool, "%s%s",
+                                                    acked, unacked);
+
+  return svn_error_trace(svn_wc__journal_create(journal, wcroot_abspath,
+                                                watch_abspath, contents,
+                                                strlen(acked), pool, pool));
+}
+
+/* Verify that JOURNAL has EXPECTED as the listing of DIR_ABSPATH.  If
+   EXPECTED is NULL, verify that JOURNAL does not know that directory. */
+static svn_error_t *
+check_listing(svn_wc__journal_t *journal,
+              const char *dir_abspath,
+              apr_hash_t *expected,
+              apr_pool_t *pool)
+{
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+
+  SVN_ERR(svn_wc__journal_get_dirents(&dirents, journal, dir_abspath,
+                                      pool, pool));
+  if (!expected)
+    {
+      SVN_TEST_ASSERT(dirents == NULL);
+      return SVN_NO_ERROR;
+    }
+
+  SVN_TEST_ASSERT(dirents != NULL);
+  SVN_TEST_ASSERT(apr_hash_count(dirents) == apr_hash_count(expected));
+  for (hi = apr_hash_first(pool, expected); hi; hi = apr_hash_next(hi))
+    {
+      const svn_io_dirent2_t *want = apr_hash_this_val(hi);
+      const svn_io_dirent2_t *got = svn_hash_gets(dirents,
+                                                  apr_hash_this_key(hi));
+
+      SVN_TEST_ASSERT(got != NULL);
+      SVN_TEST_ASSERT(got->kind == want->kind);
+      SVN_TEST_ASSERT(got->special == want->special);
+      SVN_TEST_ASSERT(got->filesize == want->filesize);
+      SVN_TEST_ASSERT(got->mtime == want->mtime);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_journal_listings(apr_pool_t *pool)
+{
+  const char *acked = "E 1\nD A\nS 1\n";
+  const char *wcroot_abspath;
+  const char *watch_abspath;
+  const char *a_abspath;
+  const char *b_abspath;
+  apr_hash_t *a_dirents = apr_hash_make(pool);
+  apr_hash_t *b_dirents = apr_hash_make(pool);
+  svn_io_dirent2_t *dirent;
+  svn_wc__journal_t *journal;
+
+  SVN_ERR(make_test_dir(&wcroot_abspath, "journal_listings", pool));
+  watch_abspath = svn_dirent_join(wcroot_abspath, "watch", pool);
+  SVN_ERR(svn_io_dir_make(watch_abspath, APR_OS_DEFAULT, pool));
+  a_abspath = svn_dirent_join(wcroot_abspath, "A", pool);
+  b_abspath = svn_dirent_join(wcroot_abspath, "A/B", pool);
+
+  dirent = svn_io_dirent2_create(pool);
+  dirent->kind = svn_node_file;
+  dirent->filesize = 10;
+  dirent->mtime = apr_time_from_sec(1000000000);
+  svn_hash_sets(a_dirents, "mu", dirent);
+  dirent = svn_io_dirent2_create(pool);
+  dirent->kind = svn_node_dir;
+  svn_hash_sets(a_dirents, "B", dirent);
+  dirent = svn_io_dirent2_create(pool);
+  dirent->kind = svn_node_file;
+  dirent->special = TRUE;
+  dirent->filesize = 4;
+  dirent->mtime = 1;
+  svn_hash_sets(a_dirents, "link with spaces", dirent);
+
+  /* Remember the listings read during a first status run. */
+  SVN_ERR(journal_from(&journal, wcroot_abspath, watch_abspath, acked, "",
+                       pool));
+  SVN_TEST_ASSERT(journal != NULL);
+  SVN_ERR(check_listing(journal, a_abspath, NULL, pool));
+  SVN_ERR(svn_wc__journal_put_dirents(journal, a_abspath, a_dirents, pool));
+  SVN_ERR(svn_wc__journal_put_dirents(journal, b_abspath, b_dirents, pool));
+  SVN_ERR(svn_wc__journal_close(journal, pool));
+
+  /* They get reused.  Changes reported before they were read or not yet
+     acknowledged by the watcher don't matter. */
+  SVN_ERR(journal_from(&journal, wcroot_abspath, watch_abspath,
+                       apr_pstrcat(pool, acked, "S 2\n", SVN_VA_NULL),
+                       "D A\n", pool));
+  SVN_ERR(check_listing(journal, a_abspath, a_dirents, pool));
+  SVN_ERR(check_listing(journal, b_abspath, b_dirents, pool));
+
+  /* A change invalidates the listing of its directory only. */
+  SVN_ERR(journal_from(&journal, wcroot_abspath, watch_abspath,
+                       apr_pstrcat(pool, acked, "D A\nS 2\n", SVN_VA_NULL),
+                       "", pool));
+  SVN_ERR(check_listing(journal, a_abspath, NULL, pool));
+  SVN_ERR(check_listing(journal, b_abspath, b_dirents, pool));
+
+  /* Lost events invalidate everything ... */
+  SVN_ERR(journal_from(&journal, wcroot_abspath, watch_abspath,
+                       apr_pstrcat(pool, acked, "O\nS 2\n", SVN_VA_NULL),
+                       "", pool));
+  SVN_ERR(check_listing(journal, a_abspath, NULL, pool));
+  SVN_ERR(check_listing(journal, b_abspath, NULL, pool));
+
+  /* ... as does a new journal instance ... */
+  SVN_ERR(journal_from(&journal, wcroot_abspath, watch_abspath,
+                       "E 2\nD A\nS 1\n", "", pool));
+  SVN_ERR(check_listing(journal, a_abspath, NULL, pool));
+  SVN_ERR(check_listing(journal, b_abspath, NULL, pool));
+
+  /* ... or a journal that does not reach the offset of the listings. */
+  SVN_ERR(journal_from(&journal, wcroot_abspath, watch_abspath,
+                       "E 1\nD A\n", "", pool));
+  SVN_ERR(check_listing(journal, a_abspath, NULL, pool));
+  SVN_ERR(check_listing(journal, b_abspath, NULL, pool));
+
+  /* A journal without epoch can't be used at all. */
+  SVN_ERR(journal_from(&journal, wcroot_abspath, watch_abspath,
+                       "D A\nS 1\n", "", pool));
+  SVN_TEST_ASSERT(journal == NULL);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+/* Baton for sync_watcher_thread(). */
+typedef struct sync_watcher_baton_t
+{
+  const char *watch_abspath;
+  svn_error_t *err;
+  apr_pool_t *pool;
+} sync_watcher_baton_t;
+
+/* Thread function acting as the watcher for the sync_watcher_baton_t
+   DATA: wait for a sync request and acknowledge it in the journal. */
+static void * APR_THREAD_FUNC
+sync_watcher_thread(apr_thread_t *thread,
+                    void *data)
+{
+  sync_watcher_baton_t *b = data;
+  const char *sync_abspath = svn_dirent_join(b->watch_abspath, "sync",
+                                             b->pool);
+  const char *journal_abspath = svn_dirent_join(b->watch_abspath, "journal",
+                                                b->pool);
+  svn_stringbuf_t *token;
+  apr_file_t *file;
+  const char *line;
+  int tries = 0;
+  svn_error_t *err;
+
+  while (TRUE)
+    {
+      err = svn_stringbuf_from_file2(&token, sync_abspath, b->pool);
+      if (!err || !APR_STATUS_IS_ENOENT(err->apr_err) || ++tries == 1000)
+        break;
+
+      svn_error_clear(err);
+      apr_sleep(apr_time_from_msec(10));
+    }
+
+  if (!err)
+    err = svn_io_file_open(&file, journal_abspath, APR_WRITE | APR_APPEND,
+                           APR_OS_DEFAULT, b->pool);
+  if (!err)
+    {
+      line = apr_pstrcat(b->pool, "S ", token->data, "\n", SVN_VA_NULL);
+      err = svn_error_compose_create(
+              svn_io_file_write_full(file, line, strlen(line), NULL,
+                                     b->pool),
+              svn_io_file_close(file, b->pool));
+    }
+
+  b->err = err;
+  return NULL;
+}
+#endif
+
+static svn_error_t *
+test_journal_sync(apr_pool_t *pool)
+{
+  const char *watch_abspath;
+  const char *journal_abspath;
+  svn_stringbuf_t *contents;
+  apr_size_t sync_end;
+
+  SVN_ERR(make_test_dir(&watch_abspath, "journal_sync", pool));
+  journal_abspath = svn_dirent_join(watch_abspath, "journal", pool);
+
+  /* Without a journal, there is nothing to sync with. */
+  SVN_TEST_ASSERT_ANY_ERROR(svn_wc__journal_sync(&contents, &sync_end,
+                                                 watch_abspath,
+                                                 apr_time_from_msec(50),
+                                                 pool, pool));
+
+  /* Give up if the watcher does not acknowledge the request in time. */
+  SVN_ERR(svn_io_write_atomic(journal_abspath, "E 1\nD A\n", 8, NULL, pool));
+  SVN_ERR(svn_wc__journal_sync(&contents, &sync_end, watch_abspath,
+                               apr_time_from_msec(50), pool, pool));
+  SVN_TEST_ASSERT(contents == NULL);
+
+#if APR_HAS_THREADS
+  {
+    sync_watcher_baton_t baton = { 0 };
+    apr_thread_t *thread;
+    apr_status_t status;
+    apr_status_t retval;
+    svn_error_t *err;
+
+    /* Don't let the watcher see the request we gave up on. */
+    SVN_ERR(svn_io_remove_file2(svn_dirent_join(watch_abspath, "sync", pool),
+                                FALSE, pool));
+
+    baton.watch_abspath = watch_abspath;
+    baton.pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+    status = apr_thread_create(&thread, NULL, sync_watcher_thread, &baton,
+                               pool);
+    if (status)
+      return svn_error_wrap_apr(status, "Can't create thread");
+
+    err = svn_wc__journal_sync(&contents, &sync_end, watch_abspath,
+                               apr_time_from_sec(10), pool, pool);
+    apr_thread_join(&retval, thread);
+    svn_pool_destroy(baton.pool);
+    SVN_ERR(svn_error_compose_create(baton.err, err));
+
+    /* We get everything up to the acknowledgement. */
+    SVN_TEST_ASSERT(contents != NULL);
+    SVN_TEST_ASSERT(sync_end == contents->len);
+    SVN_TEST_ASSERT(strncmp(contents->data, "E 1\nD A\nS ", 10) == 0);
+  }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for status_to_string(). */
+typedef struct status_string_baton_t
+{
+  /* Relative to this path ... */
+  const char *wc_abspath;
+
+  /* ... add a line per reported node to this buffer. */
+  svn_stringbuf_t *output;
+
+  /* Fail once this many nodes have been reported, unless it is 0. */
+  int fail_after;
+  int reported;
+} status_string_baton_t;
+
+/* Implements svn_wc_status_func4_t.  Record LOCAL_ABSPATH and STATUS
+   in the status_string_baton_t BATON. */
+static svn_error_t *
+status_to_string(void *baton,
+                 const char *local_abspath,
+                 const svn_wc_status3_t *status,
+                 apr_pool_t *scratch_pool)
+{
+  status_string_baton_t *b = baton;
+
+  if (b->fail_after && b->reported == b->fail_after)
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  ++b->reported;
+  svn_stringbuf_appendcstr(b->output,
+                           apr_psprintf(scratch_pool, "%d %d %s\n",
+                                        status->node_status,
+                                        status->text_status,
+                                        svn_dirent_skip_ancestor(
+                                          b->wc_abspath, local_abspath)));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_status_threads(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_config_t *config;
+  svn_wc_context_t *wc_ctx;
+  status_string_baton_t expected = { 0 };
+  status_string_baton_t actual = { 0 };
+
+  SVN_ERR(svn_test__sandbox_create(&b, "status_threads", opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+  SVN_ERR(sbox_file_write(&b, "A/B/E/alpha", "modified alpha\n"));
+  SVN_ERR(sbox_file_write(&b, "A/D/H/omega", "modified omega\n"));
+  SVN_ERR(sbox_file_write(&b, "A/D/G/unversioned", "new\n"));
+  SVN_ERR(sbox_disk_mkdir(&b, "A/C/unversioned"));
+  SVN_ERR(svn_io_remove_file2(sbox_wc_path(&b, "A/D/gamma"), FALSE, pool));
+
+  expected.wc_abspath = b.wc_abspath;
+  expected.output = svn_stringbuf_create_empty(pool);
+  SVN_ERR(svn_wc_walk_status(b.wc_ctx, b.wc_abspath, svn_depth_infinity,
+                             TRUE, FALSE, FALSE, NULL,
+                             status_to_string, &expected, NULL, NULL, pool));
+
+  /* Reading directories ahead must not change what gets reported
+     or in which order. */
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_STATUS_THREADS, "4");
+  SVN_ERR(svn_wc_context_create(&wc_ctx, config, pool, pool));
+
+  actual.wc_abspath = b.wc_abspath;
+  actual.output = svn_stringbuf_create_empty(pool);
+  SVN_ERR(svn_wc_walk_status(wc_ctx, b.wc_abspath, svn_depth_infinity,
+                             TRUE, FALSE, FALSE, NULL,
+                             status_to_string, &actual, NULL, NULL, pool));
+  SVN_TEST_STRING_ASSERT(actual.output->data, expected.output->data);
+
+  /* Stop the walk while listings read ahead have not been used yet. */
+  svn_stringbuf_setempty(actual.output);
+  actual.reported = 0;
+  actual.fail_after = 3;
+  SVN_TEST_ASSERT_ERROR(svn_wc_walk_status(wc_ctx, b.wc_abspath,
+                                           svn_depth_infinity,
+                                           TRUE, FALSE, FALSE, NULL,
+                                           status_to_string, &actual,
+                                           NULL, NULL, pool),
+                        SVN_ERR_CANCELLED);
+
+  return SVN_NO_ERROR;
+}
+
+/* Add the file NAME with contents TEXT in the directory DIR_BATON of
+   EDITOR, as received from revision 1.  Unless CLOSE is FALSE, close it. */
+static svn_error_t *
+add_edited_file(const svn_delta_editor_t *editor,
+                void *dir_baton,
+                const char *name,
+                const char *text,
+                svn_boolean_t close,
+                apr_pool_t *pool)
+{
+  void *file_baton;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  SVN_ERR(editor->add_file(name, dir_baton, NULL, SVN_INVALID_REVNUM,
+                           pool, &file_baton));
+  SVN_ERR(editor->change_file_prop(file_baton, SVN_PROP_ENTRY_COMMITTED_REV,
+                                   svn_string_create("1", pool), pool));
+  SVN_ERR(editor->change_file_prop(file_baton, SVN_PROP_ENTRY_COMMITTED_DATE,
+                                   svn_string_create(
+                                     "2000-01-01T00:00:00.000000Z", pool),
+                                   pool));
+  SVN_ERR(editor->change_file_prop(file_baton, SVN_PROP_ENTRY_LAST_AUTHOR,
+                                   svn_string_create("jrandom", pool), pool));
+  SVN_ERR(editor->apply_textdelta(file_baton, NULL, pool,
+                                  &handler, &handler_baton));
+  SVN_ERR(svn_txdelta_send_string(svn_string_create(text, pool),
+                                  handler, handler_baton, pool));
+  if (close)
+    SVN_ERR(editor->close_file(file_baton, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_aborted_update_edit(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  const char *closed[] = { "alpha", "beta", "gamma", NULL };
+  apr_pool_t *edit_pool = svn_pool_create(pool);
+  const svn_delta_editor_t *editor;
+  void *edit_baton;
+  void *root_baton;
+  svn_revnum_t target_revision;
+  svn_revnum_t revision;
+  svn_node_kind_t kind;
+  int i;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "aborted_update_edit", opts, pool));
+  SVN_ERR(svn_wc__acquire_write_lock(NULL, b.wc_ctx, b.wc_abspath, FALSE,
+                                     pool, pool));
+
+  SVN_ERR(svn_wc__get_update_editor(&editor, &edit_baton, &target_revision,
+                                    b.wc_ctx, b.wc_abspath, "", NULL,
+                                    FALSE, svn_depth_infinity, FALSE,
+                                    FALSE, FALSE, FALSE, FALSE,
+                                    NULL, NULL, NULL, NULL, NULL, NULL,
+                                    NULL, NULL, NULL, NULL, NULL, NULL,
+                                    edit_pool, pool));
+
+  /* Receive a few files, which the editor keeps in its batch until the
+     root directory gets closed, and start receiving another one. */
+  SVN_ERR(editor->set_target_revision(edit_baton, 1, edit_pool));
+  SVN_ERR(editor->open_root(edit_baton, 0, edit_pool, &root_baton));
+  for (i = 0; closed[i]; ++i)
+    SVN_ERR(add_edited_file(editor, root_baton, closed[i], "text\n", TRUE,
+                            edit_pool));
+  SVN_ERR(add_edited_file(editor, root_baton, "delta", "text\n", FALSE,
+                          edit_pool));
+
+  /* Abort the edit without closing anything. */
+  svn_pool_destroy(edit_pool);
+
+  /* The files that were completely received are in BASE and on disk. */
+  for (i = 0; closed[i]; ++i)
+    {
+      const char *local_abspath = sbox_wc_path(&b, closed[i]);
+
+      SVN_ERR(svn_wc__node_get_base(&kind, &revision, NULL, NULL, NULL,
+                                    NULL, b.wc_ctx, local_abspath, TRUE,
+                                    pool, pool));
+      SVN_TEST_ASSERT(kind == svn_node_file);
+      SVN_TEST_ASSERT(revision == 1);
+
+      SVN_ERR(svn_io_check_path(local_abspath, &kind, pool));
+      SVN_TEST_ASSERT(kind == svn_node_file);
+    }
+
+  /* The file that was not closed is not. */
+  SVN_ERR(svn_wc__node_get_base(&kind, &revision, NULL, NULL, NULL, NULL,
+                                b.wc_ctx, sbox_wc_path(&b, "delta"), TRUE,
+                                pool, pool));
+  SVN_TEST_ASSERT(!SVN_IS_VALID_REVNUM(revision));
+
+  SVN_ERR(svn_wc__release_write_lock(b.wc_ctx, b.wc_abspath, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* ---------------------------------------------------------------------- */
 /* The list of test functions */
 
@@ -454,6 +996,16 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test legacy commit1"),
     SVN_TEST_OPTS_PASS(test_legacy_commit2,
                        "test legacy commit2"),
+    SVN_TEST_OPTS_PASS(test_install_batch_failure,
+                       "failure in the middle of an install batch"),
+    SVN_TEST_PASS2(test_journal_listings,
+                   "reuse and invalidate journal listings"),
+    SVN_TEST_PASS2(test_journal_sync,
+                   "sync with the change journal watcher"),
+    SVN_TEST_OPTS_PASS(test_status_threads,
+                       "status reading directories on multiple threads"),
+    SVN_TEST_OPTS_PASS(test_aborted_update_edit,
+                       "abort an update edit with batched files"),
     SVN_TEST_NULL
   };
 